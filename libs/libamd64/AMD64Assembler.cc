@@ -623,6 +623,44 @@ string AMD64Assembler::generate_rm(Operation op, const MemoryReference& mem,
       extra_prefixes, skip_64bit_prefix);
 }
 
+string AMD64Assembler::generate_vex_rm(Operation op, const MemoryReference& mem,
+    Register reg, Register vvvv, uint8_t pp, bool w) {
+  uint32_t opcode = static_cast<uint32_t>(op);
+  uint8_t map_select;
+  if ((opcode >> 8) == 0x0F) {
+    map_select = 1;
+  } else if ((opcode >> 8) == 0x0F38) {
+    map_select = 2;
+  } else if ((opcode >> 8) == 0x0F3A) {
+    map_select = 3;
+  } else {
+    throw invalid_argument("opcode cannot be VEX-encoded");
+  }
+  if ((opcode & 0xF0) == 0x40) {
+    throw invalid_argument("VEX opcode would be confused with a REX prefix");
+  }
+
+  // generate the legacy encoding with a one-byte opcode, then move the REX bits
+  // (if any) into the VEX prefix. VEX stores R, X, and B inverted
+  string legacy = AMD64Assembler::generate_rm(
+      static_cast<Operation>(opcode & 0xFF), mem, reg,
+      OperandSize::DoublePrecision, 0, true);
+  uint8_t rex = 0x40;
+  size_t legacy_start = 0;
+  if ((legacy[0] & 0xF0) == 0x40) {
+    rex = legacy[0];
+    legacy_start = 1;
+  }
+
+  string ret;
+  ret += 0xC4;
+  ret += ((rex & 0x04) ? 0x00 : 0x80) | ((rex & 0x02) ? 0x00 : 0x40) |
+      ((rex & 0x01) ? 0x00 : 0x20) | map_select;
+  ret += (w ? 0x80 : 0x00) | ((~vvvv & 0x0F) << 3) | (pp & 3);
+  ret += legacy.substr(legacy_start);
+  return ret;
+}
+
 void AMD64Assembler::write_rm(Operation op, const MemoryReference& mem,
     Register reg, OperandSize size, uint32_t extra_prefixes,
     bool skip_64bit_prefix) {
@@ -1093,6 +1131,10 @@ void AMD64Assembler::write_cmpordsd(Register to, const MemoryReference& from) {
   this->write_cmpsd(to, from, 7);
 }
 
+void AMD64Assembler::write_ucomisd(Register a, const MemoryReference& b) {
+  this->write_rm(Operation::UCOMISD, b, a, OperandSize::DoublePrecision, 0x66);
+}
+
 void AMD64Assembler::write_roundsd(Register to, const MemoryReference& from,
     uint8_t mode) {
   string data = this->generate_rm(Operation::ROUNDSD, from, to,
@@ -1110,11 +1152,79 @@ void AMD64Assembler::write_cvtsd2si(Register to, Register from) {
       OperandSize::QuadWord, 0xF2);
 }
 
+void AMD64Assembler::write_vfmadd213sd(Register to, Register multiplier,
+    const MemoryReference& addend) {
+  this->write(this->generate_vex_rm(Operation::VFMADD213SD, addend, to,
+      multiplier, 1, true));
+}
+
+void AMD64Assembler::write_vfmsub213sd(Register to, Register multiplier,
+    const MemoryReference& addend) {
+  this->write(this->generate_vex_rm(Operation::VFMSUB213SD, addend, to,
+      multiplier, 1, true));
+}
+
+void AMD64Assembler::write_vfnmadd213sd(Register to, Register multiplier,
+    const MemoryReference& addend) {
+  this->write(this->generate_vex_rm(Operation::VFNMADD213SD, addend, to,
+      multiplier, 1, true));
+}
+
+void AMD64Assembler::write_punpcklqdq(Register to, const MemoryReference& from) {
+  this->write_rm(Operation::PUNPCKLQDQ, from, to, OperandSize::DoublePrecision,
+      0x66);
+}
+
+void AMD64Assembler::write_pcmpeqb(Register to, const MemoryReference& from) {
+  this->write_rm(Operation::PCMPEQB, from, to, OperandSize::DoublePrecision,
+      0x66);
+}
+
+void AMD64Assembler::write_pmovmskb(Register to, Register from) {
+  this->write_rm(Operation::PMOVMSKB, MemoryReference(from), to,
+      OperandSize::DoubleWord, 0x66);
+}
+
 void AMD64Assembler::write_nop() {
   static string nop("\x90", 1);
   this->write(nop);
 }
 
+string AMD64Assembler::generate_nops(size_t size) {
+  // these are the recommended multi-byte nop forms from the intel and amd
+  // optimization manuals. they decode as a single instruction each, so they're
+  // much cheaper than a string of 0x90s
+  static const string nops[10] = {
+    string(),
+    string("\x90", 1),
+    string("\x66\x90", 2),
+    string("\x0F\x1F\x00", 3),
+    string("\x0F\x1F\x40\x00", 4),
+    string("\x0F\x1F\x44\x00\x00", 5),
+    string("\x66\x0F\x1F\x44\x00\x00", 6),
+    string("\x0F\x1F\x80\x00\x00\x00\x00", 7),
+    string("\x0F\x1F\x84\x00\x00\x00\x00\x00", 8),
+    string("\x66\x0F\x1F\x84\x00\x00\x00\x00\x00", 9),
+  };
+
+  string ret;
+  while (size > 9) {
+    ret += nops[9];
+    size -= 9;
+  }
+  ret += nops[size];
+  return ret;
+}
+
+void AMD64Assembler::write_align(uint8_t alignment, uint8_t max_padding) {
+  if (!alignment || (alignment & (alignment - 1))) {
+    throw invalid_argument("alignment must be a power of 2");
+  }
+  this->stream.emplace_back(string());
+  this->stream.back().alignment = alignment;
+  this->stream.back().max_padding = max_padding;
+}
+
 void AMD64Assembler::write_jmp(const string& label_name) {
   this->stream.emplace_back(label_name, Operation::JMP8, Operation::JMP32);
 }
@@ -1607,6 +1717,14 @@ void AMD64Assembler::write_imul(const MemoryReference& mem, OperandSize size) {
   this->write_rm(op, mem, 5, size);
 }
 
+void AMD64Assembler::write_bsf(Register to, const MemoryReference& from,
+    OperandSize size) {
+  if (size == OperandSize::Byte) {
+    throw invalid_argument("bsf requires at least halfword operand size");
+  }
+  this->write_rm(Operation::BSF, from, to, size);
+}
+
 void AMD64Assembler::write_div(const MemoryReference& mem, OperandSize size) {
   Operation op = (size == OperandSize::Byte) ? Operation::NOT_NEG8 : Operation::NOT_NEG32;
   this->write_rm(op, mem, 6, size);
@@ -1903,6 +2021,10 @@ string AMD64Assembler::assemble(unordered_set<size_t>* patch_offsets,
             if (where_it->is_jump_call()) {
               // assume it's a 32-bit jump
               max_displacement += 5 + (where_it->op32 > 0xFF);
+            } else if (where_it->alignment) {
+              // assume the alignment needs as much padding as it's allowed
+              max_displacement += min<int64_t>(where_it->alignment - 1,
+                  where_it->max_padding);
             } else {
               max_displacement += where_it->data.size();
             }
@@ -1923,6 +2045,16 @@ string AMD64Assembler::assemble(unordered_set<size_t>* patch_offsets,
         }
       }
 
+    // this item is an alignment directive; pad with nops if the padding
+    // doesn't exceed the item's limit. alignment is relative to base_address
+    // (if given) or the start of the code, which CodeBuffer aligns
+    } else if (item.alignment) {
+      size_t padding = (item.alignment - ((base_address + code.size()) %
+          item.alignment)) % item.alignment;
+      if (padding <= item.max_padding) {
+        code += this->generate_nops(padding);
+      }
+
     // this item is not a jump opcode; stick it in the buffer
     } else {
       code += item.data;
@@ -1981,16 +2113,18 @@ string AMD64Assembler::assemble(unordered_set<size_t>* patch_offsets,
 
 AMD64Assembler::StreamItem::StreamItem(const string& data) : data(data),
     op8(Operation::NOP), op32(Operation::NOP), absolute_target(0),
-    patch(0, 0, false) { }
+    patch(0, 0, false), alignment(0), max_padding(0) { }
 
 AMD64Assembler::StreamItem::StreamItem(const string& data,
     const string& patch_label_name, size_t where, uint8_t size, bool absolute) :
     data(data), op8(Operation::NOP), op32(Operation::NOP), absolute_target(0),
-    patch_label_name(patch_label_name), patch(where, size, absolute) { }
+    patch_label_name(patch_label_name), patch(where, size, absolute),
+    alignment(0), max_padding(0) { }
 
 AMD64Assembler::StreamItem::StreamItem(const string& data, Operation op8,
     Operation op32, int64_t absolute_target) : data(data), op8(op8),
-    op32(op32), absolute_target(absolute_target), patch(0, 0, false) { }
+    op32(op32), absolute_target(absolute_target), patch(0, 0, false),
+    alignment(0), max_padding(0) { }
 
 string AMD64Assembler::StreamItem::str() const {
   string data_str;
@@ -2002,9 +2136,11 @@ string AMD64Assembler::StreamItem::str() const {
 
   string patch_str = this->patch.str();
   return string_printf("StreamItem(data=[%s], op8=%02X, op32=%02X, "
-      "absolute_target=0x%" PRIX64 ", patch_label_name=%s, patch=%s)",
+      "absolute_target=0x%" PRIX64 ", patch_label_name=%s, patch=%s, "
+      "alignment=%hhu, max_padding=%hhu)",
       data_str.c_str(), this->op8, this->op32, this->absolute_target,
-      this->patch_label_name.c_str(), patch_str.c_str());
+      this->patch_label_name.c_str(), patch_str.c_str(), this->alignment,
+      this->max_padding);
 }
 
 bool AMD64Assembler::StreamItem::is_jump_call() const {
@@ -2106,6 +2242,11 @@ string AMD64Assembler::disassemble(const void* vdata, size_t size,
         if (opcode == 0x05) {
           opcode_text = "syscall";
 
+        } else if (opcode == 0x1F) {
+          opcode_text = AMD64Assembler::disassemble_rm(data, size, offset,
+              "nop", false, nullptr, ext, reg_ext, base_ext, index_ext,
+              operand_size);
+
         } else if ((opcode & 0xFE) == 0x10) {
           if (!xmm_prefix) {
             opcode_text = "<<unknown-0F-non-xmm>>";
@@ -2133,6 +2274,15 @@ string AMD64Assembler::disassemble(const void* vdata, size_t size,
                 OperandSize::DoublePrecision);
           }
 
+        } else if (opcode == 0x2E) {
+          if (operand_size != OperandSize::Word) {
+            opcode_text = "<<unknown-0F-2E-non-66>>";
+          } else {
+            opcode_text = AMD64Assembler::disassemble_rm(data, size, offset,
+                "ucomisd", true, nullptr, ext, reg_ext, base_ext, index_ext,
+                OperandSize::DoublePrecision);
+          }
+
         } else if (opcode == 0x3A) {
           if (xmm_prefix) {
             opcode_text = "<<unknown-0F-3A-xmm>>";
@@ -2183,6 +2333,24 @@ string AMD64Assembler::disassemble(const void* vdata, size_t size,
               names[opcode & 0x0F], true, nullptr, ext, reg_ext, base_ext,
               index_ext, operand_size);
 
+        } else if (opcode == 0x6C) {
+          if (operand_size != OperandSize::Word) {
+            opcode_text = "<<unknown-0F-6C-non-66>>";
+          } else {
+            opcode_text = AMD64Assembler::disassemble_rm(data, size, offset,
+                "punpcklqdq", true, nullptr, ext, reg_ext, base_ext, index_ext,
+                OperandSize::DoublePrecision);
+          }
+
+        } else if (opcode == 0x74) {
+          if (operand_size != OperandSize::Word) {
+            opcode_text = "<<unknown-0F-74-non-66>>";
+          } else {
+            opcode_text = AMD64Assembler::disassemble_rm(data, size, offset,
+                "pcmpeqb", true, nullptr, ext, reg_ext, base_ext, index_ext,
+                OperandSize::DoublePrecision);
+          }
+
         } else if (opcode == 0x6E) {
           opcode_text = AMD64Assembler::disassemble_rm(data, size, offset,
               "movq", true, nullptr, ext, reg_ext, base_ext,
@@ -2218,6 +2386,20 @@ string AMD64Assembler::disassemble(const void* vdata, size_t size,
               "movzx", true, nullptr, ext, reg_ext, base_ext, index_ext,
               operand_size, (opcode & 1) ? OperandSize::Word : OperandSize::Byte);
 
+        } else if (opcode == 0xBC) {
+          opcode_text = AMD64Assembler::disassemble_rm(data, size, offset,
+              "bsf", true, nullptr, ext, reg_ext, base_ext, index_ext,
+              operand_size);
+
+        } else if (opcode == 0xD7) {
+          if (operand_size != OperandSize::Word) {
+            opcode_text = "<<unknown-0F-D7-non-66>>";
+          } else {
+            opcode_text = AMD64Assembler::disassemble_rm(data, size, offset,
+                "pmovmskb", true, nullptr, ext, reg_ext, base_ext, index_ext,
+                OperandSize::DoubleWord, OperandSize::DoublePrecision);
+          }
+
         } else if (opcode == 0xC2) {
           if (!xmm_prefix) {
             opcode_text = "<<unknown-0F-C2-non-xmm>>";
@@ -2384,6 +2566,46 @@ string AMD64Assembler::disassemble(const void* vdata, size_t size,
     } else if (opcode == 0xC3) {
       opcode_text = "ret";
 
+    } else if (opcode == 0xC4) {
+      if (offset + 3 > size) {
+        opcode_text = "<<incomplete-vex>>";
+        offset = size;
+      } else {
+        uint8_t vex_map = data[offset];
+        uint8_t vex_flags = data[offset + 1];
+        uint8_t vex_opcode = data[offset + 2];
+        offset += 3;
+        reg_ext = !(vex_map & 0x80);
+        index_ext = !(vex_map & 0x40);
+        base_ext = !(vex_map & 0x20);
+        Register vvvv = static_cast<Register>((~vex_flags >> 3) & 0x0F);
+
+        const char* name = nullptr;
+        if (((vex_map & 0x1F) == 2) && ((vex_flags & 0x83) == 0x81)) {
+          if (vex_opcode == 0xA9) {
+            name = "vfmadd213sd";
+          } else if (vex_opcode == 0xAB) {
+            name = "vfmsub213sd";
+          } else if (vex_opcode == 0xAD) {
+            name = "vfnmadd213sd";
+          }
+        }
+
+        if (!name) {
+          opcode_text = string_printf("<<unknown-vex-%02hhX-%02hhX-%02hhX>>",
+              vex_map, vex_flags, vex_opcode);
+        } else {
+          opcode_text = AMD64Assembler::disassemble_rm(data, size, offset,
+              name, true, nullptr, false, reg_ext, base_ext, index_ext,
+              OperandSize::DoublePrecision);
+          size_t comma_offset = opcode_text.find(',');
+          if (comma_offset != string::npos) {
+            opcode_text.insert(comma_offset, string(", ") +
+                name_for_register(vvvv, OperandSize::DoublePrecision));
+          }
+        }
+      }
+
     } else if ((opcode & 0xFE) == 0xC6) {
       if (!(opcode & 1)) {
         operand_size = OperandSize::Byte;
@@ -132,6 +132,7 @@ enum Operation {
 
   CVTSI2SD   = 0x0F2A,
   CVTSD2SI   = 0x0F2C,
+  UCOMISD    = 0x0F2E,
   ROUNDSD    = 0x0F3A0B,
 
   CMOVO      = 0x0F40,
@@ -165,7 +166,9 @@ enum Operation {
   CMOVNLE    = 0x0F4F,
   CMOVG      = 0x0F4F,
 
+  PUNPCKLQDQ = 0x0F6C,
   MOVQ_TO_XMM   = 0x0F6E,
+  PCMPEQB    = 0x0F74,
   MOVQ_FROM_XMM = 0x0F7E,
   JO         = 0x0F80,
   JNO        = 0x0F81,
@@ -238,7 +241,12 @@ enum Operation {
   MAXSD      = 0x0F5F,
   MOVZX8     = 0x0FB6,
   MOVZX16    = 0x0FB7,
+  BSF        = 0x0FBC,
   CMPSD      = 0x0FC2,
+  PMOVMSKB   = 0x0FD7,
+  VFMADD213SD  = 0x0F38A9,
+  VFMSUB213SD  = 0x0F38AB,
+  VFNMADD213SD = 0x0F38AD,
 };
 
 
@@ -545,12 +553,30 @@ public:
   void write_cmpnltsd(Register to, const MemoryReference& from);
   void write_cmpnlesd(Register to, const MemoryReference& from);
   void write_cmpordsd(Register to, const MemoryReference& from);
+  void write_ucomisd(Register a, const MemoryReference& b);
   void write_roundsd(Register to, const MemoryReference& from, uint8_t mode);
   void write_cvtsi2sd(Register to, const MemoryReference& from);
   void write_cvtsd2si(Register to, Register from);
+  // these compute to = (multiplier * to) +/- addend with a single rounding
+  // step. they're VEX-encoded and require a CPU that supports FMA3
+  void write_vfmadd213sd(Register to, Register multiplier,
+      const MemoryReference& addend);
+  void write_vfmsub213sd(Register to, Register multiplier,
+      const MemoryReference& addend);
+  void write_vfnmadd213sd(Register to, Register multiplier,
+      const MemoryReference& addend);
+  // packed integer opcodes. these operate on all 16 bytes of the xmm register;
+  // memory operands for pcmpeqb and punpcklqdq must be 16-byte aligned
+  void write_punpcklqdq(Register to, const MemoryReference& from);
+  void write_pcmpeqb(Register to, const MemoryReference& from);
+  void write_pmovmskb(Register to, Register from);
 
   // control flow opcodes
   void write_nop();
+  // pads the code with multi-byte nops so the next opcode begins at a multiple
+  // of alignment (which must be a power of 2). if more than max_padding bytes
+  // would be needed, writes nothing instead
+  void write_align(uint8_t alignment, uint8_t max_padding = 0xFF);
   void write_jmp(const std::string& label_name);
   void write_jmp(const MemoryReference& mem);
   void write_jmp_abs(const void* addr);
@@ -669,6 +695,9 @@ public:
       OperandSize size = OperandSize::QuadWord);
   void write_idiv(const MemoryReference& mem,
       OperandSize size = OperandSize::QuadWord);
+  // the result is undefined if the source is zero
+  void write_bsf(Register to, const MemoryReference& from,
+      OperandSize size = OperandSize::QuadWord);
 
   // comparison opcodes
   void write_cmp(const MemoryReference& to, const MemoryReference& from,
@@ -714,6 +743,7 @@ public:
   void write_lock();
 
 private:
+  static std::string generate_nops(size_t size);
   static std::string generate_jmp(Operation op8, Operation op32,
       int64_t opcode_address, int64_t target_address, OperandSize* offset_size = nullptr);
   static std::string generate_absolute_jmp_position_independent(Operation op8,
@@ -724,6 +754,8 @@ private:
   static std::string generate_rm(Operation op, const MemoryReference& mem,
       uint8_t z, OperandSize size, uint32_t extra_prefixes = 0,
       bool skip_64bit_prefix = false);
+  static std::string generate_vex_rm(Operation op, const MemoryReference& mem,
+      Register reg, Register vvvv, uint8_t pp, bool w);
   void write_rm(Operation op, const MemoryReference& mem, Register reg,
       OperandSize size, uint32_t extra_prefixes = 0,
       bool skip_64bit_prefix = false);
@@ -766,6 +798,11 @@ private:
     std::string patch_label_name; // blank for no patch
     Patch patch; // relative to start of data string
 
+    // alignment directive. if nonzero, data is empty and the padding is
+    // computed during assembly
+    uint8_t alignment;
+    uint8_t max_padding;
+
     StreamItem(const std::string& data);
     StreamItem(const std::string& data, const std::string& patch_label_name,
         size_t where, uint8_t size, bool absolute);
@@ -410,6 +410,158 @@ void test_float_neg() {
 }
 
 
+void test_float_fma() {
+  printf("-- floating fused multiply-add\n");
+
+  AMD64Assembler as;
+  CodeBuffer code;
+
+  as.write_movsd(xmm9, xmm1);
+  as.write_vfmadd213sd(xmm0, xmm9, xmm2);
+  as.write_vfmsub213sd(xmm0, xmm1, MemoryReference(rdi, 0));
+  as.write_vfnmadd213sd(xmm0, xmm9, MemoryReference(rdi, 8));
+  as.write_ret();
+
+  const char* expected_disassembly = "\
+0000000000000000   F2 41 0F 11 C9                  movsd    xmm9, xmm1\n\
+0000000000000005   C4 E2 B1 A9 C2                  vfmadd213sd xmm0, xmm9, xmm2\n\
+000000000000000A   C4 E2 F1 AB 07                  vfmsub213sd xmm0, xmm1, [rdi]\n\
+000000000000000F   C4 E2 B1 AD 47 08               vfnmadd213sd xmm0, xmm9, [rdi + 0x8]\n\
+0000000000000015   C3                              ret\n";
+  void* function = assemble(code, as, expected_disassembly);
+
+  // only run the code if the CPU supports it
+  if (__builtin_cpu_supports("fma")) {
+    double (*fma)(double, double, double, const double*) =
+        reinterpret_cast<double (*)(double, double, double, const double*)>(function);
+    double addends[2] = {1.0, 100.0};
+    // 3 * 2 + 4 => 10; 3 * 10 - 1 => 29; 100 - 3 * 29 => 13
+    assert(fma(2.0, 3.0, 4.0, addends) == 13.0);
+  }
+}
+
+
+void test_byte_match() {
+  printf("-- packed byte match\n");
+
+  AMD64Assembler as;
+  CodeBuffer code;
+
+  // returns the index of the first byte in the 16-byte group at rdi that's
+  // equal to sil, or 16 if there are none
+  as.write_mov(rax, 0x0101010101010101);
+  as.write_imul(rsi, rax);
+  as.write_movq_to_xmm(xmm0, rsi);
+  as.write_punpcklqdq(xmm0, xmm0);
+  as.write_pcmpeqb(xmm0, MemoryReference(rdi, 0));
+  as.write_pmovmskb(rcx, xmm0);
+  as.write_mov(rax, 16);
+  as.write_test(rcx, rcx);
+  as.write_je("return");
+  as.write_bsf(rax, rcx);
+  as.write_label("return");
+  as.write_ret();
+
+  const char* expected_disassembly = "\
+0000000000000000   48 B8 01 01 01 01 01 01 01 01   movabs   rax, 0x0101010101010101\n\
+000000000000000A   48 0F AF F0                     imul     rsi, rax\n\
+000000000000000E   66 48 0F 6E C6                  movq     xmm0, rsi\n\
+0000000000000013   66 0F 6C C0                     punpcklqdq xmm0, xmm0\n\
+0000000000000017   66 0F 74 07                     pcmpeqb  xmm0, [rdi]\n\
+000000000000001B   66 0F D7 C8                     pmovmskb ecx, xmm0\n\
+000000000000001F   48 C7 C0 10 00 00 00            mov      rax, 0x00000010\n\
+0000000000000026   48 85 C9                        test     rcx, rcx\n\
+0000000000000029   74 04                           je       +0x4 ; return\n\
+000000000000002B   48 0F BC C1                     bsf      rax, rcx\n\
+return:\n\
+000000000000002F   C3                              ret\n";
+  void* function = assemble(code, as, expected_disassembly);
+  size_t (*find)(const int8_t*, int64_t) =
+      reinterpret_cast<size_t (*)(const int8_t*, int64_t)>(function);
+
+  alignas(16) int8_t group[16] = {
+      3, 7, -0x80, 7, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0x7F};
+  assert(find(group, 3) == 0);
+  assert(find(group, 7) == 1);
+  assert(find(group, 0x80) == 2);
+  assert(find(group, 0) == 4);
+  assert(find(group, 0x7F) == 15);
+  assert(find(group, 0x55) == 16);
+}
+
+
+void test_align_nops() {
+  printf("-- align nops\n");
+
+  // padding longer than 9 bytes is a 9-byte nop followed by a shorter one
+  static const string nops[10] = {
+    string(),
+    string("\x90", 1),
+    string("\x66\x90", 2),
+    string("\x0F\x1F\x00", 3),
+    string("\x0F\x1F\x40\x00", 4),
+    string("\x0F\x1F\x44\x00\x00", 5),
+    string("\x66\x0F\x1F\x44\x00\x00", 6),
+    string("\x0F\x1F\x80\x00\x00\x00\x00", 7),
+    string("\x0F\x1F\x84\x00\x00\x00\x00\x00", 8),
+    string("\x66\x0F\x1F\x84\x00\x00\x00\x00\x00", 9),
+  };
+
+  for (size_t padding = 1; padding < 16; padding++) {
+    AMD64Assembler as;
+    as.write_raw(string(16 - padding, '\xCC'));
+    as.write_align(16);
+    as.write_label("aligned");
+    as.write_ret();
+
+    multimap<size_t, string> labels;
+    string data = as.assemble(nullptr, &labels);
+    string expected_nops = (padding > 9) ?
+        (nops[9] + nops[padding - 9]) : nops[padding];
+    assert(data.size() == 17);
+    assert(data.substr(16 - padding, padding) == expected_nops);
+    assert(labels.size() == 1);
+    assert(labels.begin()->first == 16);
+    assert(labels.begin()->second == "aligned");
+
+    // if the padding would be longer than max_padding, none is written
+    AMD64Assembler limited_as;
+    limited_as.write_raw(string(16 - padding, '\xCC'));
+    limited_as.write_align(16, padding - 1);
+    limited_as.write_ret();
+    assert(limited_as.assemble().size() == 17 - padding);
+  }
+
+  // a loop head after an alignment directive starts on the boundary, and the
+  // padding before it doesn't change what the code does
+  for (size_t prefix = 0; prefix < 16; prefix++) {
+    AMD64Assembler as;
+    CodeBuffer code;
+
+    as.write_xor(rax, rax);
+    as.write_raw(string(prefix, '\x90'));
+    as.write_align(16);
+    as.write_label("loop");
+    as.write_add(rax, rdi);
+    as.write_dec(rsi);
+    as.write_jnz("loop");
+    as.write_ret();
+
+    multimap<size_t, string> labels;
+    unordered_set<size_t> patch_offsets;
+    string data = as.assemble(&patch_offsets, &labels);
+    void* function = code.append(data, &patch_offsets);
+    int64_t (*fn)(int64_t, int64_t) =
+        reinterpret_cast<int64_t (*)(int64_t, int64_t)>(function);
+
+    assert(labels.size() == 1);
+    assert((labels.begin()->first & 0x0F) == 0);
+    assert((reinterpret_cast<uintptr_t>(function) & 0x0F) == 0);
+    assert(fn(7, 5) == 35);
+  }
+}
+
+
 void test_absolute_patches() {
   printf("-- absolute patches\n");
 
@@ -436,6 +588,9 @@ int main(int argc, char** argv) {
   test_quicksort();
   test_float_move_load_multiply();
   test_float_neg();
+  test_float_fma();
+  test_byte_match();
+  test_align_nops();
   test_absolute_patches();
 
   printf("-- all tests passed\n");
@@ -20,14 +20,16 @@ void* CodeBuffer::append(const string& data,
 
 void* CodeBuffer::append(const void* data, size_t size,
     const unordered_set<size_t>* patch_offsets) {
-  // find the block with the least free space that this function can fit in
-  auto block_it = this->free_bytes_to_block.lower_bound(size);
+  // find the block with the least free space that this function can fit in.
+  // leave room for the start of the function to be aligned
+  auto block_it = this->free_bytes_to_block.lower_bound(size + CodeBuffer::alignment - 1);
   if (block_it != this->free_bytes_to_block.end()) {
     shared_ptr<Block> block = block_it->second;
+    size_t prev_used_bytes = block->used_bytes;
     void* ret = block->append(data, size, patch_offsets);
     this->free_bytes_to_block.erase(block_it);
     this->free_bytes_to_block.emplace(block->size - block->used_bytes, block);
-    this->used_bytes += size;
+    this->used_bytes += block->used_bytes - prev_used_bytes;
     return ret;
   }
 
@@ -97,15 +99,25 @@ CodeBuffer::Block::~Block() {
 
 void* CodeBuffer::Block::append(const void* data, size_t size,
     const unordered_set<size_t>* patch_offsets) {
-  if (this->size - this->used_bytes < size) {
+  // align the start of the data so the alignment directives in the assembled
+  // code (which are relative to its start) are meaningful. the padding is
+  // never executed, but fill it with int3s anyway
+  size_t aligned_offset = (this->used_bytes + CodeBuffer::alignment - 1) &
+      ~(CodeBuffer::alignment - 1);
+  if (aligned_offset > this->size) {
+    aligned_offset = this->size;
+  }
+  if (this->size - aligned_offset < size) {
     throw logic_error(string_printf("block cannot accept more data (%zu bytes, %zu used, %zu requested)",
         this->size, this->used_bytes, size));
   }
 
-  void* dest = reinterpret_cast<uint8_t*>(this->data) + this->used_bytes;
-  this->used_bytes += size;
+  void* dest = reinterpret_cast<uint8_t*>(this->data) + aligned_offset;
+  size_t padding = aligned_offset - this->used_bytes;
+  this->used_bytes = aligned_offset + size;
 
   mprotect(this->data, this->size, PROT_READ | PROT_WRITE | PROT_EXEC);
+  memset(reinterpret_cast<uint8_t*>(dest) - padding, 0xCC, padding);
   memcpy(dest, data, size);
   if (patch_offsets) {
     size_t delta = reinterpret_cast<ssize_t>(dest);
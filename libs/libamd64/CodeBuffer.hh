@@ -29,6 +29,9 @@ public:
   size_t total_size() const;
   size_t total_used_bytes() const;
 
+  // appended data always begins at a multiple of this many bytes
+  static constexpr size_t alignment = 32;
+
 private:
   struct Block {
     void* data;
@@ -893,7 +893,7 @@ void AssignmentStatement::accept(ASTVisitor *v)
 AugmentStatement::AugmentStatement(AugmentOperator oper,
                                    shared_ptr<Expression> target, shared_ptr<Expression> value,
                                    size_t file_offset) : SimpleStatement(file_offset), oper(oper),
-                                                         target(target), value(value)
+                                                         target(target), value(value), operation(nullptr)
 {}
 
 string AugmentStatement::str() const
@@ -560,6 +560,11 @@ struct AugmentStatement : SimpleStatement
     std::shared_ptr<Expression> target; // lvalue reference
     std::shared_ptr<Expression> value;
 
+    // annotations
+    // if target is a simple variable, this is the equivalent `target oper value`
+    // expression; the statement is compiled as an assignment of this to target
+    std::shared_ptr<BinaryOperation> operation;
+
     AugmentStatement(AugmentOperator oper, std::shared_ptr<Expression> target,
                      std::shared_ptr<Expression> value, size_t file_offset);
 
@@ -6,6 +6,7 @@
 #include <set>
 
 #include "PythonLexer.hh"
+#include "../Types/StringKernels.hh"
 
 using namespace std;
 
@@ -216,7 +217,7 @@ wstring unescape_unicode(const char *s, size_t size)
                     {
                         throw invalid_argument("invalid character in unicode16 escape sequence");
                     }
-                    ret += static_cast<char>((value_for_hex_char(s[x + 2]) << 12) |
+                    ret += static_cast<wchar_t>((value_for_hex_char(s[x + 2]) << 12) |
                                              (value_for_hex_char(s[x + 3]) << 8) |
                                              (value_for_hex_char(s[x + 4]) << 4) |
                                              value_for_hex_char(s[x + 5]));
@@ -235,7 +236,7 @@ wstring unescape_unicode(const char *s, size_t size)
                     {
                         throw invalid_argument("invalid character in unicode32 escape sequence");
                     }
-                    ret += static_cast<char>((value_for_hex_char(s[x + 2]) << 28) |
+                    ret += static_cast<wchar_t>((value_for_hex_char(s[x + 2]) << 28) |
                                              (value_for_hex_char(s[x + 3]) << 24) |
                                              (value_for_hex_char(s[x + 4]) << 20) |
                                              (value_for_hex_char(s[x + 5]) << 16) |
@@ -251,11 +252,25 @@ wstring unescape_unicode(const char *s, size_t size)
                     x++;
             }
         }
-        else
+        else if (!(s[x] & 0x80))
         {
             ret += s[x];
             x++;
         }
+        else
+        {
+            // source files are utf-8, so non-ascii characters in literals
+            // are multibyte sequences
+            uint32_t ch;
+            size_t length = string_kernel_utf8_decode(reinterpret_cast<const uint8_t *>(s + x),
+                                                      size - x, &ch);
+            if (!length)
+            {
+                throw invalid_argument("invalid utf-8 sequence in string literal");
+            }
+            ret += static_cast<wchar_t>(ch);
+            x += length;
+        }
     }
     return ret;
 }
@@ -311,9 +326,9 @@ string escape(const char *s, size_t size)
         {
             ret += "\\v";
         }
-        else if (ch < 0x20 || ch > 0x7F)
+        else if (static_cast<uint8_t>(ch) < 0x20 || static_cast<uint8_t>(ch) >= 0x7F)
         {
-            ret += string_printf("\\x%02" PRIX8, static_cast<uint8_t>(ch));
+            ret += string_printf("\\x%02" PRIx8, static_cast<uint8_t>(ch));
         }
         else
         {
@@ -333,7 +348,7 @@ string escape(const wchar_t *s, size_t size)
     string ret;
     for (size_t x = 0; x < size; x++)
     {
-        char ch = s[x];
+        uint32_t ch = s[x];
         if (ch == '\\')
         {
             ret += "\\\\";
@@ -376,15 +391,15 @@ string escape(const wchar_t *s, size_t size)
         }
         else if (ch & 0xFFFF0000)
         {
-            ret += string_printf("\\U%08" PRIX32, static_cast<uint32_t>(ch));
+            ret += string_printf("\\U%08" PRIx32, static_cast<uint32_t>(ch));
         }
         else if (ch & 0xFFFFFF00)
         {
-            ret += string_printf("\\u%04" PRIX16, static_cast<uint16_t>(ch));
+            ret += string_printf("\\u%04" PRIx16, static_cast<uint16_t>(ch));
         }
-        else if (ch < 0x20 || ch > 0x7F)
+        else if (ch < 0x20 || ch >= 0x7F)
         {
-            ret += string_printf("\\x%02" PRIX8, static_cast<uint8_t>(ch));
+            ret += string_printf("\\x%02" PRIx8, static_cast<uint8_t>(ch));
         }
         else
         {
@@ -725,7 +740,7 @@ static size_t get_line_indent(const char *str)
 
 
 PythonLexer::Token::Token(TokenType type, const string &string_data,
-                          float float_data, int64_t int_data, size_t text_offset, size_t text_length)
+                          double float_data, int64_t int_data, size_t text_offset, size_t text_length)
         : type(type), string_data(string_data), float_data(float_data),
           int_data(int_data), text_offset(text_offset), text_length(text_length)
 {}
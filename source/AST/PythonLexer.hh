@@ -159,7 +159,7 @@ public:
         size_t text_offset;
         size_t text_length;
 
-        Token(TokenType type, const std::string &string_data, float float_data,
+        Token(TokenType type, const std::string &string_data, double float_data,
               int64_t int_data, size_t text_offset, size_t text_length);
 
         std::string str() const;
@@ -12,6 +12,29 @@
 using namespace std;
 
 
+// lists, sets and dicts can be modified through any reference to them (e.g.
+// `m = k; m.pop()`), so once one is stored in a variable or returned from a
+// function, we only know its type and not its contents
+static Value without_mutable_contents(const Value &value)
+{
+    if ((value.type == ValueType::List) || (value.type == ValueType::Set) ||
+        (value.type == ValueType::Dict))
+    {
+        return value.type_only();
+    }
+    if ((value.type == ValueType::Tuple) && value.value_known)
+    {
+        vector<shared_ptr<Value>> items;
+        for (const auto &item: *value.list_value)
+        {
+            items.emplace_back(new Value(without_mutable_contents(*item)));
+        }
+        return Value(ValueType::Tuple, std::move(items));
+    }
+    return value;
+}
+
+
 AnalysisVisitor::AnalysisVisitor(GlobalContext *global, ModuleContext *module)
         : global(global), module(module), in_function_id(0), in_class_id(0),
           last_attribute_lookup_had_class_base(false)
@@ -85,32 +108,53 @@ void AnalysisVisitor::visit(ListConstructor *a)
 void AnalysisVisitor::visit(SetConstructor *a)
 {
     unordered_set<Value> items;
+    bool all_items_known = true;
     for (auto item: a->items)
     {
         item->accept(this);
+        all_items_known &= this->current_value.value_known;
         items.emplace(std::move(this->current_value));
     }
 
+    // if any item's value is unknown, the set's size is unknown too (unknown
+    // items may or may not be equal to each other)
     a->value_type = compute_set_extension_type(items);
-    this->current_value = Value(ValueType::Set, std::move(items));
+    if (all_items_known)
+    {
+        this->current_value = Value(ValueType::Set, std::move(items));
+    }
+    else
+    {
+        this->current_value = Value(ValueType::Set, vector<Value>({a->value_type}));
+    }
 }
 
 void AnalysisVisitor::visit(DictConstructor *a)
 {
     unordered_map<Value, shared_ptr<Value>> items;
+    bool all_keys_known = true;
     for (auto item: a->items)
     {
         item.first->accept(this);
         Value key(std::move(this->current_value));
+        all_keys_known &= key.value_known;
         item.second->accept(this);
         items.emplace(piecewise_construct, forward_as_tuple(std::move(key)),
                       forward_as_tuple(new Value(std::move(this->current_value))));
     }
 
+    // like sets, if any key is unknown then the dict's contents are unknown
     auto ex_types = compute_dict_extension_type(items);
     a->key_type = std::move(ex_types.first);
     a->value_type = std::move(ex_types.second);
-    this->current_value = Value(ValueType::Dict, std::move(items));
+    if (all_keys_known)
+    {
+        this->current_value = Value(ValueType::Dict, std::move(items));
+    }
+    else
+    {
+        this->current_value = Value(ValueType::Dict, vector<Value>({a->key_type, a->value_type}));
+    }
 }
 
 void AnalysisVisitor::visit(TupleConstructor *a)
@@ -127,20 +171,47 @@ void AnalysisVisitor::visit(TupleConstructor *a)
 
 void AnalysisVisitor::visit(ListComprehension *a)
 {
-    // for now, just make these unknown-value lists
-    this->current_value = Value(ValueType::List);
+    // like DictComprehension below, but with only one pattern
+    a->source_data->accept(this);
+    this->replace_current_value_with_iteration_item(a->file_offset);
+    a->variable->accept(this);
+    if (a->predicate.get())
+    {
+        a->predicate->accept(this);
+    }
+    a->item_pattern->accept(this);
+    this->current_value = Value(ValueType::List, vector<Value>({this->current_value.type_only()}));
 }
 
 void AnalysisVisitor::visit(SetComprehension *a)
 {
-    // for now, just make these unknown-value sets
-    this->current_value = Value(ValueType::Set);
+    a->source_data->accept(this);
+    this->replace_current_value_with_iteration_item(a->file_offset);
+    a->variable->accept(this);
+    if (a->predicate.get())
+    {
+        a->predicate->accept(this);
+    }
+    a->item_pattern->accept(this);
+    this->current_value = Value(ValueType::Set, vector<Value>({this->current_value.type_only()}));
 }
 
 void AnalysisVisitor::visit(DictComprehension *a)
 {
-    // for now, just make these unknown-value dicts
-    this->current_value = Value(ValueType::Dict);
+    // the variable is assigned like a for loop's variable, then the key and
+    // value patterns tell us the dict's extension types
+    a->source_data->accept(this);
+    this->replace_current_value_with_iteration_item(a->file_offset);
+    a->variable->accept(this);
+    if (a->predicate.get())
+    {
+        a->predicate->accept(this);
+    }
+    a->key_pattern->accept(this);
+    Value key_type = this->current_value.type_only();
+    a->value_pattern->accept(this);
+    Value value_type = this->current_value.type_only();
+    this->current_value = Value(ValueType::Dict, vector<Value>({key_type, value_type}));
 }
 
 void AnalysisVisitor::visit(LambdaDefinition *a)
@@ -179,7 +250,7 @@ void AnalysisVisitor::visit(LambdaDefinition *a)
     fn->varkwargs_name = a->args.varkwargs_name;
 
     a->result->accept(this);
-    fn->return_types.emplace(std::move(this->current_value));
+    fn->return_types.emplace(without_mutable_contents(this->current_value));
 
     this->in_function_id = prev_function_id;
 
@@ -199,6 +270,15 @@ void AnalysisVisitor::visit(FunctionCall *a)
     }
     Value function = std::move(this->current_value);
 
+    // builtin methods' return types can refer to the extension types of the
+    // object they're called on (e.g. list.pop returns an item of the list's
+    // type), so remember what that object is
+    Value self_type;
+    if (dynamic_cast<AttributeLookup *>(a->function.get()))
+    {
+        self_type = this->last_attribute_lookup_base_type;
+    }
+
     // if the function a class, then it's actually an __init__ call
     if (function.type == ValueType::Class)
     {
@@ -215,13 +295,17 @@ void AnalysisVisitor::visit(FunctionCall *a)
     }
 
     // now visit the arg values
+    vector<Value> arg_types;
     for (auto &arg: a->args)
     {
         arg->accept(this);
+        arg_types.emplace_back(this->current_value.type_only());
     }
+    unordered_map<string, Value> kwarg_types;
     for (auto &it: a->kwargs)
     {
         it.second->accept(this);
+        kwarg_types.emplace(it.first, this->current_value.type_only());
     }
 
     // TODO: typecheck the args if the function's arguments have type annotations
@@ -242,7 +326,16 @@ void AnalysisVisitor::visit(FunctionCall *a)
         if (!callee_fn->module || (callee_fn->module == this->module) ||
             (callee_fn->module->phase >= ModuleContext::Phase::Analyzed))
         {
-            if (callee_fn->return_types.empty())
+            // return_types doesn't distinguish between extension types (so
+            // List[Int] and List[Float] are the same there), so builtins with
+            // several fragments are handled separately
+            if (callee_fn->is_builtin() && !callee_fn->class_id &&
+                (callee_fn->fragments.size() > 1))
+            {
+                this->current_value = this->builtin_return_type_for_call(callee_fn,
+                                                                         arg_types, kwarg_types);
+            }
+            else if (callee_fn->return_types.empty())
             {
                 this->current_value = Value(ValueType::None);
             }
@@ -250,10 +343,74 @@ void AnalysisVisitor::visit(FunctionCall *a)
             {
                 this->current_value = *callee_fn->return_types.begin();
             }
+
+            if (callee_fn->is_builtin() && callee_fn->class_id && !a->is_class_method_call)
+            {
+                this->current_value = resolve_extension_type_references(
+                        this->current_value, self_type);
+            }
         }
     }
 }
 
+Value AnalysisVisitor::builtin_return_type_for_call(const FunctionContext *fn,
+                                                    const vector<Value> &arg_types,
+                                                    const unordered_map<string, Value> &kwarg_types)
+{
+    // if all the fragments return the same type, we don't need to know which
+    // one will be called
+    const Value &first_return_type = fn->fragments[0].return_type;
+    bool all_return_types_equal = true;
+    for (const auto &fragment: fn->fragments)
+    {
+        if (!fragment.return_type.types_equal(first_return_type))
+        {
+            all_return_types_equal = false;
+            break;
+        }
+    }
+    if (all_return_types_equal)
+    {
+        return first_return_type;
+    }
+
+    // otherwise (for example, in sorted), the return type depends on the
+    // argument types. if we know the types of all the arguments, we can tell
+    // which fragment will be called
+    if (arg_types.size() > fn->args.size())
+    {
+        return Value(ValueType::Indeterminate);
+    }
+    vector<Value> call_types = arg_types;
+    for (size_t x = call_types.size(); x < fn->args.size(); x++)
+    {
+        const auto &arg = fn->args[x];
+        auto kwarg_it = arg.name.empty() ? kwarg_types.end() : kwarg_types.find(arg.name);
+        call_types.emplace_back((kwarg_it == kwarg_types.end()) ?
+                                arg.default_value.type_only() : kwarg_it->second);
+    }
+    for (const auto &type: call_types)
+    {
+        if (type.type == ValueType::Indeterminate)
+        {
+            return Value(ValueType::Indeterminate);
+        }
+    }
+
+    try
+    {
+        int64_t fragment_index = fn->fragment_index_for_call_args(call_types);
+        if (fragment_index >= 0)
+        {
+            return fn->fragments[fragment_index].return_type;
+        }
+    } catch (const compile_error &)
+    {
+        // an extension type was Indeterminate (e.g. the argument is [])
+    }
+    return Value(ValueType::Indeterminate);
+}
+
 void AnalysisVisitor::visit(ArrayIndex *a)
 {
     a->array->accept(this);
@@ -288,10 +445,12 @@ void AnalysisVisitor::visit(ArrayIndex *a)
             a->index_value = this->current_value.int_value;
         }
 
-        // if we don't know the array value, we can't know the result type
+        // if we don't know the array value, we can only know the result type
+        // if it's a list whose item type we know
         if (!array.value_known)
         {
-            this->current_value = Value(ValueType::Indeterminate);
+            this->current_value = ((array.type == ValueType::List) && !array.extension_types.empty()) ?
+                    array.extension_types[0].type_only() : Value(ValueType::Indeterminate);
             return;
         }
     }
@@ -393,10 +552,12 @@ void AnalysisVisitor::visit(ArrayIndex *a)
     }
     else if (array.type == ValueType::Dict)
     {
-        // if we don't know the dict value, we can't know the result type
+        // if we don't know the dict value, the result has the dict's value type
+        // (which is Indeterminate if we don't know that either)
         if (!array.value_known)
         {
-            this->current_value = Value(ValueType::Indeterminate);
+            this->current_value = (array.extension_types.size() == 2) ?
+                    array.extension_types[1].type_only() : Value(ValueType::Indeterminate);
             return;
         }
 
@@ -440,8 +601,40 @@ void AnalysisVisitor::visit(ArrayIndex *a)
 
 void AnalysisVisitor::visit(ArraySlice *a)
 {
-    // TODO
-    throw compile_error("array slices are currently not supported", a->file_offset);
+    a->array->accept(this);
+    Value array = std::move(this->current_value);
+
+    for (const auto &index: {a->start_index, a->end_index, a->step_size})
+    {
+        if (!index.get())
+        {
+            continue;
+        }
+        index->accept(this);
+        if ((this->current_value.type != ValueType::Bool) &&
+            (this->current_value.type != ValueType::Int) &&
+            (this->current_value.type != ValueType::Indeterminate))
+        {
+            throw compile_error("slice index is not Bool or Int", a->file_offset);
+        }
+    }
+
+    // a slice has the same type as the object it came from. we don't bother
+    // computing the value even if it's known
+    if (array.type == ValueType::Indeterminate)
+    {
+        this->current_value = Value(ValueType::Indeterminate);
+    }
+    else if ((array.type == ValueType::Bytes) || (array.type == ValueType::Unicode) ||
+             (array.type == ValueType::List))
+    {
+        this->current_value = array.type_only();
+    }
+    else
+    {
+        string array_str = array.str();
+        throw compile_error("invalid slice of " + array_str, a->file_offset);
+    }
 }
 
 void AnalysisVisitor::visit(IntegerConstant *a)
@@ -516,6 +709,7 @@ void AnalysisVisitor::visit(AttributeLookup *a)
     a->base->accept(this);
 
     this->last_attribute_lookup_had_class_base = false;
+    this->last_attribute_lookup_base_type = this->current_value.type_only();
 
     int64_t class_id;
     switch (this->current_value.type)
@@ -648,12 +842,65 @@ void AnalysisVisitor::visit(TupleLValueReference *a)
 
 void AnalysisVisitor::visit(ArrayIndexLValueReference *a)
 {
-    // TODO: for now ignore these
+    Value value = std::move(this->current_value);
+    a->array->accept(this);
+    Value array = std::move(this->current_value);
+    a->index->accept(this);
+    Value index = std::move(this->current_value);
+
+    auto *array_var = dynamic_cast<VariableLookup *>(a->array.get());
+    if (!array_var)
+    {
+        return;
+    }
+
+    // an empty dict literal doesn't tell us the key and value types, so if a
+    // dict variable in the current scope doesn't know them yet, we take them
+    // from the first item assignment
+    auto *fn = this->current_function();
+    if (fn ? (!fn->locals.count(array_var->name) || fn->explicit_globals.count(array_var->name))
+           : (this->current_class() || !this->module->global_variables.count(array_var->name)))
+    {
+        return;
+    }
+    if ((array.type != ValueType::Dict) || (array.extension_types.size() != 2) ||
+        ((array.extension_types[0].type != ValueType::Indeterminate) &&
+         (array.extension_types[1].type != ValueType::Indeterminate)))
+    {
+        return;
+    }
+
+    vector<Value> extension_types(array.extension_types);
+    if (extension_types[0].type == ValueType::Indeterminate)
+    {
+        extension_types[0] = index.type_only();
+    }
+    if (extension_types[1].type == ValueType::Indeterminate)
+    {
+        extension_types[1] = value.type_only();
+    }
+    this->record_assignment(array_var->name,
+                            Value(ValueType::Dict, extension_types), a->file_offset);
 }
 
 void AnalysisVisitor::visit(ArraySliceLValueReference *a)
 {
-    // TODO: for now ignore these
+    // CompilationVisitor checks that the list and value types match
+    a->array->accept(this);
+    for (const auto &index: {a->start_index, a->end_index, a->step_size})
+    {
+        if (!index.get())
+        {
+            continue;
+        }
+        index->accept(this);
+        if ((this->current_value.type != ValueType::Bool) &&
+            (this->current_value.type != ValueType::Int) &&
+            (this->current_value.type != ValueType::Indeterminate))
+        {
+            throw compile_error("slice index is not Bool or Int", a->file_offset);
+        }
+    }
 }
 
 void AnalysisVisitor::visit(AttributeLValueReference *a)
@@ -768,8 +1015,26 @@ void AnalysisVisitor::visit(AssignmentStatement *a)
 
 void AnalysisVisitor::visit(AugmentStatement *a)
 {
-    // TODO
-    throw compile_error("AugmentStatement not yet implemented", a->file_offset);
+    // `x op= y` is the same as `x = x op y` if x is a simple variable. we don't
+    // support augmenting attributes or items yet, since the base expression
+    // must only be evaluated once. (CompilationVisitor compiles += on lists as
+    // an in-place extend, but the result type is the same)
+    auto *target = dynamic_cast<AttributeLValueReference *>(a->target.get());
+    if (!target || target->base.get())
+    {
+        throw compile_error("AugmentStatement only supported for simple variables",
+                            a->file_offset);
+    }
+    if (!a->operation.get())
+    {
+        a->operation.reset(new BinaryOperation(
+                binary_operator_for_augment_operator(a->oper),
+                shared_ptr<Expression>(new VariableLookup(target->name, a->file_offset)),
+                a->value, a->file_offset));
+    }
+
+    a->operation->accept(this);
+    a->target->accept(this);
 }
 
 void AnalysisVisitor::visit(DeleteStatement *a)
@@ -886,7 +1151,7 @@ void AnalysisVisitor::visit(ReturnStatement *a)
         }
 
         a->value->accept(this);
-        fn->return_types.emplace(std::move(this->current_value));
+        fn->return_types.emplace(without_mutable_contents(this->current_value));
     }
     else
     {
@@ -976,9 +1241,10 @@ void AnalysisVisitor::visit(ElifStatement *a)
     }
 }
 
-void AnalysisVisitor::visit(ForStatement *a)
+void AnalysisVisitor::replace_current_value_with_iteration_item(size_t file_offset)
 {
-    a->collection->accept(this);
+    // replaces current_value (a collection) with the value of the items you
+    // get by iterating over it, as much as we know about them.
 
     // if the current value is known, we can at least get the types of the values
     if (this->current_value.value_known)
@@ -1005,7 +1271,7 @@ void AnalysisVisitor::visit(ForStatement *a)
                 string target_value = this->current_value.str();
                 throw compile_error(string_printf(
                                             "iteration target %s is not a collection", target_value.c_str()),
-                                    a->file_offset);
+                                    file_offset);
             }
 
                 // these you can iterate. if all the values are the same type, then we can
@@ -1112,13 +1378,25 @@ void AnalysisVisitor::visit(ForStatement *a)
                 // just proceed without knowing
             case ValueType::Indeterminate:
 
-                // for these we can't know what the result type will be without also
-                // knowing the value
-            case ValueType::List:
+                // for tuples we can't know what the result type will be without
+                // also knowing the value
             case ValueType::Tuple:
+                this->current_value = Value(ValueType::Indeterminate);
+                break;
+
+                // for these, the item (or key) type is the first extension type,
+                // if we know it
+            case ValueType::List:
             case ValueType::Set:
             case ValueType::Dict:
-                this->current_value = Value(ValueType::Indeterminate);
+                if (this->current_value.extension_types.empty())
+                {
+                    this->current_value = Value(ValueType::Indeterminate);
+                }
+                else
+                {
+                    this->current_value = this->current_value.extension_types[0].type_only();
+                }
                 break;
 
                 // silly programmer; you can't iterate these types
@@ -1134,7 +1412,7 @@ void AnalysisVisitor::visit(ForStatement *a)
                 string target_type = this->current_value.str();
                 throw compile_error(string_printf(
                                             "iteration target of type %s is not a collection", target_type.c_str()),
-                                    a->file_offset);
+                                    file_offset);
             }
 
                 // even if we don't know the value, we know what type the result will be
@@ -1144,7 +1422,13 @@ void AnalysisVisitor::visit(ForStatement *a)
                 break;
         }
     }
+}
+
+void AnalysisVisitor::visit(ForStatement *a)
+{
+    a->collection->accept(this);
 
+    this->replace_current_value_with_iteration_item(a->file_offset);
     a->variable->accept(this);
 
     this->visit_list(a->items);
@@ -1535,12 +1819,24 @@ ClassContext *AnalysisVisitor::current_class()
 
 
 void AnalysisVisitor::record_assignment_generic(Value &var,
-                                                const string &name, const Value &value, size_t file_offset)
+                                                const string &name, const Value &assigned_value, size_t file_offset)
 {
+    Value value = without_mutable_contents(assigned_value);
     if (var.type == ValueType::Indeterminate)
     {
         var = value; // this is the first write
     }
+    else if (is_refinement_of_type(value, var))
+    {
+        // e.g. an empty dict whose key and value types we now know
+        var = value;
+        var.clear_value();
+    }
+    else if (is_refinement_of_type(var, value))
+    {
+        // e.g. an empty dict assigned to a variable whose types we know
+        var.clear_value();
+    }
     else
     {
         if (!var.types_equal(value))
@@ -138,6 +138,7 @@ private:
     int64_t in_function_id;
     int64_t in_class_id;
     bool last_attribute_lookup_had_class_base;
+    Value last_attribute_lookup_base_type;
 
     FunctionContext *current_function();
 
@@ -157,4 +158,10 @@ private:
 
     void record_assignment(const std::string &name, const Value &var,
                            size_t file_offset);
+
+    void replace_current_value_with_iteration_item(size_t file_offset);
+
+    Value builtin_return_type_for_call(const FunctionContext *fn,
+                                       const std::vector<Value> &arg_types,
+                                       const std::unordered_map<std::string, Value> &kwarg_types);
 };
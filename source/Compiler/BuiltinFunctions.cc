@@ -11,6 +11,7 @@
 
 // builtin module implementations
 #include "../Modules/__pyjit__.hh"
+#include "../Modules/__pyjit_array__.hh"
 #include "../Modules/builtins.hh"
 #include "../Modules/errno.hh"
 #include "../Modules/math.hh"
@@ -32,6 +33,7 @@ typedef shared_ptr<ModuleContext> (*module_constructor_t)(GlobalContext *);
 
 static unordered_map<string, module_constructor_t> builtin_modules({
                                                                            DECLARE_MODULE(__pyjit__),
+                                                                           DECLARE_MODULE(__pyjit_array__),
                                                                            DECLARE_MODULE(builtins),
                                                                            DECLARE_MODULE(errno),
                                                                            DECLARE_MODULE(math),
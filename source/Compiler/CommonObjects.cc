@@ -12,6 +12,7 @@
 #include "../Types/Format.hh"
 #include "../Types/List.hh"
 #include "../Types/Dictionary.hh"
+#include "../Types/Set.hh"
 
 using namespace std;
 
@@ -33,27 +34,55 @@ static const vector<const void *> objects({
                                                   void_fn_ptr(&_resolve_function_call),
 
                                                   void_fn_ptr(&bytes_equal),
+                                                  void_fn_ptr(&bytes_hash),
                                                   void_fn_ptr(&bytes_compare),
                                                   void_fn_ptr(&bytes_contains),
                                                   void_fn_ptr(&bytes_concat),
+                                                  void_fn_ptr(&bytes_slice),
+                                                  void_fn_ptr(&bytes_append),
                                                   void_fn_ptr(&bytes_format),
                                                   void_fn_ptr(&bytes_format_one),
+                                                  void_fn_ptr(&bytes_format_compiled),
 
                                                   void_fn_ptr(&unicode_equal),
+                                                  void_fn_ptr(&unicode_hash),
                                                   void_fn_ptr(&unicode_compare),
                                                   void_fn_ptr(&unicode_contains),
                                                   void_fn_ptr(&unicode_concat),
+                                                  void_fn_ptr(&unicode_slice),
+                                                  void_fn_ptr(&unicode_append),
                                                   void_fn_ptr(&unicode_format),
                                                   void_fn_ptr(&unicode_format_one),
+                                                  void_fn_ptr(&unicode_format_compiled),
 
                                                   void_fn_ptr(&list_new),
+                                                  void_fn_ptr(&list_reserve),
+                                                  void_fn_ptr(&list_grow),
+                                                  void_fn_ptr(&list_slice),
+                                                  void_fn_ptr(&list_set_slice),
+                                                  void_fn_ptr(&list_extend),
+                                                  void_fn_ptr(&list_concat),
+                                                  void_fn_ptr(&list_repeat),
                                                   void_fn_ptr(&list_get_item),
                                                   void_fn_ptr(&list_set_item),
 
                                                   void_fn_ptr(&tuple_new),
                                                   void_fn_ptr(&tuple_get_item),
 
+                                                  void_fn_ptr(&dictionary_new),
+                                                  void_fn_ptr(&dictionary_reserve),
+                                                  void_fn_ptr(&dictionary_insert),
+                                                  void_fn_ptr(&dictionary_insert_steal),
+                                                  void_fn_ptr(&dictionary_exists),
+                                                  void_fn_ptr(&dictionary_at),
                                                   void_fn_ptr(&dictionary_next_item),
+
+                                                  void_fn_ptr(&set_new),
+                                                  void_fn_ptr(&set_add),
+                                                  void_fn_ptr(&set_contains),
+                                                  void_fn_ptr(&set_union),
+                                                  void_fn_ptr(&set_intersection),
+                                                  void_fn_ptr(&set_next_item),
                                           });
 
 static unique_ptr<const unordered_map<const void *, size_t>> pointer_to_index;
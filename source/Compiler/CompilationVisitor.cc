@@ -4,6 +4,10 @@
 #include <math.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <functional>
 
 #include <phosg/Filesystem.hh>
 #include <phosg/Strings.hh>
@@ -14,6 +18,7 @@
 #include "../Types/Format.hh"
 #include "../Types/List.hh"
 #include "../Types/Dictionary.hh"
+#include "../Types/Set.hh"
 #include "CommonObjects.hh"
 #include "Exception.hh"
 #include "BuiltinFunctions.hh"
@@ -55,6 +60,7 @@ CompilationVisitor::CompilationVisitor(GlobalContext *global,
                                                                                     float_target_register(xmm0),
                                                                                     stack_bytes_used(0),
                                                                                     holding_reference(false),
+                                                                                    condition_jump_if(false),
                                                                                     evaluating_instance_pointer(false),
                                                                                     in_finally_block(false)
 {
@@ -232,6 +238,21 @@ Register CompilationVisitor::available_register_except(
     return which;
 }
 
+Register CompilationVisitor::available_float_temporary_register()
+{
+    // intermediate float values go in xmm8-15 when possible, since xmm0-7 are
+    // used to pass arguments to functions
+    for (Register which = Register::XMM8; which <= Register::XMM15;
+         which = static_cast<Register>(static_cast<int64_t>(which) + 1))
+    {
+        if (this->available_float_registers & (1 << which))
+        {
+            return which;
+        }
+    }
+    return this->available_register(Register::None, true);
+}
+
 int64_t CompilationVisitor::write_push_reserved_registers()
 {
     // push int registers
@@ -471,6 +492,231 @@ void CompilationVisitor::visit(UnaryOperation *a)
     }
 }
 
+static size_t count_statements(const vector<shared_ptr<Statement>> &items)
+{
+    size_t ret = items.size();
+    for (const auto &item: items)
+    {
+        auto *compound = dynamic_cast<const CompoundStatement *>(item.get());
+        if (compound)
+        {
+            ret += count_statements(compound->items);
+        }
+    }
+    return ret;
+}
+
+static bool any_expression_may_raise(const vector<Expression *> &exprs,
+                                     size_t start_index)
+{
+    // constants can't raise; anything else (even a variable lookup) might
+    for (size_t x = start_index; x < exprs.size(); x++)
+    {
+        Expression *e = exprs[x];
+        if (!dynamic_cast<IntegerConstant *>(e) && !dynamic_cast<FloatConstant *>(e) &&
+            !dynamic_cast<BytesConstant *>(e) && !dynamic_cast<UnicodeConstant *>(e) &&
+            !dynamic_cast<TrueConstant *>(e) && !dynamic_cast<FalseConstant *>(e) &&
+            !dynamic_cast<NoneConstant *>(e))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool is_comparison_operator(BinaryOperator oper)
+{
+    return (oper == BinaryOperator::LessThan) ||
+           (oper == BinaryOperator::GreaterThan) ||
+           (oper == BinaryOperator::LessOrEqual) ||
+           (oper == BinaryOperator::GreaterOrEqual) ||
+           (oper == BinaryOperator::Equality) ||
+           (oper == BinaryOperator::NotEqual);
+}
+
+static bool is_float_arithmetic_operator(BinaryOperator oper)
+{
+    return (oper == BinaryOperator::Addition) ||
+           (oper == BinaryOperator::Subtraction) ||
+           (oper == BinaryOperator::Multiplication) ||
+           (oper == BinaryOperator::Division);
+}
+
+static bool cpu_has_fma()
+{
+    static const bool has_fma = __builtin_cpu_supports("fma");
+    return has_fma;
+}
+
+// conditions that comparisons can leave in the flags. the float conditions
+// assume the operands were swapped as needed so that only above/above-equal
+// are used for ordered comparisons; OrderedEqual and UnorderedNotEqual also
+// need to check PF, so they don't correspond to a single jcc/setcc
+enum class Condition
+{
+    Equal = 0,
+    NotEqual,
+    Less,
+    GreaterOrEqual,
+    Greater,
+    LessOrEqual,
+    Above,
+    BelowOrEqual,
+    AboveOrEqual,
+    Below,
+    OrderedEqual,
+    UnorderedNotEqual,
+};
+
+static Condition negate_condition(Condition cond)
+{
+    // negated conditions are adjacent pairs in the enum
+    return static_cast<Condition>(static_cast<int>(cond) ^ 1);
+}
+
+static Condition condition_for_int_comparison(BinaryOperator oper)
+{
+    switch (oper)
+    {
+        case BinaryOperator::LessThan:
+            return Condition::Less;
+        case BinaryOperator::GreaterThan:
+            return Condition::Greater;
+        case BinaryOperator::LessOrEqual:
+            return Condition::LessOrEqual;
+        case BinaryOperator::GreaterOrEqual:
+            return Condition::GreaterOrEqual;
+        case BinaryOperator::Equality:
+            return Condition::Equal;
+        case BinaryOperator::NotEqual:
+            return Condition::NotEqual;
+        default:
+            throw logic_error("not a comparison operator");
+    }
+}
+
+static Condition condition_for_float_comparison(BinaryOperator oper)
+{
+    switch (oper)
+    {
+        case BinaryOperator::LessThan:
+        case BinaryOperator::GreaterThan:
+            return Condition::Above;
+        case BinaryOperator::LessOrEqual:
+        case BinaryOperator::GreaterOrEqual:
+            return Condition::AboveOrEqual;
+        case BinaryOperator::Equality:
+            return Condition::OrderedEqual;
+        case BinaryOperator::NotEqual:
+            return Condition::UnorderedNotEqual;
+        default:
+            throw logic_error("not a comparison operator");
+    }
+}
+
+static void write_jcc_for_condition(AMD64Assembler &as, Condition cond,
+                                    const string &label)
+{
+    switch (cond)
+    {
+        case Condition::Equal:
+            as.write_je(label);
+            break;
+        case Condition::NotEqual:
+            as.write_jne(label);
+            break;
+        case Condition::Less:
+            as.write_jl(label);
+            break;
+        case Condition::GreaterOrEqual:
+            as.write_jge(label);
+            break;
+        case Condition::Greater:
+            as.write_jg(label);
+            break;
+        case Condition::LessOrEqual:
+            as.write_jle(label);
+            break;
+        case Condition::Above:
+            as.write_ja(label);
+            break;
+        case Condition::BelowOrEqual:
+            as.write_jbe(label);
+            break;
+        case Condition::AboveOrEqual:
+            as.write_jae(label);
+            break;
+        case Condition::Below:
+            as.write_jb(label);
+            break;
+        default:
+            throw logic_error("condition does not correspond to a single jcc");
+    }
+}
+
+static void write_setcc_for_condition(AMD64Assembler &as, Condition cond,
+                                      const MemoryReference &target)
+{
+    switch (cond)
+    {
+        case Condition::Equal:
+            as.write_sete(target);
+            break;
+        case Condition::NotEqual:
+            as.write_setne(target);
+            break;
+        case Condition::Less:
+            as.write_setl(target);
+            break;
+        case Condition::GreaterOrEqual:
+            as.write_setge(target);
+            break;
+        case Condition::Greater:
+            as.write_setg(target);
+            break;
+        case Condition::LessOrEqual:
+            as.write_setle(target);
+            break;
+        case Condition::Above:
+            as.write_seta(target);
+            break;
+        case Condition::BelowOrEqual:
+            as.write_setbe(target);
+            break;
+        case Condition::AboveOrEqual:
+            as.write_setae(target);
+            break;
+        case Condition::Below:
+            as.write_setb(target);
+            break;
+        default:
+            throw logic_error("condition does not correspond to a single setcc");
+    }
+}
+
+void CompilationVisitor::write_loop_head_alignment(const CompoundStatement *loop)
+{
+    if (debug_flags & DebugFlag::NoLoopAlignment)
+    {
+        return;
+    }
+
+    // tiny loops get a whole 32-byte fetch block to themselves; small loops just
+    // get 16-byte alignment so they don't straddle as many fetch blocks. large
+    // loop bodies are dominated by what they do, not by the loop head, so we
+    // don't pad them at all. the padding is executed only once when the loop is
+    // entered (backward jumps go directly to the label after it)
+    size_t statement_count = count_statements(loop->items);
+    if (statement_count <= 4)
+    {
+        this->as.write_align(32);
+    }
+    else if (statement_count <= 16)
+    {
+        this->as.write_align(16);
+    }
+}
+
 bool CompilationVisitor::is_always_truthy(const Value &type)
 {
     return (type.type == ValueType::Function) ||
@@ -541,11 +787,114 @@ void CompilationVisitor::write_current_truth_value_test()
     }
 }
 
+void CompilationVisitor::write_condition_jump(Expression *condition,
+                                              const string &label, bool jump_if)
+{
+    // `not x` just inverts the jump
+    auto *unary = dynamic_cast<UnaryOperation *>(condition);
+    if (unary && (unary->oper == UnaryOperator::LogicalNot))
+    {
+        this->file_offset = unary->file_offset;
+        this->write_condition_jump(unary->expr.get(), label, !jump_if);
+        return;
+    }
+
+    auto *binary = dynamic_cast<BinaryOperation *>(condition);
+    if (binary && ((binary->oper == BinaryOperator::LogicalAnd) ||
+                   (binary->oper == BinaryOperator::LogicalOr)))
+    {
+        // `a and b` is false if either side is false, and `a or b` is true if
+        // either side is true; in these cases both sides can jump to the label.
+        // otherwise, the left side short-circuits past the right side's check
+        this->file_offset = binary->file_offset;
+        bool is_and = (binary->oper == BinaryOperator::LogicalAnd);
+        if (jump_if != is_and)
+        {
+            this->write_condition_jump(binary->left.get(), label, jump_if);
+            this->write_condition_jump(binary->right.get(), label, jump_if);
+        }
+        else
+        {
+            string short_circuit_label = string_printf(
+                    "__BinaryOperation_%p_short_circuit", binary);
+            this->write_condition_jump(binary->left.get(), short_circuit_label, !jump_if);
+            this->write_condition_jump(binary->right.get(), label, jump_if);
+            this->as.write_label(short_circuit_label);
+        }
+        return;
+    }
+
+    this->target_register = this->available_register();
+
+    // comparisons jump directly on the flags
+    if (binary && is_comparison_operator(binary->oper))
+    {
+        this->condition_jump_label = label;
+        this->condition_jump_if = jump_if;
+        binary->accept(this);
+        return;
+    }
+
+    // anything else is evaluated and truth-tested
+    condition->accept(this);
+    if (this->is_always_truthy(this->current_type) ||
+        this->is_always_falsey(this->current_type))
+    {
+        bool value = this->is_always_truthy(this->current_type);
+        this->write_delete_held_reference(MemoryReference(this->target_register));
+        if (value == jump_if)
+        {
+            this->as.write_jmp(label);
+        }
+        return;
+    }
+
+    if (!this->holding_reference)
+    {
+        this->write_current_truth_value_test();
+        if (jump_if)
+        {
+            this->as.write_jnz(label);
+        }
+        else
+        {
+            this->as.write_jz(label);
+        }
+        return;
+    }
+
+    // we're holding a reference to the value, so we have to save the truth
+    // value before releasing it
+    Register truth_reg = this->reserve_register(this->available_register_except(
+            {this->target_register}));
+    MemoryReference truth_mem(truth_reg);
+    this->write_current_truth_value_test();
+    this->as.write_mov(truth_reg, 0);
+    this->as.write_setnz(MemoryReference(byte_register_for_register(truth_reg)));
+    this->write_delete_held_reference(MemoryReference(this->target_register));
+    this->release_register(truth_reg);
+    this->as.write_test(truth_mem, truth_mem);
+    if (jump_if)
+    {
+        this->as.write_jnz(label);
+    }
+    else
+    {
+        this->as.write_jz(label);
+    }
+}
+
 void CompilationVisitor::visit(BinaryOperation *a)
 {
     this->file_offset = a->file_offset;
     this->assert_not_evaluating_instance_pointer();
 
+    // if this comparison is the condition of a branch, we'll jump directly
+    // instead of producing a Bool. the operands must not see the jump label
+    string jump_label = std::move(this->condition_jump_label);
+    bool jump_if = this->condition_jump_if;
+    this->condition_jump_label.clear();
+
     MemoryReference target_mem(this->target_register);
     MemoryReference float_target_mem(this->float_target_register);
 
@@ -627,6 +976,19 @@ void CompilationVisitor::visit(BinaryOperation *a)
         return;
     }
 
+    if (this->write_fused_multiply_add(a))
+    {
+        return;
+    }
+    if (this->write_compiled_format(a))
+    {
+        return;
+    }
+    if (this->write_constant_string_comparison(a, jump_label, jump_if))
+    {
+        return;
+    }
+
     // all of the remaining operators use both operands, so evaluate both of them
     // into different registers
     // TODO: it's kind of stupid that we push the result onto the stack; figure
@@ -635,6 +997,34 @@ void CompilationVisitor::visit(BinaryOperation *a)
     this->as.write_label(string_printf("__BinaryOperation_%p_evaluate_left", a));
     a->left->accept(this);
     Value left_type = std::move(this->current_type);
+
+    // numeric comparisons don't need the stack; they're done in registers
+    if (is_comparison_operator(a->oper) &&
+        ((left_type.type == ValueType::Int) ||
+         (left_type.type == ValueType::Bool) ||
+         (left_type.type == ValueType::Float)))
+    {
+        this->write_numeric_comparison(a, left_type, jump_label, jump_if);
+        return;
+    }
+
+    // float arithmetic is done entirely in xmm registers. if left is an Int but
+    // right is known to be a Float, convert left now so we can do the same
+    if (is_float_arithmetic_operator(a->oper))
+    {
+        if (((left_type.type == ValueType::Int) || (left_type.type == ValueType::Bool)) &&
+            this->is_static_float_expression(a->right.get()))
+        {
+            this->as.write_cvtsi2sd(this->float_target_register, target_mem);
+            left_type = Value(ValueType::Float);
+        }
+        if (left_type.type == ValueType::Float)
+        {
+            this->write_float_arithmetic(a);
+            return;
+        }
+    }
+
     if (left_type.type == ValueType::Float)
     {
         this->as.write_movq_from_xmm(target_mem, this->float_target_register);
@@ -665,6 +1055,9 @@ void CompilationVisitor::visit(BinaryOperation *a)
     }
     this->write_push(this->target_register); // for the destructor call later
     bool right_holding_reference = type_has_refcount(this->current_type.type);
+    // some operators below change current_type (which right_type refers to),
+    // so remember what right actually was for the cleanup
+    ValueType right_value_type = right_type.type;
     if (right_holding_reference && !this->holding_reference)
     {
         throw compile_error("non-held reference to right binary operator argument",
@@ -690,6 +1083,10 @@ void CompilationVisitor::visit(BinaryOperation *a)
     bool left_unicode = (left_type.type == ValueType::Unicode);
     bool right_unicode = (right_type.type == ValueType::Unicode);
     bool right_tuple = (right_type.type == ValueType::Tuple);
+    bool left_set = (left_type.type == ValueType::Set);
+    bool right_set = (right_type.type == ValueType::Set);
+    bool left_list = (left_type.type == ValueType::List);
+    bool right_list = (right_type.type == ValueType::List);
 
     this->as.write_label(string_printf("__BinaryOperation_%p_combine", a));
     switch (a->oper)
@@ -699,9 +1096,10 @@ void CompilationVisitor::visit(BinaryOperation *a)
         case BinaryOperator::LessOrEqual:
         case BinaryOperator::GreaterOrEqual:
 
-            // it's an error to ordered-compare disparate types to each other, except
-            // for numeric types
-            if ((!left_numeric || !right_numeric) && (left_type.type != right_type.type))
+            // it's an error to ordered-compare disparate types to each other.
+            // comparisons with a numeric left side don't get here; they're done
+            // by write_numeric_comparison
+            if (left_type.type != right_type.type)
             {
                 throw compile_error("cannot perform ordered comparison between " +
                                     left_type.str() + " and " + right_type.str(), this->file_offset);
@@ -709,124 +1107,7 @@ void CompilationVisitor::visit(BinaryOperation *a)
 
         case BinaryOperator::Equality:
         case BinaryOperator::NotEqual:
-            if (left_numeric && right_numeric)
-            {
-                Register xmm = this->available_register(Register::None, true);
-                MemoryReference xmm_mem(xmm);
-                this->as.write_xor(target_mem, target_mem);
-
-                // Int vs Int
-                if (left_int && right_int)
-                {
-                    this->as.write_mov(temp_mem, left_mem);
-                    this->as.write_cmp(temp_mem, right_mem);
-                    target_mem.base_register = byte_register_for_register(target_mem.base_register);
-                    if (a->oper == BinaryOperator::LessThan)
-                    {
-                        this->as.write_setl(target_mem);
-                    }
-                    else if (a->oper == BinaryOperator::GreaterThan)
-                    {
-                        this->as.write_setg(target_mem);
-                    }
-                    else if (a->oper == BinaryOperator::LessOrEqual)
-                    {
-                        this->as.write_setle(target_mem);
-                    }
-                    else if (a->oper == BinaryOperator::GreaterOrEqual)
-                    {
-                        this->as.write_setge(target_mem);
-                    }
-                    else if (a->oper == BinaryOperator::Equality)
-                    {
-                        this->as.write_sete(target_mem);
-                    }
-                    else if (a->oper == BinaryOperator::NotEqual)
-                    {
-                        this->as.write_setne(target_mem);
-                    }
-
-                    // Float vs Int
-                }
-                else if (left_float && right_int)
-                {
-                    this->as.write_cvtsi2sd(xmm, right_mem);
-
-                    // we're comparing in the opposite direction, so we negate the results
-                    // of ordered comparisons
-                    if (a->oper == BinaryOperator::LessThan)
-                    {
-                        this->as.write_cmpnltsd(xmm, left_mem);
-                    }
-                    else if (a->oper == BinaryOperator::GreaterThan)
-                    {
-                        this->as.write_cmplesd(xmm, left_mem);
-                    }
-                    else if (a->oper == BinaryOperator::LessOrEqual)
-                    {
-                        this->as.write_cmpnlesd(xmm, left_mem);
-                    }
-                    else if (a->oper == BinaryOperator::GreaterOrEqual)
-                    {
-                        this->as.write_cmpltsd(xmm, left_mem);
-                    }
-                    else if (a->oper == BinaryOperator::Equality)
-                    {
-                        this->as.write_cmpeqsd(xmm, left_mem);
-                    }
-                    else if (a->oper == BinaryOperator::NotEqual)
-                    {
-                        this->as.write_cmpneqsd(xmm, left_mem);
-                    }
-                    this->as.write_movq_from_xmm(target_mem, xmm);
-
-                    // Int vs Float and Float vs Float
-                }
-                else if (right_float)
-                {
-                    if (left_int)
-                    {
-                        this->as.write_cvtsi2sd(xmm, left_mem);
-                    }
-                    else
-                    {
-                        this->as.write_movsd(xmm_mem, left_mem);
-                    }
-                    if (a->oper == BinaryOperator::LessThan)
-                    {
-                        this->as.write_cmpltsd(xmm, right_mem);
-                    }
-                    else if (a->oper == BinaryOperator::GreaterThan)
-                    {
-                        this->as.write_cmpnlesd(xmm, right_mem);
-                    }
-                    else if (a->oper == BinaryOperator::LessOrEqual)
-                    {
-                        this->as.write_cmplesd(xmm, right_mem);
-                    }
-                    else if (a->oper == BinaryOperator::GreaterOrEqual)
-                    {
-                        this->as.write_cmpnltsd(xmm, right_mem);
-                    }
-                    else if (a->oper == BinaryOperator::Equality)
-                    {
-                        this->as.write_cmpeqsd(xmm, right_mem);
-                    }
-                    else if (a->oper == BinaryOperator::NotEqual)
-                    {
-                        this->as.write_cmpneqsd(xmm, right_mem);
-                    }
-                    this->as.write_movq_from_xmm(target_mem, xmm);
-
-                }
-                else
-                {
-                    throw compile_error("unimplemented numeric ordered comparison: " +
-                                        left_type.str() + " vs " + right_type.str(), this->file_offset);
-                }
-
-            }
-            else if ((left_bytes && right_bytes) || (left_unicode && right_unicode))
+            if ((left_bytes && right_bytes) || (left_unicode && right_unicode))
             {
 
                 if ((a->oper == BinaryOperator::Equality) ||
@@ -889,6 +1170,30 @@ void CompilationVisitor::visit(BinaryOperation *a)
                 this->write_function_call(target_function, {target_mem, left_mem}, {},
                                           -1, this->target_register);
 
+            }
+            else if (right_set)
+            {
+                if (right_type.extension_types.empty() ||
+                    !right_type.extension_types[0].types_equal(left_type))
+                {
+                    throw compile_error("operator `in` not valid for " + left_type.str() + " and " + right_type.str(),
+                                        this->file_offset);
+                }
+                this->write_function_call(common_object_reference(void_fn_ptr(&set_contains)),
+                                          {target_mem, left_mem}, {}, -1, this->target_register);
+
+            }
+            else if (right_type.type == ValueType::Dict)
+            {
+                if ((right_type.extension_types.size() != 2) ||
+                    !right_type.extension_types[0].types_equal(left_type))
+                {
+                    throw compile_error("operator `in` not valid for " + left_type.str() + " and " + right_type.str(),
+                                        this->file_offset);
+                }
+                this->write_inline_dictionary_lookup(a, right_type, target_mem, left_mem,
+                                                     this->target_register, true);
+
             }
             else
             {
@@ -972,6 +1277,12 @@ void CompilationVisitor::visit(BinaryOperation *a)
                 this->as.write_or(target_mem, left_mem);
                 break;
             }
+            if (left_set && right_set && left_type.types_equal(right_type))
+            {
+                this->write_function_call(common_object_reference(void_fn_ptr(&::set_union)),
+                                          {left_mem, target_mem, r14}, {}, -1, this->target_register);
+                break;
+            }
             throw compile_error("operator `or` not valid for " + left_type.str() + " and " + right_type.str(),
                                 this->file_offset);
 
@@ -981,6 +1292,12 @@ void CompilationVisitor::visit(BinaryOperation *a)
                 this->as.write_and(target_mem, left_mem);
                 break;
             }
+            if (left_set && right_set && left_type.types_equal(right_type))
+            {
+                this->write_function_call(common_object_reference(void_fn_ptr(&::set_intersection)),
+                                          {left_mem, target_mem, r14}, {}, -1, this->target_register);
+                break;
+            }
             throw compile_error("operator `and` not valid for " + left_type.str() + " and " + right_type.str(),
                                 this->file_offset);
 
@@ -1030,6 +1347,27 @@ void CompilationVisitor::visit(BinaryOperation *a)
                 this->write_function_call(common_object_reference(void_fn_ptr(&unicode_concat)),
                                           {left_mem, target_mem, r14}, {}, -1, this->target_register);
 
+            }
+            else if (left_list && right_list)
+            {
+                // an empty list constructor has an Indeterminate item type; the
+                // result has the other list's item type
+                const Value &left_item_type = left_type.extension_types.at(0);
+                const Value &right_item_type = right_type.extension_types.at(0);
+                bool left_known = (left_item_type.type != ValueType::Indeterminate);
+                bool right_known = (right_item_type.type != ValueType::Indeterminate);
+                if (left_known && right_known && (left_item_type != right_item_type))
+                {
+                    throw compile_error("cannot concatenate " + left_type.str() + " and " + right_type.str(),
+                                        this->file_offset);
+                }
+                this->write_function_call(common_object_reference(void_fn_ptr(&list_concat)),
+                                          {left_mem, target_mem, r14}, {}, -1, this->target_register);
+                if (!right_known)
+                {
+                    this->current_type = left_type;
+                }
+
             }
             else if (left_int && right_int)
             {
@@ -1126,6 +1464,22 @@ void CompilationVisitor::visit(BinaryOperation *a)
             {
                 this->as.write_mulsd(this->float_target_register, left_mem);
 
+            }
+            else if (left_list && right_int)
+            {
+                this->write_function_call(common_object_reference(void_fn_ptr(&list_repeat)),
+                                          {left_mem, target_mem, r14}, {}, -1, this->target_register);
+
+                // watch it: in this case the type is different from right_type
+                this->current_type = left_type;
+                this->holding_reference = true;
+
+            }
+            else if (left_int && right_list)
+            {
+                this->write_function_call(common_object_reference(void_fn_ptr(&list_repeat)),
+                                          {target_mem, left_mem, r14}, {}, -1, this->target_register);
+
             }
             else
             {
@@ -1185,7 +1539,8 @@ void CompilationVisitor::visit(BinaryOperation *a)
             if (left_bytes || left_unicode)
             {
                 // AnalysisVisitor should have already done the typechecking - all we
-                // have to do is call the right format function
+                // have to do is call the right format function. this is only used if
+                // the format isn't a constant (see write_compiled_format)
                 if (right_tuple)
                 {
                     const void *fn = left_bytes ?
@@ -1196,23 +1551,10 @@ void CompilationVisitor::visit(BinaryOperation *a)
                 }
                 else
                 {
-                    // in this case (unlike above) right might not be an object, so we
-                    // have to tell the callee whether it is or not
-                    Register r = available_register(rdx);
-                    MemoryReference r_mem(r);
-                    if (!right_holding_reference)
-                    {
-                        this->as.write_xor(r_mem, r_mem);
-                    }
-                    else
-                    {
-                        this->as.write_mov(r_mem, 1);
-                    }
-
                     const void *fn = left_bytes ?
                                      void_fn_ptr(&bytes_format_one) : void_fn_ptr(&unicode_format_one);
                     this->write_function_call(common_object_reference(fn),
-                                              {left_mem, right_mem, r_mem, r14}, {}, -1, this->target_register);
+                                              {left_mem, right_mem, r14}, {}, -1, this->target_register);
                 }
 
                 // if returned a new reference to a string of some sort
@@ -1422,16 +1764,16 @@ void CompilationVisitor::visit(BinaryOperation *a)
         // save the return value before destroying the temp values
         this->write_push(this->target_register);
 
-        // destroy the temp values
-        if (type_has_refcount(left_type.type))
+        // destroy the temp values. left was pushed first, so it's deeper
+        if (left_holding_reference)
         {
             this->as.write_label(string_printf("__BinaryOperation_%p_destroy_left", a));
-            this->write_delete_reference(MemoryReference(rsp, 8), left_type.type);
+            this->write_delete_reference(MemoryReference(rsp, 16), left_type.type);
         }
-        if (type_has_refcount(right_type.type))
+        if (right_holding_reference)
         {
             this->as.write_label(string_printf("__BinaryOperation_%p_destroy_right", a));
-            this->write_delete_reference(MemoryReference(rsp, 16), right_type.type);
+            this->write_delete_reference(MemoryReference(rsp, 8), right_value_type);
         }
 
         // load the result again and clean up the stack
@@ -1446,212 +1788,1480 @@ void CompilationVisitor::visit(BinaryOperation *a)
         this->adjust_stack(0x10);
     }
 
+    // if this is a branch condition, the result is a Bool; branch on it
+    if (!jump_label.empty())
+    {
+        MemoryReference result_mem(this->target_register);
+        this->as.write_test(result_mem, result_mem);
+        if (jump_if)
+        {
+            this->as.write_jnz(jump_label);
+        }
+        else
+        {
+            this->as.write_jz(jump_label);
+        }
+    }
+
     this->as.write_label(string_printf("__BinaryOperation_%p_complete", a));
 }
 
-void CompilationVisitor::visit(TernaryOperation *a)
+void CompilationVisitor::write_numeric_comparison(BinaryOperation *a,
+                                                  const Value &left_type, const string &jump_label, bool jump_if)
 {
-    this->file_offset = a->file_offset;
-    this->assert_not_evaluating_instance_pointer();
+    bool left_float = (left_type.type == ValueType::Float);
+    Register left_reg = left_float ? this->float_target_register : this->target_register;
+    Register prev_target_register = this->target_register;
+    Register prev_float_target_register = this->float_target_register;
+
+    // ints can be compared directly against small constants and variables in
+    // memory, so we don't need to evaluate the right side in those cases
+    Value right_type;
+    MemoryReference right_mem;
+    bool right_is_imm = false;
+    int64_t right_imm = 0;
+    bool right_evaluated = false;
+    if (!left_float)
+    {
+        auto *int_constant = dynamic_cast<IntegerConstant *>(a->right.get());
+        auto *variable = dynamic_cast<VariableLookup *>(a->right.get());
+        if (int_constant && (int_constant->value >= -0x80000000LL) &&
+            (int_constant->value <= 0x7FFFFFFFLL))
+        {
+            right_type = Value(ValueType::Int);
+            right_is_imm = true;
+            right_imm = int_constant->value;
+            right_evaluated = true;
 
-    if (a->oper != TernaryOperator::IfElse)
-    {
-        throw compile_error("unrecognized ternary operator", this->file_offset);
+        }
+        else if (variable)
+        {
+            VariableLocation loc = this->location_for_variable(variable->name);
+            if (loc.variable_mem_valid && ((loc.type.type == ValueType::Int) ||
+                                           (loc.type.type == ValueType::Bool)))
+            {
+                right_type = loc.type;
+                right_mem = loc.variable_mem;
+                right_evaluated = true;
+            }
+        }
     }
 
-    this->as.write_label(string_printf("__TernaryOperation_%p_evaluate", a));
-
-    // generate the condition evaluation
-    a->center->accept(this);
-
-    // if the value is always truthy or always falsey, don't bother generating the
-    // unused side
-    if (this->is_always_truthy(this->current_type))
-    {
-        this->write_delete_held_reference(MemoryReference(this->target_register));
-        a->left->accept(this);
-        return;
-    }
-    if (this->is_always_falsey(this->current_type))
+    // otherwise, evaluate the right side into a different register
+    if (!right_evaluated)
     {
-        this->write_delete_held_reference(MemoryReference(this->target_register));
-        a->right->accept(this);
-        return;
-    }
-
-    // left comes first in the code
-    string false_label = string_printf("TernaryOperation_%p_condition_false", a);
-    string end_label = string_printf("TernaryOperation_%p_end", a);
-    this->write_current_truth_value_test();
-    this->as.write_jz(false_label); // skip left
-
-    int64_t left_callsite_token = -1, right_callsite_token = -1;
+        this->reserve_register(left_reg, left_float);
+        if (left_float)
+        {
+            this->float_target_register = this->available_register(Register::None, true);
+        }
+        else
+        {
+            this->target_register = this->available_register();
+        }
 
-    // generate code for the left (True) value
-    this->write_delete_held_reference(MemoryReference(this->target_register));
-    try
-    {
-        a->left->accept(this);
-    } catch (const terminated_by_split &e)
-    {
-        left_callsite_token = e.callsite_token;
-    }
-    this->as.write_jmp(end_label);
-    Value left_type = this->current_type;
-    bool left_holding_reference = this->holding_reference;
+        this->as.write_label(string_printf("__BinaryOperation_%p_evaluate_right", a));
+        try
+        {
+            a->right->accept(this);
+        } catch (const terminated_by_split &)
+        {
+            this->release_register(left_reg, left_float);
+            this->target_register = prev_target_register;
+            this->float_target_register = prev_float_target_register;
+            throw;
+        }
+        right_type = this->current_type;
+        right_mem = MemoryReference((right_type.type == ValueType::Float) ?
+                                    this->float_target_register : this->target_register);
 
-    // generate code for the right (False) value
-    this->as.write_label(false_label);
-    this->write_delete_held_reference(MemoryReference(this->target_register));
-    try
-    {
-        a->right->accept(this);
-    } catch (const terminated_by_split &e)
-    {
-        right_callsite_token = e.callsite_token;
+        this->release_register(left_reg, left_float);
+        this->target_register = prev_target_register;
+        this->float_target_register = prev_float_target_register;
     }
-    this->as.write_label(end_label);
 
-    // if both of the values were terminated by a split, terminate the entire
-    // thing and don't typecheck
-    if ((left_callsite_token >= 0) && (right_callsite_token >= 0))
+    bool right_float = (right_type.type == ValueType::Float);
+    if (!right_float && (right_type.type != ValueType::Int) &&
+        (right_type.type != ValueType::Bool))
     {
-        throw terminated_by_split(left_callsite_token);
+        throw compile_error("unimplemented numeric comparison: " + left_type.str() +
+                            " vs " + right_type.str(), this->file_offset);
     }
 
-    // if right was terminated, use the type for left
-    if (right_callsite_token >= 0)
-    {
-        this->current_type = left_type;
-        this->holding_reference = left_holding_reference;
+    this->as.write_label(string_printf("__BinaryOperation_%p_combine", a));
 
-        // if neither was terminated, check that right and left have the same types
-    }
-    else if (left_callsite_token < 0)
+    Condition cond;
+    if (!left_float && !right_float)
     {
-        // TODO: support different value types (maybe by splitting the function)
-        if (!left_type.types_equal(this->current_type))
+        if (right_is_imm)
         {
-            string left_s = left_type.str();
-            string right_s = this->current_type.str();
-            throw compile_error(string_printf("ternary operator sides have different types (left is %s, right is %s)",
-                                              left_s.c_str(), right_s.c_str()), this->file_offset);
+            this->as.write_cmp(MemoryReference(left_reg), right_imm);
         }
-        if (left_holding_reference != this->holding_reference)
+        else
         {
-            throw compile_error("ternary operator sides have different reference semantics", this->file_offset);
+            this->as.write_cmp(MemoryReference(left_reg), right_mem);
         }
-    }
-}
-
-void CompilationVisitor::visit(ListConstructor *a)
-{
-    this->file_offset = a->file_offset;
-    this->assert_not_evaluating_instance_pointer();
-
-    this->as.write_label(string_printf("__ListConstructor_%p_setup", a));
-
-    // we'll use rbx to store the list ptr while constructing items and I'm lazy
-    if (this->target_register == rbx)
-    {
-        throw compile_error("cannot use rbx as target register for list construction", this->file_offset);
-    }
-    this->write_push(rbx);
-    int64_t previously_reserved_registers = this->write_push_reserved_registers();
+        cond = condition_for_int_comparison(a->oper);
 
-    // allocate the list object
-    this->as.write_label(string_printf("__ListConstructor_%p_allocate", a));
-    vector<MemoryReference> int_args({rdi, rsi, r14});
-    this->as.write_mov(int_args[0], a->items.size());
-    if (type_has_refcount(a->value_type.type))
-    {
-        this->as.write_mov(int_args[1], 1);
     }
     else
     {
-        this->as.write_xor(int_args[1], int_args[1]);
+        // get both values into xmm registers, converting ints as needed
+        Register left_xmm = left_reg;
+        Register right_xmm = right_mem.base_register;
+        if (!left_float)
+        {
+            left_xmm = this->available_register_except({right_xmm}, true);
+            this->as.write_cvtsi2sd(left_xmm, MemoryReference(left_reg));
+        }
+        if (!right_float)
+        {
+            Register int_reg = right_xmm;
+            right_xmm = this->available_register_except({left_xmm}, true);
+            this->as.write_cvtsi2sd(right_xmm, MemoryReference(int_reg));
+        }
+
+        // ucomisd sets the flags like an unsigned comparison, and unordered
+        // results (NaNs) set CF, ZF and PF. we only use the above/above-equal
+        // conditions (which are false when CF is set) for ordered comparisons,
+        // so NaNs always compare false
+        if ((a->oper == BinaryOperator::LessThan) ||
+            (a->oper == BinaryOperator::LessOrEqual))
+        {
+            this->as.write_ucomisd(right_xmm, MemoryReference(left_xmm));
+        }
+        else
+        {
+            this->as.write_ucomisd(left_xmm, MemoryReference(right_xmm));
+        }
+        cond = condition_for_float_comparison(a->oper);
     }
-    this->write_function_call(common_object_reference(void_fn_ptr(&list_new)),
-                              int_args, {}, -1, this->target_register);
 
-    // save the list items pointer
-    this->as.write_mov(rbx, MemoryReference(this->target_register, 0x28));
-    this->write_push(rax);
+    this->current_type = Value(ValueType::Bool);
+    this->holding_reference = false;
 
-    // generate code for each item and track the extension type
-    size_t item_index = 0;
-    for (const auto &item: a->items)
+    // if this is a branch condition, jump on the flags directly
+    if (!jump_label.empty())
     {
-        this->as.write_label(string_printf("__ListConstructor_%p_item_%zu", a, item_index));
-        try
-        {
-            item->accept(this);
-        } catch (const terminated_by_split &e)
+        if (!jump_if)
         {
-            // TODO: delete unfinished list object
-            this->adjust_stack(8);
-            this->as.write_pop(rbx);
-            throw;
+            cond = negate_condition(cond);
         }
 
-        if (this->current_type.type == ValueType::Float)
+        if (cond == Condition::OrderedEqual)
         {
-            this->as.write_movsd(MemoryReference(rbx, item_index * 8),
-                                 MemoryReference(this->float_target_register));
+            string unordered_label = string_printf("__BinaryOperation_%p_unordered", a);
+            this->as.write_jp(unordered_label);
+            this->as.write_je(jump_label);
+            this->as.write_label(unordered_label);
+        }
+        else if (cond == Condition::UnorderedNotEqual)
+        {
+            this->as.write_jne(jump_label);
+            this->as.write_jp(jump_label);
         }
         else
         {
-            this->as.write_mov(MemoryReference(rbx, item_index * 8),
-                               MemoryReference(this->target_register));
+            write_jcc_for_condition(this->as, cond, jump_label);
         }
-        item_index++;
 
-        // typecheck the value
-        if (!a->value_type.types_equal(this->current_type))
+        this->as.write_label(string_printf("__BinaryOperation_%p_complete", a));
+        return;
+    }
+
+    // otherwise, produce a Bool. note that mov doesn't affect the flags
+    MemoryReference target_mem(this->target_register);
+    MemoryReference target_byte_mem(byte_register_for_register(this->target_register));
+    this->as.write_mov(this->target_register, 0);
+    if ((cond == Condition::OrderedEqual) || (cond == Condition::UnorderedNotEqual))
+    {
+        Register tmp = this->available_register_except({this->target_register});
+        MemoryReference tmp_byte_mem(byte_register_for_register(tmp));
+        this->as.write_mov(tmp, 0);
+        if (cond == Condition::OrderedEqual)
+        {
+            this->as.write_sete(target_byte_mem);
+            this->as.write_setnp(tmp_byte_mem);
+            this->as.write_and(target_mem, MemoryReference(tmp));
+        }
+        else
         {
-            throw compile_error("list analysis produced different type than compilation: " +
-                                a->value_type.type_only().str() + " (analysis) vs " +
-                                this->current_type.type_only().str() + " (compilation)", this->file_offset);
+            this->as.write_setne(target_byte_mem);
+            this->as.write_setp(tmp_byte_mem);
+            this->as.write_or(target_mem, MemoryReference(tmp));
         }
     }
+    else
+    {
+        write_setcc_for_condition(this->as, cond, target_byte_mem);
+    }
 
-    // get the list pointer back
-    this->as.write_label(string_printf("__ListConstructor_%p_finalize", a));
-    this->write_pop(this->target_register);
-
-    // restore the regs we saved
-    this->write_pop_reserved_registers(previously_reserved_registers);
-    this->write_pop(rbx);
-
-    // the result type is a new reference to a List[extension_type]
-    vector<Value> extension_types({a->value_type});
-    this->current_type = Value(ValueType::List, extension_types);
-    this->holding_reference = true;
+    this->as.write_label(string_printf("__BinaryOperation_%p_complete", a));
 }
 
-void CompilationVisitor::visit(SetConstructor *a)
+bool CompilationVisitor::is_static_float_expression(Expression *a)
 {
-    this->file_offset = a->file_offset;
-    this->assert_not_evaluating_instance_pointer();
-
-    // TODO: generate malloc call, item constructor and insert code
-    throw compile_error("SetConstructor not yet implemented", this->file_offset);
-}
+    // returns true if the expression is known to produce a Float before it's
+    // evaluated, and evaluating it has no side effects
+    ValueType type = this->trivial_value_type(a);
+    if (type != ValueType::Indeterminate)
+    {
+        return type == ValueType::Float;
+    }
 
-void CompilationVisitor::visit(DictConstructor *a)
-{
-    this->file_offset = a->file_offset;
-    this->assert_not_evaluating_instance_pointer();
+    auto *op = dynamic_cast<BinaryOperation *>(a);
+    if (!op || !is_float_arithmetic_operator(op->oper))
+    {
+        return false;
+    }
 
-    // TODO: generate malloc call, item constructor and insert code
-    throw compile_error("DictConstructor not yet implemented", this->file_offset);
+    // arithmetic between a Float and an Int also produces a Float
+    bool left_float = this->is_static_float_expression(op->left.get());
+    bool right_float = this->is_static_float_expression(op->right.get());
+    ValueType left_type = this->trivial_value_type(op->left.get());
+    ValueType right_type = this->trivial_value_type(op->right.get());
+    return (left_float && right_float) ||
+           (left_float && ((right_type == ValueType::Int) || (right_type == ValueType::Bool))) ||
+           (right_float && ((left_type == ValueType::Int) || (left_type == ValueType::Bool)));
 }
 
-void CompilationVisitor::visit(TupleConstructor *a)
+void CompilationVisitor::write_float_operand(Expression *a)
 {
-    // TODO: deduplicate this with ListConstructor
-
-    this->file_offset = a->file_offset;
+    // evaluates the expression into float_target_register, converting it if
+    // it's an Int
+    a->accept(this);
+    if ((this->current_type.type == ValueType::Int) ||
+        (this->current_type.type == ValueType::Bool))
+    {
+        this->as.write_cvtsi2sd(this->float_target_register,
+                                MemoryReference(this->target_register));
+    }
+    else if (this->current_type.type != ValueType::Float)
+    {
+        throw compile_error("non-numeric operand in float expression: " +
+                            this->current_type.str(), this->file_offset);
+    }
+    this->current_type = Value(ValueType::Float);
+    this->holding_reference = false;
+}
+
+bool CompilationVisitor::write_fused_multiply_add(BinaryOperation *a)
+{
+    // a * b + c can be computed with one rounding step instead of two. this can
+    // change the last bit of the result, so it's disabled by StrictFloatRounding
+    if ((debug_flags & DebugFlag::StrictFloatRounding) || !cpu_has_fma() ||
+        ((a->oper != BinaryOperator::Addition) &&
+         (a->oper != BinaryOperator::Subtraction)))
+    {
+        return false;
+    }
+
+    bool product_on_left = true;
+    auto *product = dynamic_cast<BinaryOperation *>(a->left.get());
+    Expression *addend = a->right.get();
+    if (!product || (product->oper != BinaryOperator::Multiplication))
+    {
+        product_on_left = false;
+        product = dynamic_cast<BinaryOperation *>(a->right.get());
+        addend = a->left.get();
+    }
+    if (!product || (product->oper != BinaryOperator::Multiplication) ||
+        !this->is_static_float_expression(product) ||
+        !this->is_static_float_expression(a))
+    {
+        return false;
+    }
+
+    // none of the operands have side effects, so the evaluation order doesn't
+    // matter. float variables can be used directly as the addend
+    this->as.write_label(string_printf("__BinaryOperation_%p_fused_multiply_add", a));
+    Register result_reg = this->float_target_register;
+    this->write_float_operand(product->left.get());
+    this->reserve_register(result_reg, true);
+
+    Register multiplier_reg = this->available_float_temporary_register();
+    this->float_target_register = multiplier_reg;
+    this->write_float_operand(product->right.get());
+
+    MemoryReference addend_mem;
+    auto *addend_variable = dynamic_cast<VariableLookup *>(addend);
+    VariableLocation addend_loc;
+    if (addend_variable)
+    {
+        addend_loc = this->location_for_variable(addend_variable->name);
+    }
+    if (addend_variable && addend_loc.variable_mem_valid &&
+        (addend_loc.type.type == ValueType::Float))
+    {
+        addend_mem = addend_loc.variable_mem;
+    }
+    else
+    {
+        this->reserve_register(multiplier_reg, true);
+        this->float_target_register = this->available_float_temporary_register();
+        this->write_float_operand(addend);
+        this->release_register(multiplier_reg, true);
+        addend_mem = MemoryReference(this->float_target_register);
+    }
+    this->release_register(result_reg, true);
+    this->float_target_register = result_reg;
+
+    if (a->oper == BinaryOperator::Addition)
+    {
+        this->as.write_vfmadd213sd(result_reg, multiplier_reg, addend_mem);
+    }
+    else if (product_on_left)
+    {
+        this->as.write_vfmsub213sd(result_reg, multiplier_reg, addend_mem);
+    }
+    else
+    {
+        this->as.write_vfnmadd213sd(result_reg, multiplier_reg, addend_mem);
+    }
+
+    this->current_type = Value(ValueType::Float);
+    this->holding_reference = false;
+    return true;
+}
+
+void CompilationVisitor::write_float_arithmetic(BinaryOperation *a)
+{
+    // left is a Float in float_target_register. keep it there and evaluate right
+    // into a temporary register, so neither goes through memory
+    Register left_reg = this->float_target_register;
+    this->reserve_register(left_reg, true);
+    Register right_reg = this->available_float_temporary_register();
+    this->float_target_register = right_reg;
+
+    this->as.write_label(string_printf("__BinaryOperation_%p_evaluate_right", a));
+    try
+    {
+        a->right->accept(this);
+    } catch (const terminated_by_split &)
+    {
+        this->release_register(left_reg, true);
+        this->float_target_register = left_reg;
+        throw;
+    }
+    this->release_register(left_reg, true);
+    this->float_target_register = left_reg;
+
+    this->as.write_label(string_printf("__BinaryOperation_%p_combine", a));
+    if ((this->current_type.type == ValueType::Int) ||
+        (this->current_type.type == ValueType::Bool))
+    {
+        this->as.write_cvtsi2sd(right_reg, MemoryReference(this->target_register));
+    }
+    else if (this->current_type.type != ValueType::Float)
+    {
+        throw compile_error("arithmetic operator not implemented for Float and " +
+                            this->current_type.str(), this->file_offset);
+    }
+
+    // TODO: check if right is zero and raise ZeroDivisionError if so
+    MemoryReference right_mem(right_reg);
+    if (a->oper == BinaryOperator::Addition)
+    {
+        this->as.write_addsd(left_reg, right_mem);
+    }
+    else if (a->oper == BinaryOperator::Subtraction)
+    {
+        this->as.write_subsd(left_reg, right_mem);
+    }
+    else if (a->oper == BinaryOperator::Multiplication)
+    {
+        this->as.write_mulsd(left_reg, right_mem);
+    }
+    else
+    {
+        this->as.write_divsd(left_reg, right_mem);
+    }
+
+    this->current_type = Value(ValueType::Float);
+    this->holding_reference = false;
+}
+
+bool CompilationVisitor::write_compiled_format(BinaryOperation *a)
+{
+    // if the format string is a constant, parse it now instead of every time
+    // the expression is evaluated. AnalysisVisitor has already typechecked it
+    // against the arguments
+    if (a->oper != BinaryOperator::Modulus)
+    {
+        return false;
+    }
+    auto *bytes_format = dynamic_cast<BytesConstant *>(a->left.get());
+    auto *unicode_format = dynamic_cast<UnicodeConstant *>(a->left.get());
+    if (!bytes_format && !unicode_format)
+    {
+        return false;
+    }
+
+    const CompiledFormat *format;
+    try
+    {
+        if (bytes_format)
+        {
+            format = bytes_compile_format(const_cast<BytesObject *>(
+                    this->global->get_or_create_constant(bytes_format->value)));
+        }
+        else
+        {
+            format = unicode_compile_format(const_cast<UnicodeObject *>(
+                    this->global->get_or_create_constant(unicode_format->value)));
+        }
+    } catch (const invalid_argument &e)
+    {
+        throw compile_error(string("invalid format string: ") + e.what(), this->file_offset);
+    }
+
+    // the arguments are written to an array on the stack in the same order as
+    // they'd be in a tuple. if right is a tuple constructor, the items go into
+    // the array directly, so the tuple is never created
+    vector<Expression *> arg_exprs;
+    auto *tuple = dynamic_cast<TupleConstructor *>(a->right.get());
+    if (tuple)
+    {
+        for (const auto &item: tuple->items)
+        {
+            arg_exprs.emplace_back(item.get());
+        }
+    }
+    else
+    {
+        arg_exprs.emplace_back(a->right.get());
+    }
+    ssize_t args_size = arg_exprs.size() * sizeof(int64_t);
+
+    Register target_register = this->target_register;
+    this->adjust_stack(-args_size);
+    vector<Value> arg_types;
+    for (size_t x = 0; x < arg_exprs.size(); x++)
+    {
+        this->as.write_label(string_printf("__BinaryOperation_%p_evaluate_format_arg_%zu", a, x));
+        this->target_register = target_register;
+        try
+        {
+            arg_exprs[x]->accept(this);
+        } catch (const terminated_by_split &)
+        {
+            this->adjust_stack(args_size);
+            throw;
+        }
+        if (this->current_type.type == ValueType::Float)
+        {
+            this->as.write_movq_from_xmm(MemoryReference(target_register),
+                                         this->float_target_register);
+        }
+        else if (type_has_refcount(this->current_type.type) && !this->holding_reference)
+        {
+            throw compile_error("non-held reference to format argument", this->file_offset);
+        }
+        this->as.write_mov(MemoryReference(rsp, x * sizeof(int64_t)),
+                           MemoryReference(target_register));
+        arg_types.emplace_back(this->current_type);
+    }
+    this->target_register = target_register;
+
+    // the argument types may not have been known during analysis, so check
+    // them again now
+    bool args_in_tuple = !tuple && (arg_types[0].type == ValueType::Tuple);
+    try
+    {
+        const vector<Value> &types = args_in_tuple ? arg_types[0].extension_types : arg_types;
+        if (bytes_format)
+        {
+            bytes_typecheck_format(bytes_format->value, types);
+        }
+        else
+        {
+            unicode_typecheck_format(unicode_format->value, types);
+        }
+    } catch (const invalid_argument &e)
+    {
+        throw compile_error(string("invalid format arguments: ") + e.what(), this->file_offset);
+    }
+
+    // if right is some other expression that returns a tuple, use the tuple's
+    // items as the arguments
+    this->as.write_label(string_printf("__BinaryOperation_%p_format", a));
+    Register format_register = this->available_register_except({target_register, rsi});
+    Register args_register = this->available_register_except({target_register, format_register});
+    this->as.write_mov(format_register, reinterpret_cast<int64_t>(format));
+    if (args_in_tuple)
+    {
+        this->as.write_mov(MemoryReference(args_register), MemoryReference(rsp, 0));
+        this->as.write_lea(args_register, MemoryReference(args_register, 0x18));
+    }
+    else
+    {
+        this->as.write_lea(args_register, MemoryReference(rsp, 0));
+    }
+    const void *fn = bytes_format ?
+                     void_fn_ptr(&bytes_format_compiled) : void_fn_ptr(&unicode_format_compiled);
+    this->write_function_call(common_object_reference(fn),
+                              {MemoryReference(format_register), MemoryReference(args_register), r14},
+                              {}, -1, target_register);
+
+    // delete the references to the arguments, saving the result while doing so
+    bool any_arg_has_refcount = false;
+    for (const Value &type: arg_types)
+    {
+        any_arg_has_refcount |= type_has_refcount(type.type);
+    }
+    if (any_arg_has_refcount)
+    {
+        this->as.write_label(string_printf("__BinaryOperation_%p_destroy_format_args", a));
+        this->write_push(target_register);
+        for (size_t x = 0; x < arg_types.size(); x++)
+        {
+            this->write_delete_reference(MemoryReference(rsp, (x + 1) * sizeof(int64_t)),
+                                         arg_types[x].type);
+        }
+        this->write_pop(target_register);
+    }
+    this->adjust_stack(args_size);
+
+    this->current_type = Value(bytes_format ? ValueType::Bytes : ValueType::Unicode);
+    this->holding_reference = true;
+    return true;
+}
+
+bool CompilationVisitor::write_constant_string_comparison(BinaryOperation *a,
+                                                          const string &jump_label, bool jump_if)
+{
+    // == and != against a short constant string are compiled inline: the
+    // length (and kind, for str) is checked first, then the contents are
+    // compared against immediates, 8 bytes at a time
+    if ((a->oper != BinaryOperator::Equality) && (a->oper != BinaryOperator::NotEqual))
+    {
+        return false;
+    }
+    Expression *constant_expr = a->right.get();
+    Expression *other_expr = a->left.get();
+    if (!dynamic_cast<BytesConstant *>(constant_expr) &&
+        !dynamic_cast<UnicodeConstant *>(constant_expr))
+    {
+        swap(constant_expr, other_expr);
+    }
+    auto *bytes_constant = dynamic_cast<BytesConstant *>(constant_expr);
+    auto *unicode_constant = dynamic_cast<UnicodeConstant *>(constant_expr);
+    if (!bytes_constant && !unicode_constant)
+    {
+        return false;
+    }
+
+    ValueType expected_type;
+    size_t count;
+    const uint8_t *data;
+    size_t data_size;
+    uint32_t kind = UnicodeKind::Latin1;
+    if (bytes_constant)
+    {
+        const BytesObject *constant = this->global->get_or_create_constant(bytes_constant->value);
+        expected_type = ValueType::Bytes;
+        count = constant->count;
+        data = reinterpret_cast<const uint8_t *>(constant->data);
+        data_size = constant->count;
+    }
+    else
+    {
+        const UnicodeObject *constant = this->global->get_or_create_constant(unicode_constant->value);
+        expected_type = ValueType::Unicode;
+        count = constant->count;
+        kind = constant->kind;
+        data = constant->latin1;
+        data_size = constant->count * constant->kind;
+    }
+    if (data_size > 64)
+    {
+        return false;
+    }
+
+    this->as.write_label(string_printf("__BinaryOperation_%p_evaluate_nonconstant", a));
+    other_expr->accept(this);
+    if (this->current_type.type != expected_type)
+    {
+        throw compile_error("unimplemented non-numeric ordered comparison: " +
+                            this->current_type.str() + " vs " +
+                            Value(expected_type).str(), this->file_offset);
+    }
+
+    Register object_register = this->target_register;
+    Register result_register = this->available_register_except({object_register});
+    MemoryReference result_mem(result_register);
+    string mismatch_label = string_printf("__BinaryOperation_%p_mismatch", a);
+
+    this->as.write_label(string_printf("__BinaryOperation_%p_combine", a));
+    this->as.write_xor(result_mem, result_mem);
+    this->as.write_cmp(MemoryReference(object_register, 0x10), count);
+    this->as.write_jne(mismatch_label);
+    // kinds are canonical, so a str of a different kind is never equal (but
+    // empty strs are equal whatever their kinds)
+    if (unicode_constant && count)
+    {
+        this->as.write_cmp(MemoryReference(object_register, 0x24), kind,
+                           OperandSize::DoubleWord);
+        this->as.write_jne(mismatch_label);
+    }
+
+    // compare 8 bytes at a time; if the size isn't a multiple of 8, the last
+    // comparison overlaps the previous one. strings shorter than 8 bytes are
+    // compared in 4, 2 and 1-byte pieces instead
+    for (size_t offset = 0; offset < data_size;)
+    {
+        size_t piece_size;
+        if (data_size >= 8)
+        {
+            piece_size = 8;
+            offset = min<size_t>(offset, data_size - 8);
+        }
+        else
+        {
+            size_t remaining = data_size - offset;
+            piece_size = (remaining >= 4) ? 4 : ((remaining >= 2) ? 2 : 1);
+        }
+
+        int64_t value = 0;
+        memcpy(&value, &data[offset], piece_size);
+        MemoryReference piece_mem(object_register, 0x30 + offset);
+        if (piece_size == 8)
+        {
+            if ((value >= -0x80000000LL) && (value <= 0x7FFFFFFFLL))
+            {
+                this->as.write_cmp(piece_mem, value);
+            }
+            else
+            {
+                // result_register is zero at this point, and it's zeroed
+                // again afterward
+                this->as.write_mov(result_register, value);
+                this->as.write_cmp(piece_mem, result_mem);
+                this->as.write_mov(result_register, 0);
+            }
+        }
+        else
+        {
+            // the assembler wants the immediate sign-extended to 64 bits
+            OperandSize size;
+            if (piece_size == 4)
+            {
+                size = OperandSize::DoubleWord;
+                value = static_cast<int32_t>(value);
+            }
+            else if (piece_size == 2)
+            {
+                size = OperandSize::Word;
+                value = static_cast<int16_t>(value);
+            }
+            else
+            {
+                size = OperandSize::Byte;
+                value = static_cast<int8_t>(value);
+            }
+            this->as.write_cmp(piece_mem, value, size);
+        }
+        this->as.write_jne(mismatch_label);
+        offset += piece_size;
+    }
+    this->as.write_mov(result_register, 1);
+    this->as.write_label(mismatch_label);
+    if (a->oper == BinaryOperator::NotEqual)
+    {
+        this->as.write_xor(result_mem, 1);
+    }
+
+    if (this->holding_reference)
+    {
+        this->write_push(result_register);
+        this->write_delete_held_reference(MemoryReference(object_register));
+        this->write_pop(this->target_register);
+    }
+    else
+    {
+        this->as.write_mov(MemoryReference(this->target_register), result_mem);
+    }
+    this->current_type = Value(ValueType::Bool);
+    this->holding_reference = false;
+
+    if (!jump_label.empty())
+    {
+        MemoryReference target_mem(this->target_register);
+        this->as.write_test(target_mem, target_mem);
+        if (jump_if)
+        {
+            this->as.write_jnz(jump_label);
+        }
+        else
+        {
+            this->as.write_jz(jump_label);
+        }
+    }
+    this->as.write_label(string_printf("__BinaryOperation_%p_complete", a));
+    return true;
+}
+
+void CompilationVisitor::visit(TernaryOperation *a)
+{
+    this->file_offset = a->file_offset;
+    this->assert_not_evaluating_instance_pointer();
+
+    if (a->oper != TernaryOperator::IfElse)
+    {
+        throw compile_error("unrecognized ternary operator", this->file_offset);
+    }
+
+    if (this->write_float_min_max(a))
+    {
+        return;
+    }
+
+    this->as.write_label(string_printf("__TernaryOperation_%p_evaluate", a));
+
+    // generate the condition evaluation
+    a->center->accept(this);
+
+    // if the value is always truthy or always falsey, don't bother generating the
+    // unused side
+    if (this->is_always_truthy(this->current_type))
+    {
+        this->write_delete_held_reference(MemoryReference(this->target_register));
+        a->left->accept(this);
+        return;
+    }
+    if (this->is_always_falsey(this->current_type))
+    {
+        this->write_delete_held_reference(MemoryReference(this->target_register));
+        a->right->accept(this);
+        return;
+    }
+
+    if (this->write_branchless_ternary(a))
+    {
+        return;
+    }
+
+    // left comes first in the code
+    string false_label = string_printf("TernaryOperation_%p_condition_false", a);
+    string end_label = string_printf("TernaryOperation_%p_end", a);
+    this->write_current_truth_value_test();
+    this->as.write_jz(false_label); // skip left
+
+    int64_t left_callsite_token = -1, right_callsite_token = -1;
+
+    // generate code for the left (True) value
+    this->write_delete_held_reference(MemoryReference(this->target_register));
+    try
+    {
+        a->left->accept(this);
+    } catch (const terminated_by_split &e)
+    {
+        left_callsite_token = e.callsite_token;
+    }
+    this->as.write_jmp(end_label);
+    Value left_type = this->current_type;
+    bool left_holding_reference = this->holding_reference;
+
+    // generate code for the right (False) value
+    this->as.write_label(false_label);
+    this->write_delete_held_reference(MemoryReference(this->target_register));
+    try
+    {
+        a->right->accept(this);
+    } catch (const terminated_by_split &e)
+    {
+        right_callsite_token = e.callsite_token;
+    }
+    this->as.write_label(end_label);
+
+    // if both of the values were terminated by a split, terminate the entire
+    // thing and don't typecheck
+    if ((left_callsite_token >= 0) && (right_callsite_token >= 0))
+    {
+        throw terminated_by_split(left_callsite_token);
+    }
+
+    // if right was terminated, use the type for left
+    if (right_callsite_token >= 0)
+    {
+        this->current_type = left_type;
+        this->holding_reference = left_holding_reference;
+
+        // if neither was terminated, check that right and left have the same types
+    }
+    else if (left_callsite_token < 0)
+    {
+        // TODO: support different value types (maybe by splitting the function)
+        if (!left_type.types_equal(this->current_type))
+        {
+            string left_s = left_type.str();
+            string right_s = this->current_type.str();
+            throw compile_error(string_printf("ternary operator sides have different types (left is %s, right is %s)",
+                                              left_s.c_str(), right_s.c_str()), this->file_offset);
+        }
+        if (left_holding_reference != this->holding_reference)
+        {
+            throw compile_error("ternary operator sides have different reference semantics", this->file_offset);
+        }
+    }
+}
+
+ValueType CompilationVisitor::trivial_value_type(Expression *a)
+{
+    // returns the type of the expression if it can be evaluated without side
+    // effects, branches, or reference counting (constants and variables holding
+    // numeric values), or Indeterminate otherwise
+    if (dynamic_cast<IntegerConstant *>(a))
+    {
+        return ValueType::Int;
+    }
+    if (dynamic_cast<FloatConstant *>(a))
+    {
+        return ValueType::Float;
+    }
+    if (dynamic_cast<TrueConstant *>(a) || dynamic_cast<FalseConstant *>(a))
+    {
+        return ValueType::Bool;
+    }
+
+    auto *variable = dynamic_cast<VariableLookup *>(a);
+    if (variable)
+    {
+        try
+        {
+            VariableLocation loc = this->location_for_variable(variable->name);
+            if ((loc.type.type == ValueType::Int) || (loc.type.type == ValueType::Float) ||
+                (loc.type.type == ValueType::Bool))
+            {
+                return loc.type.type;
+            }
+        } catch (const compile_error &)
+        {
+        }
+    }
+    return ValueType::Indeterminate;
+}
+
+bool CompilationVisitor::write_float_min_max(TernaryOperation *a)
+{
+    // `x if x < y else y` and its variants are exactly what minsd and maxsd
+    // compute (including for NaNs, where both return the second operand), so we
+    // don't need to evaluate the condition at all. this doesn't apply to <= and
+    // >= since those differ from minsd/maxsd for 0.0 vs. -0.0
+    auto *condition = dynamic_cast<BinaryOperation *>(a->center.get());
+    if (!condition || ((condition->oper != BinaryOperator::LessThan) &&
+                       (condition->oper != BinaryOperator::GreaterThan)))
+    {
+        return false;
+    }
+
+    auto *condition_left = dynamic_cast<VariableLookup *>(condition->left.get());
+    auto *condition_right = dynamic_cast<VariableLookup *>(condition->right.get());
+    auto *true_value = dynamic_cast<VariableLookup *>(a->left.get());
+    auto *false_value = dynamic_cast<VariableLookup *>(a->right.get());
+    if (!condition_left || !condition_right || !true_value || !false_value ||
+        (condition_left->name == condition_right->name) ||
+        (this->trivial_value_type(condition_left) != ValueType::Float) ||
+        (this->trivial_value_type(condition_right) != ValueType::Float))
+    {
+        return false;
+    }
+
+    // the result is the first operand if the comparison between it and the
+    // second operand is true (for minsd, if first < second)
+    bool use_min;
+    if ((true_value->name == condition_left->name) &&
+        (false_value->name == condition_right->name))
+    {
+        use_min = (condition->oper == BinaryOperator::LessThan);
+    }
+    else if ((true_value->name == condition_right->name) &&
+             (false_value->name == condition_left->name))
+    {
+        use_min = (condition->oper == BinaryOperator::GreaterThan);
+    }
+    else
+    {
+        return false;
+    }
+
+    this->as.write_label(string_printf("__TernaryOperation_%p_min_max", a));
+    Register prev_float_target_register = this->float_target_register;
+    VariableLocation first_loc = this->location_for_variable(true_value->name);
+    VariableLocation second_loc = this->location_for_variable(false_value->name);
+    this->write_read_variable(this->target_register, this->float_target_register, first_loc);
+
+    MemoryReference second_mem;
+    if (second_loc.variable_mem_valid)
+    {
+        second_mem = second_loc.variable_mem;
+    }
+    else
+    {
+        this->reserve_register(this->float_target_register, true);
+        second_mem = MemoryReference(this->available_register(Register::None, true));
+        this->release_register(this->float_target_register, true);
+        this->write_read_variable(this->target_register, second_mem.base_register, second_loc);
+    }
+
+    if (use_min)
+    {
+        this->as.write_minsd(this->float_target_register, second_mem);
+    }
+    else
+    {
+        this->as.write_maxsd(this->float_target_register, second_mem);
+    }
+
+    this->float_target_register = prev_float_target_register;
+    this->current_type = Value(ValueType::Float);
+    this->holding_reference = false;
+    return true;
+}
+
+bool CompilationVisitor::write_branchless_ternary(TernaryOperation *a)
+{
+    // if the condition has already been evaluated to an Int or Bool and both
+    // sides are trivial, we can evaluate both sides and pick one with cmov. this
+    // avoids a mispredicted branch when the condition is unpredictable
+    if ((this->current_type.type != ValueType::Int) &&
+        (this->current_type.type != ValueType::Bool))
+    {
+        return false;
+    }
+    ValueType value_type = this->trivial_value_type(a->left.get());
+    if ((value_type == ValueType::Indeterminate) ||
+        (value_type != this->trivial_value_type(a->right.get())))
+    {
+        return false;
+    }
+    bool is_float = (value_type == ValueType::Float);
+
+    this->as.write_label(string_printf("__TernaryOperation_%p_select", a));
+    Register condition_reg = this->target_register;
+    Register prev_float_target_register = this->float_target_register;
+    this->reserve_register(condition_reg);
+
+    // evaluate the false value into the register the result will end up in.
+    // int variables in memory can be used directly as the cmov source, so we
+    // only need a second register for the true value otherwise
+    Register false_reg = this->available_register();
+    this->target_register = false_reg;
+    a->right->accept(this);
+
+    MemoryReference true_mem;
+    auto *true_variable = dynamic_cast<VariableLookup *>(a->left.get());
+    VariableLocation true_loc;
+    if (true_variable && !is_float)
+    {
+        true_loc = this->location_for_variable(true_variable->name);
+    }
+    if (true_variable && !is_float && true_loc.variable_mem_valid)
+    {
+        true_mem = true_loc.variable_mem;
+    }
+    else
+    {
+        this->reserve_register(is_float ? this->float_target_register : false_reg, is_float);
+        if (is_float)
+        {
+            this->float_target_register = this->available_register(Register::None, true);
+        }
+        else
+        {
+            this->target_register = this->available_register();
+        }
+        a->left->accept(this);
+        this->release_register(is_float ? prev_float_target_register : false_reg, is_float);
+        true_mem = MemoryReference(this->target_register);
+    }
+
+    // floats are selected as raw bits in int registers
+    if (is_float)
+    {
+        Register true_reg = this->available_register_except({false_reg});
+        this->as.write_movq_from_xmm(MemoryReference(false_reg), prev_float_target_register);
+        this->as.write_movq_from_xmm(MemoryReference(true_reg), this->float_target_register);
+        true_mem = MemoryReference(true_reg);
+    }
+
+    MemoryReference condition_mem(condition_reg);
+    this->as.write_test(condition_mem, condition_mem);
+    this->as.write_cmovnz(false_reg, true_mem);
+    this->release_register(condition_reg);
+
+    this->target_register = condition_reg;
+    this->float_target_register = prev_float_target_register;
+    if (is_float)
+    {
+        this->as.write_movq_to_xmm(this->float_target_register, MemoryReference(false_reg));
+    }
+    else
+    {
+        this->as.write_mov(MemoryReference(this->target_register), MemoryReference(false_reg));
+    }
+
+    this->current_type = Value(value_type);
+    this->holding_reference = false;
+    return true;
+}
+
+void CompilationVisitor::visit(ListConstructor *a)
+{
+    this->file_offset = a->file_offset;
+    this->assert_not_evaluating_instance_pointer();
+
+    this->as.write_label(string_printf("__ListConstructor_%p_setup", a));
+
+    // we'll use rbx to store the list ptr while constructing items and I'm lazy
+    if (this->target_register == rbx)
+    {
+        throw compile_error("cannot use rbx as target register for list construction", this->file_offset);
+    }
+    this->write_push(rbx);
+    int64_t previously_reserved_registers = this->write_push_reserved_registers();
+
+    // allocate the list object
+    this->as.write_label(string_printf("__ListConstructor_%p_allocate", a));
+    vector<MemoryReference> int_args({rdi, rsi, r14});
+    this->as.write_mov(int_args[0], a->items.size());
+    if (type_has_refcount(a->value_type.type))
+    {
+        this->as.write_mov(int_args[1], 1);
+    }
+    else
+    {
+        this->as.write_xor(int_args[1], int_args[1]);
+    }
+    this->write_function_call(common_object_reference(void_fn_ptr(&list_new)),
+                              int_args, {}, -1, this->target_register);
+
+    // save the list items pointer
+    this->as.write_mov(rbx, MemoryReference(this->target_register, 0x28));
+    this->write_push(rax);
+
+    // generate code for each item and track the extension type
+    size_t item_index = 0;
+    for (const auto &item: a->items)
+    {
+        this->as.write_label(string_printf("__ListConstructor_%p_item_%zu", a, item_index));
+        try
+        {
+            item->accept(this);
+        } catch (const terminated_by_split &e)
+        {
+            // TODO: delete unfinished list object
+            this->adjust_stack(8);
+            this->as.write_pop(rbx);
+            throw;
+        }
+
+        if (this->current_type.type == ValueType::Float)
+        {
+            this->as.write_movsd(MemoryReference(rbx, item_index * 8),
+                                 MemoryReference(this->float_target_register));
+        }
+        else
+        {
+            this->as.write_mov(MemoryReference(rbx, item_index * 8),
+                               MemoryReference(this->target_register));
+        }
+        item_index++;
+
+        // typecheck the value
+        if (!a->value_type.types_equal(this->current_type))
+        {
+            throw compile_error("list analysis produced different type than compilation: " +
+                                a->value_type.type_only().str() + " (analysis) vs " +
+                                this->current_type.type_only().str() + " (compilation)", this->file_offset);
+        }
+    }
+
+    // get the list pointer back
+    this->as.write_label(string_printf("__ListConstructor_%p_finalize", a));
+    this->write_pop(this->target_register);
+
+    // restore the regs we saved
+    this->write_pop_reserved_registers(previously_reserved_registers);
+    this->write_pop(rbx);
+
+    // the result type is a new reference to a List[extension_type]
+    vector<Value> extension_types({a->value_type});
+    this->current_type = Value(ValueType::List, extension_types);
+    this->holding_reference = true;
+}
+
+void CompilationVisitor::visit(SetConstructor *a)
+{
+    this->file_offset = a->file_offset;
+    this->assert_not_evaluating_instance_pointer();
+
+    this->as.write_label(string_printf("__SetConstructor_%p_setup", a));
+    int64_t previously_reserved_registers = this->write_push_reserved_registers();
+
+    // the hash functions depend on the item type, which analysis may not know
+    // (e.g. if the items are function arguments), so we evaluate all the items
+    // before creating the set. the set pointer goes in the first stack slot and
+    // the items go in the following slots
+    size_t stack_bytes = ((a->items.size() + 2) * 8) & ~0x0F;
+    this->adjust_stack(-stack_bytes);
+    ssize_t slots_stack_bytes_used = this->stack_bytes_used;
+
+    Value item_type = a->value_type;
+
+    // if an item raises, the references held in the slots before it would be
+    // lost. to avoid this, we clear the slots and evaluate the items inside an
+    // exception block that deletes them and continues unwinding. we skip this
+    // if the items can't hold references or nothing after the first can raise
+    vector<Expression *> item_exprs;
+    for (const auto &item: a->items)
+    {
+        item_exprs.emplace_back(item.get());
+    }
+    bool use_cleanup_block = ((item_type.type == ValueType::Indeterminate) ||
+                              type_has_refcount(item_type.type)) &&
+                             any_expression_may_raise(item_exprs, 1);
+    string cleanup_label = string_printf("__SetConstructor_%p_cleanup", a);
+    size_t slots_offset = 0;
+    if (use_cleanup_block)
+    {
+        this->as.write_label(string_printf("__SetConstructor_%p_create_exc_block", a));
+        for (size_t x = 0; x < a->items.size(); x++)
+        {
+            this->as.write_mov(MemoryReference(rsp, (x + 1) * 8), 0);
+        }
+        this->write_create_exception_block({}, cleanup_label);
+        slots_offset = this->stack_bytes_used - slots_stack_bytes_used;
+    }
+
+    // deletes the items evaluated so far, then continues unwinding. the stack
+    // is already at slots_stack_bytes_used when we get here
+    auto write_cleanup = [&](size_t items_evaluated)
+    {
+        this->as.write_label(cleanup_label);
+        this->adjust_stack_to(slots_stack_bytes_used, false);
+        if (type_has_refcount(item_type.type))
+        {
+            for (size_t x = 0; x < items_evaluated; x++)
+            {
+                this->write_delete_reference(MemoryReference(rsp, (x + 1) * 8),
+                                             item_type.type);
+            }
+        }
+        this->as.write_jmp(common_object_reference(void_fn_ptr(&_unwind_exception_internal)));
+    };
+
+    size_t item_index = 0;
+    for (const auto &item: a->items)
+    {
+        this->as.write_label(string_printf("__SetConstructor_%p_item_%zu", a, item_index));
+        try
+        {
+            item->accept(this);
+        } catch (const terminated_by_split &e)
+        {
+            // the split can return only if it raised an exception, which the
+            // cleanup block handles. the code after this point is unreachable,
+            // but we still have to keep the stack offset consistent
+            if (use_cleanup_block)
+            {
+                write_cleanup(item_index);
+            }
+            this->adjust_stack_to(slots_stack_bytes_used, false);
+            this->adjust_stack(stack_bytes);
+            this->write_pop_reserved_registers(previously_reserved_registers);
+            throw;
+        }
+
+        // typecheck the value. all items must have the same type
+        if (item_type.type == ValueType::Indeterminate)
+        {
+            item_type = this->current_type.type_only();
+        }
+        else if (!item_type.types_equal(this->current_type))
+        {
+            throw compile_error("set items have different types: " +
+                                item_type.type_only().str() + " and " +
+                                this->current_type.type_only().str(), this->file_offset);
+        }
+        if (type_has_refcount(item_type.type) && !this->holding_reference)
+        {
+            throw compile_error("not holding reference to set item", this->file_offset);
+        }
+
+        this->as.write_mov(MemoryReference(rsp, slots_offset + (item_index + 1) * 8),
+                           MemoryReference(this->target_register));
+        item_index++;
+    }
+
+    // remove the exception block and skip over its handler
+    string allocate_label = string_printf("__SetConstructor_%p_allocate", a);
+    if (use_cleanup_block)
+    {
+        this->as.write_label(string_printf("__SetConstructor_%p_remove_exc_block", a));
+        this->as.write_mov(r14, MemoryReference(rsp, 0));
+        this->adjust_stack_to(slots_stack_bytes_used);
+        this->as.write_jmp(allocate_label);
+        write_cleanup(a->items.size());
+    }
+
+    // allocate the set object
+    this->as.write_label(allocate_label);
+    bool items_are_objects = type_has_refcount(item_type.type);
+    this->write_set_new(item_type);
+    this->as.write_mov(MemoryReference(rsp, 0), MemoryReference(this->target_register));
+
+    // add the items. set_add adds its own reference to each item, so we delete
+    // the references we're holding afterward
+    for (item_index = 0; item_index < a->items.size(); item_index++)
+    {
+        this->as.write_label(string_printf("__SetConstructor_%p_add_item_%zu", a, item_index));
+        MemoryReference item_mem(rsp, (item_index + 1) * 8);
+        this->as.write_mov(rdi, MemoryReference(rsp, 0));
+        this->as.write_mov(rsi, item_mem);
+        this->write_function_call(common_object_reference(void_fn_ptr(&set_add)),
+                                  {rdi, rsi, r14}, {});
+        if (items_are_objects)
+        {
+            this->write_delete_reference(item_mem, item_type.type);
+        }
+    }
+
+    // get the set pointer back
+    this->as.write_label(string_printf("__SetConstructor_%p_finalize", a));
+    this->as.write_mov(MemoryReference(this->target_register), MemoryReference(rsp, 0));
+    this->adjust_stack(stack_bytes);
+    this->write_pop_reserved_registers(previously_reserved_registers);
+
+    // the result type is a new reference to a Set[item_type]
+    vector<Value> extension_types({item_type});
+    this->current_type = Value(ValueType::Set, extension_types);
+    this->holding_reference = true;
+}
+
+void CompilationVisitor::write_set_new(const Value &item_type)
+{
+    // creates an empty set for the given type and puts it in target_register
+    HashFunctions fns = hash_functions_for_type(item_type.type, this->file_offset);
+    vector<MemoryReference> int_args({rdi, rsi, rdx, r14});
+    if (fns.key_hash)
+    {
+        this->as.write_mov(int_args[0], common_object_reference(void_fn_ptr(fns.key_hash)));
+        this->as.write_mov(int_args[1], common_object_reference(void_fn_ptr(fns.key_equal)));
+    }
+    else
+    {
+        this->as.write_xor(int_args[0], int_args[0]);
+        this->as.write_xor(int_args[1], int_args[1]);
+    }
+    this->as.write_mov(int_args[2], type_has_refcount(item_type.type));
+    this->write_function_call(common_object_reference(void_fn_ptr(&set_new)),
+                              int_args, {}, -1, this->target_register);
+}
+
+void CompilationVisitor::write_dictionary_new(const Value &key_type,
+                                              const Value &value_type)
+{
+    // creates an empty dict for the given types and puts it in target_register
+    HashFunctions fns = hash_functions_for_type(key_type.type, this->file_offset);
+    bool keys_are_objects = type_has_refcount(key_type.type);
+    bool values_are_objects = type_has_refcount(value_type.type);
+    vector<MemoryReference> int_args({rdi, rsi, rdx, r14});
+    if (fns.key_hash)
+    {
+        this->as.write_mov(int_args[0], common_object_reference(void_fn_ptr(fns.key_hash)));
+        this->as.write_mov(int_args[1], common_object_reference(void_fn_ptr(fns.key_equal)));
+    }
+    else
+    {
+        this->as.write_xor(int_args[0], int_args[0]);
+        this->as.write_xor(int_args[1], int_args[1]);
+    }
+    this->as.write_mov(int_args[2], (keys_are_objects ? DictionaryFlag::KeysAreObjects : 0) |
+                                    (values_are_objects ? DictionaryFlag::ValuesAreObjects : 0));
+    this->write_function_call(common_object_reference(void_fn_ptr(&dictionary_new)),
+                              int_args, {}, -1, this->target_register);
+}
+
+void CompilationVisitor::visit(DictConstructor *a)
+{
+    this->file_offset = a->file_offset;
+    this->assert_not_evaluating_instance_pointer();
+
+    this->as.write_label(string_printf("__DictConstructor_%p_setup", a));
+    int64_t previously_reserved_registers = this->write_push_reserved_registers();
+
+    // like SetConstructor, we evaluate all the keys and values before creating
+    // the dict, since we need to know the key type to choose the hash
+    // functions. the dict pointer goes in the first stack slot and each item
+    // takes the two slots after that (key, then value)
+    size_t stack_bytes = ((a->items.size() * 2 + 2) * 8) & ~0x0F;
+    this->adjust_stack(-stack_bytes);
+    ssize_t slots_stack_bytes_used = this->stack_bytes_used;
+
+    Value key_type = a->key_type;
+    Value value_type = a->value_type;
+
+    // as in SetConstructor, if a key or value raises, we have to delete the
+    // ones evaluated before it, so we cover the evaluation with an exception
+    // block when the keys or values can hold references
+    vector<Expression *> item_exprs;
+    for (const auto &item: a->items)
+    {
+        item_exprs.emplace_back(item.first.get());
+        item_exprs.emplace_back(item.second.get());
+    }
+    bool use_cleanup_block = ((key_type.type == ValueType::Indeterminate) ||
+                              (value_type.type == ValueType::Indeterminate) ||
+                              type_has_refcount(key_type.type) ||
+                              type_has_refcount(value_type.type)) &&
+                             any_expression_may_raise(item_exprs, 1);
+    string cleanup_label = string_printf("__DictConstructor_%p_cleanup", a);
+    size_t slots_offset = 0;
+    if (use_cleanup_block)
+    {
+        this->as.write_label(string_printf("__DictConstructor_%p_create_exc_block", a));
+        for (size_t x = 0; x < a->items.size() * 2; x++)
+        {
+            this->as.write_mov(MemoryReference(rsp, (x + 1) * 8), 0);
+        }
+        this->write_create_exception_block({}, cleanup_label);
+        slots_offset = this->stack_bytes_used - slots_stack_bytes_used;
+    }
+
+    // deletes the keys and values evaluated so far (the slots that haven't
+    // been written are still zero), then continues unwinding
+    auto write_cleanup = [&](size_t items_evaluated)
+    {
+        this->as.write_label(cleanup_label);
+        this->adjust_stack_to(slots_stack_bytes_used, false);
+        for (size_t x = 0; x < items_evaluated; x++)
+        {
+            if (type_has_refcount(key_type.type))
+            {
+                this->write_delete_reference(MemoryReference(rsp, (x * 2 + 1) * 8),
+                                             key_type.type);
+            }
+            if (type_has_refcount(value_type.type))
+            {
+                this->write_delete_reference(MemoryReference(rsp, (x * 2 + 2) * 8),
+                                             value_type.type);
+            }
+        }
+        this->as.write_jmp(common_object_reference(void_fn_ptr(&_unwind_exception_internal)));
+    };
+
+    size_t item_index = 0;
+    for (const auto &item: a->items)
+    {
+        MemoryReference key_mem(rsp, slots_offset + (item_index * 2 + 1) * 8);
+        MemoryReference value_mem(rsp, slots_offset + (item_index * 2 + 2) * 8);
+
+        for (size_t is_value = 0; is_value < 2; is_value++)
+        {
+            Value &expected_type = is_value ? value_type : key_type;
+            this->as.write_label(string_printf("__DictConstructor_%p_item_%zu_%s", a,
+                                               item_index, is_value ? "value" : "key"));
+            try
+            {
+                (is_value ? item.second : item.first)->accept(this);
+            } catch (const terminated_by_split &e)
+            {
+                // the key of this item may have been evaluated already; the
+                // cleanup handles that since its value slot is still zero
+                if (use_cleanup_block)
+                {
+                    write_cleanup(item_index + is_value);
+                }
+                this->adjust_stack_to(slots_stack_bytes_used, false);
+                this->adjust_stack(stack_bytes);
+                this->write_pop_reserved_registers(previously_reserved_registers);
+                throw;
+            }
+
+            // all keys must have the same type, and so must all values
+            if (expected_type.type == ValueType::Indeterminate)
+            {
+                expected_type = this->current_type.type_only();
+            }
+            else if (!expected_type.types_equal(this->current_type))
+            {
+                throw compile_error(string_printf("dict %ss have different types: %s and %s",
+                                                  is_value ? "value" : "key", expected_type.type_only().str().c_str(),
+                                                  this->current_type.type_only().str().c_str()), this->file_offset);
+            }
+            if (type_has_refcount(expected_type.type) && !this->holding_reference)
+            {
+                throw compile_error("not holding reference to dict item", this->file_offset);
+            }
+
+            MemoryReference &dest_mem = is_value ? value_mem : key_mem;
+            if (this->current_type.type == ValueType::Float)
+            {
+                this->as.write_movsd(dest_mem, MemoryReference(this->float_target_register));
+            }
+            else
+            {
+                this->as.write_mov(dest_mem, MemoryReference(this->target_register));
+            }
+        }
+        item_index++;
+    }
+
+    // remove the exception block and skip over its handler
+    string allocate_label = string_printf("__DictConstructor_%p_allocate", a);
+    if (use_cleanup_block)
+    {
+        this->as.write_label(string_printf("__DictConstructor_%p_remove_exc_block", a));
+        this->as.write_mov(r14, MemoryReference(rsp, 0));
+        this->adjust_stack_to(slots_stack_bytes_used);
+        this->as.write_jmp(allocate_label);
+        write_cleanup(a->items.size());
+    }
+
+    // allocate the dict object with enough space for all the items
+    this->as.write_label(allocate_label);
+    this->write_dictionary_new(key_type, value_type);
+    this->as.write_mov(MemoryReference(rsp, 0), MemoryReference(this->target_register));
+    if (!a->items.empty())
+    {
+        this->as.write_mov(rdi, MemoryReference(rsp, 0));
+        this->as.write_mov(rsi, a->items.size());
+        this->write_function_call(common_object_reference(void_fn_ptr(&dictionary_reserve)),
+                                  {rdi, rsi, r14}, {});
+    }
+
+    // insert the items. we're holding references to them already, so the dict
+    // takes those references instead of making its own
+    for (item_index = 0; item_index < a->items.size(); item_index++)
+    {
+        this->as.write_label(string_printf("__DictConstructor_%p_insert_item_%zu", a, item_index));
+        MemoryReference key_mem(rsp, (item_index * 2 + 1) * 8);
+        MemoryReference value_mem(rsp, (item_index * 2 + 2) * 8);
+        this->as.write_mov(rdi, MemoryReference(rsp, 0));
+        this->as.write_mov(rsi, key_mem);
+        this->as.write_mov(rdx, value_mem);
+        this->write_function_call(common_object_reference(void_fn_ptr(&dictionary_insert_steal)),
+                                  {rdi, rsi, rdx, r14}, {});
+    }
+
+    // get the dict pointer back
+    this->as.write_label(string_printf("__DictConstructor_%p_finalize", a));
+    this->as.write_mov(MemoryReference(this->target_register), MemoryReference(rsp, 0));
+    this->adjust_stack(stack_bytes);
+    this->write_pop_reserved_registers(previously_reserved_registers);
+
+    // the result type is a new reference to a Dict[key_type, value_type]
+    vector<Value> extension_types({key_type, value_type});
+    this->current_type = Value(ValueType::Dict, extension_types);
+    this->holding_reference = true;
+}
+
+void CompilationVisitor::visit(TupleConstructor *a)
+{
+    // TODO: deduplicate this with ListConstructor
+
+    this->file_offset = a->file_offset;
     this->assert_not_evaluating_instance_pointer();
 
     this->as.write_label(string_printf("__TupleConstructor_%p_setup", a));
@@ -1717,65 +3327,455 @@ void CompilationVisitor::visit(TupleConstructor *a)
                     "for item %zu: %s (analysis) vs %s (compilation)", x,
                     analysis_type_str.c_str(), compilation_type_str.c_str()), this->file_offset);
         }
-    }
+    }
+
+    // generate code to write the has_refcount map
+    // TODO: we can coalesce these writes for tuples larger than 8 items
+    this->as.write_label(string_printf("__TupleConstructor_%p_has_refcount_map", a));
+    size_t types_handled = 0;
+    while (types_handled < a->value_types.size())
+    {
+        uint8_t value = 0;
+        for (size_t x = 0; (x < 8) && ((types_handled + x) < a->value_types.size()); x++)
+        {
+            if (type_has_refcount(a->value_types[types_handled + x].type))
+            {
+                value |= (0x80 >> x);
+            }
+        }
+        this->as.write_mov(MemoryReference(rbx,
+                                           a->value_types.size() * 8 + (types_handled / 8)), value, OperandSize::Byte);
+        types_handled += 8;
+    }
+
+    // get the tuple pointer back
+    this->as.write_label(string_printf("__TupleConstructor_%p_finalize", a));
+    this->write_pop(this->target_register);
+
+    // restore the regs we saved
+    this->write_pop_reserved_registers(previously_reserved_registers);
+    this->write_pop(rbx);
+
+    // the result type is a new reference to a Tuple[extension_types]
+    this->current_type = Value(ValueType::Tuple, a->value_types);
+    this->holding_reference = true;
+}
+
+void CompilationVisitor::visit(ListComprehension *a)
+{
+    this->file_offset = a->file_offset;
+    this->assert_not_evaluating_instance_pointer();
+
+    string base_label = string_printf("__ListComprehension_%p", a);
+    string allocate_label = base_label + "_allocate";
+    string loop_label = base_label + "_loop";
+    string finalize_label = base_label + "_finalize";
+
+    // we'll use rbx for the iteration state
+    if (this->target_register == rbx)
+    {
+        throw compile_error("cannot use rbx as target register for list comprehension", this->file_offset);
+    }
+
+    this->as.write_label(base_label + "_setup");
+    int64_t previously_reserved_registers = this->write_push_reserved_registers();
+
+    // reserve space for the list pointer and the current item. like in
+    // DictComprehension, these are addressed relative to the current stack depth
+    this->adjust_stack(-0x10);
+    int64_t base_stack_bytes_used = this->stack_bytes_used;
+    auto stack_mem = [&](int64_t offset) -> MemoryReference {
+        return MemoryReference(rsp, this->stack_bytes_used - base_stack_bytes_used + offset);
+    };
+    static const int64_t item_offset = 0x00;
+    static const int64_t list_offset = 0x08;
+
+    this->as.write_label(base_label + "_get_collection");
+    try
+    {
+        a->source_data->accept(this);
+    } catch (const terminated_by_split &)
+    {
+        this->adjust_stack(0x10);
+        this->write_pop_reserved_registers(previously_reserved_registers);
+        throw;
+    }
+    Value collection_type = this->current_type;
+    this->write_push(this->target_register);
+    this->write_push(rbx);
+    this->as.write_xor(rbx, rbx);
+
+    // the list's items_are_objects flag depends on the item type, which we
+    // don't know until the loop body is compiled, so the list is created after
+    // the loop (see DictComprehension)
+    this->as.write_jmp(allocate_label);
+    this->as.write_label(loop_label);
+
+    Value item_type(ValueType::Indeterminate);
+    auto write_body = [&](const string &next_label)
+    {
+        if (a->predicate.get())
+        {
+            Register target_register = this->target_register;
+            this->write_condition_jump(a->predicate.get(), next_label, false);
+            this->target_register = target_register;
+        }
+
+        this->as.write_label(base_label + "_item");
+        a->item_pattern->accept(this);
+        item_type = this->current_type.type_only();
+        if (type_has_refcount(this->current_type.type) && !this->holding_reference)
+        {
+            throw compile_error("not holding reference to list item", this->file_offset);
+        }
+        if (this->current_type.type == ValueType::Float)
+        {
+            this->as.write_movsd(stack_mem(item_offset), MemoryReference(this->float_target_register));
+        }
+        else
+        {
+            this->as.write_mov(stack_mem(item_offset), MemoryReference(this->target_register));
+        }
+
+        // store the item directly into the list, which takes the reference
+        // we're holding. if the list was allocated at its final size, there's
+        // always room, unless the loop body appended to the source list; we
+        // still check for that, but it's a branch that's never taken
+        string store_label = base_label + "_store";
+        this->as.write_label(base_label + "_append");
+        this->as.write_mov(rdi, stack_mem(list_offset));
+        this->as.write_mov(rsi, MemoryReference(rdi, 0x10));
+        this->as.write_cmp(rsi, MemoryReference(rdi, 0x18));
+        this->as.write_jl(store_label);
+        this->write_function_call(common_object_reference(void_fn_ptr(&list_grow)),
+                                  {rdi, r14}, {});
+        this->as.write_mov(rdi, stack_mem(list_offset));
+        this->as.write_mov(rsi, MemoryReference(rdi, 0x10));
+        this->as.write_label(store_label);
+        this->as.write_mov(rdx, MemoryReference(rdi, 0x28));
+        this->as.write_mov(rax, stack_mem(item_offset));
+        this->as.write_mov(MemoryReference(rdx, 0, rsi, 8), rax);
+        this->as.write_inc(rsi);
+        this->as.write_mov(MemoryReference(rdi, 0x10), rsi);
+    };
+
+    try
+    {
+        this->write_iteration(base_label, collection_type, a->variable.get(), nullptr,
+                              write_body);
+        this->as.write_jmp(finalize_label);
+
+        // create the list. if there's no predicate, the result has as many
+        // items as the source, so allocate that much space up front (all
+        // collection types have their item count at offset 0x10)
+        this->as.write_label(allocate_label);
+        this->as.write_xor(rdi, rdi);
+        this->as.write_mov(rsi, type_has_refcount(item_type.type));
+        this->write_function_call(common_object_reference(void_fn_ptr(&list_new)),
+                                  {rdi, rsi, r14}, {}, -1, this->target_register);
+        this->as.write_mov(stack_mem(list_offset), MemoryReference(this->target_register));
+        if (!a->predicate.get())
+        {
+            this->as.write_mov(rdi, MemoryReference(this->target_register));
+            this->as.write_mov(rsi, MemoryReference(rsp, 8));
+            this->as.write_mov(rsi, MemoryReference(rsi, 0x10));
+            this->write_function_call(common_object_reference(void_fn_ptr(&list_reserve)),
+                                      {rdi, rsi, r14}, {});
+        }
+        this->as.write_jmp(loop_label);
+
+    } catch (const terminated_by_split &)
+    {
+        this->write_pop(rbx);
+        this->write_pop(this->target_register);
+        this->write_delete_reference(MemoryReference(this->target_register),
+                                     collection_type.type);
+        this->adjust_stack(0x10);
+        this->write_pop_reserved_registers(previously_reserved_registers);
+        throw;
+    }
+
+    // clean up the collection and get the list pointer back
+    this->as.write_label(finalize_label);
+    this->write_pop(rbx);
+    this->write_pop(this->target_register);
+    this->write_delete_reference(MemoryReference(this->target_register),
+                                 collection_type.type);
+    this->as.write_mov(MemoryReference(this->target_register), stack_mem(list_offset));
+    this->adjust_stack(0x10);
+    this->write_pop_reserved_registers(previously_reserved_registers);
+
+    // the result type is a new reference to a List[item_type]
+    vector<Value> extension_types({item_type});
+    this->current_type = Value(ValueType::List, extension_types);
+    this->holding_reference = true;
+}
+
+void CompilationVisitor::visit(SetComprehension *a)
+{
+    this->file_offset = a->file_offset;
+    this->assert_not_evaluating_instance_pointer();
+
+    string base_label = string_printf("__SetComprehension_%p", a);
+    string allocate_label = base_label + "_allocate";
+    string loop_label = base_label + "_loop";
+    string finalize_label = base_label + "_finalize";
+
+    // we'll use rbx for the iteration state
+    if (this->target_register == rbx)
+    {
+        throw compile_error("cannot use rbx as target register for set comprehension", this->file_offset);
+    }
+
+    this->as.write_label(base_label + "_setup");
+    int64_t previously_reserved_registers = this->write_push_reserved_registers();
+
+    // this is like ListComprehension, except the set's hash functions are what
+    // depend on the item type
+    this->adjust_stack(-0x10);
+    int64_t base_stack_bytes_used = this->stack_bytes_used;
+    auto stack_mem = [&](int64_t offset) -> MemoryReference {
+        return MemoryReference(rsp, this->stack_bytes_used - base_stack_bytes_used + offset);
+    };
+    static const int64_t item_offset = 0x00;
+    static const int64_t set_offset = 0x08;
+
+    this->as.write_label(base_label + "_get_collection");
+    try
+    {
+        a->source_data->accept(this);
+    } catch (const terminated_by_split &)
+    {
+        this->adjust_stack(0x10);
+        this->write_pop_reserved_registers(previously_reserved_registers);
+        throw;
+    }
+    Value collection_type = this->current_type;
+    this->write_push(this->target_register);
+    this->write_push(rbx);
+    this->as.write_xor(rbx, rbx);
+
+    this->as.write_jmp(allocate_label);
+    this->as.write_label(loop_label);
+
+    Value item_type(ValueType::Indeterminate);
+    auto write_body = [&](const string &next_label)
+    {
+        if (a->predicate.get())
+        {
+            Register target_register = this->target_register;
+            this->write_condition_jump(a->predicate.get(), next_label, false);
+            this->target_register = target_register;
+        }
+
+        this->as.write_label(base_label + "_item");
+        a->item_pattern->accept(this);
+        item_type = this->current_type.type_only();
+        if (type_has_refcount(this->current_type.type) && !this->holding_reference)
+        {
+            throw compile_error("not holding reference to set item", this->file_offset);
+        }
+        if (this->current_type.type == ValueType::Float)
+        {
+            this->as.write_movsd(stack_mem(item_offset), MemoryReference(this->float_target_register));
+        }
+        else
+        {
+            this->as.write_mov(stack_mem(item_offset), MemoryReference(this->target_register));
+        }
 
-    // generate code to write the has_refcount map
-    // TODO: we can coalesce these writes for tuples larger than 8 items
-    this->as.write_label(string_printf("__TupleConstructor_%p_has_refcount_map", a));
-    size_t types_handled = 0;
-    while (types_handled < a->value_types.size())
-    {
-        uint8_t value = 0;
-        for (size_t x = 0; (x < 8) && ((types_handled + x) < a->value_types.size()); x++)
+        // set_add adds its own reference to the item, so delete ours afterward
+        this->as.write_label(base_label + "_add");
+        this->as.write_mov(rdi, stack_mem(set_offset));
+        this->as.write_mov(rsi, stack_mem(item_offset));
+        this->write_function_call(common_object_reference(void_fn_ptr(&set_add)),
+                                  {rdi, rsi, r14}, {});
+        if (type_has_refcount(item_type.type))
         {
-            if (type_has_refcount(a->value_types[types_handled + x].type))
-            {
-                value |= (0x80 >> x);
-            }
+            this->write_delete_reference(stack_mem(item_offset), item_type.type);
         }
-        this->as.write_mov(MemoryReference(rbx,
-                                           a->value_types.size() * 8 + (types_handled / 8)), value, OperandSize::Byte);
-        types_handled += 8;
+    };
+
+    try
+    {
+        this->write_iteration(base_label, collection_type, a->variable.get(), nullptr,
+                              write_body);
+        this->as.write_jmp(finalize_label);
+
+        this->as.write_label(allocate_label);
+        this->write_set_new(item_type);
+        this->as.write_mov(stack_mem(set_offset), MemoryReference(this->target_register));
+        this->as.write_jmp(loop_label);
+
+    } catch (const terminated_by_split &)
+    {
+        this->write_pop(rbx);
+        this->write_pop(this->target_register);
+        this->write_delete_reference(MemoryReference(this->target_register),
+                                     collection_type.type);
+        this->adjust_stack(0x10);
+        this->write_pop_reserved_registers(previously_reserved_registers);
+        throw;
     }
 
-    // get the tuple pointer back
-    this->as.write_label(string_printf("__TupleConstructor_%p_finalize", a));
+    // clean up the collection and get the set pointer back
+    this->as.write_label(finalize_label);
+    this->write_pop(rbx);
     this->write_pop(this->target_register);
-
-    // restore the regs we saved
+    this->write_delete_reference(MemoryReference(this->target_register),
+                                 collection_type.type);
+    this->as.write_mov(MemoryReference(this->target_register), stack_mem(set_offset));
+    this->adjust_stack(0x10);
     this->write_pop_reserved_registers(previously_reserved_registers);
-    this->write_pop(rbx);
 
-    // the result type is a new reference to a Tuple[extension_types]
-    this->current_type = Value(ValueType::Tuple, a->value_types);
+    // the result type is a new reference to a Set[item_type]
+    vector<Value> extension_types({item_type});
+    this->current_type = Value(ValueType::Set, extension_types);
     this->holding_reference = true;
 }
 
-void CompilationVisitor::visit(ListComprehension *a)
+void CompilationVisitor::visit(DictComprehension *a)
 {
     this->file_offset = a->file_offset;
     this->assert_not_evaluating_instance_pointer();
 
-    // TODO
-    throw compile_error("ListComprehension not yet implemented", this->file_offset);
-}
+    string base_label = string_printf("__DictComprehension_%p", a);
+    string allocate_label = base_label + "_allocate";
+    string loop_label = base_label + "_loop";
+    string finalize_label = base_label + "_finalize";
 
-void CompilationVisitor::visit(SetComprehension *a)
-{
-    this->file_offset = a->file_offset;
-    this->assert_not_evaluating_instance_pointer();
+    // we'll use rbx for the iteration state
+    if (this->target_register == rbx)
+    {
+        throw compile_error("cannot use rbx as target register for dict comprehension", this->file_offset);
+    }
 
-    // TODO
-    throw compile_error("SetComprehension not yet implemented", this->file_offset);
-}
+    this->as.write_label(base_label + "_setup");
+    int64_t previously_reserved_registers = this->write_push_reserved_registers();
 
-void CompilationVisitor::visit(DictComprehension *a)
-{
-    this->file_offset = a->file_offset;
-    this->assert_not_evaluating_instance_pointer();
+    // reserve space for the dict pointer and the current key and value. the
+    // loop pushes things on top of these, so they're addressed relative to the
+    // current stack depth
+    this->adjust_stack(-0x20);
+    int64_t base_stack_bytes_used = this->stack_bytes_used;
+    auto stack_mem = [&](int64_t offset) -> MemoryReference {
+        return MemoryReference(rsp, this->stack_bytes_used - base_stack_bytes_used + offset);
+    };
+    static const int64_t key_offset = 0x00;
+    static const int64_t value_offset = 0x08;
+    static const int64_t dict_offset = 0x10;
 
-    // TODO
-    throw compile_error("DictComprehension not yet implemented", this->file_offset);
+    // get the source collection and save it on the stack, like ForStatement
+    this->as.write_label(base_label + "_get_collection");
+    try
+    {
+        a->source_data->accept(this);
+    } catch (const terminated_by_split &)
+    {
+        this->adjust_stack(0x20);
+        this->write_pop_reserved_registers(previously_reserved_registers);
+        throw;
+    }
+    Value collection_type = this->current_type;
+    this->write_push(this->target_register);
+    this->write_push(rbx);
+    this->as.write_xor(rbx, rbx);
+
+    // we don't know the key and value types until we've compiled the loop body,
+    // but we need them to create the dict. so the code that creates the dict
+    // goes after the loop, and we jump there first and then back
+    this->as.write_jmp(allocate_label);
+    this->as.write_label(loop_label);
+
+    Value key_type(ValueType::Indeterminate);
+    Value value_type(ValueType::Indeterminate);
+    auto write_body = [&](const string &next_label)
+    {
+        // write_condition_jump picks its own target register
+        if (a->predicate.get())
+        {
+            Register target_register = this->target_register;
+            this->write_condition_jump(a->predicate.get(), next_label, false);
+            this->target_register = target_register;
+        }
+
+        for (size_t is_value = 0; is_value < 2; is_value++)
+        {
+            this->as.write_label(base_label + (is_value ? "_value" : "_key"));
+            (is_value ? a->value_pattern : a->key_pattern)->accept(this);
+            (is_value ? value_type : key_type) = this->current_type.type_only();
+            if (type_has_refcount(this->current_type.type) && !this->holding_reference)
+            {
+                throw compile_error("not holding reference to dict item", this->file_offset);
+            }
+
+            MemoryReference dest_mem = stack_mem(is_value ? value_offset : key_offset);
+            if (this->current_type.type == ValueType::Float)
+            {
+                this->as.write_movsd(dest_mem, MemoryReference(this->float_target_register));
+            }
+            else
+            {
+                this->as.write_mov(dest_mem, MemoryReference(this->target_register));
+            }
+        }
+
+        // the dict takes the references we're holding to the key and value
+        this->as.write_label(base_label + "_insert");
+        this->as.write_mov(rdi, stack_mem(dict_offset));
+        this->as.write_mov(rsi, stack_mem(key_offset));
+        this->as.write_mov(rdx, stack_mem(value_offset));
+        this->write_function_call(common_object_reference(void_fn_ptr(&dictionary_insert_steal)),
+                                  {rdi, rsi, rdx, r14}, {});
+    };
+
+    try
+    {
+        this->write_iteration(base_label, collection_type, a->variable.get(), nullptr,
+                              write_body);
+        this->as.write_jmp(finalize_label);
+
+        // create the dict. if there's no predicate, we know how many items the
+        // source has, so allocate that much space up front. all collection types
+        // have their item count at offset 0x10
+        this->as.write_label(allocate_label);
+        this->write_dictionary_new(key_type, value_type);
+        this->as.write_mov(stack_mem(dict_offset), MemoryReference(this->target_register));
+        if (!a->predicate.get())
+        {
+            this->as.write_mov(rdi, MemoryReference(this->target_register));
+            this->as.write_mov(rsi, MemoryReference(rsp, 8));
+            this->as.write_mov(rsi, MemoryReference(rsi, 0x10));
+            this->write_function_call(common_object_reference(void_fn_ptr(&dictionary_reserve)),
+                                      {rdi, rsi, r14}, {});
+        }
+        this->as.write_jmp(loop_label);
+
+    } catch (const terminated_by_split &)
+    {
+        this->write_pop(rbx);
+        this->write_pop(this->target_register);
+        this->write_delete_reference(MemoryReference(this->target_register),
+                                     collection_type.type);
+        this->adjust_stack(0x20);
+        this->write_pop_reserved_registers(previously_reserved_registers);
+        throw;
+    }
+
+    // clean up the collection and get the dict pointer back
+    this->as.write_label(finalize_label);
+    this->write_pop(rbx);
+    this->write_pop(this->target_register);
+    this->write_delete_reference(MemoryReference(this->target_register),
+                                 collection_type.type);
+    this->as.write_mov(MemoryReference(this->target_register), stack_mem(dict_offset));
+    this->adjust_stack(0x20);
+    this->write_pop_reserved_registers(previously_reserved_registers);
+
+    // the result type is a new reference to a Dict[key_type, value_type]
+    vector<Value> extension_types({key_type, value_type});
+    this->current_type = Value(ValueType::Dict, extension_types);
+    this->holding_reference = true;
 }
 
 void CompilationVisitor::visit(LambdaDefinition *a)
@@ -1976,6 +3976,7 @@ void CompilationVisitor::visit(FunctionCall *a)
                 "incorrect argument count in function call (given: %zu, expected: %zu)",
                 arg_values.size(), fn->args.size()), this->file_offset);
     }
+    fn->check_keyword_arguments(keyword_call_args, this->file_offset);
 
     // if the function takes the exception block as an argument, push it here
     if (fn->pass_exception_block)
@@ -2304,10 +4305,26 @@ void CompilationVisitor::visit(FunctionCall *a)
         this->as.write_jmp(common_object_reference(void_fn_ptr(&_unwind_exception_internal)));
         this->as.write_label(no_exc_label);
 
-        // put the return value into the target register
-        if (callee_fragment.return_type.type == ValueType::Float)
+        // builtin methods' return types can refer to the extension types of the
+        // object they're called on (e.g. list.pop returns an item of the list's
+        // type), which is the first argument
+        Value return_type = callee_fragment.return_type;
+        if (fn->is_builtin() && fn->class_id && !arg_types.empty())
         {
-            if (this->target_register != rax)
+            return_type = resolve_extension_type_references(return_type, arg_types[0]);
+        }
+
+        // put the return value into the target register. builtins whose return
+        // type is an extension type return Floats in rax, like list_get_item
+        if ((callee_fragment.return_type.type == ValueType::ExtensionTypeReference) &&
+            (return_type.type == ValueType::Float))
+        {
+            this->as.write_label(string_printf("__FunctionCall_%p_save_return_value", a));
+            this->as.write_movq_to_xmm(this->float_target_register, MemoryReference(rax));
+        }
+        else if (callee_fragment.return_type.type == ValueType::Float)
+        {
+            if (this->float_target_register != xmm0)
             {
                 this->as.write_label(string_printf("__FunctionCall_%p_save_return_value", a));
                 this->as.write_movsd(MemoryReference(this->float_target_register), xmm0);
@@ -2323,7 +4340,7 @@ void CompilationVisitor::visit(FunctionCall *a)
         }
 
         // functions always return new references, unless they return trivial types
-        this->current_type = callee_fragment.return_type;
+        this->current_type = return_type;
         this->holding_reference = type_has_refcount(this->current_type.type);
 
         // note: we don't have to destroy the function arguments; we passed the
@@ -2381,7 +4398,7 @@ void CompilationVisitor::visit(ArrayIndex *a)
         if (collection_type.type == ValueType::Dict)
         {
 
-            // arg 1 is the dict object
+            // the dict object goes in rdi
             if (this->target_register != rdi)
             {
                 this->as.write_mov(rdi, MemoryReference(this->target_register));
@@ -2408,8 +4425,8 @@ void CompilationVisitor::visit(ArrayIndex *a)
             this->release_register(rdi);
 
             // get the dict item
-            this->write_function_call(common_object_reference(void_fn_ptr(&dictionary_at)),
-                                      {rdi, rsi, r14}, {}, -1, original_target_register);
+            this->write_inline_dictionary_lookup(a, collection_type, rdi, rsi,
+                                                 original_target_register, false);
 
             // the return type is the value extension type
             this->current_type = collection_type.extension_types[1];
@@ -2495,7 +4512,7 @@ void CompilationVisitor::visit(ArrayIndex *a)
         if (this->current_type.type == ValueType::Float)
         {
             this->as.write_movq_to_xmm(this->float_target_register,
-                                       MemoryReference(this->target_register));
+                                       MemoryReference(original_target_register));
         }
 
     } catch (const terminated_by_split &)
@@ -2509,13 +4526,300 @@ void CompilationVisitor::visit(ArrayIndex *a)
     this->target_register = original_target_register;
 }
 
+void CompilationVisitor::write_inline_dictionary_lookup(const void *node,
+                                                        const Value &dict_type, const MemoryReference &dict_mem,
+                                                        const MemoryReference &key_mem, Register result_register,
+                                                        bool check_only)
+{
+    // this is an inlined version of dictionary_at (or dictionary_exists, if
+    // check_only is true). it computes the key's hash and probes the first
+    // group of the table, which is almost always where the key is if it
+    // exists. if the first group has no match and no empty slots, or if a
+    // string key has the right hash but is a different object that isn't
+    // known to be unequal (or its hash hasn't been computed yet), we call the helper function to do the full
+    // lookup (which also raises KeyError if needed). the layouts used here are:
+    // DictionaryObject: 0x30 = capacity, 0x40 = entries, 0x48 = control,
+    //   0x50 = indexes (uint32_t per slot)
+    // Entry (0x18 bytes): 0x00 = key, 0x08 = value, 0x10 = hash
+    // BytesObject/UnicodeObject: 0x10 = count, 0x18 = hash (0 if not computed),
+    //   0x20 = flags (StringFlag)
+    ValueType key_type = dict_type.extension_types[0].type;
+    bool key_is_string = (key_type == ValueType::Bytes) ||
+                         (key_type == ValueType::Unicode);
+    bool values_are_objects = !check_only &&
+                              type_has_refcount(dict_type.extension_types[1].type);
+
+    string base_label = string_printf("__DictionaryLookup_%p", node);
+    string found_label = base_label + "_found";
+    string call_helper_label = base_label + "_call_helper";
+    string miss_label = check_only ? (base_label + "_miss") : call_helper_label;
+    string got_value_label = base_label + "_got_value";
+    string done_label = base_label + "_done";
+
+    // everything below uses the caller-save registers, so save any that are in
+    // use. this moves rsp, so adjust the args if they're on the stack
+    int64_t previous_stack_bytes_used = this->stack_bytes_used;
+    int64_t previously_reserved_registers = this->write_push_reserved_registers();
+    int64_t rsp_adjustment = this->stack_bytes_used - previous_stack_bytes_used;
+    auto adjust_mem = [&](const MemoryReference &mem) -> MemoryReference {
+        if (mem.field_size && (mem.base_register == rsp))
+        {
+            return MemoryReference(rsp, mem.offset + rsp_adjustment,
+                                   mem.index_register, mem.field_size);
+        }
+        return mem;
+    };
+    if ((dict_mem == rsi) && (key_mem == rdi))
+    {
+        this->as.write_xchg(rdi, rsi);
+    }
+    else if (key_mem == rdi)
+    {
+        this->as.write_mov(rsi, adjust_mem(key_mem));
+        this->as.write_mov(rdi, adjust_mem(dict_mem));
+    }
+    else
+    {
+        if (dict_mem != rdi)
+        {
+            this->as.write_mov(rdi, adjust_mem(dict_mem));
+        }
+        if (key_mem != rsi)
+        {
+            this->as.write_mov(rsi, adjust_mem(key_mem));
+        }
+    }
+
+    // compute the hash into rax. this must match the key_hash function that
+    // hash_functions_for_type chooses for the key type
+    if (key_is_string)
+    {
+        // strings cache their hashes. if this one hasn't been computed yet, let
+        // the helper do it (it stores the hash in the object, so later lookups
+        // with the same key object won't need to call the helper)
+        this->as.write_mov(rax, MemoryReference(rsi, 0x18));
+        this->as.write_test(rax, rax);
+        this->as.write_je(call_helper_label);
+
+        // the hashes in the entries have the high bit set; see
+        // DictionaryObject::hash_for_key. this doesn't affect the control byte
+        // or group index computed below
+        this->as.write_mov(rcx, static_cast<int64_t>(0x8000000000000000));
+        this->as.write_or(rax, rcx);
+    }
+    else
+    {
+        // hash_table_default_key_hash
+        this->as.write_mov(rax, rsi);
+        this->as.write_mov(rcx, rax);
+        this->as.write_shr(rcx, 30);
+        this->as.write_xor(rax, rcx);
+        this->as.write_mov(rcx, 0xBF58476D1CE4E5B9);
+        this->as.write_imul(rax, rcx);
+        this->as.write_mov(rcx, rax);
+        this->as.write_shr(rcx, 27);
+        this->as.write_xor(rax, rcx);
+        this->as.write_mov(rcx, 0x94D049BB133111EB);
+        this->as.write_imul(rax, rcx);
+        this->as.write_mov(rcx, rax);
+        this->as.write_shr(rcx, 31);
+        this->as.write_xor(rax, rcx);
+    }
+
+    // if the table is empty, the key isn't in it. otherwise, find the first
+    // slot index in the key's group (r8) and the group's control bytes (r9)
+    this->as.write_mov(rdx, MemoryReference(rdi, 0x30));
+    this->as.write_test(rdx, rdx);
+    this->as.write_je(miss_label);
+    this->as.write_shr(rdx, 4);
+    this->as.write_dec(rdx);
+    this->as.write_mov(r8, rax);
+    this->as.write_shr(r8, 7);
+    this->as.write_and(r8, rdx);
+    this->as.write_shl(r8, 4);
+    this->as.write_mov(r9, MemoryReference(rdi, 0x48));
+    this->as.write_add(r9, r8);
+    this->as.write_mov(r10, MemoryReference(rdi, 0x40));
+    this->as.write_mov(r11, MemoryReference(rdi, 0x50));
+
+    // compare all the control bytes in the group against the hash's low 7 bits
+    this->as.write_mov(rcx, rax);
+    this->as.write_and(rcx, 0x7F);
+    this->as.write_mov(rdx, 0x0101010101010101);
+    this->as.write_imul(rcx, rdx);
+    this->as.write_movq_to_xmm(xmm0, rcx);
+    this->as.write_punpcklqdq(xmm0, xmm0);
+    this->as.write_pcmpeqb(xmm0, MemoryReference(r9, 0));
+    this->as.write_pmovmskb(rcx, xmm0);
+    this->as.write_test(rcx, rcx);
+    this->as.write_je(base_label + "_check_empty");
+
+    // check the keys in the matching slots' entries. rdx is the entry's offset
+    // from the start of the entries array, in units of 8 bytes
+    this->as.write_label(base_label + "_check_candidate");
+    this->as.write_bsf(rdx, rcx);
+    this->as.write_add(rdx, r8);
+    this->as.write_mov(MemoryReference(rdx), MemoryReference(r11, 0, rdx, 4),
+                       OperandSize::DoubleWord);
+    this->as.write_lea(rdx, MemoryReference(rdx, 0, rdx, 2));
+    this->as.write_cmp(rsi, MemoryReference(r10, 0, rdx, 8));
+    this->as.write_je(found_label);
+    if (key_is_string)
+    {
+        // equal strings may be different objects; let the helper compare them,
+        // unless both are interned (then they can't be equal)
+        this->as.write_cmp(rax, MemoryReference(r10, 0x10, rdx, 8));
+        this->as.write_jne(base_label + "_next_candidate");
+        this->as.write_test(MemoryReference(rsi, 0x20), StringFlag::Interned,
+                            OperandSize::Byte);
+        this->as.write_je(call_helper_label);
+        this->as.write_mov(rdx, MemoryReference(r10, 0, rdx, 8));
+        this->as.write_test(MemoryReference(rdx, 0x20), StringFlag::Interned,
+                            OperandSize::Byte);
+        this->as.write_je(call_helper_label);
+        this->as.write_label(base_label + "_next_candidate");
+    }
+    this->as.write_lea(rdx, MemoryReference(rcx, -1));
+    this->as.write_and(rcx, rdx);
+    this->as.write_jnz(base_label + "_check_candidate");
+
+    // if the group has an empty slot, the key would have been in this group;
+    // otherwise, it could be in a later group
+    this->as.write_label(base_label + "_check_empty");
+    this->as.write_mov(rdx, static_cast<int64_t>(0x8080808080808080));
+    this->as.write_movq_to_xmm(xmm0, rdx);
+    this->as.write_punpcklqdq(xmm0, xmm0);
+    this->as.write_pcmpeqb(xmm0, MemoryReference(r9, 0));
+    this->as.write_pmovmskb(rcx, xmm0);
+    this->as.write_test(rcx, rcx);
+    this->as.write_je(call_helper_label);
+    if (check_only)
+    {
+        this->as.write_label(miss_label);
+        this->as.write_xor(MemoryReference(result_register), MemoryReference(result_register));
+        this->as.write_jmp(done_label);
+    }
+    else
+    {
+        this->as.write_jmp(call_helper_label);
+    }
+
+    this->as.write_label(found_label);
+    if (check_only)
+    {
+        this->as.write_mov(result_register, 1);
+    }
+    else
+    {
+        this->as.write_mov(MemoryReference(result_register),
+                           MemoryReference(r10, 0x08, rdx, 8));
+    }
+    this->as.write_jmp(check_only ? done_label : got_value_label);
+
+    this->as.write_label(call_helper_label);
+    if (check_only)
+    {
+        this->write_function_call(common_object_reference(void_fn_ptr(&dictionary_exists)),
+                                  {rdi, rsi}, {}, -1, result_register);
+        this->as.write_movzx8(result_register,
+                              MemoryReference(byte_register_for_register(result_register)));
+    }
+    else
+    {
+        this->write_function_call(common_object_reference(void_fn_ptr(&dictionary_at)),
+                                  {rdi, rsi, r14}, {}, -1, result_register);
+    }
+
+    // dictionary_at doesn't return a new reference, so make one
+    this->as.write_label(got_value_label);
+    if (values_are_objects)
+    {
+        this->write_add_reference(result_register);
+    }
+
+    this->as.write_label(done_label);
+    this->write_pop_reserved_registers(previously_reserved_registers);
+}
+
 void CompilationVisitor::visit(ArraySlice *a)
 {
     this->file_offset = a->file_offset;
     this->assert_not_evaluating_instance_pointer();
 
-    // TODO
-    throw compile_error("ArraySlice not yet implemented", this->file_offset);
+    string base_label = string_printf("__ArraySlice_%p", a);
+    Register original_target_register = this->target_register;
+    int64_t previously_reserved_registers = this->write_push_reserved_registers();
+
+    // the collection and slice arguments are saved on the stack while the
+    // other arguments are evaluated
+    static const int64_t collection_offset = 0x00;
+    this->adjust_stack(-0x20);
+
+    Value collection_type;
+    const void *fn = nullptr;
+    try
+    {
+        this->as.write_label(base_label + "_get_collection");
+        a->array->accept(this);
+        collection_type = std::move(this->current_type);
+        if (!this->holding_reference)
+        {
+            throw compile_error("not holding reference to collection", this->file_offset);
+        }
+        if (collection_type.type == ValueType::List)
+        {
+            fn = void_fn_ptr(&list_slice);
+        }
+        else if (collection_type.type == ValueType::Bytes)
+        {
+            fn = void_fn_ptr(&bytes_slice);
+        }
+        else if (collection_type.type == ValueType::Unicode)
+        {
+            fn = void_fn_ptr(&unicode_slice);
+        }
+        else
+        {
+            throw compile_error("ArraySlice not yet implemented for collections of type " + collection_type.str(),
+                                this->file_offset);
+        }
+        this->as.write_mov(MemoryReference(rsp, collection_offset),
+                           MemoryReference(this->target_register));
+
+        this->as.write_label(base_label + "_get_indexes");
+        this->write_slice_indexes(a->start_index.get(), a->end_index.get(),
+                                  a->step_size.get(), collection_offset + 0x08);
+
+    } catch (const terminated_by_split &)
+    {
+        this->adjust_stack(0x20);
+        this->write_pop_reserved_registers(previously_reserved_registers);
+        throw;
+    }
+
+    // the slice functions return a new reference (which may be to the same
+    // object, if the slice covers all of it). save it while we delete our
+    // reference to the collection
+    this->as.write_label(base_label + "_call");
+    this->as.write_mov(rdi, MemoryReference(rsp, collection_offset));
+    this->as.write_mov(rsi, MemoryReference(rsp, collection_offset + 0x08));
+    this->as.write_mov(rdx, MemoryReference(rsp, collection_offset + 0x10));
+    this->as.write_mov(rcx, MemoryReference(rsp, collection_offset + 0x18));
+    this->write_function_call(common_object_reference(fn), {rdi, rsi, rdx, rcx, r14},
+                              {}, -1, original_target_register);
+    this->as.write_mov(MemoryReference(rsp, collection_offset + 0x08),
+                       MemoryReference(original_target_register));
+    this->write_delete_reference(MemoryReference(rsp, collection_offset),
+                                 collection_type.type);
+    this->as.write_mov(MemoryReference(original_target_register),
+                       MemoryReference(rsp, collection_offset + 0x08));
+
+    this->adjust_stack(0x20);
+    this->write_pop_reserved_registers(previously_reserved_registers);
+
+    this->target_register = original_target_register;
+    this->current_type = collection_type.type_only();
+    this->holding_reference = true;
 }
 
 void CompilationVisitor::visit(IntegerConstant *a)
@@ -2682,50 +4986,233 @@ void CompilationVisitor::visit(AttributeLookup *a)
         this->write_read_variable(attr_register, this->float_target_register, loc);
         this->release_register(base_register);
 
-        // if we're holding a reference to the base, delete that reference now
-        if (base_holding_reference)
+        // if we're holding a reference to the base, delete that reference now
+        if (base_holding_reference)
+        {
+            this->reserve_register(attr_register);
+            this->write_delete_held_reference(MemoryReference(base_register));
+            this->release_register(attr_register);
+        }
+
+        this->target_register = attr_register;
+        this->current_type = loc.type;
+        this->holding_reference = type_has_refcount(this->current_type.type);
+        return;
+    }
+
+    // TODO
+    throw compile_error("AttributeLookup not yet implemented on " + this->current_type.str(),
+                        this->file_offset);
+}
+
+void CompilationVisitor::visit(TupleLValueReference *a)
+{
+    this->file_offset = a->file_offset;
+    this->assert_not_evaluating_instance_pointer();
+
+    // TODO
+    throw compile_error("TupleLValueReference not yet implemented", this->file_offset);
+}
+
+void CompilationVisitor::visit(ArrayIndexLValueReference *a)
+{
+    this->file_offset = a->file_offset;
+    this->assert_not_evaluating_instance_pointer();
+
+    if (type_has_refcount(this->current_type.type) && !this->holding_reference)
+    {
+        throw compile_error("assignment of non-held reference to item", this->file_offset);
+    }
+
+    string base_label = string_printf("__ArrayIndexLValueReference_%p", a);
+    Register value_register = this->target_register;
+    Value value_type = std::move(this->current_type);
+    int64_t previously_reserved_registers = this->write_push_reserved_registers();
+
+    // the collection, index and value are saved on the stack while the other
+    // expressions are evaluated
+    static const int64_t collection_offset = 0x00;
+    static const int64_t index_offset = 0x08;
+    static const int64_t value_offset = 0x10;
+    this->adjust_stack(-0x18);
+    if (value_type.type == ValueType::Float)
+    {
+        this->as.write_movsd(MemoryReference(rsp, value_offset),
+                             MemoryReference(this->float_target_register));
+    }
+    else
+    {
+        this->as.write_mov(MemoryReference(rsp, value_offset),
+                           MemoryReference(value_register));
+    }
+
+    Value collection_type;
+    Value index_type;
+    try
+    {
+        this->as.write_label(base_label + "_get_collection");
+        a->array->accept(this);
+        collection_type = std::move(this->current_type);
+        if (!this->holding_reference)
+        {
+            throw compile_error("not holding reference to collection", this->file_offset);
+        }
+        this->as.write_mov(MemoryReference(rsp, collection_offset),
+                           MemoryReference(this->target_register));
+
+        // lists can only be indexed by Ints, and the value must have the list's
+        // item type. dicts must have the same key and value types as the dict
+        const Value *expected_value_type = nullptr;
+        if (collection_type.type == ValueType::List)
+        {
+            expected_value_type = &collection_type.extension_types[0];
+        }
+        else if (collection_type.type == ValueType::Dict)
+        {
+            expected_value_type = &collection_type.extension_types[1];
+        }
+        else
+        {
+            throw compile_error("can\'t assign to item of " + collection_type.str(),
+                                this->file_offset);
+        }
+        if (!expected_value_type->types_equal(value_type))
+        {
+            string value_type_str = value_type.str();
+            string collection_type_str = collection_type.str();
+            throw compile_error(string_printf("can\'t assign %s to item of %s",
+                                              value_type_str.c_str(), collection_type_str.c_str()),
+                                this->file_offset);
+        }
+
+        this->as.write_label(base_label + "_get_index");
+        a->index->accept(this);
+        index_type = std::move(this->current_type);
+        const Value &expected_index_type = (collection_type.type == ValueType::List) ?
+                Value(ValueType::Int) : collection_type.extension_types[0];
+        if (!index_type.types_equal(expected_index_type))
+        {
+            string index_type_str = index_type.str();
+            string collection_type_str = collection_type.str();
+            throw compile_error(string_printf("can\'t assign item with index of type %s on %s",
+                                              index_type_str.c_str(), collection_type_str.c_str()),
+                                this->file_offset);
+        }
+        if (type_has_refcount(index_type.type) && !this->holding_reference)
         {
-            this->reserve_register(attr_register);
-            this->write_delete_held_reference(MemoryReference(base_register));
-            this->release_register(attr_register);
+            throw compile_error("not holding reference to key", this->file_offset);
         }
+        this->as.write_mov(MemoryReference(rsp, index_offset),
+                           MemoryReference(this->target_register));
 
-        this->target_register = attr_register;
-        this->current_type = loc.type;
-        this->holding_reference = type_has_refcount(this->current_type.type);
-        return;
+    } catch (const terminated_by_split &)
+    {
+        this->adjust_stack(0x18);
+        this->write_pop_reserved_registers(previously_reserved_registers);
+        throw;
     }
 
-    // TODO
-    throw compile_error("AttributeLookup not yet implemented on " + this->current_type.str(),
-                        this->file_offset);
+    // list_set_item and dictionary_insert add their own references to the key
+    // and value, so delete the ones we hold afterward
+    this->as.write_label(base_label + "_call");
+    this->as.write_mov(rdi, MemoryReference(rsp, collection_offset));
+    this->as.write_mov(rsi, MemoryReference(rsp, index_offset));
+    this->as.write_mov(rdx, MemoryReference(rsp, value_offset));
+    const void *fn = (collection_type.type == ValueType::List) ?
+            void_fn_ptr(&list_set_item) : void_fn_ptr(&dictionary_insert);
+    this->write_function_call(common_object_reference(fn), {rdi, rsi, rdx, r14}, {});
+    this->write_delete_reference(MemoryReference(rsp, collection_offset), collection_type.type);
+    this->write_delete_reference(MemoryReference(rsp, index_offset), index_type.type);
+    this->write_delete_reference(MemoryReference(rsp, value_offset), value_type.type);
+
+    this->adjust_stack(0x18);
+    this->write_pop_reserved_registers(previously_reserved_registers);
+    this->target_register = value_register;
 }
 
-void CompilationVisitor::visit(TupleLValueReference *a)
+void CompilationVisitor::visit(ArraySliceLValueReference *a)
 {
     this->file_offset = a->file_offset;
     this->assert_not_evaluating_instance_pointer();
 
-    // TODO
-    throw compile_error("TupleLValueReference not yet implemented", this->file_offset);
-}
+    // only lists are mutable, and only lists can be assigned to their slices
+    if (this->current_type.type != ValueType::List)
+    {
+        throw compile_error("can\'t assign " + this->current_type.str() + " to slice",
+                            this->file_offset);
+    }
+    if (!this->holding_reference)
+    {
+        throw compile_error("assignment of non-held reference to slice", this->file_offset);
+    }
 
-void CompilationVisitor::visit(ArrayIndexLValueReference *a)
-{
-    this->file_offset = a->file_offset;
-    this->assert_not_evaluating_instance_pointer();
+    string base_label = string_printf("__ArraySliceLValueReference_%p", a);
+    Register value_register = this->target_register;
+    Value value_type = std::move(this->current_type);
+    int64_t previously_reserved_registers = this->write_push_reserved_registers();
 
-    // TODO
-    throw compile_error("ArrayIndexLValueReference not yet implemented", this->file_offset);
-}
+    // the list, slice arguments and value are saved on the stack while the
+    // other arguments are evaluated
+    static const int64_t list_offset = 0x00;
+    static const int64_t value_offset = 0x20;
+    this->adjust_stack(-0x28);
+    this->as.write_mov(MemoryReference(rsp, value_offset), MemoryReference(value_register));
 
-void CompilationVisitor::visit(ArraySliceLValueReference *a)
-{
-    this->file_offset = a->file_offset;
-    this->assert_not_evaluating_instance_pointer();
+    try
+    {
+        this->as.write_label(base_label + "_get_list");
+        a->array->accept(this);
+        if (this->current_type.type != ValueType::List)
+        {
+            throw compile_error("can\'t assign to slice of " + this->current_type.str(),
+                                this->file_offset);
+        }
+        if (!this->holding_reference)
+        {
+            throw compile_error("not holding reference to list", this->file_offset);
+        }
 
-    // TODO
-    throw compile_error("ArraySliceLValueReference not yet implemented", this->file_offset);
+        // the value's item type must match the list's, unless it's an empty list
+        // constant (which has no item type)
+        const Value &value_item_type = value_type.extension_types[0];
+        if ((value_item_type.type != ValueType::Indeterminate) &&
+            !value_item_type.types_equal(this->current_type.extension_types[0]))
+        {
+            string value_type_str = value_type.str();
+            string list_type_str = this->current_type.str();
+            throw compile_error(string_printf("can\'t assign %s to slice of %s",
+                                              value_type_str.c_str(), list_type_str.c_str()),
+                                this->file_offset);
+        }
+        this->as.write_mov(MemoryReference(rsp, list_offset),
+                           MemoryReference(this->target_register));
+
+        this->as.write_label(base_label + "_get_indexes");
+        this->write_slice_indexes(a->start_index.get(), a->end_index.get(),
+                                  a->step_size.get(), list_offset + 0x08);
+
+    } catch (const terminated_by_split &)
+    {
+        this->adjust_stack(0x28);
+        this->write_pop_reserved_registers(previously_reserved_registers);
+        throw;
+    }
+
+    // list_set_slice doesn't take any references, so delete the ones we hold
+    this->as.write_label(base_label + "_call");
+    this->as.write_mov(rdi, MemoryReference(rsp, list_offset));
+    this->as.write_mov(rsi, MemoryReference(rsp, list_offset + 0x08));
+    this->as.write_mov(rdx, MemoryReference(rsp, list_offset + 0x10));
+    this->as.write_mov(rcx, MemoryReference(rsp, list_offset + 0x18));
+    this->as.write_mov(r8, MemoryReference(rsp, value_offset));
+    this->write_function_call(common_object_reference(void_fn_ptr(&list_set_slice)),
+                              {rdi, rsi, rdx, rcx, r8, r14}, {});
+    this->write_delete_reference(MemoryReference(rsp, list_offset), ValueType::List);
+    this->write_delete_reference(MemoryReference(rsp, value_offset), ValueType::List);
+
+    this->adjust_stack(0x28);
+    this->write_pop_reserved_registers(previously_reserved_registers);
+    this->target_register = value_register;
 }
 
 void CompilationVisitor::visit(AttributeLValueReference *a)
@@ -2844,7 +5331,8 @@ void CompilationVisitor::visit(AttributeLValueReference *a)
         {
             throw compile_error("target variable not found", this->file_offset);
         }
-        if (target_variable->type == ValueType::Indeterminate)
+        if ((target_variable->type == ValueType::Indeterminate) ||
+            is_refinement_of_type(this->current_type, *target_variable))
         {
             *target_variable = this->current_type;
         }
@@ -2943,21 +5431,185 @@ void CompilationVisitor::visit(ExpressionStatement *a)
     this->write_delete_held_reference(MemoryReference(this->target_register));
 }
 
+bool CompilationVisitor::write_string_append(Expression *target, Expression *value)
+{
+    // `x = x + y` where x is a Bytes or Unicode variable can modify x in place
+    // if nothing else refers to it. we can't tell that here, so we pass the
+    // variable's address to the append function instead, which checks the
+    // refcount at runtime
+    auto *target_lvalue = dynamic_cast<AttributeLValueReference *>(target);
+    auto *operation = dynamic_cast<BinaryOperation *>(value);
+    if (!target_lvalue || target_lvalue->base.get() || !operation ||
+        (operation->oper != BinaryOperator::Addition))
+    {
+        return false;
+    }
+    auto *left = dynamic_cast<VariableLookup *>(operation->left.get());
+    if (!left || (left->name != target_lvalue->name))
+    {
+        return false;
+    }
+    VariableLocation loc = this->location_for_variable(left->name);
+    if (((loc.type.type != ValueType::Bytes) && (loc.type.type != ValueType::Unicode)) ||
+        !loc.variable_mem_valid)
+    {
+        return false;
+    }
+
+    // x is read before y is evaluated, since evaluating y could reassign x. we
+    // hold a reference to the old value; the append function accounts for it
+    this->as.write_label(string_printf("__BinaryOperation_%p_append_evaluate_left", operation));
+    this->target_register = this->available_register();
+    left->accept(this);
+    this->write_push(this->target_register);
+
+    this->as.write_label(string_printf("__BinaryOperation_%p_append_evaluate_right", operation));
+    try
+    {
+        operation->right->accept(this);
+    } catch (const terminated_by_split &e)
+    {
+        this->adjust_stack(8);
+        throw;
+    }
+    if (this->current_type.type != loc.type.type)
+    {
+        throw compile_error("addition operator not implemented for " + loc.type.str() +
+                            " and " + this->current_type.str(), this->file_offset);
+    }
+    if (!this->holding_reference)
+    {
+        throw compile_error("non-held reference to right binary operator argument",
+                            this->file_offset);
+    }
+
+    // the append function takes both references. the address register can't
+    // be rsi or rdx, or moving the arguments into place could conflict
+    this->as.write_label(string_printf("__BinaryOperation_%p_append", operation));
+    Register address_register = this->available_register_except({this->target_register, rsi, rdx});
+    this->as.write_lea(address_register, loc.variable_mem);
+    const void *append_fn = (loc.type.type == ValueType::Bytes) ?
+                            void_fn_ptr(&bytes_append) : void_fn_ptr(&unicode_append);
+    this->write_function_call(common_object_reference(append_fn),
+                              {MemoryReference(address_register), MemoryReference(rsp, 0),
+                               MemoryReference(this->target_register), r14},
+                              {});
+    this->adjust_stack(8);
+    this->holding_reference = false;
+    return true;
+}
+
+bool CompilationVisitor::write_list_extend(AugmentStatement *a)
+{
+    // `x += y` where x is a List variable extends x in place (unlike `x = x + y`,
+    // which makes a new list), so other references to the list see the new items
+    auto *target_lvalue = dynamic_cast<AttributeLValueReference *>(a->target.get());
+    if (!target_lvalue || target_lvalue->base.get() ||
+        (a->oper != AugmentOperator::Addition))
+    {
+        return false;
+    }
+    VariableLocation loc = this->location_for_variable(target_lvalue->name);
+    if ((loc.type.type != ValueType::List) || !loc.variable_mem_valid)
+    {
+        return false;
+    }
+    auto *operation = dynamic_cast<BinaryOperation *>(a->operation.get());
+
+    // like `x = x.__iadd__(y)`: x is read before y is evaluated (which could
+    // reassign x), the old list is extended, and then it's stored back into x
+    this->as.write_label(string_printf("__AugmentStatement_%p_extend_evaluate_left", a));
+    this->target_register = this->available_register();
+    operation->left->accept(this);
+    this->write_push(this->target_register);
+
+    this->as.write_label(string_printf("__AugmentStatement_%p_extend_evaluate_right", a));
+    try
+    {
+        operation->right->accept(this);
+    } catch (const terminated_by_split &e)
+    {
+        this->adjust_stack(8);
+        throw;
+    }
+    const Value &item_type = loc.type.extension_types.at(0);
+    const Value &right_item_type = (this->current_type.type == ValueType::List) ?
+                                   this->current_type.extension_types.at(0) : Value();
+    if ((this->current_type.type != ValueType::List) ||
+        ((item_type.type != ValueType::Indeterminate) &&
+         (right_item_type.type != ValueType::Indeterminate) &&
+         (item_type != right_item_type)))
+    {
+        throw compile_error("can't extend " + loc.type.str() + " with " +
+                            this->current_type.str(), this->file_offset);
+    }
+    if (!this->holding_reference)
+    {
+        throw compile_error("non-held reference to right binary operator argument",
+                            this->file_offset);
+    }
+
+    // list_extend doesn't take any references, so delete ours to the right
+    // value afterward. our reference to the old list goes into the variable
+    this->as.write_label(string_printf("__AugmentStatement_%p_extend", a));
+    this->write_push(this->target_register);
+    this->write_function_call(common_object_reference(void_fn_ptr(&list_extend)),
+                              {MemoryReference(rsp, 8), MemoryReference(rsp, 0), r14}, {});
+    this->write_delete_reference(MemoryReference(rsp, 0), ValueType::List);
+    this->adjust_stack(8);
+    this->write_pop(this->target_register);
+
+    this->as.write_label(string_printf("__AugmentStatement_%p_write_value", a));
+    this->current_type = loc.type;
+    this->holding_reference = true;
+    a->target->accept(this);
+    this->holding_reference = false;
+    return true;
+}
+
 void CompilationVisitor::visit(AssignmentStatement *a)
 {
     this->file_offset = a->file_offset;
 
     this->as.write_label(string_printf("__AssignmentStatement_%p", a));
 
+    if (this->write_string_append(a->target.get(), a->value.get()))
+    {
+        return;
+    }
+
     // unlike in AnalysisVisitor, we look at the lvalue references first, so we
     // can know where to put the resulting values when generating their code
 
     // TODO: currently we don't support unpacking at all; we only support simple
     // assignments
 
-    // generate code to load the value into any available register
+    // generate code to load the value into any available register. an empty
+    // dict literal doesn't know its key and value types, but analysis may have
+    // found them from later uses of the variable; if so, create it with those
     this->target_register = available_register();
-    a->value->accept(this);
+    auto *dict_constructor = dynamic_cast<DictConstructor *>(a->value.get());
+    auto *target = dynamic_cast<AttributeLValueReference *>(a->target.get());
+    Value empty_dict_type;
+    if (dict_constructor && dict_constructor->items.empty() && target &&
+        !target->base.get())
+    {
+        empty_dict_type = this->location_for_variable(target->name).type;
+    }
+    if ((empty_dict_type.type == ValueType::Dict) &&
+        (empty_dict_type.extension_types.size() == 2) &&
+        (empty_dict_type.extension_types[0].type != ValueType::Indeterminate))
+    {
+        this->as.write_label(string_printf("__AssignmentStatement_%p_empty_dict", a));
+        this->write_dictionary_new(empty_dict_type.extension_types[0],
+                                   empty_dict_type.extension_types[1]);
+        this->current_type = empty_dict_type.type_only();
+        this->holding_reference = true;
+    }
+    else
+    {
+        a->value->accept(this);
+    }
     if (type_has_refcount(this->current_type.type) && !this->holding_reference)
     {
         throw compile_error("can\'t assign borrowed reference to " + this->current_type.str(),
@@ -2977,8 +5629,30 @@ void CompilationVisitor::visit(AugmentStatement *a)
 {
     this->file_offset = a->file_offset;
 
-    // TODO
-    throw compile_error("AugmentStatement not yet implemented", this->file_offset);
+    this->as.write_label(string_printf("__AugmentStatement_%p", a));
+
+    // AnalysisVisitor rewrites `x op= y` as `x = x op y`
+    if (!a->operation.get())
+    {
+        throw compile_error("AugmentStatement was not rewritten", this->file_offset);
+    }
+    if (this->write_string_append(a->target.get(), a->operation.get()) ||
+        this->write_list_extend(a))
+    {
+        return;
+    }
+
+    this->target_register = available_register();
+    a->operation->accept(this);
+    if (type_has_refcount(this->current_type.type) && !this->holding_reference)
+    {
+        throw compile_error("can\'t assign borrowed reference to " + this->current_type.str(),
+                            this->file_offset);
+    }
+
+    this->as.write_label(string_printf("__AugmentStatement_%p_write_value", a));
+    a->target->accept(this);
+    this->holding_reference = false;
 }
 
 void CompilationVisitor::visit(DeleteStatement *a)
@@ -3226,36 +5900,215 @@ void CompilationVisitor::visit(RaiseStatement *a)
 {
     this->file_offset = a->file_offset;
 
-    // we only support the one-argument form of the raise statement
-    if (a->value.get() || a->traceback.get())
+    // we only support the one-argument form of the raise statement
+    if (a->value.get() || a->traceback.get())
+    {
+        throw compile_error("raise statement may only take one argument",
+                            this->file_offset);
+    }
+
+    // we'll construct the exception object into r15
+    this->as.write_label(string_printf("__RaiseStatement_%p_evaluate_object", a));
+    a->type->accept(this);
+
+    // now jump to unwind_exception
+    this->as.write_label(string_printf("__RaiseStatement_%p_unwind", a));
+    this->as.write_mov(r15, MemoryReference(this->target_register));
+    this->as.write_jmp(common_object_reference(void_fn_ptr(&_unwind_exception_internal)));
+}
+
+void CompilationVisitor::visit(YieldStatement *a)
+{
+    this->file_offset = a->file_offset;
+
+    // TODO
+    throw compile_error("YieldStatement not yet implemented", this->file_offset);
+}
+
+void CompilationVisitor::visit(SingleIfStatement *a)
+{
+    this->file_offset = a->file_offset;
+    throw compile_error("SingleIfStatement used instead of subclass",
+                        this->file_offset);
+}
+
+// if the statement's condition compares an Int variable with a constant for
+// equality, returns the variable name and constant value
+static bool get_dispatch_case(const SingleIfStatement *s, string &variable_name,
+                              int64_t &value)
+{
+    auto *binary = dynamic_cast<const BinaryOperation *>(s->check.get());
+    if (!binary || (binary->oper != BinaryOperator::Equality))
+    {
+        return false;
+    }
+
+    auto *variable = dynamic_cast<const VariableLookup *>(binary->left.get());
+    auto *constant = dynamic_cast<const IntegerConstant *>(binary->right.get());
+    if (!variable || !constant)
+    {
+        variable = dynamic_cast<const VariableLookup *>(binary->right.get());
+        constant = dynamic_cast<const IntegerConstant *>(binary->left.get());
+    }
+    if (!variable || !constant)
+    {
+        return false;
+    }
+
+    // the dispatch code uses 32-bit immediates, so the values must fit
+    if ((constant->value < -0x80000000LL) || (constant->value > 0x7FFFFFFFLL))
+    {
+        return false;
+    }
+
+    variable_name = variable->name;
+    value = constant->value;
+    return true;
+}
+
+bool CompilationVisitor::write_if_dispatch(IfStatement *a)
+{
+    // chains shorter than this are just as fast as a series of compares
+    static const size_t min_dispatch_cases = 4;
+
+    if (a->always_false || (a->elifs.size() + 1 < min_dispatch_cases))
+    {
+        return false;
+    }
+
+    // all of the conditions must compare the same variable against distinct
+    // constants. we don't do this if static analysis already resolved any of
+    // the conditions
+    vector<SingleIfStatement *> arms;
+    arms.emplace_back(a);
+    for (auto &elif: a->elifs)
+    {
+        arms.emplace_back(elif.get());
+    }
+
+    string variable_name;
+    vector<pair<int64_t, size_t>> cases; // (value, arm index)
+    unordered_set<int64_t> values;
+    for (size_t x = 0; x < arms.size(); x++)
+    {
+        string arm_variable_name;
+        int64_t value;
+        if (arms[x]->always_true || arms[x]->always_false ||
+            !get_dispatch_case(arms[x], arm_variable_name, value) ||
+            (x && (arm_variable_name != variable_name)) ||
+            !values.emplace(value).second)
+        {
+            return false;
+        }
+        variable_name = arm_variable_name;
+        cases.emplace_back(value, x);
+    }
+
+    VariableLocation loc = this->location_for_variable(variable_name);
+    if (loc.type.type != ValueType::Int)
+    {
+        return false;
+    }
+
+    string base_label = string_printf("__IfStatement_%p", a);
+    string end_label = base_label + "_end";
+    string default_label = base_label + "_default";
+    auto case_label = [&](size_t arm_index) -> string {
+        return string_printf("%s_case_%zu", base_label.c_str(), arm_index);
+    };
+
+    // read the variable once
+    this->as.write_label(base_label + "_dispatch");
+    this->target_register = this->available_register();
+    MemoryReference target_mem(this->target_register);
+    this->write_read_variable(this->target_register, this->float_target_register, loc);
+
+    sort(cases.begin(), cases.end());
+    int64_t min_value = cases.front().first;
+    int64_t max_value = cases.back().first;
+    size_t range = max_value - min_value + 1;
+
+    // if the values are dense enough, use a jump table; otherwise, do a binary
+    // search over the values
+    if ((range <= 0x400) && (range * 2 <= cases.size() * 5))
+    {
+        string table_label = base_label + "_dispatch_table";
+        if (min_value)
+        {
+            this->as.write_sub(target_mem, min_value);
+        }
+        this->as.write_cmp(target_mem, range - 1);
+        this->as.write_ja(default_label);
+        Register table_reg = this->available_register_except({this->target_register});
+        this->as.write_mov(table_reg, table_label);
+        this->as.write_jmp(MemoryReference(table_reg, 0, this->target_register, 8));
+
+        this->as.write_align(8);
+        this->as.write_label(table_label);
+        auto case_it = cases.begin();
+        for (int64_t value = min_value; value <= max_value; value++)
+        {
+            if (case_it->first == value)
+            {
+                this->as.write_label_address(case_label(case_it->second));
+                case_it++;
+            }
+            else
+            {
+                this->as.write_label_address(default_label);
+            }
+        }
+
+    }
+    else
+    {
+        function<void(size_t, size_t)> write_search = [&](size_t start, size_t end)
+        {
+            // small ranges are checked linearly
+            if (end - start <= 3)
+            {
+                for (size_t x = start; x < end; x++)
+                {
+                    this->as.write_cmp(target_mem, cases[x].first);
+                    this->as.write_je(case_label(cases[x].second));
+                }
+                this->as.write_jmp(default_label);
+                return;
+            }
+
+            size_t mid = (start + end) / 2;
+            string upper_label = string_printf("%s_dispatch_%zu_%zu",
+                                               base_label.c_str(), mid + 1, end);
+            this->as.write_cmp(target_mem, cases[mid].first);
+            this->as.write_je(case_label(cases[mid].second));
+            this->as.write_jg(upper_label);
+            write_search(start, mid);
+            this->as.write_label(upper_label);
+            write_search(mid + 1, end);
+        };
+        write_search(0, cases.size());
+    }
+
+    // generate the bodies, each of which jumps to the end when done
+    for (size_t x = 0; x < arms.size(); x++)
     {
-        throw compile_error("raise statement may only take one argument",
-                            this->file_offset);
+        this->as.write_label(case_label(x));
+        try
+        {
+            this->visit_list(arms[x]->items);
+        } catch (const terminated_by_split &)
+        {}
+        this->as.write_jmp(end_label);
     }
 
-    // we'll construct the exception object into r15
-    this->as.write_label(string_printf("__RaiseStatement_%p_evaluate_object", a));
-    a->type->accept(this);
-
-    // now jump to unwind_exception
-    this->as.write_label(string_printf("__RaiseStatement_%p_unwind", a));
-    this->as.write_mov(r15, MemoryReference(this->target_register));
-    this->as.write_jmp(common_object_reference(void_fn_ptr(&_unwind_exception_internal)));
-}
-
-void CompilationVisitor::visit(YieldStatement *a)
-{
-    this->file_offset = a->file_offset;
-
-    // TODO
-    throw compile_error("YieldStatement not yet implemented", this->file_offset);
-}
+    this->as.write_label(default_label);
+    if (a->else_suite.get())
+    {
+        a->else_suite->accept(this);
+    }
 
-void CompilationVisitor::visit(SingleIfStatement *a)
-{
-    this->file_offset = a->file_offset;
-    throw compile_error("SingleIfStatement used instead of subclass",
-                        this->file_offset);
+    this->as.write_label(end_label);
+    return true;
 }
 
 void CompilationVisitor::visit(IfStatement *a)
@@ -3275,6 +6128,13 @@ void CompilationVisitor::visit(IfStatement *a)
         return;
     }
 
+    // long if/elif chains comparing a variable with constants are compiled as
+    // jump tables or binary searches
+    if (this->write_if_dispatch(a))
+    {
+        return;
+    }
+
     string false_label = string_printf("__IfStatement_%p_condition_false", a);
     string end_label = string_printf("__IfStatement_%p_end", a);
 
@@ -3289,12 +6149,7 @@ void CompilationVisitor::visit(IfStatement *a)
         if (!a->always_true)
         {
             this->as.write_label(string_printf("__IfStatement_%p_condition", a));
-            this->target_register = this->available_register();
-            a->check->accept(this);
-            this->as.write_label(string_printf("__IfStatement_%p_test", a));
-            this->write_current_truth_value_test();
-            this->as.write_jz(false_label);
-            this->write_delete_held_reference(MemoryReference(this->target_register));
+            this->write_condition_jump(a->check.get(), false_label, false);
 
         }
         else
@@ -3338,13 +6193,7 @@ void CompilationVisitor::visit(IfStatement *a)
         // generate the condition check
         this->as.write_label(string_printf("__IfStatement_%p_elif_%p_condition",
                                            a, elif.get()));
-        this->target_register = this->available_register();
-        elif->check->accept(this);
-        this->as.write_label(string_printf("__IfStatement_%p_elif_%p_test", a,
-                                           elif.get()));
-        this->write_current_truth_value_test();
-        this->as.write_jz(false_label);
-        this->write_delete_held_reference(MemoryReference(this->target_register));
+        this->write_condition_jump(elif->check.get(), false_label, false);
 
         // generate the body
         elif->accept(this);
@@ -3353,17 +6202,11 @@ void CompilationVisitor::visit(IfStatement *a)
 
     // generate the else block, if any. note that we don't get here if any of the
     // if blocks were always true
+    this->as.write_label(false_label);
     if (a->else_suite.get())
     {
-        this->as.write_label(false_label);
-        this->write_delete_held_reference(MemoryReference(this->target_register));
         a->else_suite->accept(this);
     }
-    else
-    {
-        this->as.write_label(false_label);
-        this->write_delete_held_reference(MemoryReference(this->target_register));
-    }
 
     this->as.write_label(end_label);
 }
@@ -3415,89 +6258,10 @@ void CompilationVisitor::visit(ForStatement *a)
 
     try
     {
-        string next_label = string_printf("__ForStatement_%p_next", a);
-        string end_label = string_printf("__ForStatement_%p_complete", a);
         string break_label = string_printf("__ForStatement_%p_broken", a);
 
-        if ((collection_type.type == ValueType::List) ||
-            (collection_type.type == ValueType::Tuple))
+        auto write_body = [&](const string &next_label)
         {
-
-            // tuples containing disparate types can't be iterated
-            if ((collection_type.type == ValueType::Tuple) &&
-                (!collection_type.extension_types.empty()))
-            {
-                Value uniform_extension_type = collection_type.extension_types[0];
-                for (const Value &extension_type: collection_type.extension_types)
-                {
-                    if (uniform_extension_type != extension_type)
-                    {
-                        string uniform_str = uniform_extension_type.str();
-                        string other_str = extension_type.str();
-                        throw compile_error(string_printf(
-                                "can\'t iterate over Tuple with disparate types (contains %s and %s)",
-                                uniform_str.c_str(), other_str.c_str()), this->file_offset);
-                    }
-                }
-            }
-
-            ValueType item_type = collection_type.extension_types[0].type;
-
-            this->as.write_label(next_label);
-            // get the list/tuple object
-            this->as.write_mov(MemoryReference(this->target_register),
-                               MemoryReference(rsp, 8));
-
-            // check if we're at the end and skip the body if so
-            this->as.write_cmp(rbx, MemoryReference(this->target_register, 0x10));
-            this->as.write_jge(end_label);
-
-            // get the next item
-            if (collection_type.type == ValueType::List)
-            {
-                this->as.write_mov(MemoryReference(this->target_register),
-                                   MemoryReference(this->target_register, 0x28));
-                if (item_type == ValueType::Float)
-                {
-                    this->as.write_movq_to_xmm(this->float_target_register,
-                                               MemoryReference(this->target_register, 0, rbx, 8));
-                }
-                else
-                {
-                    this->as.write_mov(MemoryReference(this->target_register),
-                                       MemoryReference(this->target_register, 0, rbx, 8));
-                }
-            }
-            else
-            {
-                if (item_type == ValueType::Float)
-                {
-                    this->as.write_movq_to_xmm(this->float_target_register,
-                                               MemoryReference(this->target_register, 0x18, rbx, 8));
-                }
-                else
-                {
-                    this->as.write_mov(MemoryReference(this->target_register),
-                                       MemoryReference(this->target_register, 0x18, rbx, 8));
-                }
-            }
-
-            // increment the item index
-            this->as.write_inc(rbx);
-
-            // if the extension type has a refcount, add a reference
-            if (type_has_refcount(item_type))
-            {
-                this->write_add_reference(this->target_register);
-            }
-
-            // load the value into the correct local variable slot
-            this->as.write_label(string_printf("__ForStatement_%p_write_value", a));
-            this->current_type = collection_type.extension_types[0];
-            a->variable->accept(this);
-
-            // do the loop body
-            this->as.write_label(string_printf("__ForStatement_%p_body", a));
             this->break_label_stack.emplace_back(break_label);
             this->continue_label_stack.emplace_back(next_label);
             try
@@ -3511,92 +6275,9 @@ void CompilationVisitor::visit(ForStatement *a)
             }
             this->continue_label_stack.pop_back();
             this->break_label_stack.pop_back();
-            this->as.write_jmp(next_label);
-            this->as.write_label(end_label);
-
-        }
-        else if (collection_type.type == ValueType::Dict)
-        {
-
-            int64_t previously_reserved_registers = this->write_push_reserved_registers();
-
-            // create a SlotContents structure
-            // TODO: figure out how this structure interacts with refcounting and
-            // exceptions (or if it does at all)
-            this->adjust_stack(-sizeof(DictionaryObject::SlotContents));
-            try
-            {
-                this->as.write_mov(MemoryReference(rsp, 0), 0);
-                this->as.write_mov(MemoryReference(rsp, 8), 0);
-                this->as.write_mov(MemoryReference(rsp, 16), 0);
-
-                // get the dict object and SlotContents pointer. we +8 to the offset
-                // because we saved rbx between the SlotContents struct and the
-                // collection pointer
-                this->as.write_label(next_label);
-                this->as.write_mov(rdi, MemoryReference(rsp,
-                                                        sizeof(DictionaryObject::SlotContents) + 8));
-                this->write_add_reference(rdi);
-                this->as.write_mov(rdi, MemoryReference(rsp,
-                                                        sizeof(DictionaryObject::SlotContents) + 8));
-                this->as.write_mov(rsi, rsp);
-
-                // call dictionary_next_item
-                this->write_function_call(
-                        common_object_reference(void_fn_ptr(&dictionary_next_item)), {rdi, rsi}, {});
-
-                // if dictionary_next_item returned 0, then we're done
-                this->as.write_test(rax, rax);
-                this->as.write_je(end_label);
-
-                // get the key pointer
-                this->as.write_mov(MemoryReference(this->target_register),
-                                   MemoryReference(rsp, 0));
-
-                // if the extension type has a refcount, add a reference
-                if (type_has_refcount(collection_type.extension_types[0].type))
-                {
-                    this->write_add_reference(this->target_register);
-                }
-
-                // load the value into the correct local variable slot
-                this->as.write_label(string_printf("__ForStatement_%p_write_key_value", a));
-                this->current_type = collection_type.extension_types[0];
-                a->variable->accept(this);
-
-                // do the loop body
-                this->as.write_label(string_printf("__ForStatement_%p_body", a));
-                this->break_label_stack.emplace_back(break_label);
-                this->continue_label_stack.emplace_back(next_label);
-                try
-                {
-                    this->visit_list(a->items);
-                } catch (const terminated_by_split &)
-                {
-                    this->continue_label_stack.pop_back();
-                    this->break_label_stack.pop_back();
-                    throw;
-                }
-                this->continue_label_stack.pop_back();
-                this->break_label_stack.pop_back();
-                this->as.write_jmp(next_label);
-                this->as.write_label(end_label);
-
-            } catch (const terminated_by_split &)
-            {
-                this->adjust_stack(sizeof(DictionaryObject::SlotContents));
-                this->write_pop_reserved_registers(previously_reserved_registers);
-                throw;
-            }
-            this->adjust_stack(sizeof(DictionaryObject::SlotContents));
-            this->write_pop_reserved_registers(previously_reserved_registers);
-
-        }
-        else
-        {
-            throw compile_error("iteration not implemented for " + collection_type.str(),
-                                this->file_offset);
-        }
+        };
+        this->write_iteration(string_printf("__ForStatement_%p", a), collection_type,
+                              a->variable.get(), a, write_body);
 
         // if there's an else statement, generate the body here
         if (a->else_suite.get())
@@ -3624,6 +6305,239 @@ void CompilationVisitor::visit(ForStatement *a)
                                  collection_type.type);
 }
 
+void CompilationVisitor::write_iteration(const string &base_label,
+                                         const Value &collection_type, Expression *variable,
+                                         const CompoundStatement *loop,
+                                         const function<void(const string &next_label)> &write_body)
+{
+    // the caller must have pushed the collection and then rbx, and set rbx to
+    // zero. each item is written to variable, then write_body is called to
+    // generate the loop body; it can jump to next_label to continue the loop.
+    // the loop head is aligned only if loop is given
+    string next_label = base_label + "_next";
+    string end_label = base_label + "_complete";
+
+    if ((collection_type.type == ValueType::List) ||
+        (collection_type.type == ValueType::Tuple))
+    {
+
+        // tuples containing disparate types can't be iterated
+        if ((collection_type.type == ValueType::Tuple) &&
+            (!collection_type.extension_types.empty()))
+        {
+            Value uniform_extension_type = collection_type.extension_types[0];
+            for (const Value &extension_type: collection_type.extension_types)
+            {
+                if (uniform_extension_type != extension_type)
+                {
+                    string uniform_str = uniform_extension_type.str();
+                    string other_str = extension_type.str();
+                    throw compile_error(string_printf(
+                            "can\'t iterate over Tuple with disparate types (contains %s and %s)",
+                            uniform_str.c_str(), other_str.c_str()), this->file_offset);
+                }
+            }
+        }
+
+        ValueType item_type = collection_type.extension_types[0].type;
+
+        if (loop)
+        {
+            this->write_loop_head_alignment(loop);
+        }
+        this->as.write_label(next_label);
+        // get the list/tuple object
+        this->as.write_mov(MemoryReference(this->target_register),
+                           MemoryReference(rsp, 8));
+
+        // check if we're at the end and skip the body if so
+        this->as.write_cmp(rbx, MemoryReference(this->target_register, 0x10));
+        this->as.write_jge(end_label);
+
+        // get the next item
+        if (collection_type.type == ValueType::List)
+        {
+            this->as.write_mov(MemoryReference(this->target_register),
+                               MemoryReference(this->target_register, 0x28));
+            if (item_type == ValueType::Float)
+            {
+                this->as.write_movq_to_xmm(this->float_target_register,
+                                           MemoryReference(this->target_register, 0, rbx, 8));
+            }
+            else
+            {
+                this->as.write_mov(MemoryReference(this->target_register),
+                                   MemoryReference(this->target_register, 0, rbx, 8));
+            }
+        }
+        else
+        {
+            if (item_type == ValueType::Float)
+            {
+                this->as.write_movq_to_xmm(this->float_target_register,
+                                           MemoryReference(this->target_register, 0x18, rbx, 8));
+            }
+            else
+            {
+                this->as.write_mov(MemoryReference(this->target_register),
+                                   MemoryReference(this->target_register, 0x18, rbx, 8));
+            }
+        }
+
+        // increment the item index
+        this->as.write_inc(rbx);
+
+        // if the extension type has a refcount, add a reference
+        if (type_has_refcount(item_type))
+        {
+            this->write_add_reference(this->target_register);
+        }
+
+        // load the value into the correct local variable slot
+        this->as.write_label(base_label + "_write_value");
+        this->current_type = collection_type.extension_types[0];
+        variable->accept(this);
+
+        // do the loop body
+        this->as.write_label(base_label + "_body");
+        write_body(next_label);
+        this->as.write_jmp(next_label);
+        this->as.write_label(end_label);
+
+    }
+    else if (collection_type.type == ValueType::Dict)
+    {
+
+        // dict entries are stored densely in insertion order, so this is
+        // like iterating over a list, except the entries are 0x18 bytes and
+        // dead entries (with hash = 0) have to be skipped. the dict's entry
+        // array can move if the loop body modifies the dict, so we reload it
+        // on every iteration
+        if (loop)
+        {
+            this->write_loop_head_alignment(loop);
+        }
+        this->as.write_label(next_label);
+        // get the dict object
+        this->as.write_mov(MemoryReference(this->target_register),
+                           MemoryReference(rsp, 8));
+
+        // check if we're at the end (entries_used) and skip the body if so
+        this->as.write_cmp(rbx, MemoryReference(this->target_register, 0x58));
+        this->as.write_jge(end_label);
+
+        // get the entry's address (entries + rbx * 0x18)
+        this->as.write_mov(MemoryReference(this->target_register),
+                           MemoryReference(this->target_register, 0x40));
+        for (size_t x = 0; x < 3; x++)
+        {
+            this->as.write_lea(this->target_register,
+                               MemoryReference(this->target_register, 0, rbx, 8));
+        }
+
+        // increment the entry index, then skip the entry if it's dead.
+        // live entries' hashes have the high bit set, so they're negative
+        this->as.write_inc(rbx);
+        this->as.write_cmp(MemoryReference(this->target_register, 0x10), 0);
+        this->as.write_jge(next_label);
+
+        // get the key, and if it has a refcount, add a reference
+        this->as.write_mov(MemoryReference(this->target_register),
+                           MemoryReference(this->target_register, 0));
+        if (type_has_refcount(collection_type.extension_types[0].type))
+        {
+            this->write_add_reference(this->target_register);
+        }
+
+        // load the value into the correct local variable slot
+        this->as.write_label(base_label + "_write_key_value");
+        this->current_type = collection_type.extension_types[0];
+        variable->accept(this);
+
+        // do the loop body
+        this->as.write_label(base_label + "_body");
+        write_body(next_label);
+        this->as.write_jmp(next_label);
+        this->as.write_label(end_label);
+
+    }
+    else if (collection_type.type == ValueType::Set)
+    {
+
+        int64_t previous_stack_bytes_used = this->stack_bytes_used;
+        int64_t previously_reserved_registers = this->write_push_reserved_registers();
+
+        size_t slot_contents_size = sizeof(SetObject::SlotContents);
+
+        // create a SlotContents structure
+        // TODO: figure out how this structure interacts with refcounting and
+        // exceptions (or if it does at all)
+        this->adjust_stack(-slot_contents_size);
+        try
+        {
+            for (size_t offset = 0; offset < slot_contents_size; offset += 8)
+            {
+                this->as.write_mov(MemoryReference(rsp, offset), 0);
+            }
+
+            // get the collection object and SlotContents pointer. we +8 to the
+            // offset because we saved rbx between the saved registers and the
+            // collection pointer
+            if (loop)
+            {
+                this->write_loop_head_alignment(loop);
+            }
+            this->as.write_label(next_label);
+            this->as.write_mov(rdi, MemoryReference(rsp,
+                                                    this->stack_bytes_used - previous_stack_bytes_used + 8));
+            this->as.write_mov(rsi, rsp);
+
+            // call set_next_item
+            this->write_function_call(common_object_reference(void_fn_ptr(&set_next_item)),
+                                      {rdi, rsi}, {});
+
+            // if it returned 0, then we're done
+            this->as.write_test(rax, rax);
+            this->as.write_je(end_label);
+
+            // get the key pointer
+            this->as.write_mov(MemoryReference(this->target_register),
+                               MemoryReference(rsp, 0));
+
+            // if the extension type has a refcount, add a reference
+            if (type_has_refcount(collection_type.extension_types[0].type))
+            {
+                this->write_add_reference(this->target_register);
+            }
+
+            // load the value into the correct local variable slot
+            this->as.write_label(base_label + "_write_key_value");
+            this->current_type = collection_type.extension_types[0];
+            variable->accept(this);
+
+            // do the loop body
+            this->as.write_label(base_label + "_body");
+            write_body(next_label);
+            this->as.write_jmp(next_label);
+            this->as.write_label(end_label);
+
+        } catch (const terminated_by_split &)
+        {
+            this->adjust_stack(slot_contents_size);
+            this->write_pop_reserved_registers(previously_reserved_registers);
+            throw;
+        }
+        this->adjust_stack(slot_contents_size);
+        this->write_pop_reserved_registers(previously_reserved_registers);
+
+    }
+    else
+    {
+        throw compile_error("iteration not implemented for " + collection_type.str(),
+                            this->file_offset);
+    }
+}
+
 void CompilationVisitor::visit(WhileStatement *a)
 {
     this->file_offset = a->file_offset;
@@ -3633,14 +6547,11 @@ void CompilationVisitor::visit(WhileStatement *a)
     string break_label = string_printf("__WhileStatement_%p_broken", a);
 
     // generate the condition check
+    this->write_loop_head_alignment(a);
     this->as.write_label(start_label);
-    this->target_register = this->available_register();
-    a->condition->accept(this);
-    this->write_current_truth_value_test();
-    this->as.write_jz(end_label);
+    this->write_condition_jump(a->condition.get(), end_label, false);
 
     // generate the loop body
-    this->write_delete_held_reference(MemoryReference(this->target_register));
     this->as.write_label(string_printf("__WhileStatement_%p_body", a));
     this->break_label_stack.emplace_back(break_label);
     this->continue_label_stack.emplace_back(start_label);
@@ -3653,10 +6564,7 @@ void CompilationVisitor::visit(WhileStatement *a)
     this->break_label_stack.pop_back();
     this->as.write_jmp(start_label);
 
-    // when the loop ends normally, we may still be holding a reference to the
-    // condition result
     this->as.write_label(end_label);
-    this->write_delete_held_reference(MemoryReference(this->target_register));
 
     // if there's an else statement, generate the body here
     if (a->else_suite.get())
@@ -4324,16 +7232,15 @@ void CompilationVisitor::write_function_call(
                             this->file_offset);
     }
 
+    // if any of the references are memory references based on RSP, we'll have
+    // to adjust them for the saved registers and the argument space
+    int64_t previous_stack_bytes_used = this->stack_bytes_used;
     int64_t previously_reserved_registers = this->write_push_reserved_registers();
-
-    size_t rsp_adjustment = 0;
     if (arg_stack_bytes < 0)
     {
         arg_stack_bytes = this->write_function_call_stack_prep(int_args.size());
-        // if any of the references are memory references based on RSP, we'll have
-        // to adjust them
-        rsp_adjustment = arg_stack_bytes;
     }
+    size_t rsp_adjustment = this->stack_bytes_used - previous_stack_bytes_used;
 
     // generate the list of move destinations
     vector<MemoryReference> dests;
@@ -4696,6 +7603,39 @@ void CompilationVisitor::write_delete_held_reference(const MemoryReference &mem)
     }
 }
 
+void CompilationVisitor::write_slice_indexes(Expression *start_index,
+                                             Expression *end_index, Expression *step_size, int64_t stack_offset)
+{
+    // the start, end and step are stored in consecutive stack slots. missing
+    // bounds are passed as slice_index_missing, and the step defaults to 1
+    Register target_register = this->target_register;
+    const vector<pair<Expression *, int64_t>> indexes({
+            {start_index, slice_index_missing},
+            {end_index, slice_index_missing},
+            {step_size, 1},
+    });
+    for (const auto &it: indexes)
+    {
+        if (it.first)
+        {
+            this->target_register = target_register;
+            it.first->accept(this);
+            if (this->current_type.type != ValueType::Int)
+            {
+                throw compile_error("slice index must be Int; here it\'s " + this->current_type.str(),
+                                    this->file_offset);
+            }
+        }
+        else
+        {
+            this->as.write_mov(target_register, it.second);
+        }
+        this->as.write_mov(MemoryReference(rsp, stack_offset), MemoryReference(target_register));
+        stack_offset += 0x08;
+    }
+    this->target_register = target_register;
+}
+
 void CompilationVisitor::write_delete_reference(const MemoryReference &mem,
                                                 ValueType type)
 {
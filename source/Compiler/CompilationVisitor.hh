@@ -1,6 +1,7 @@
 #pragma once
 
 #include <atomic>
+#include <functional>
 #include <memory>
 #include <stdexcept>
 #include <string>
@@ -150,6 +151,11 @@ private:
     Value current_type;
     bool holding_reference;
 
+    // if not empty, the comparison being compiled should jump to this label if
+    // its result is equal to condition_jump_if instead of producing a Bool
+    std::string condition_jump_label;
+    bool condition_jump_if;
+
     bool evaluating_instance_pointer;
     bool in_finally_block;
 
@@ -172,16 +178,63 @@ private:
             const std::vector<Register> &prevented_registers,
             bool float_register = false);
 
+    Register available_float_temporary_register();
+
     int64_t write_push_reserved_registers();
 
     void write_pop_reserved_registers(int64_t registers);
 
+    void write_loop_head_alignment(const CompoundStatement *loop);
+
+    void write_iteration(const std::string &base_label, const Value &collection_type,
+                         Expression *variable, const CompoundStatement *loop,
+                         const std::function<void(const std::string &next_label)> &write_body);
+
     bool is_always_truthy(const Value &type);
 
     bool is_always_falsey(const Value &type);
 
     void write_current_truth_value_test();
 
+    void write_condition_jump(Expression *condition, const std::string &label,
+                              bool jump_if);
+
+    void write_numeric_comparison(BinaryOperation *a, const Value &left_type,
+                                  const std::string &jump_label, bool jump_if);
+
+    bool write_if_dispatch(IfStatement *a);
+
+    bool write_string_append(Expression *target, Expression *value);
+
+    bool write_list_extend(AugmentStatement *a);
+
+    bool is_static_float_expression(Expression *a);
+
+    void write_float_operand(Expression *a);
+
+    bool write_fused_multiply_add(BinaryOperation *a);
+
+    void write_float_arithmetic(BinaryOperation *a);
+
+    bool write_compiled_format(BinaryOperation *a);
+
+    bool write_constant_string_comparison(BinaryOperation *a,
+                                          const std::string &jump_label, bool jump_if);
+
+    void write_dictionary_new(const Value &key_type, const Value &value_type);
+
+    void write_set_new(const Value &item_type);
+
+    void write_inline_dictionary_lookup(const void *node, const Value &dict_type,
+                                        const MemoryReference &dict_mem, const MemoryReference &key_mem,
+                                        Register result_register, bool check_only);
+
+    ValueType trivial_value_type(Expression *a);
+
+    bool write_float_min_max(TernaryOperation *a);
+
+    bool write_branchless_ternary(TernaryOperation *a);
+
     void write_code_for_value(const Value &value);
 
     void assert_not_evaluating_instance_pointer();
@@ -200,6 +253,9 @@ private:
 
     void write_add_reference(Register addr_reg);
 
+    void write_slice_indexes(Expression *start_index, Expression *end_index,
+                             Expression *step_size, int64_t stack_offset);
+
     void write_delete_held_reference(const MemoryReference &mem);
 
     void write_delete_reference(const MemoryReference &mem, ValueType type);
@@ -11,6 +11,7 @@
 #include "CompilationVisitor.hh"
 #include "../Types/List.hh"
 #include "../Types/Dictionary.hh"
+#include "../Types/Set.hh"
 
 using namespace std;
 
@@ -57,26 +58,10 @@ int64_t construct_value(GlobalContext *global, const Value &value,
 
         case ValueType::Dict:
         {
-            size_t (*key_length)(const void *) = nullptr;
-            uint8_t (*key_at)(const void *, size_t) = nullptr;
-            if (value.extension_types[0].type == ValueType::Bytes)
-            {
-                key_length = reinterpret_cast<size_t (*)(const void *)>(bytes_length);
-                key_at = reinterpret_cast<uint8_t (*)(const void *, size_t)>(bytes_at);
-            }
-            else if (value.extension_types[0].type == ValueType::Unicode)
-            {
-                key_length = reinterpret_cast<size_t (*)(const void *)>(unicode_length);
-                key_at = reinterpret_cast<uint8_t (*)(const void *, size_t)>(unicode_at);
-            }
-            else
-            {
-                throw compile_error("dictionary key type does not have sequence functions");
-            }
-
+            HashFunctions fns = hash_functions_for_type(value.extension_types[0].type);
             uint64_t flags = (type_has_refcount(value.extension_types[0].type) ? DictionaryFlag::KeysAreObjects : 0) |
                              (type_has_refcount(value.extension_types[1].type) ? DictionaryFlag::ValuesAreObjects : 0);
-            DictionaryObject *d = dictionary_new(key_length, key_at, flags);
+            DictionaryObject *d = dictionary_new(fns.key_hash, fns.key_equal, flags);
 
             for (const auto &item: *value.dict_value)
             {
@@ -96,8 +81,25 @@ int64_t construct_value(GlobalContext *global, const Value &value,
             return reinterpret_cast<int64_t>(global->context_for_class(value.class_id));
         }
 
-        case ValueType::Tuple:
         case ValueType::Set:
+        {
+            HashFunctions fns = hash_functions_for_type(value.extension_types[0].type);
+            SetObject *s = set_new(fns.key_hash, fns.key_equal,
+                                   type_has_refcount(value.extension_types[0].type));
+            for (const auto &item: *value.set_value)
+            {
+                // set_add adds its own reference to the item
+                void *k = reinterpret_cast<void *>(construct_value(global, item, false));
+                set_add(s, k);
+                if (s->items_are_objects)
+                {
+                    delete_reference(k);
+                }
+            }
+            return reinterpret_cast<int64_t>(s);
+        }
+
+        case ValueType::Tuple:
         default:
         {
             string value_str = value.str();
@@ -108,6 +110,33 @@ int64_t construct_value(GlobalContext *global, const Value &value,
 }
 
 
+HashFunctions hash_functions_for_type(ValueType type, ssize_t file_offset)
+{
+    switch (type)
+    {
+        case ValueType::Int:
+        case ValueType::Bool:
+            return {nullptr, nullptr};
+        // an empty dict or set whose key type is never known. nothing can be
+        // inserted into it, so any functions will do
+        case ValueType::Indeterminate:
+            return {nullptr, nullptr};
+        case ValueType::Bytes:
+            return {reinterpret_cast<uint64_t (*)(const void *)>(bytes_hash),
+                    reinterpret_cast<bool (*)(const void *, const void *)>(bytes_equal)};
+        case ValueType::Unicode:
+            return {reinterpret_cast<uint64_t (*)(const void *)>(unicode_hash),
+                    reinterpret_cast<bool (*)(const void *, const void *)>(unicode_equal)};
+        default:
+        {
+            string type_str = Value(type).str();
+            throw compile_error(type_str + " values cannot be dictionary keys or set items",
+                                file_offset);
+        }
+    }
+}
+
+
 void initialize_global_space_for_module(GlobalContext *global,
                                         ModuleContext *module)
 {
@@ -16,6 +16,17 @@ void compile_fragment(GlobalContext *global, ModuleContext *module, Fragment *f)
 void initialize_global_space_for_module(GlobalContext *global,
                                         ModuleContext *module);
 
+struct HashFunctions
+{
+    uint64_t (*key_hash)(const void *k);
+    bool (*key_equal)(const void *a, const void *b);
+};
+
+// returns the functions that dictionaries and sets use for keys of the given
+// type. Int and Bool keys are hashed and compared by value, so both functions
+// are null for them. throws compile_error if the type can't be a key
+HashFunctions hash_functions_for_type(ValueType type, ssize_t file_offset = -1);
+
 
 extern "C" {
 
@@ -36,10 +36,10 @@ BuiltinFunctionDefinition::BuiltinFunctionDefinition(const char *name,
 
 BuiltinFunctionDefinition::BuiltinFunctionDefinition(const char *name,
                                                      const std::vector<BuiltinFragmentDefinition> &fragments,
-                                                     bool pass_exception_block) : name(name),
-                                                                                  fragments(fragments),
-                                                                                  pass_exception_block(
-                                                                                          pass_exception_block)
+                                                     bool pass_exception_block,
+                                                     const std::vector<std::string> &arg_names) :
+        name(name), fragments(fragments), pass_exception_block(pass_exception_block),
+        arg_names(arg_names)
 {}
 
 BuiltinClassDefinition::BuiltinClassDefinition(const char *name,
@@ -130,15 +130,23 @@ FunctionContext::FunctionContext(ModuleContext *module, int64_t id) :
 
 FunctionContext::FunctionContext(ModuleContext *module, int64_t id,
                                  const char *name, const vector<BuiltinFragmentDefinition> &fragments,
-                                 bool pass_exception_block) : module(module), id(id), class_id(0),
-                                                              name(name), ast_root(nullptr), num_splits(0),
-                                                              pass_exception_block(pass_exception_block)
+                                 bool pass_exception_block, const vector<string> &arg_names) :
+        module(module), id(id), class_id(0), name(name), ast_root(nullptr), num_splits(0),
+        pass_exception_block(pass_exception_block)
 {
 
     // populate the arguments from the first fragment definition
+    if (arg_names.size() > fragments[0].arg_types.size())
+    {
+        throw invalid_argument("builtin function has more argument names than arguments");
+    }
     for (const auto &arg: fragments[0].arg_types)
     {
         this->args.emplace_back();
+        if (this->args.size() <= arg_names.size())
+        {
+            this->args.back().name = arg_names[this->args.size() - 1];
+        }
         if (arg.type == ValueType::Indeterminate)
         {
             throw invalid_argument("builtin functions must have known argument types");
@@ -191,6 +199,25 @@ bool FunctionContext::is_builtin() const
     return !this->ast_root;
 }
 
+void FunctionContext::check_keyword_arguments(
+        const unordered_map<string, shared_ptr<Expression>> &kwargs,
+        ssize_t file_offset) const
+{
+    for (const auto &it: kwargs)
+    {
+        bool found = false;
+        for (const auto &arg: this->args)
+        {
+            found |= (arg.name == it.first);
+        }
+        if (!found)
+        {
+            throw compile_error(string_printf("%s() got an unexpected keyword argument \'%s\'",
+                                              this->name.c_str(), it.first.c_str()), file_offset);
+        }
+    }
+}
+
 int64_t FunctionContext::fragment_index_for_call_args(
         const vector<Value> &arg_types) const
 {
@@ -285,7 +312,8 @@ int64_t ModuleContext::create_builtin_function(BuiltinFunctionDefinition &def)
                                                  forward_as_tuple(function_id), forward_as_tuple(this, function_id,
                                                                                                  def.name,
                                                                                                  def.fragments,
-                                                                                                 def.pass_exception_block));
+                                                                                                 def.pass_exception_block,
+                                                                                                 def.arg_names));
 
     // register the function in the module's global namespace
     this->create_global_variable(def.name, Value(ValueType::Function, function_id), false);
@@ -319,6 +347,10 @@ int64_t ModuleContext::create_builtin_class(BuiltinClassDefinition &def)
     static const Value Extension1(ValueType::ExtensionTypeReference, static_cast<int64_t>(1));
     static const Value List_Any(ValueType::List, vector<Value>({Value()}));
     static const Value List_Same(ValueType::List, vector<Value>({Extension0}));
+    static const Value List_Int(ValueType::List, vector<Value>({Value(ValueType::Int)}));
+    static const Value List_Float(ValueType::List, vector<Value>({Value(ValueType::Float)}));
+    static const Value List_Bytes(ValueType::List, vector<Value>({Value(ValueType::Bytes)}));
+    static const Value List_Unicode(ValueType::List, vector<Value>({Value(ValueType::Unicode)}));
     static const Value Set_Any(ValueType::Set, vector<Value>({Value()}));
     static const Value Set_Same(ValueType::Set, vector<Value>({Extension0}));
     static const Value Dict_Any(ValueType::Dict, vector<Value>({Value(), Value()}));
@@ -328,7 +360,7 @@ int64_t ModuleContext::create_builtin_class(BuiltinClassDefinition &def)
                                                                                                 ValueType::Bytes)}},
                                                                                         {"unicode", {Value(
                                                                                                 ValueType::Unicode)}},
-                                                                                        {"list",    {List_Any, List_Same}},
+                                                                                        {"list",    {List_Any, List_Same, List_Int, List_Float, List_Bytes, List_Unicode}},
                                                                                         {"set",     {Set_Any,  Set_Same}},
                                                                                         {"dict",    {Dict_Any, Dict_Same}},
                                                                                 });
@@ -402,7 +434,7 @@ int64_t ModuleContext::create_builtin_class(BuiltinClassDefinition &def)
         FunctionContext &fn = this->global->function_id_to_context.emplace(
                 piecewise_construct, forward_as_tuple(function_id),
                 forward_as_tuple(this, function_id, method_def.name, method_def.fragments,
-                                 method_def.pass_exception_block)).first->second;
+                                 method_def.pass_exception_block, method_def.arg_names)).first->second;
         fn.class_id = class_id;
 
         // link the function as a class attribute
@@ -457,7 +489,7 @@ GlobalContext::~GlobalContext()
         if (debug_flags & DebugFlag::ShowRefcountChanges)
         {
             fprintf(stderr, "[refcount:constants] deleting Unicode constant %ls\n",
-                    it.second->data);
+                    it.first.c_str());
         }
         delete_reference(it.second);
     }
@@ -669,6 +701,13 @@ int64_t GlobalContext::match_value_to_type(const Value &expected_type,
         return 1;
 
     }
+    else if (expected_type.type == ValueType::ExtensionTypeReference)
+    {
+        // extension type references that aren't resolved by
+        // match_values_to_types are the ones inside the self argument's type,
+        // which define what the other references refer to
+        return 0;
+    }
     else if (expected_type.type != value.type)
     {
         return -1; // no match
@@ -691,9 +730,37 @@ int64_t GlobalContext::match_value_to_type(const Value &expected_type,
         return cls ? 0 : -1;
     }
 
-    // if it's not Indeterminate and not a class, check the extension types
-    return this->match_values_to_types(
-            expected_type.extension_types, value.extension_types);
+    // if it's not Indeterminate and not a class, check the extension types.
+    // this doesn't call match_values_to_types since extension type references
+    // are only resolved at the top level
+    if (expected_type.extension_types.size() != value.extension_types.size())
+    {
+        return -1;
+    }
+    int64_t promotion_count = 0;
+    for (size_t x = 0; x < expected_type.extension_types.size(); x++)
+    {
+        // an empty dict whose key and value types are never known can still be
+        // passed where any dict is accepted (e.g. to len())
+        if (value.extension_types[x].type == ValueType::Indeterminate)
+        {
+            if (expected_type.extension_types[x].type != ValueType::Indeterminate)
+            {
+                return -1;
+            }
+            promotion_count++;
+            continue;
+        }
+
+        int64_t this_promotion_count = this->match_value_to_type(
+                expected_type.extension_types[x], value.extension_types[x]);
+        if (this_promotion_count < 0)
+        {
+            return this_promotion_count;
+        }
+        promotion_count += this_promotion_count;
+    }
+    return promotion_count;
 }
 
 int64_t GlobalContext::match_values_to_types(
@@ -707,8 +774,51 @@ int64_t GlobalContext::match_values_to_types(
     int64_t promotion_count = 0;
     for (size_t x = 0; x < expected_types.size(); x++)
     {
+        // builtin methods refer to the extension types of the object they're
+        // called on (e.g. list.append takes an item of the list's type), so
+        // resolve these references against the first argument's type
+        const Value *expected_type = &expected_types[x];
+        if ((expected_type->type == ValueType::ExtensionTypeReference) && (x > 0))
+        {
+            size_t index = expected_type->int_value;
+            if (index >= values[0].extension_types.size())
+            {
+                return -1;
+            }
+            expected_type = &values[0].extension_types[index];
+        }
+
+        // references can also be one level down (e.g. list.extend takes a list
+        // of the same item type as the list it's called on)
+        Value resolved_type;
+        if ((x > 0) && !expected_type->extension_types.empty())
+        {
+            for (size_t y = 0; y < expected_type->extension_types.size(); y++)
+            {
+                const Value &ext_type = expected_type->extension_types[y];
+                if (ext_type.type != ValueType::ExtensionTypeReference)
+                {
+                    continue;
+                }
+                size_t index = ext_type.int_value;
+                if (index >= values[0].extension_types.size())
+                {
+                    return -1;
+                }
+                if (resolved_type.type == ValueType::Indeterminate)
+                {
+                    resolved_type = *expected_type;
+                }
+                resolved_type.extension_types[y] = values[0].extension_types[index];
+            }
+            if (resolved_type.type != ValueType::Indeterminate)
+            {
+                expected_type = &resolved_type;
+            }
+        }
+
         int64_t this_value_promotion_count = this->match_value_to_type(
-                expected_types[x], values[x]);
+                *expected_type, values[x]);
         if (this_value_promotion_count < 0)
         {
             return this_value_promotion_count;
@@ -722,9 +832,15 @@ int64_t GlobalContext::match_values_to_types(
 const BytesObject *GlobalContext::get_or_create_constant(const string &s,
                                                          bool use_shared_constants)
 {
+    // constants are often used as dict keys, so compute their hashes now
+    // instead of on the first lookup. shared constants are also interned, so
+    // comparisons between them (and other interned strings) are just pointer
+    // comparisons
     if (!use_shared_constants)
     {
-        return bytes_new(s.data(), s.size());
+        BytesObject *o = bytes_new(s.data(), s.size());
+        bytes_hash(o);
+        return o;
     }
 
     BytesObject *o = nullptr;
@@ -733,7 +849,7 @@ const BytesObject *GlobalContext::get_or_create_constant(const string &s,
         o = this->bytes_constants.at(s);
     } catch (const out_of_range &e)
     {
-        o = bytes_new(s.data(), s.size());
+        o = bytes_intern(bytes_new(s.data(), s.size()));
         this->bytes_constants.emplace(s, o);
     }
     return o;
@@ -744,7 +860,9 @@ const UnicodeObject *GlobalContext::get_or_create_constant(const wstring &s,
 {
     if (!use_shared_constants)
     {
-        return unicode_new(s.data(), s.size());
+        UnicodeObject *o = unicode_new(s.data(), s.size());
+        unicode_hash(o);
+        return o;
     }
 
     UnicodeObject *o = nullptr;
@@ -753,7 +871,7 @@ const UnicodeObject *GlobalContext::get_or_create_constant(const wstring &s,
         o = this->unicode_constants.at(s);
     } catch (const out_of_range &e)
     {
-        o = unicode_new(s.data(), s.size());
+        o = unicode_intern(unicode_new(s.data(), s.size()));
         this->unicode_constants.emplace(s, o);
     }
     return o;
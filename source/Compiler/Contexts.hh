@@ -47,13 +47,19 @@ struct BuiltinFunctionDefinition
     std::vector<BuiltinFragmentDefinition> fragments;
     bool pass_exception_block;
 
+    // names of the arguments, so they can be passed as keyword arguments. this
+    // can be empty (or shorter than the argument list) if they can only be
+    // passed positionally
+    std::vector<std::string> arg_names;
+
     BuiltinFunctionDefinition(const char *name,
                               const std::vector<Value> &arg_types, Value return_type,
                               const void *compiled, bool pass_exception_blocky);
 
     BuiltinFunctionDefinition(const char *name,
                               const std::vector<BuiltinFragmentDefinition> &fragments,
-                              bool pass_exception_block);
+                              bool pass_exception_block,
+                              const std::vector<std::string> &arg_names = {});
 };
 
 struct BuiltinClassDefinition
@@ -185,7 +191,8 @@ struct FunctionContext
     // constructor for builtin functions
     FunctionContext(ModuleContext *module, int64_t id, const char *name,
                     const std::vector<BuiltinFragmentDefinition> &fragments,
-                    bool pass_exception_block);
+                    bool pass_exception_block,
+                    const std::vector<std::string> &arg_names = {});
 
     bool is_class_init() const;
 
@@ -195,6 +202,12 @@ struct FunctionContext
     // no appropriate fragment exists
     int64_t fragment_index_for_call_args(const std::vector<Value> &arg_types) const;
 
+    // throws compile_error if a call passes a keyword argument this function
+    // doesn't have
+    void check_keyword_arguments(
+            const std::unordered_map<std::string, std::shared_ptr<Expression>> &kwargs,
+            ssize_t file_offset) const;
+
     // gets the appropriate type for the given annotation
     Value type_for_annotation(std::shared_ptr<const TypeAnnotation> type_annotation) const;
 };
@@ -287,9 +300,13 @@ struct GlobalContext
     int64_t AssertionError_class_id;
     int64_t IndexError_class_id;
     int64_t KeyError_class_id;
+    int64_t LookupError_class_id;
     int64_t OSError_class_id;
+    int64_t OverflowError_class_id;
     int64_t PyJitCompilerError_class_id;
     int64_t TypeError_class_id;
+    int64_t UnicodeDecodeError_class_id;
+    int64_t UnicodeEncodeError_class_id;
     int64_t ValueError_class_id;
 
     int64_t BytesObject_class_id;
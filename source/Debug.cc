@@ -56,6 +56,14 @@ DebugFlag debug_flag_for_name(const char *name)
     {
         return DebugFlag::NoEagerCompilation;
     }
+    if (!strcasecmp(name, "NoLoopAlignment"))
+    {
+        return DebugFlag::NoLoopAlignment;
+    }
+    if (!strcasecmp(name, "StrictFloatRounding"))
+    {
+        return DebugFlag::StrictFloatRounding;
+    }
     if (!strcasecmp(name, "Code"))
     {
         return DebugFlag::Code;
@@ -87,6 +95,8 @@ const unordered_map<string, DebugFlag> name_to_debug_flag({
                                                                   {"ShowCompileErrors",   DebugFlag::ShowCompileErrors},
                                                                   {"NoInlineRefcounting", DebugFlag::NoInlineRefcounting},
                                                                   {"NoEagerCompilation",  DebugFlag::NoEagerCompilation},
+                                                                  {"NoLoopAlignment",     DebugFlag::NoLoopAlignment},
+                                                                  {"StrictFloatRounding", DebugFlag::StrictFloatRounding},
                                                                   {"Code",                DebugFlag::Code},
                                                                   {"Verbose",             DebugFlag::Verbose},
                                                                   {"All",                 DebugFlag::All},
@@ -23,10 +23,15 @@ enum DebugFlag
     ShowCompileErrors = 0x0000000000000800,
     NoInlineRefcounting = 0x0000000000010000,
     NoEagerCompilation = 0x0000000000020000,
+    NoLoopAlignment = 0x0000000000040000,
+    StrictFloatRounding = 0x0000000000080000,
 
     Code = 0x0000000000000CF0, // transformation steps only
     Verbose = 0x000000000000FFFF, // no behaviors, all debug info
-    All = 0xFFFFFFFFFFFFFFFF, // all behaviors and debug info
+    // All leaves out NoLoopAlignment and StrictFloatRounding. they're codegen
+    // options that were added after All was defined, so leaving them out makes
+    // -XAll keep generating the same code (and float results) as before
+    All = 0x000000000003FFFF, // all debug info, NoInlineRefcounting and NoEagerCompilation
 };
 
 DebugFlag debug_flag_for_name(const char *name);
@@ -331,11 +331,17 @@ Value &Value::operator=(const Value &other)
     }
     else
     {
+        // these are part of the type, not the value, so copy them even if the
+        // value isn't known
         if (this->type == ValueType::Instance)
         {
             this->class_id = other.class_id;
             this->instance = nullptr;
         }
+        else if (this->type == ValueType::ExtensionTypeReference)
+        {
+            this->extension_type_index = other.extension_type_index;
+        }
     }
 
     return *this;
@@ -399,11 +405,17 @@ Value &Value::operator=(Value &&other)
     }
     else
     {
+        // these are part of the type, not the value, so copy them even if the
+        // value isn't known
         if (this->type == ValueType::Instance)
         {
             this->class_id = other.class_id;
             this->instance = nullptr;
         }
+        else if (this->type == ValueType::ExtensionTypeReference)
+        {
+            this->extension_type_index = other.extension_type_index;
+        }
     }
 
     other.type = ValueType::Indeterminate;
@@ -795,6 +807,66 @@ bool type_has_refcount(ValueType type)
 }
 
 
+// returns true if type is a collection type with the same structure as
+// declared_type, but with known extension types where declared_type's are
+// missing or Indeterminate. for example, analysis may infer Set[Indeterminate]
+// for a set built from function arguments, but compilation knows it's a
+// Set[Int]
+bool is_refinement_of_type(const Value &type, const Value &declared_type)
+{
+    if ((type.type != declared_type.type) || type.extension_types.empty())
+    {
+        return false;
+    }
+    if (declared_type.extension_types.empty())
+    {
+        return true;
+    }
+    if (type.extension_types.size() != declared_type.extension_types.size())
+    {
+        return false;
+    }
+
+    bool refined = false;
+    for (size_t x = 0; x < type.extension_types.size(); x++)
+    {
+        const Value &declared_ext = declared_type.extension_types[x];
+        if (declared_ext.type == ValueType::Indeterminate)
+        {
+            refined |= (type.extension_types[x].type != ValueType::Indeterminate);
+        }
+        else if (!declared_ext.types_equal(type.extension_types[x]))
+        {
+            return false;
+        }
+    }
+    return refined;
+}
+
+Value resolve_extension_type_references(const Value &type, const Value &self_type)
+{
+    if (type.type == ValueType::ExtensionTypeReference)
+    {
+        if (static_cast<size_t>(type.int_value) >= self_type.extension_types.size())
+        {
+            return Value(ValueType::Indeterminate);
+        }
+        return self_type.extension_types[type.int_value];
+    }
+    if (type.extension_types.empty())
+    {
+        return type;
+    }
+
+    Value ret = type.type_only();
+    for (auto &ext_type: ret.extension_types)
+    {
+        ext_type = resolve_extension_type_references(ext_type, self_type);
+    }
+    return ret;
+}
+
+
 string type_signature_for_variables(const vector<Value> &vars,
                                     bool allow_indeterminate)
 {
@@ -1613,7 +1685,7 @@ Value execute_binary_operator(BinaryOperator oper, const Value &left,
                 }
                 else
                 {
-                    return Value(ValueType::Set);
+                    return Value(ValueType::Set, left.extension_types);
                 }
             }
 
@@ -1663,7 +1735,7 @@ Value execute_binary_operator(BinaryOperator oper, const Value &left,
                 if (left.value_known && right.value_known)
                 {
                     unordered_set<Value> result = *left.set_value;
-                    for (auto it = result.begin(); it != result.end(); it++)
+                    for (auto it = result.begin(); it != result.end();)
                     {
                         if (!right.set_value->count(*it))
                         {
@@ -1678,7 +1750,7 @@ Value execute_binary_operator(BinaryOperator oper, const Value &left,
                 }
                 else
                 {
-                    return Value(ValueType::Set);
+                    return Value(ValueType::Set, left.extension_types);
                 }
             }
 
@@ -1738,7 +1810,7 @@ Value execute_binary_operator(BinaryOperator oper, const Value &left,
                 }
                 else
                 {
-                    return Value(ValueType::Set);
+                    return Value(ValueType::Set, left.extension_types);
                 }
             }
 
@@ -1915,9 +1987,31 @@ Value execute_binary_operator(BinaryOperator oper, const Value &left,
                         throw invalid_argument(string_printf("can\'t compute result of %s + %s", left_str.c_str(), right_str.c_str()));
                     }
 
-                    vector<shared_ptr<Value>> result = *left.list_value;
-                    result.insert(result.end(), right.list_value->begin(), right.list_value->end());
-                    return Value(left.type, std::move(result));
+                    if (left.value_known && right.value_known)
+                    {
+                        vector<shared_ptr<Value>> result = *left.list_value;
+                        result.insert(result.end(), right.list_value->begin(), right.list_value->end());
+                        return Value(left.type, std::move(result));
+                    }
+
+                    // tuples have one extension type per item, so the result's
+                    // types are just both sides' types
+                    if (left.type == ValueType::Tuple)
+                    {
+                        vector<Value> extension_types = left.extension_types;
+                        extension_types.insert(extension_types.end(), right.extension_types.begin(),
+                                               right.extension_types.end());
+                        return Value(ValueType::Tuple, std::move(extension_types));
+                    }
+
+                    // one of the lists may be empty, so its item type may be
+                    // Indeterminate; the result has the other list's item type
+                    if (!left.extension_types.empty() &&
+                        (left.extension_types[0].type != ValueType::Indeterminate))
+                    {
+                        return left.type_only();
+                    }
+                    return right.type_only();
                 }
 
                 default:
@@ -1950,7 +2044,7 @@ Value execute_binary_operator(BinaryOperator oper, const Value &left,
                 }
                 else
                 {
-                    return Value(ValueType::Set);
+                    return Value(ValueType::Set, left.extension_types);
                 }
             }
 
@@ -1995,7 +2089,7 @@ Value execute_binary_operator(BinaryOperator oper, const Value &left,
                 {
                     return Value(list->type, vector<shared_ptr<Value>>());
                 }
-                if (multiplier->value_known && (multiplier->int_value == 0))
+                if (multiplier->value_known && (multiplier->int_value <= 0))
                 {
                     return Value(list->type, vector<shared_ptr<Value>>());
                 }
@@ -2005,7 +2099,9 @@ Value execute_binary_operator(BinaryOperator oper, const Value &left,
                 }
                 if (!list->value_known || !multiplier->value_known)
                 {
-                    return Value(list->type);
+                    // a list keeps its item type, but a tuple's length (and
+                    // therefore its extension types) isn't known
+                    return (list->type == ValueType::List) ? list->type_only() : Value(list->type);
                 }
 
                 vector<shared_ptr<Value>> result;
@@ -2152,8 +2248,14 @@ Value execute_binary_operator(BinaryOperator oper, const Value &left,
                 return Value(ValueType::Indeterminate);
             }
 
+            // the format can only be typechecked if it's known; otherwise it's
+            // checked when it's executed
             if (left.type == ValueType::Bytes)
             {
+                if (!left.value_known)
+                {
+                    return Value(ValueType::Bytes);
+                }
                 if (right.type != ValueType::Tuple)
                 {
                     bytes_typecheck_format(*left.bytes_value, {right});
@@ -2166,6 +2268,10 @@ Value execute_binary_operator(BinaryOperator oper, const Value &left,
             }
             if (left.type == ValueType::Unicode)
             {
+                if (!left.value_known)
+                {
+                    return Value(ValueType::Unicode);
+                }
                 if (right.type != ValueType::Tuple)
                 {
                     unicode_typecheck_format(*left.unicode_value, {right});
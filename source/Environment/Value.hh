@@ -155,6 +155,12 @@ namespace std
 
 bool type_has_refcount(ValueType type);
 
+bool is_refinement_of_type(const Value &type, const Value &declared_type);
+
+// replaces ExtensionTypeReferences in type (at any depth) with the extension
+// types of self_type that they refer to
+Value resolve_extension_type_references(const Value &type, const Value &self_type);
+
 std::string type_signature_for_variables(const std::vector<Value> &vars,
                                          bool allow_indeterminate = false);
 
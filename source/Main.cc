@@ -48,7 +48,11 @@ Options:\n\
         NoInlineRefcounting - disable inline refcounting\n\
         NoEagerCompilation - disable compiling callees even when all argument\n\
           types are available\n\
-        All - enable all behavior flags and debug info\n\
+        NoLoopAlignment - don\'t pad code to align the beginnings of loops\n\
+        StrictFloatRounding - round every float operation separately, as\n\
+          CPython does (disables fused multiply-add)\n\
+        All - enable all debug info, NoInlineRefcounting and\n\
+          NoEagerCompilation\n\
       -X may be used multiple times to enable multiple flags.\n\
 \n\
 All arguments after a filename, -c option, or -m option are not parsed;\n\
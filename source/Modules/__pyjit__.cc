@@ -1,6 +1,7 @@
 #include "__pyjit__.hh"
 
 #include <errno.h>
+#include <malloc.h>
 #include <stdint.h>
 #include <stdio.h>
 
@@ -31,7 +32,7 @@ static std::shared_ptr<ModuleContext> get_module(UnicodeObject* module_name) {
     string module_name_str;
     module_name_str.reserve(module_name->count);
     for (size_t x = 0; x < module_name->count; x++) {
-        module_name_str += static_cast<char>(module_name->data[x]);
+        module_name_str += static_cast<char>(unicode_read(module_name, x));
     }
     try {
         return global->modules.at(module_name_str);
@@ -182,6 +183,11 @@ shared_ptr<ModuleContext> __pyjit___initialize(GlobalContext* global_context) {
                                                                        debug_flags = new_debug_flags;
                                                                    }), false},
 
+                                                                   {"heap_used_size", {}, Int, void_fn_ptr([]() -> int64_t {
+                                                                       struct mallinfo2 info = mallinfo2();
+                                                                       return info.uordblks + info.hblkhd;
+                                                                   }), false},
+
                                                                    {"common_object_count", {}, Int, void_fn_ptr([]() -> int64_t {
                                                                        return common_object_count();
                                                                    }), false},
@@ -0,0 +1,159 @@
+#include "__pyjit_array__.hh"
+
+#include <stdint.h>
+
+#include "../Compiler/BuiltinFunctions.hh"
+#include "../Types/List.hh"
+#include "../Types/NumericKernels.hh"
+
+using namespace std;
+
+
+extern shared_ptr<GlobalContext> global;
+
+// this is a pyjit-only module (like __pyjit__), not python's array module, so
+// it has a name that can't collide with a standard module. lists of Ints and
+// Floats already store their items as contiguous 64-bit values, so these
+// functions run the kernels in NumericKernels directly on the list's items.
+// like the other builtin functions, they consume the references passed to them.
+
+static wstring __doc__ = L"Vectorized operations on lists of ints and floats.";
+
+static map<string, Value> globals({
+                                          {"__doc__",     Value(ValueType::Unicode, __doc__)},
+                                          {"__name__",    Value(ValueType::Unicode, L"__pyjit_array__")},
+                                          {"__package__", Value(ValueType::Unicode, L"")},
+                                  });
+
+template <typename T>
+static T *items_of(ListObject *l)
+{
+    return reinterpret_cast<T *>(l->items);
+}
+
+static void check_lengths_match(ListObject *a, ListObject *b, ExceptionBlock *exc_block)
+{
+    if (a->count != b->count)
+    {
+        delete_reference(a);
+        delete_reference(b);
+        raise_python_exception_with_message(exc_block, global->ValueError_class_id,
+                                            "lists have different lengths");
+        throw invalid_argument("lists have different lengths");
+    }
+}
+
+template <typename T, T (*Kernel)(const T *, size_t)>
+static T reduce_list(ListObject *l)
+{
+    T ret = Kernel(items_of<T>(l), l->count);
+    delete_reference(l);
+    return ret;
+}
+
+template <typename T, T (*Kernel)(const T *, size_t)>
+static T reduce_nonempty_list(ListObject *l, ExceptionBlock *exc_block)
+{
+    if (!l->count)
+    {
+        delete_reference(l);
+        raise_python_exception_with_message(exc_block, global->ValueError_class_id,
+                                            "arg is an empty sequence");
+        throw invalid_argument("arg is an empty sequence");
+    }
+    return reduce_list<T, Kernel>(l);
+}
+
+template <typename T, T (*Kernel)(const T *, const T *, size_t)>
+static T dot_lists(ListObject *a, ListObject *b, ExceptionBlock *exc_block)
+{
+    check_lengths_match(a, b, exc_block);
+    T ret = Kernel(items_of<T>(a), items_of<T>(b), a->count);
+    delete_reference(a);
+    delete_reference(b);
+    return ret;
+}
+
+template <typename T, void (*Kernel)(T *, const T *, const T *, size_t)>
+static ListObject *combine_lists(ListObject *a, ListObject *b, ExceptionBlock *exc_block)
+{
+    check_lengths_match(a, b, exc_block);
+    ListObject *ret = list_new(a->count, false, exc_block);
+    Kernel(items_of<T>(ret), items_of<T>(a), items_of<T>(b), a->count);
+    delete_reference(a);
+    delete_reference(b);
+    return ret;
+}
+
+template <typename T, void (*Kernel)(T *, const T *, T, size_t)>
+static ListObject *scale_list(ListObject *l, T factor, ExceptionBlock *exc_block)
+{
+    ListObject *ret = list_new(l->count, false, exc_block);
+    Kernel(items_of<T>(ret), items_of<T>(l), factor, l->count);
+    delete_reference(l);
+    return ret;
+}
+
+template <typename T, void (*Kernel)(T *, const T *, size_t)>
+static ListObject *prefix_sum_list(ListObject *l, ExceptionBlock *exc_block)
+{
+    ListObject *ret = list_new(l->count, false, exc_block);
+    Kernel(items_of<T>(ret), items_of<T>(l), l->count);
+    delete_reference(l);
+    return ret;
+}
+
+static ListObject *scale_float_list(ListObject *l, double factor, ExceptionBlock *exc_block)
+{
+    return scale_list<double, numeric_kernel_scale_floats>(l, factor, exc_block);
+}
+
+shared_ptr<ModuleContext> __pyjit_array___initialize(GlobalContext *global_context)
+{
+    Value Int(ValueType::Int);
+    Value Float(ValueType::Float);
+    Value List_Int(ValueType::List, vector<Value>({Int}));
+    Value List_Float(ValueType::List, vector<Value>({Float}));
+
+    vector<BuiltinFunctionDefinition> module_function_defs({
+                                                                   // reductions
+
+                                                                   {"sum",     {{{List_Int},             Int,        void_fn_ptr((&reduce_list<int64_t, numeric_kernel_sum_ints>))},
+                                                                                {{List_Float},           Float,      void_fn_ptr((&reduce_list<double, numeric_kernel_sum_floats>))}},                         false},
+
+                                                                   {"min",     {{{List_Int},             Int,        void_fn_ptr((&reduce_nonempty_list<int64_t, numeric_kernel_min_ints>))},
+                                                                                {{List_Float},           Float,      void_fn_ptr((&reduce_nonempty_list<double, numeric_kernel_min_floats>))}},                true},
+
+                                                                   {"max",     {{{List_Int},             Int,        void_fn_ptr((&reduce_nonempty_list<int64_t, numeric_kernel_max_ints>))},
+                                                                                {{List_Float},           Float,      void_fn_ptr((&reduce_nonempty_list<double, numeric_kernel_max_floats>))}},                true},
+
+                                                                   {"dot",     {{{List_Int, List_Int},   Int,        void_fn_ptr((&dot_lists<int64_t, numeric_kernel_dot_ints>))},
+                                                                                {{List_Float, List_Float}, Float,    void_fn_ptr((&dot_lists<double, numeric_kernel_dot_floats>))}},                           true},
+
+                                                                   // elementwise operations (these return new lists)
+
+                                                                   {"add",     {{{List_Int, List_Int},   List_Int,   void_fn_ptr((&combine_lists<int64_t, numeric_kernel_add_ints>))},
+                                                                                {{List_Float, List_Float}, List_Float, void_fn_ptr((&combine_lists<double, numeric_kernel_add_floats>))}},                     true},
+
+                                                                   {"mul",     {{{List_Int, List_Int},   List_Int,   void_fn_ptr((&combine_lists<int64_t, numeric_kernel_mul_ints>))},
+                                                                                {{List_Float, List_Float}, List_Float, void_fn_ptr((&combine_lists<double, numeric_kernel_mul_floats>))}},                     true},
+
+                                                                   {"scale",   {{{List_Int, Int},        List_Int,   void_fn_ptr((&scale_list<int64_t, numeric_kernel_scale_ints>))},
+                                                                                {{List_Float, Float},    List_Float, void_fn_ptr((&scale_list<double, numeric_kernel_scale_floats>))},
+                                                                                {{List_Float, Int},      List_Float, void_fn_ptr([](ListObject *l, int64_t factor, ExceptionBlock *exc_block) -> ListObject * {
+                                                                                    return scale_float_list(l, factor, exc_block);
+                                                                                })}},                                                                                                                 true},
+
+                                                                   // prefix sums: item x of the result is the sum of items 0 through x
+
+                                                                   {"cumsum",  {{{List_Int},             List_Int,   void_fn_ptr((&prefix_sum_list<int64_t, numeric_kernel_prefix_sum_ints>))},
+                                                                                {{List_Float},           List_Float, void_fn_ptr((&prefix_sum_list<double, numeric_kernel_prefix_sum_floats>))}},                  true},
+                                                           });
+
+    shared_ptr<ModuleContext> module(new ModuleContext(global_context, "__pyjit_array__", globals));
+    for (auto &def: module_function_defs)
+    {
+        module->create_builtin_function(def);
+    }
+    return module;
+}
@@ -0,0 +1,7 @@
+#pragma once
+
+#include <memory>
+
+#include "../Compiler/Contexts.hh"
+
+std::shared_ptr<ModuleContext> __pyjit_array___initialize(GlobalContext *global);
@@ -4,6 +4,7 @@
 #include <math.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <string.h>
 #include <unistd.h>
 
 #include <phosg/Strings.hh>
@@ -12,6 +13,8 @@
 #include "../Compiler/BuiltinFunctions.hh"
 #include "../Types/List.hh"
 #include "../Types/Dictionary.hh"
+#include "../Types/Set.hh"
+#include "../Types/Numbers.hh"
 
 using namespace std;
 using FragDef = BuiltinFragmentDefinition;
@@ -19,7 +22,90 @@ using FragDef = BuiltinFragmentDefinition;
 
 extern shared_ptr<GlobalContext> global;
 
-static UnicodeObject *empty_unicode = unicode_new(nullptr, 0);
+// ascii strings can be written directly; anything else is encoded as utf-8
+// first (we never call setlocale, so the wide stdio functions can't be used)
+static void write_unicode(FILE *stream, const UnicodeObject *s)
+{
+    if (unicode_is_ascii(s))
+    {
+        fwrite(s->latin1, 1, s->count, stream);
+    }
+    else
+    {
+        string data(unicode_utf8_size(s), '\0');
+        unicode_write_utf8(reinterpret_cast<uint8_t *>(data.data()), s);
+        fwrite(data.data(), 1, data.size(), stream);
+    }
+}
+
+// bytes.decode and str.encode call this to find the codec. if the name isn't
+// a known codec, it deletes the references and raises LookupError
+static StringCodec codec_for_name(ExceptionBlock *exc_block, UnicodeObject *name,
+                                  void *s)
+{
+    StringCodec codec = string_codec_for_name(name);
+    if (codec == StringCodec::Unknown)
+    {
+        string message = "unknown encoding: ";
+        for (size_t x = 0; x < name->count; x++)
+        {
+            uint32_t ch = unicode_read(name, x);
+            message.push_back((ch < 0x80) ? ch : '?');
+        }
+        delete_reference(s);
+        delete_reference(name);
+        raise_python_exception_with_message(exc_block, global->LookupError_class_id,
+                                            message.c_str());
+        throw invalid_argument(message);
+    }
+    return codec;
+}
+
+// int() and float() parse their arguments before deleting the references to
+// them, then call this to raise the appropriate exception if parsing failed
+static void raise_for_parse_result(ExceptionBlock *exc_block, ParseNumberResult result,
+                                   int64_t base, const char *function_name)
+{
+    if (result == ParseNumberResult::Valid)
+    {
+        return;
+    }
+    if ((base != 0) && ((base < 2) || (base > 36)))
+    {
+        raise_python_exception_with_message(exc_block, global->ValueError_class_id,
+                                            "int() base must be >= 2 and <= 36, or 0");
+    }
+    else if (result == ParseNumberResult::OutOfRange)
+    {
+        raise_python_exception_with_message(exc_block, global->OverflowError_class_id,
+                                            "int too large to convert");
+    }
+    else
+    {
+        raise_python_exception_with_format(exc_block, global->ValueError_class_id,
+                                           "invalid value for %s()", function_name);
+    }
+}
+
+// sorted() and list.sort() consume the references passed to them, unlike the
+// list_sort functions they call
+template <void (*Sort)(ListObject *, bool, ExceptionBlock *)>
+static ListObject *sorted_list(ListObject *l, bool reverse, ExceptionBlock *exc_block)
+{
+    ListObject *ret = list_slice(l, slice_index_missing, slice_index_missing, 1, exc_block);
+    delete_reference(l);
+    Sort(ret, reverse, exc_block);
+    return ret;
+}
+
+template <void (*Sort)(ListObject *, bool, ExceptionBlock *)>
+static void sort_list(ListObject *l, bool reverse, ExceptionBlock *exc_block)
+{
+    Sort(l, reverse, exc_block);
+    delete_reference(l);
+}
+
+static UnicodeObject *empty_unicode = unicode_new_with_kind(UnicodeKind::Latin1, 0);
 static const Value None(ValueType::None);
 static const Value Bool(ValueType::Bool);
 static const Value Bool_True(ValueType::Bool, true);
@@ -27,11 +113,17 @@ static const Value Bool_False(ValueType::Bool, false);
 static const Value Int(ValueType::Int);
 static const Value Int_Zero(ValueType::Int, static_cast<int64_t>(0));
 static const Value Int_NegOne(ValueType::Int, static_cast<int64_t>(-1));
+static const Value Int_Ten(ValueType::Int, static_cast<int64_t>(10));
 static const Value Float(ValueType::Float);
 static const Value Float_Zero(ValueType::Float, 0.0);
 static const Value Bytes(ValueType::Bytes);
 static const Value Unicode(ValueType::Unicode);
 static const Value Unicode_Blank(ValueType::Unicode, L"");
+static const Value Unicode_UTF8(ValueType::Unicode, L"utf-8");
+static const Value List_Int(ValueType::List, vector<Value>({Int}));
+static const Value List_Float(ValueType::List, vector<Value>({Float}));
+static const Value List_Bytes(ValueType::List, vector<Value>({Bytes}));
+static const Value List_Unicode(ValueType::List, vector<Value>({Unicode}));
 static const Value Extension0(ValueType::ExtensionTypeReference, static_cast<int64_t>(0));
 static const Value Extension1(ValueType::ExtensionTypeReference, static_cast<int64_t>(1));
 static const Value Self(ValueType::Instance, 0LL, nullptr);
@@ -105,7 +197,6 @@ static map<string, Value> globals({
                                           // {"round",           Value(ValueType::Function)},
                                           // {"setattr",         Value(ValueType::Function)},
                                           // {"slice",           Value(ValueType::Function)},
-                                          // {"sorted",          Value(ValueType::Function)},
                                           // {"staticmethod",    Value(ValueType::Function)},
                                           // {"str",             Value(ValueType::Function)},
                                           // {"sum",             Value(ValueType::Function)},
@@ -140,19 +231,24 @@ shared_ptr<ModuleContext> builtins_initialize(GlobalContext *global_context)
                                                                        }
 
                                                                    })), FragDef({Int}, None, void_fn_ptr([](int64_t v) {
-                                                                       fprintf(stdout, "%"
-                                                                       PRId64
-                                                                       "\n", v);
+                                                                       char buf[max_number_text_length + 1];
+                                                                       size_t count = format_int(buf, v);
+                                                                       buf[count] = '\n';
+                                                                       fwrite(buf, count + 1, 1, stdout);
 
                                                                    })), FragDef({Float}, None, void_fn_ptr([](double v) {
-                                                                       fprintf(stdout, "%lg\n", v);
+                                                                       char buf[max_number_text_length + 1];
+                                                                       size_t count = format_float_repr(buf, v);
+                                                                       buf[count] = '\n';
+                                                                       fwrite(buf, count + 1, 1, stdout);
 
                                                                    })), FragDef({Bytes}, None, void_fn_ptr([](BytesObject *str) {
                                                                        fprintf(stdout, "%.*s\n", static_cast<int>(str->count), str->data);
                                                                        delete_reference(str);
 
                                                                    })), FragDef({Unicode}, None, void_fn_ptr([](UnicodeObject *str) {
-                                                                       fprintf(stdout, "%.*ls\n", static_cast<int>(str->count), str->data);
+                                                                       write_unicode(stdout, str);
+                                                                       fputc('\n', stdout);
                                                                        delete_reference(str);
                                                                    }))},                      false},
 
@@ -185,7 +281,7 @@ shared_ptr<ModuleContext> builtins_initialize(GlobalContext *global_context)
                                                                    {"input", {Unicode_Blank}, Unicode, void_fn_ptr([](UnicodeObject *prompt) -> UnicodeObject * {
                                                                        if (prompt->count)
                                                                        {
-                                                                           fprintf(stdout, "%.*ls", static_cast<int>(prompt->count), prompt->data);
+                                                                           write_unicode(stdout, prompt);
                                                                            fflush(stdout);
                                                                        }
                                                                        delete_reference(prompt);
@@ -271,41 +367,33 @@ shared_ptr<ModuleContext> builtins_initialize(GlobalContext *global_context)
                                                                        return ret;
                                                                    }))},                      false},
 
-                                                                   // Int int(Int=0, Int=0)
-                                                                   // Int int(Bytes, Int=0)
-                                                                   // Int int(Unicode, Int=0)
-                                                                   // Int int(Float, Int=0)
-                                                                   {"int",   {FragDef({Int_Zero, Int_Zero}, Int, void_fn_ptr([](
+                                                                   // Int int(Int=0, Int=10)
+                                                                   // Int int(Bytes, Int=10)
+                                                                   // Int int(Unicode, Int=10)
+                                                                   // Int int(Float, Int=10)
+                                                                   {"int",   {FragDef({Int_Zero, Int_Ten}, Int, void_fn_ptr([](
                                                                            int64_t i, int64_t, ExceptionBlock *) -> int64_t {
                                                                        return i;
 
-                                                                   })), FragDef({Bytes, Int_Zero}, Int, void_fn_ptr([](
+                                                                   })), FragDef({Bytes, Int_Ten}, Int, void_fn_ptr([](
                                                                            BytesObject *s, int64_t base, ExceptionBlock *exc_block) -> int64_t {
-                                                                       char *endptr;
-                                                                       int64_t ret = strtoll(reinterpret_cast<const char *>(s->data), &endptr, base);
+                                                                       int64_t ret = 0;
+                                                                       ParseNumberResult result = ((base == 0) || ((base >= 2) && (base <= 36))) ?
+                                                                                                  bytes_parse_int(s, base, &ret) : ParseNumberResult::Invalid;
                                                                        delete_reference(s);
-
-                                                                       if (endptr != s->data + s->count)
-                                                                       {
-                                                                           raise_python_exception_with_message(exc_block, global->ValueError_class_id,
-                                                                                                               "invalid value for int()");
-                                                                       }
+                                                                       raise_for_parse_result(exc_block, result, base, "int");
                                                                        return ret;
 
-                                                                   })), FragDef({Unicode, Int_Zero}, Int, void_fn_ptr([](
+                                                                   })), FragDef({Unicode, Int_Ten}, Int, void_fn_ptr([](
                                                                            UnicodeObject *s, int64_t base, ExceptionBlock *exc_block) -> int64_t {
-                                                                       wchar_t *endptr;
-                                                                       int64_t ret = wcstoll(s->data, &endptr, base);
+                                                                       int64_t ret = 0;
+                                                                       ParseNumberResult result = ((base == 0) || ((base >= 2) && (base <= 36))) ?
+                                                                                                  unicode_parse_int(s, base, &ret) : ParseNumberResult::Invalid;
                                                                        delete_reference(s);
-
-                                                                       if (endptr != s->data + s->count)
-                                                                       {
-                                                                           raise_python_exception_with_message(exc_block, global->ValueError_class_id,
-                                                                                                               "invalid value for int()");
-                                                                       }
+                                                                       raise_for_parse_result(exc_block, result, base, "int");
                                                                        return ret;
 
-                                                                   })), FragDef({Float, Int_Zero}, Int, void_fn_ptr([](
+                                                                   })), FragDef({Float, Int_Ten}, Int, void_fn_ptr([](
                                                                            double x, int64_t, ExceptionBlock *) -> int64_t {
                                                                        return static_cast<int64_t>(x);
                                                                    }))},                      true},
@@ -324,28 +412,18 @@ shared_ptr<ModuleContext> builtins_initialize(GlobalContext *global_context)
 
                                                                    })), FragDef({Bytes}, Float, void_fn_ptr([](
                                                                            BytesObject *s, ExceptionBlock *exc_block) -> double {
-                                                                       char *endptr;
-                                                                       double ret = strtod(s->data, &endptr);
+                                                                       double ret = 0.0;
+                                                                       ParseNumberResult result = bytes_parse_float(s, &ret);
                                                                        delete_reference(s);
-
-                                                                       if (endptr != s->data + s->count)
-                                                                       {
-                                                                           raise_python_exception_with_message(exc_block, global->ValueError_class_id,
-                                                                                                               "invalid value for float()");
-                                                                       }
+                                                                       raise_for_parse_result(exc_block, result, 10, "float");
                                                                        return ret;
 
                                                                    })), FragDef({Unicode}, Float, void_fn_ptr([](
                                                                            UnicodeObject *s, ExceptionBlock *exc_block) -> double {
-                                                                       wchar_t *endptr;
-                                                                       double ret = wcstod(s->data, &endptr);
+                                                                       double ret = 0.0;
+                                                                       ParseNumberResult result = unicode_parse_float(s, &ret);
                                                                        delete_reference(s);
-
-                                                                       if (endptr != s->data + s->count)
-                                                                       {
-                                                                           raise_python_exception_with_message(exc_block, global->ValueError_class_id,
-                                                                                                               "invalid value for float()");
-                                                                       }
+                                                                       raise_for_parse_result(exc_block, result, 10, "float");
                                                                        return ret;
                                                                    }))},                      true},
 
@@ -368,56 +446,30 @@ shared_ptr<ModuleContext> builtins_initialize(GlobalContext *global_context)
                                                                        return ret;
 
                                                                    })), FragDef({Int}, Unicode, void_fn_ptr([](int64_t v) -> UnicodeObject * {
-                                                                       wchar_t buf[24];
-                                                                       return unicode_new(buf, swprintf(buf, sizeof(buf) / sizeof(buf[0]), L"%"
-                                                                       PRId64, v));
+                                                                       char buf[max_number_text_length];
+                                                                       return unicode_new_latin1(buf, format_int(buf, v));
 
                                                                    })), FragDef({Float}, Unicode, void_fn_ptr([](double v) -> UnicodeObject * {
-                                                                       wchar_t buf[60]; // TODO: figure out how long this actually needs to be
-                                                                       size_t count = swprintf(buf, sizeof(buf) / sizeof(buf[0]) - 2, L"%lg", v);
-
-                                                                       // if there isn't a . in the output, add .0 at the end
-                                                                       size_t x;
-                                                                       for (x = 0; x < count; x++)
-                                                                       {
-                                                                           if (buf[x] == L'.')
-                                                                           {
-                                                                               break;
-                                                                           }
-                                                                       }
-                                                                       if (x == count)
-                                                                       {
-                                                                           buf[count] = L'.';
-                                                                           buf[count + 1] = L'0';
-                                                                           buf[count + 2] = 0;
-                                                                       }
-
-                                                                       return unicode_new(buf, wcslen(buf));
+                                                                       char buf[max_number_text_length];
+                                                                       return unicode_new_latin1(buf, format_float_repr(buf, v));
 
                                                                    })), FragDef({Bytes}, Unicode, void_fn_ptr([](BytesObject *v) -> UnicodeObject * {
                                                                        string escape_ret = escape(reinterpret_cast<const char *>(v->data), v->count);
-                                                                       UnicodeObject *ret = unicode_new(nullptr, escape_ret.size() + 3);
-                                                                       ret->data[0] = L'b';
-                                                                       ret->data[1] = L'\'';
-                                                                       for (size_t x = 0; x < escape_ret.size(); x++)
-                                                                       {
-                                                                           ret->data[x + 2] = escape_ret[x];
-                                                                       }
-                                                                       ret->data[escape_ret.size() + 2] = L'\'';
-                                                                       ret->data[escape_ret.size() + 3] = 0;
+                                                                       UnicodeObject *ret = unicode_new_with_kind(UnicodeKind::Latin1, escape_ret.size() + 3);
+                                                                       ret->latin1[0] = 'b';
+                                                                       ret->latin1[1] = '\'';
+                                                                       memcpy(&ret->latin1[2], escape_ret.data(), escape_ret.size());
+                                                                       ret->latin1[escape_ret.size() + 2] = '\'';
                                                                        delete_reference(v);
                                                                        return ret;
 
                                                                    })), FragDef({Unicode}, Unicode, void_fn_ptr([](UnicodeObject *v) -> UnicodeObject * {
-                                                                       string escape_ret = escape(v->data, v->count);
-                                                                       UnicodeObject *ret = unicode_new(nullptr, escape_ret.size() + 2);
-                                                                       ret->data[0] = L'\'';
-                                                                       for (size_t x = 0; x < escape_ret.size(); x++)
-                                                                       {
-                                                                           ret->data[x + 1] = escape_ret[x];
-                                                                       }
-                                                                       ret->data[escape_ret.size() + 1] = L'\'';
-                                                                       ret->data[escape_ret.size() + 2] = 0;
+                                                                       wstring data = unicode_to_cxx_wstring(v);
+                                                                       string escape_ret = escape(data.data(), data.size());
+                                                                       UnicodeObject *ret = unicode_new_with_kind(UnicodeKind::Latin1, escape_ret.size() + 2);
+                                                                       ret->latin1[0] = '\'';
+                                                                       memcpy(&ret->latin1[1], escape_ret.data(), escape_ret.size());
+                                                                       ret->latin1[escape_ret.size() + 1] = '\'';
                                                                        delete_reference(v);
                                                                        return ret;
                                                                    }))},                      false},
@@ -426,8 +478,8 @@ shared_ptr<ModuleContext> builtins_initialize(GlobalContext *global_context)
                                                                    // Int len(Unicode)
                                                                    // Int len(List[Any])
                                                                    // Int len(Tuple[...]) // unimplemented
-                                                                   // Int len(Set[Any]) // unimplemented
-                                                                   // Int len(Dict[Any, Any]) // unimplemented
+                                                                   // Int len(Set[Any])
+                                                                   // Int len(Dict[Any, Any])
                                                                    {"len",   {FragDef({Bytes}, Int, void_fn_ptr([](BytesObject *s) -> int64_t {
                                                                        int64_t ret = s->count;
                                                                        delete_reference(s);
@@ -440,6 +492,14 @@ shared_ptr<ModuleContext> builtins_initialize(GlobalContext *global_context)
                                                                        int64_t ret = l->count;
                                                                        delete_reference(l);
                                                                        return ret;
+                                                                   })), FragDef({Set_Any}, Int, void_fn_ptr([](SetObject *s) -> int64_t {
+                                                                       int64_t ret = s->count;
+                                                                       delete_reference(s);
+                                                                       return ret;
+                                                                   })), FragDef({Dict_Any}, Int, void_fn_ptr([](DictionaryObject *d) -> int64_t {
+                                                                       int64_t ret = d->count;
+                                                                       delete_reference(d);
+                                                                       return ret;
                                                                    }))},                      false},
 
                                                                    // Int abs(Int)
@@ -459,9 +519,8 @@ shared_ptr<ModuleContext> builtins_initialize(GlobalContext *global_context)
                                                                                                                "invalid value for chr()");
                                                                        }
 
-                                                                       UnicodeObject *s = unicode_new(nullptr, 1);
-                                                                       s->data[0] = i;
-                                                                       s->data[1] = 0;
+                                                                       UnicodeObject *s = unicode_new_with_kind(unicode_kind_for_char(i), 1);
+                                                                       unicode_write(s, 0, i);
                                                                        return s;
                                                                    }), true},
 
@@ -485,97 +544,41 @@ shared_ptr<ModuleContext> builtins_initialize(GlobalContext *global_context)
                                                                                                                "string contains more than one character");
                                                                        }
 
-                                                                       int64_t ret = (s->count < 1) ? -1 : s->data[0];
+                                                                       int64_t ret = (s->count < 1) ? -1 : unicode_read(s, 0);
                                                                        delete_reference(s);
                                                                        return ret;
                                                                    }))},                      true},
 
                                                                    // Unicode bin(Int)
                                                                    {"bin",   {Int},           Unicode, void_fn_ptr([](int64_t i) -> UnicodeObject * {
-                                                                       if (!i)
-                                                                       {
-                                                                           return unicode_new(L"0b0", 3);
-                                                                       }
-
-                                                                       UnicodeObject *s = unicode_new(nullptr, 67);
-                                                                       size_t x = 0;
-                                                                       if (i < 0)
-                                                                       {
-                                                                           i = -i;
-                                                                           s->data[x++] = L'-';
-                                                                       }
-                                                                       s->data[x++] = L'0';
-                                                                       s->data[x++] = L'b';
-
-                                                                       bool should_write = false;
-                                                                       for (size_t y = 0; y < sizeof(int64_t) * 8; y++)
-                                                                       {
-                                                                           bool bit_set = i & 0x8000000000000000;
-                                                                           if (bit_set)
-                                                                           {
-                                                                               should_write = true;
-                                                                           }
-                                                                           if (should_write)
-                                                                           {
-                                                                               s->data[x++] = bit_set ? L'1' : L'0';
-                                                                           }
-                                                                           i <<= 1;
-                                                                       }
-                                                                       s->data[x] = 0;
-                                                                       s->count = x;
-                                                                       return s;
+                                                                       char buf[max_number_text_length];
+                                                                       return unicode_new_latin1(buf, format_int_prefixed(buf, i, 1));
                                                                    }), false},
 
                                                                    // Unicode oct(Int)
                                                                    {"oct",   {Int},           Unicode, void_fn_ptr([](int64_t i) -> UnicodeObject * {
-                                                                       if (!i)
-                                                                       {
-                                                                           return unicode_new(L"0o0", 3);
-                                                                       }
-
-                                                                       // 1<<63 is its own negative, so special-case it here so we can assume
-                                                                       // below that the sign bit is never set
-                                                                       if (i == -i)
-                                                                       {
-                                                                           return unicode_new(L"-0o1000000000000000000000", 25);
-                                                                       }
-
-                                                                       UnicodeObject *s = unicode_new(nullptr, 25);
-                                                                       size_t x = 0;
-                                                                       if (i < 0)
-                                                                       {
-                                                                           i = -i;
-                                                                           s->data[x++] = '-';
-                                                                       }
-                                                                       s->data[x++] = L'0';
-                                                                       s->data[x++] = L'o';
-
-                                                                       i <<= 1;
-                                                                       bool should_write = false;
-                                                                       for (ssize_t y = 63; y > 0; y -= 3)
-                                                                       {
-                                                                           uint8_t value = ((i >> 61) & 7);
-                                                                           if (value != 0)
-                                                                           {
-                                                                               should_write = true;
-                                                                           }
-                                                                           if (should_write)
-                                                                           {
-                                                                               s->data[x++] = L'0' + value;
-                                                                           }
-                                                                           i <<= 3;
-                                                                       }
-                                                                       s->data[x] = 0;
-                                                                       s->count = x;
-                                                                       return s;
+                                                                       char buf[max_number_text_length];
+                                                                       return unicode_new_latin1(buf, format_int_prefixed(buf, i, 3));
                                                                    }), false},
 
                                                                    // Unicode hex(Int)
                                                                    {"hex",   {Int},           Unicode, void_fn_ptr([](int64_t i) -> UnicodeObject * {
-                                                                       UnicodeObject *s = unicode_new(nullptr, 19);
-                                                                       s->count = swprintf(s->data, 19, L"%s0x%x", (i < 0) ? "-" : "", (i < 0) ? -i : i);
-                                                                       return s;
+                                                                       char buf[max_number_text_length];
+                                                                       return unicode_new_latin1(buf, format_int_prefixed(buf, i, 4));
                                                                    }), false},
+
+                                                                   // List[Int] sorted(List[Int], reverse=False)
+                                                                   // List[Float] sorted(List[Float], reverse=False)
+                                                                   // List[Bytes] sorted(List[Bytes], reverse=False)
+                                                                   // List[Unicode] sorted(List[Unicode], reverse=False)
+                                                                   // key= isn't supported, so calls that pass it fail
+                                                                   // to compile
+                                                                   {"sorted", {
+                                                                           FragDef({List_Int, Bool_False}, List_Int, void_fn_ptr(&sorted_list<list_sort_ints>)),
+                                                                           FragDef({List_Float, Bool_False}, List_Float, void_fn_ptr(&sorted_list<list_sort_floats>)),
+                                                                           FragDef({List_Bytes, Bool_False}, List_Bytes, void_fn_ptr(&sorted_list<list_sort_bytes>)),
+                                                                           FragDef({List_Unicode, Bool_False}, List_Unicode, void_fn_ptr(&sorted_list<list_sort_unicode>)),
+                                                                   }, true, {"iterable", "reverse"}},
                                                            });
 
     static auto one_field_constructor = void_fn_ptr([](uint8_t *o, int64_t value) -> void * {
@@ -676,14 +679,106 @@ shared_ptr<ModuleContext> builtins_initialize(GlobalContext *global_context)
                                                       }, trivial_destructor},
 
                                                       {"bytes", {}, {
+                                                              {"count", {Bytes, Bytes}, Int, void_fn_ptr([](BytesObject *s, BytesObject *x) -> int64_t {
+                                                                  int64_t ret = bytes_count(s, x);
+                                                                  delete_reference(s);
+                                                                  delete_reference(x);
+                                                                  return ret;
+                                                              }), false},
+                                                              {"decode", {Bytes, Unicode_UTF8}, Unicode, void_fn_ptr([](BytesObject *s, UnicodeObject *encoding, ExceptionBlock *exc_block) -> UnicodeObject * {
+                                                                  StringCodec codec = codec_for_name(exc_block, encoding, s);
+                                                                  string error;
+                                                                  UnicodeObject *ret = bytes_decode(s, codec, &error, exc_block);
+                                                                  delete_reference(s);
+                                                                  delete_reference(encoding);
+                                                                  if (!ret)
+                                                                  {
+                                                                      raise_python_exception_with_message(exc_block, global->UnicodeDecodeError_class_id,
+                                                                                                          error.c_str());
+                                                                      throw invalid_argument(error);
+                                                                  }
+                                                                  return ret;
+                                                              }), true},
+                                                              {"endswith", {Bytes, Bytes}, Bool, void_fn_ptr([](BytesObject *s, BytesObject *x) -> bool {
+                                                                  bool ret = bytes_endswith(s, x);
+                                                                  delete_reference(s);
+                                                                  delete_reference(x);
+                                                                  return ret;
+                                                              }), false},
+                                                              {"find", {Bytes, Bytes}, Int, void_fn_ptr([](BytesObject *s, BytesObject *x) -> int64_t {
+                                                                  int64_t ret = bytes_find(s, x);
+                                                                  delete_reference(s);
+                                                                  delete_reference(x);
+                                                                  return ret;
+                                                              }), false},
+                                                              {"join", {Bytes, List_Bytes}, Bytes, void_fn_ptr([](BytesObject *s, ListObject *items, ExceptionBlock *exc_block) -> BytesObject * {
+                                                                  BytesObject *ret = bytes_join(s, items, exc_block);
+                                                                  delete_reference(s);
+                                                                  delete_reference(items);
+                                                                  return ret;
+                                                              }), true},
+                                                              {"lower", {Bytes}, Bytes, void_fn_ptr([](BytesObject *s, ExceptionBlock *exc_block) -> BytesObject * {
+                                                                  BytesObject *ret = bytes_lower(s, exc_block);
+                                                                  delete_reference(s);
+                                                                  return ret;
+                                                              }), true},
+                                                              {"lstrip", {Bytes}, Bytes, void_fn_ptr([](BytesObject *s, ExceptionBlock *exc_block) -> BytesObject * {
+                                                                  BytesObject *ret = bytes_strip(s, true, false, exc_block);
+                                                                  delete_reference(s);
+                                                                  return ret;
+                                                              }), true},
+                                                              {"replace", {Bytes, Bytes, Bytes}, Bytes, void_fn_ptr([](BytesObject *s, BytesObject *old, BytesObject *new_s, ExceptionBlock *exc_block) -> BytesObject * {
+                                                                  BytesObject *ret = bytes_replace(s, old, new_s, exc_block);
+                                                                  delete_reference(s);
+                                                                  delete_reference(old);
+                                                                  delete_reference(new_s);
+                                                                  return ret;
+                                                              }), true},
+                                                              {"rstrip", {Bytes}, Bytes, void_fn_ptr([](BytesObject *s, ExceptionBlock *exc_block) -> BytesObject * {
+                                                                  BytesObject *ret = bytes_strip(s, false, true, exc_block);
+                                                                  delete_reference(s);
+                                                                  return ret;
+                                                              }), true},
+                                                              // split(None) splits on whitespace
+                                                              {"split", {FragDef({Bytes, None}, List_Bytes, void_fn_ptr([](BytesObject *s, void *, ExceptionBlock *exc_block) -> ListObject * {
+                                                                  ListObject *ret = bytes_split(s, nullptr, exc_block);
+                                                                  delete_reference(s);
+                                                                  return ret;
+                                                              })), FragDef({Bytes, Bytes}, List_Bytes, void_fn_ptr([](BytesObject *s, BytesObject *sep, ExceptionBlock *exc_block) -> ListObject * {
+                                                                  if (!sep->count)
+                                                                  {
+                                                                      delete_reference(s);
+                                                                      delete_reference(sep);
+                                                                      raise_python_exception_with_message(exc_block, global->ValueError_class_id,
+                                                                                                          "empty separator");
+                                                                      throw invalid_argument("empty separator");
+                                                                  }
+                                                                  ListObject *ret = bytes_split(s, sep, exc_block);
+                                                                  delete_reference(s);
+                                                                  delete_reference(sep);
+                                                                  return ret;
+                                                              }))}, true},
+                                                              {"startswith", {Bytes, Bytes}, Bool, void_fn_ptr([](BytesObject *s, BytesObject *x) -> bool {
+                                                                  bool ret = bytes_startswith(s, x);
+                                                                  delete_reference(s);
+                                                                  delete_reference(x);
+                                                                  return ret;
+                                                              }), false},
+                                                              {"strip", {Bytes}, Bytes, void_fn_ptr([](BytesObject *s, ExceptionBlock *exc_block) -> BytesObject * {
+                                                                  BytesObject *ret = bytes_strip(s, true, true, exc_block);
+                                                                  delete_reference(s);
+                                                                  return ret;
+                                                              }), true},
+                                                              {"upper", {Bytes}, Bytes, void_fn_ptr([](BytesObject *s, ExceptionBlock *exc_block) -> BytesObject * {
+                                                                  BytesObject *ret = bytes_upper(s, exc_block);
+                                                                  delete_reference(s);
+                                                                  return ret;
+                                                              }), true},
+
                                                               /* TODO: implement these
                                                               {"capitalize", {Self, TODO}, TODO, void_fn_ptr(nullptr), false},
                                                               {"center", {Self, TODO}, TODO, void_fn_ptr(nullptr), false},
-                                                              {"count", {Self, TODO}, TODO, void_fn_ptr(nullptr), false},
-                                                              {"decode", {Self, TODO}, TODO, void_fn_ptr(nullptr), false},
-                                                              {"endswith", {Self, TODO}, TODO, void_fn_ptr(nullptr), false},
                                                               {"expandtabs", {Self, TODO}, TODO, void_fn_ptr(nullptr), false},
-                                                              {"find", {Self, TODO}, TODO, void_fn_ptr(nullptr), false},
                                                               {"fromhex", {Self, TODO}, TODO, void_fn_ptr(nullptr), false},
                                                               {"hex", {Self, TODO}, TODO, void_fn_ptr(nullptr), false},
                                                               {"index", {Self, TODO}, TODO, void_fn_ptr(nullptr), false},
@@ -694,41 +789,124 @@ shared_ptr<ModuleContext> builtins_initialize(GlobalContext *global_context)
                                                               {"isspace", {Self, TODO}, TODO, void_fn_ptr(nullptr), false},
                                                               {"istitle", {Self, TODO}, TODO, void_fn_ptr(nullptr), false},
                                                               {"isupper", {Self, TODO}, TODO, void_fn_ptr(nullptr), false},
-                                                              {"join", {Self, TODO}, TODO, void_fn_ptr(nullptr), false},
                                                               {"ljust", {Self, TODO}, TODO, void_fn_ptr(nullptr), false},
-                                                              {"lower", {Self, TODO}, TODO, void_fn_ptr(nullptr), false},
-                                                              {"lstrip", {Self, TODO}, TODO, void_fn_ptr(nullptr), false},
                                                               {"maketrans", {Self, TODO}, TODO, void_fn_ptr(nullptr), false},
                                                               {"partition", {Self, TODO}, TODO, void_fn_ptr(nullptr), false},
-                                                              {"replace", {Self, TODO}, TODO, void_fn_ptr(nullptr), false},
                                                               {"rfind", {Self, TODO}, TODO, void_fn_ptr(nullptr), false},
                                                               {"rindex", {Self, TODO}, TODO, void_fn_ptr(nullptr), false},
                                                               {"rjust", {Self, TODO}, TODO, void_fn_ptr(nullptr), false},
                                                               {"rpartition", {Self, TODO}, TODO, void_fn_ptr(nullptr), false},
                                                               {"rsplit", {Self, TODO}, TODO, void_fn_ptr(nullptr), false},
-                                                              {"rstrip", {Self, TODO}, TODO, void_fn_ptr(nullptr), false},
-                                                              {"split", {Self, TODO}, TODO, void_fn_ptr(nullptr), false},
                                                               {"splitlines", {Self, TODO}, TODO, void_fn_ptr(nullptr), false},
-                                                              {"startswith", {Self, TODO}, TODO, void_fn_ptr(nullptr), false},
-                                                              {"strip", {Self, TODO}, TODO, void_fn_ptr(nullptr), false},
                                                               {"swapcase", {Self, TODO}, TODO, void_fn_ptr(nullptr), false},
                                                               {"title", {Self, TODO}, TODO, void_fn_ptr(nullptr), false},
                                                               {"translate", {Self, TODO}, TODO, void_fn_ptr(nullptr), false},
-                                                              {"upper", {Self, TODO}, TODO, void_fn_ptr(nullptr), false},
                                                               {"zfill", {Self, TODO}, TODO, void_fn_ptr(nullptr), false},
                                                               */
                                                       }, trivial_destructor},
 
                                                       {"unicode", {}, {
+                                                              {"count", {Unicode, Unicode}, Int, void_fn_ptr([](UnicodeObject *s, UnicodeObject *x) -> int64_t {
+                                                                  int64_t ret = unicode_count(s, x);
+                                                                  delete_reference(s);
+                                                                  delete_reference(x);
+                                                                  return ret;
+                                                              }), false},
+                                                              {"encode", {Unicode, Unicode_UTF8}, Bytes, void_fn_ptr([](UnicodeObject *s, UnicodeObject *encoding, ExceptionBlock *exc_block) -> BytesObject * {
+                                                                  StringCodec codec = codec_for_name(exc_block, encoding, s);
+                                                                  string error;
+                                                                  BytesObject *ret = unicode_encode(s, codec, &error, exc_block);
+                                                                  delete_reference(s);
+                                                                  delete_reference(encoding);
+                                                                  if (!ret)
+                                                                  {
+                                                                      raise_python_exception_with_message(exc_block, global->UnicodeEncodeError_class_id,
+                                                                                                          error.c_str());
+                                                                      throw invalid_argument(error);
+                                                                  }
+                                                                  return ret;
+                                                              }), true},
+                                                              {"endswith", {Unicode, Unicode}, Bool, void_fn_ptr([](UnicodeObject *s, UnicodeObject *x) -> bool {
+                                                                  bool ret = unicode_endswith(s, x);
+                                                                  delete_reference(s);
+                                                                  delete_reference(x);
+                                                                  return ret;
+                                                              }), false},
+                                                              {"find", {Unicode, Unicode}, Int, void_fn_ptr([](UnicodeObject *s, UnicodeObject *x) -> int64_t {
+                                                                  int64_t ret = unicode_find(s, x);
+                                                                  delete_reference(s);
+                                                                  delete_reference(x);
+                                                                  return ret;
+                                                              }), false},
+                                                              {"join", {Unicode, List_Unicode}, Unicode, void_fn_ptr([](UnicodeObject *s, ListObject *items, ExceptionBlock *exc_block) -> UnicodeObject * {
+                                                                  UnicodeObject *ret = unicode_join(s, items, exc_block);
+                                                                  delete_reference(s);
+                                                                  delete_reference(items);
+                                                                  return ret;
+                                                              }), true},
+                                                              {"lower", {Unicode}, Unicode, void_fn_ptr([](UnicodeObject *s, ExceptionBlock *exc_block) -> UnicodeObject * {
+                                                                  UnicodeObject *ret = unicode_lower(s, exc_block);
+                                                                  delete_reference(s);
+                                                                  return ret;
+                                                              }), true},
+                                                              {"lstrip", {Unicode}, Unicode, void_fn_ptr([](UnicodeObject *s, ExceptionBlock *exc_block) -> UnicodeObject * {
+                                                                  UnicodeObject *ret = unicode_strip(s, true, false, exc_block);
+                                                                  delete_reference(s);
+                                                                  return ret;
+                                                              }), true},
+                                                              {"replace", {Unicode, Unicode, Unicode}, Unicode, void_fn_ptr([](UnicodeObject *s, UnicodeObject *old, UnicodeObject *new_s, ExceptionBlock *exc_block) -> UnicodeObject * {
+                                                                  UnicodeObject *ret = unicode_replace(s, old, new_s, exc_block);
+                                                                  delete_reference(s);
+                                                                  delete_reference(old);
+                                                                  delete_reference(new_s);
+                                                                  return ret;
+                                                              }), true},
+                                                              {"rstrip", {Unicode}, Unicode, void_fn_ptr([](UnicodeObject *s, ExceptionBlock *exc_block) -> UnicodeObject * {
+                                                                  UnicodeObject *ret = unicode_strip(s, false, true, exc_block);
+                                                                  delete_reference(s);
+                                                                  return ret;
+                                                              }), true},
+                                                              // split(None) splits on whitespace
+                                                              {"split", {FragDef({Unicode, None}, List_Unicode, void_fn_ptr([](UnicodeObject *s, void *, ExceptionBlock *exc_block) -> ListObject * {
+                                                                  ListObject *ret = unicode_split(s, nullptr, exc_block);
+                                                                  delete_reference(s);
+                                                                  return ret;
+                                                              })), FragDef({Unicode, Unicode}, List_Unicode, void_fn_ptr([](UnicodeObject *s, UnicodeObject *sep, ExceptionBlock *exc_block) -> ListObject * {
+                                                                  if (!sep->count)
+                                                                  {
+                                                                      delete_reference(s);
+                                                                      delete_reference(sep);
+                                                                      raise_python_exception_with_message(exc_block, global->ValueError_class_id,
+                                                                                                          "empty separator");
+                                                                      throw invalid_argument("empty separator");
+                                                                  }
+                                                                  ListObject *ret = unicode_split(s, sep, exc_block);
+                                                                  delete_reference(s);
+                                                                  delete_reference(sep);
+                                                                  return ret;
+                                                              }))}, true},
+                                                              {"startswith", {Unicode, Unicode}, Bool, void_fn_ptr([](UnicodeObject *s, UnicodeObject *x) -> bool {
+                                                                  bool ret = unicode_startswith(s, x);
+                                                                  delete_reference(s);
+                                                                  delete_reference(x);
+                                                                  return ret;
+                                                              }), false},
+                                                              {"strip", {Unicode}, Unicode, void_fn_ptr([](UnicodeObject *s, ExceptionBlock *exc_block) -> UnicodeObject * {
+                                                                  UnicodeObject *ret = unicode_strip(s, true, true, exc_block);
+                                                                  delete_reference(s);
+                                                                  return ret;
+                                                              }), true},
+                                                              {"upper", {Unicode}, Unicode, void_fn_ptr([](UnicodeObject *s, ExceptionBlock *exc_block) -> UnicodeObject * {
+                                                                  UnicodeObject *ret = unicode_upper(s, exc_block);
+                                                                  delete_reference(s);
+                                                                  return ret;
+                                                              }), true},
+
                                                               /* TODO: implement these
                                                               {"capitalize", {Self, TODO}, TODO, void_fn_ptr(nullptr), false},
                                                               {"casefold", {Self, TODO}, TODO, void_fn_ptr(nullptr), false},
                                                               {"center", {Self, TODO}, TODO, void_fn_ptr(nullptr), false},
-                                                              {"count", {Self, TODO}, TODO, void_fn_ptr(nullptr), false},
-                                                              {"encode", {Self, TODO}, TODO, void_fn_ptr(nullptr), false},
-                                                              {"endswith", {Self, TODO}, TODO, void_fn_ptr(nullptr), false},
                                                               {"expandtabs", {Self, TODO}, TODO, void_fn_ptr(nullptr), false},
-                                                              {"find", {Self, TODO}, TODO, void_fn_ptr(nullptr), false},
                                                               {"format", {Self, TODO}, TODO, void_fn_ptr(nullptr), false},
                                                               {"format_map", {Self, TODO}, TODO, void_fn_ptr(nullptr), false},
                                                               {"index", {Self, TODO}, TODO, void_fn_ptr(nullptr), false},
@@ -743,27 +921,18 @@ shared_ptr<ModuleContext> builtins_initialize(GlobalContext *global_context)
                                                               {"isspace", {Self, TODO}, TODO, void_fn_ptr(nullptr), false},
                                                               {"istitle", {Self, TODO}, TODO, void_fn_ptr(nullptr), false},
                                                               {"isupper", {Self, TODO}, TODO, void_fn_ptr(nullptr), false},
-                                                              {"join", {Self, TODO}, TODO, void_fn_ptr(nullptr), false},
                                                               {"ljust", {Self, TODO}, TODO, void_fn_ptr(nullptr), false},
-                                                              {"lower", {Self, TODO}, TODO, void_fn_ptr(nullptr), false},
-                                                              {"lstrip", {Self, TODO}, TODO, void_fn_ptr(nullptr), false},
                                                               {"maketrans", {Self, TODO}, TODO, void_fn_ptr(nullptr), false},
                                                               {"partition", {Self, TODO}, TODO, void_fn_ptr(nullptr), false},
-                                                              {"replace", {Self, TODO}, TODO, void_fn_ptr(nullptr), false},
                                                               {"rfind", {Self, TODO}, TODO, void_fn_ptr(nullptr), false},
                                                               {"rindex", {Self, TODO}, TODO, void_fn_ptr(nullptr), false},
                                                               {"rjust", {Self, TODO}, TODO, void_fn_ptr(nullptr), false},
                                                               {"rpartition", {Self, TODO}, TODO, void_fn_ptr(nullptr), false},
                                                               {"rsplit", {Self, TODO}, TODO, void_fn_ptr(nullptr), false},
-                                                              {"rstrip", {Self, TODO}, TODO, void_fn_ptr(nullptr), false},
-                                                              {"split", {Self, TODO}, TODO, void_fn_ptr(nullptr), false},
                                                               {"splitlines", {Self, TODO}, TODO, void_fn_ptr(nullptr), false},
-                                                              {"startswith", {Self, TODO}, TODO, void_fn_ptr(nullptr), false},
-                                                              {"strip", {Self, TODO}, TODO, void_fn_ptr(nullptr), false},
                                                               {"swapcase", {Self, TODO}, TODO, void_fn_ptr(nullptr), false},
                                                               {"title", {Self, TODO}, TODO, void_fn_ptr(nullptr), false},
                                                               {"translate", {Self, TODO}, TODO, void_fn_ptr(nullptr), false},
-                                                              {"upper", {Self, TODO}, TODO, void_fn_ptr(nullptr), false},
                                                               {"zfill", {Self, TODO}, TODO, void_fn_ptr(nullptr), false},
                                                               */
                                                       }, trivial_destructor},
@@ -773,15 +942,26 @@ shared_ptr<ModuleContext> builtins_initialize(GlobalContext *global_context)
                                                               {"append", {List_Same, Extension0}, None, void_fn_ptr(&list_append), true},
                                                               {"insert", {List_Same, Int, Extension0}, None, void_fn_ptr(&list_insert), true},
                                                               {"pop", {List_Same, Int_NegOne}, Extension0, void_fn_ptr(&list_pop), true},
+                                                              {"sort", {
+                                                                      FragDef({List_Int, Bool_False}, None, void_fn_ptr(&sort_list<list_sort_ints>)),
+                                                                      FragDef({List_Float, Bool_False}, None, void_fn_ptr(&sort_list<list_sort_floats>)),
+                                                                      FragDef({List_Bytes, Bool_False}, None, void_fn_ptr(&sort_list<list_sort_bytes>)),
+                                                                      FragDef({List_Unicode, Bool_False}, None, void_fn_ptr(&sort_list<list_sort_unicode>)),
+                                                              }, true, {"self", "reverse"}},
+                                                              {"extend", {List_Same, List_Same}, None, void_fn_ptr([](ListObject *l, ListObject *items, ExceptionBlock *exc_block) {
+                                                                  // l and items may be the same list; the references
+                                                                  // are deleted separately either way
+                                                                  list_extend(l, items, exc_block);
+                                                                  delete_reference(items);
+                                                                  delete_reference(l);
+                                                              }), true},
 
                                                               /* TODO: implement these
                                                               {"copy", {Self}, List_Same, void_fn_ptr(), true},
                                                               {"count", {Self, Extension0}, Int, void_fn_ptr(), true},
-                                                              {"extend", {Self, TODO}, None, void_fn_ptr(), true},
                                                               {"index", {Self, Extension0}, Int, void_fn_ptr(), true},
                                                               {"remove", {Self, Extension0}, None, void_fn_ptr(), true},
                                                               {"reverse", {Self}, None, void_fn_ptr(), true},
-                                                              {"sort", {Self, key=TODO, Bool_False}, None, void_fn_ptr(), true},
                                                               */
                                                       }, void_fn_ptr(&list_delete)},
 
@@ -792,31 +972,77 @@ shared_ptr<ModuleContext> builtins_initialize(GlobalContext *global_context)
                                                               */
                                                       }, nullptr},
 
+                                                      // these consume the references passed to them, unlike
+                                                      // the Set functions they call
                                                       {"set", {}, {
-                                                              /* TODO: implement these
-                                                              {"add", {Self, Extension0}, None, void_fn_ptr(), true},
-                                                              {"clear", {Self}, None, void_fn_ptr(), true},
-                                                              {"copy", {Self}, Set_Same, void_fn_ptr(), true},
+                                                              {"add", {Set_Same, Extension0}, None, void_fn_ptr([](SetObject *s, void *k, ExceptionBlock *exc_block) {
+                                                                  set_add(s, k, exc_block);
+                                                                  if (s->items_are_objects)
+                                                                  {
+                                                                      delete_reference(k);
+                                                                  }
+                                                                  delete_reference(s);
+                                                              }), true},
+                                                              {"discard", {Set_Same, Extension0}, None, void_fn_ptr([](SetObject *s, void *k) {
+                                                                  set_discard(s, k);
+                                                                  if (s->items_are_objects)
+                                                                  {
+                                                                      delete_reference(k);
+                                                                  }
+                                                                  delete_reference(s);
+                                                              }), false},
+                                                              {"remove", {Set_Same, Extension0}, None, void_fn_ptr([](SetObject *s, void *k, ExceptionBlock *exc_block) {
+                                                                  bool removed = set_discard(s, k);
+                                                                  if (s->items_are_objects)
+                                                                  {
+                                                                      delete_reference(k);
+                                                                  }
+                                                                  delete_reference(s);
+                                                                  if (!removed)
+                                                                  {
+                                                                      raise_python_exception_with_message(exc_block, global->KeyError_class_id,
+                                                                                                          "item not present");
+                                                                      throw out_of_range("item not present in set");
+                                                                  }
+                                                              }), true},
+                                                              {"clear", {Set_Any}, None, void_fn_ptr([](SetObject *s) {
+                                                                  set_clear(s);
+                                                                  delete_reference(s);
+                                                              }), false},
+                                                              {"copy", {Set_Same}, Set_Same, void_fn_ptr([](SetObject *s, ExceptionBlock *exc_block) -> SetObject * {
+                                                                  SetObject *ret = set_copy(s, exc_block);
+                                                                  delete_reference(s);
+                                                                  return ret;
+                                                              }), true},
 
                                                               // TODO: these should support variadic arguments
+                                                              {"union", {Set_Same, Set_Same}, Set_Same, void_fn_ptr([](SetObject *a, SetObject *b, ExceptionBlock *exc_block) -> SetObject * {
+                                                                  SetObject *ret = set_union(a, b, exc_block);
+                                                                  delete_reference(a);
+                                                                  delete_reference(b);
+                                                                  return ret;
+                                                              }), true},
+                                                              {"intersection", {Set_Same, Set_Same}, Set_Same, void_fn_ptr([](SetObject *a, SetObject *b, ExceptionBlock *exc_block) -> SetObject * {
+                                                                  SetObject *ret = set_intersection(a, b, exc_block);
+                                                                  delete_reference(a);
+                                                                  delete_reference(b);
+                                                                  return ret;
+                                                              }), true},
+
+                                                              /* TODO: implement these
                                                               {"difference", {Self, Set_Same}, Set_Same, void_fn_ptr(), true},
                                                               {"difference_update", {Self, Set_Same}, None, void_fn_ptr(), true},
-                                                              {"intersection", {Self, Set_Same}, Set_Same, void_fn_ptr(), true},
                                                               {"intersection_update", {Self, Set_Same}, None, void_fn_ptr(), true},
                                                               {"symmetric_difference", {Self, Set_Same}, Set_Same, void_fn_ptr(), true},
                                                               {"symmetric_difference_update", {Self, Set_Same}, None, void_fn_ptr(), true},
-                                                              {"union", {Self, Set_Same}, Set_Same, void_fn_ptr(), true},
                                                               {"update", {Self, Set_Same}, None, void_fn_ptr(), true},
 
-                                                              {"discard", {Self, Extension0}, None, void_fn_ptr(), true},
-                                                              {"remove", {Self, Extension0}, None, void_fn_ptr(), true},
-
                                                               {"isdisjoint", {Self, Set_Same}, Bool, void_fn_ptr(), true},
                                                               {"issubset", {Self, Set_Same}, Bool, void_fn_ptr(), true},
                                                               {"issuperset", {Self, Set_Same}, Bool, void_fn_ptr(), true},
                                                               {"pop", {Self}, Extension0, void_fn_ptr(), true},
                                                               */
-                                                      }, nullptr},
+                                                      }, void_fn_ptr(&set_delete)},
 
                                                       {"dict", {}, {
                                                               /* TODO: implement these
@@ -875,6 +1101,10 @@ shared_ptr<ModuleContext> builtins_initialize(GlobalContext *global_context)
     global_context->ValueError_class_id = get_class_id("ValueError");
     global_context->AssertionError_class_id = get_class_id("AssertionError");
     global_context->OSError_class_id = get_class_id("OSError");
+    global_context->OverflowError_class_id = get_class_id("OverflowError");
+    global_context->LookupError_class_id = get_class_id("LookupError");
+    global_context->UnicodeDecodeError_class_id = get_class_id("UnicodeDecodeError");
+    global_context->UnicodeEncodeError_class_id = get_class_id("UnicodeEncodeError");
     global_context->PyJitCompilerError_class_id = get_class_id("PyJitCompilerError");
 
     global_context->BytesObject_class_id = get_class_id("bytes");
@@ -99,6 +99,10 @@ shared_ptr<ModuleContext> sys_initialize(GlobalContext *global)
         return a->refcount;
     };
 
+    static auto intern = +[](UnicodeObject *s, ExceptionBlock *exc_block) -> UnicodeObject * {
+        return unicode_intern(s, exc_block);
+    };
+
     vector<BuiltinFunctionDefinition> module_function_defs({
                                                                    // TODO: this should support Instance also, but this will require some
                                                                    // typecheck hax
@@ -108,6 +112,7 @@ shared_ptr<ModuleContext> sys_initialize(GlobalContext *global)
                                                                                     {{Tuple}, Int, void_fn_ptr(getrefcount)},
                                                                                     {{Set}, Int, void_fn_ptr(getrefcount)},
                                                                                     {{Dict}, Int, void_fn_ptr(getrefcount)}}, false},
+                                                                   {"intern",      {{{Unicode}, Unicode, void_fn_ptr(intern)}}, false},
                                                            });
 
     shared_ptr<ModuleContext> module(new ModuleContext(global, "sys", globals));
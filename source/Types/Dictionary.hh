@@ -7,6 +7,7 @@
 #include <vector>
 
 #include "../Compiler/Exception.hh"
+#include "HashTable.hh"
 #include "Reference.hh"
 
 
@@ -16,88 +17,82 @@ enum DictionaryFlag
     ValuesAreObjects = 0x02,
 };
 
+// dictionaries are ordered by insertion, like in python 3.7+. the items are
+// stored in a dense array of entries in the order they were added, and the hash
+// table (see HashTable.hh) only holds the indexes of the entries. this keeps
+// the table small and makes iteration a linear scan over the entries.
+// erasing an item leaves a dead entry behind (with hash = 0); dead entries are
+// removed when the table is next rehashed. live entries always have the high
+// bit of their hash set (see DictionaryObject::hash_for_key), so a live entry
+// never looks dead.
 struct DictionaryObject
 {
     BasicObject basic;
 
-    size_t (*key_length)(const void *k);
-
-    uint8_t (*key_char)(const void *k, size_t offset);
-
     uint64_t count;
-    uint64_t node_count;
     uint64_t flags;
 
-    struct SlotContents
+    uint64_t (*key_hash)(const void *k);
+
+    bool (*key_equal)(const void *a, const void *b);
+
+    struct Entry
     {
         void *key;
         void *value;
-        uint8_t occupied;
-        uint8_t is_subnode;
-
-        SlotContents();
+        uint64_t hash;
     };
 
-    struct Node
+    // capacity is 0 (if nothing has been allocated) or a power of 2 that's at
+    // least group_size. growth_left is the number of empty slots that can be
+    // filled before the table must be rehashed; deleted slots don't count.
+    // there's room for hash_table_max_load(capacity) entries, of which
+    // entries_used have been filled (including dead entries)
+    uint64_t capacity;
+    uint64_t growth_left;
+    Entry *entries;
+    int8_t *control;
+    uint32_t *indexes; // follows the control bytes in the same allocation
+    uint64_t entries_used;
+
+    struct SlotContents
     {
-        uint8_t start;
-        uint8_t end;
-        uint8_t parent_slot;
-        bool has_value;
         void *key;
         void *value;
-        uint8_t data[0];
-
-        Node(uint8_t start, uint8_t end, uint8_t parent_slot, void *key,
-             void *value, bool has_value);
-
-        Node(uint8_t slot, uint8_t parent_slot, void *key, void *value,
-             bool has_value);
-
-        static size_t size_for_range(uint8_t start, uint8_t end);
-
-        void **fields_array();
+        uint64_t index; // 0 before iteration begins
 
-        uint8_t *flags_array();
-
-        void *const *fields_array() const;
-
-        const uint8_t *flags_array() const;
-
-        SlotContents get_slot(uint16_t ch) const;
-
-        void set_slot(uint16_t ch, void *k, void *v, bool occupied,
-                      bool is_subnode);
-
-        bool has_children() const;
+        SlotContents();
     };
 
-    Node *root;
+    uint64_t hash_for_key(const void *k) const;
 
-    struct Traversal
-    {
-        Node *node;
-        uint16_t ch;
-        std::vector<Node *> nodes;
-    };
-
-    Traversal traverse(void *k, bool with_nodes, bool create,
-                       ExceptionBlock *exc_block = nullptr);
+    // returns the slot index (not the entry index) of the key, or -1
+    ssize_t find(const void *k, uint64_t hash) const;
 
-    Traversal traverse(void *k, bool with_nodes) const;
+    size_t find_insert_position(uint64_t hash) const;
 
-    std::string structure_for_node(const Node *n) const;
+    void resize(size_t new_capacity, ExceptionBlock *exc_block = nullptr);
 };
 
-DictionaryObject *dictionary_new(size_t (*key_length)(const void *k),
-                                 uint8_t (*key_char)(const void *k, size_t which), uint64_t flags,
+DictionaryObject *dictionary_new(uint64_t (*key_hash)(const void *k),
+                                 bool (*key_equal)(const void *a, const void *b), uint64_t flags,
                                  ExceptionBlock *exc_block = nullptr);
 
 void dictionary_delete(void *d);
 
+// makes the table large enough to hold count items without rehashing
+void dictionary_reserve(DictionaryObject *d, size_t count,
+                        ExceptionBlock *exc_block = nullptr);
+
 void dictionary_insert(DictionaryObject *d, void *k, void *v,
                        ExceptionBlock *exc_block = nullptr);
 
+// like dictionary_insert, but takes ownership of the caller's references to k
+// and v instead of adding new ones. this is used when building new dicts,
+// since the caller would otherwise just delete its references right after
+void dictionary_insert_steal(DictionaryObject *d, void *k, void *v,
+                             ExceptionBlock *exc_block = nullptr);
+
 bool dictionary_erase(DictionaryObject *d, void *k);
 
 void dictionary_clear(DictionaryObject *d);
@@ -112,6 +107,4 @@ bool dictionary_next_item(const DictionaryObject *d,
 
 size_t dictionary_size(const DictionaryObject *d);
 
-size_t dictionary_node_size(const DictionaryObject *d);
-
-std::string dictionary_structure(const DictionaryObject *d);
+size_t dictionary_capacity(const DictionaryObject *d);
@@ -1,472 +1,560 @@
-#include <errno.h>
-#include <inttypes.h>
-#include <stdlib.h>
-#include <stdio.h>
-#include <string.h>
-#include <unistd.h>
-#include <sys/types.h>
-
-#include <phosg/UnitTest.hh>
-#include <string>
-#include <unordered_map>
-
-#include "Dictionary.hh"
-#include "Strings.hh"
-#include "Instance.hh"
-#include "../Compiler/Contexts.hh"
-
-using namespace std;
-
-// Dictionary.cc needs this to exist, but it doesn't need to be initialized
-// because we never pass an exc_block in the unit tests
-shared_ptr<GlobalContext> global;
-
-
-void expect_key_missing(const DictionaryObject *d, void *k)
-{
-    expect(!dictionary_exists(d, k));
-    try
-    {
-        dictionary_at(d, k);
-        expect(false);
-    } catch (const out_of_range &e)
-    {}
-}
-
-void verify_structure(const DictionaryObject *d, const char *expected_structure)
-{
-    // remove whitespace from expected_structure
-    string processed_expected_structure;
-    for (const char *ch = expected_structure; *ch; ch++)
-    {
-        if (!isblank(*ch))
-        {
-            processed_expected_structure += *ch;
-        }
-    }
-
-    string actual_structure = dictionary_structure(d);
-    if (processed_expected_structure != actual_structure)
-    {
-        fprintf(stderr, "structures don\'t match\n  expected (orig): %s\n  expected: %s\n  actual  : %s\n",
-                expected_structure, processed_expected_structure.c_str(),
-                actual_structure.c_str());
-    }
-    expect_eq(processed_expected_structure, actual_structure);
-}
-
-void verify_state(
-        const unordered_map<BytesObject *, BytesObject *> &expected,
-        const DictionaryObject *d, size_t expected_node_size,
-        const char *expected_structure = nullptr)
-{
-    expect_eq(expected.size(), dictionary_size(d));
-    expect_eq(expected_node_size, dictionary_node_size(d));
-    for (const auto &it: expected)
-    {
-        expect_eq(it.second, dictionary_at(d, it.first));
-    }
-
-    auto missing_elements = expected;
-    DictionaryObject::SlotContents item;
-    while (dictionary_next_item(d, &item))
-    {
-        BytesObject *k = reinterpret_cast<BytesObject *>(item.key);
-        auto missing_it = missing_elements.find(k);
-        expect_ne(missing_it, missing_elements.end());
-        expect_eq(missing_it->second, item.value);
-        missing_elements.erase(missing_it);
-    }
-    expect_eq(true, missing_elements.empty());
-
-    if (expected_structure)
-    {
-        verify_structure(d, expected_structure);
-    }
-}
-
-
-static size_t num_bytes_objects = 0;
-
-static void tracked_bytes_delete(void *o)
-{
-    num_bytes_objects--;
-    free(o);
-}
-
-BytesObject *tracked_bytes_new(const char *data, size_t count)
-{
-    num_bytes_objects++;
-    BytesObject *b = bytes_new(data, count);
-    b->basic.destructor = tracked_bytes_delete;
-    return b;
-}
-
-BytesObject *tracked_bytes_new(const char *text)
-{
-    return tracked_bytes_new(text, strlen(text));
-}
-
-
-void run_basic_test()
-{
-    printf("-- basic\n");
-
-    DictionaryObject *d = dictionary_new(
-            reinterpret_cast<size_t (*)(const void *)>(bytes_length),
-            reinterpret_cast<uint8_t (*)(const void *, size_t)>(bytes_at),
-            DictionaryFlag::KeysAreObjects | DictionaryFlag::ValuesAreObjects);
-
-    expect_eq(0, num_bytes_objects);
-    expect_eq(0, dictionary_size(d));
-
-    BytesObject *k1 = tracked_bytes_new("key1");
-    BytesObject *k2 = tracked_bytes_new("key2");
-    BytesObject *k3 = tracked_bytes_new("key3");
-    BytesObject *v0 = tracked_bytes_new("value0");
-    BytesObject *v1 = tracked_bytes_new("value1");
-    BytesObject *v2 = tracked_bytes_new("value2");
-    BytesObject *v3 = tracked_bytes_new("value3");
-    expect_eq(1, k1->basic.refcount);
-    expect_eq(1, k2->basic.refcount);
-    expect_eq(1, k3->basic.refcount);
-    expect_eq(1, v0->basic.refcount);
-    expect_eq(1, v1->basic.refcount);
-    expect_eq(1, v2->basic.refcount);
-    expect_eq(1, v3->basic.refcount);
-    expect_eq(7, num_bytes_objects);
-
-    dictionary_insert(d, k1, v1);
-    expect_eq(1, dictionary_size(d));
-    expect_eq(4, dictionary_node_size(d));
-    dictionary_insert(d, k2, v2);
-    expect_eq(2, dictionary_size(d));
-    expect_eq(4, dictionary_node_size(d));
-    dictionary_insert(d, k3, v3);
-    expect_eq(3, dictionary_size(d));
-    expect_eq(4, dictionary_node_size(d));
-
-    expect_eq(2, k1->basic.refcount);
-    expect_eq(2, k2->basic.refcount);
-    expect_eq(2, k3->basic.refcount);
-    expect_eq(1, v0->basic.refcount);
-    expect_eq(2, v1->basic.refcount);
-    expect_eq(2, v2->basic.refcount);
-    expect_eq(2, v3->basic.refcount);
-    expect_eq(7, num_bytes_objects);
-
-    expect_eq(v1, dictionary_at(d, k1));
-    expect_eq(v2, dictionary_at(d, k2));
-    expect_eq(v3, dictionary_at(d, k3));
-    expect_eq(3, dictionary_size(d));
-    expect_eq(4, dictionary_node_size(d));
-
-    expect_eq(true, dictionary_erase(d, k2));
-    expect_eq(2, dictionary_size(d));
-    expect_eq(4, dictionary_node_size(d));
-    expect_eq(false, dictionary_erase(d, k2));
-    expect_eq(2, dictionary_size(d));
-    expect_eq(4, dictionary_node_size(d));
-
-    expect_eq(2, k1->basic.refcount);
-    expect_eq(1, k2->basic.refcount);
-    expect_eq(2, k3->basic.refcount);
-    expect_eq(1, v0->basic.refcount);
-    expect_eq(2, v1->basic.refcount);
-    expect_eq(1, v2->basic.refcount);
-    expect_eq(2, v3->basic.refcount);
-    expect_eq(7, num_bytes_objects);
-
-    expect_eq(v1, dictionary_at(d, k1));
-    expect_key_missing(d, k2);
-    expect_eq(v3, dictionary_at(d, k3));
-    expect_eq(2, dictionary_size(d));
-    expect_eq(4, dictionary_node_size(d));
-
-    dictionary_insert(d, k1, v0);
-    expect_eq(2, dictionary_size(d));
-    expect_eq(4, dictionary_node_size(d));
-
-    expect_eq(2, k1->basic.refcount);
-    expect_eq(1, k2->basic.refcount);
-    expect_eq(2, k3->basic.refcount);
-    expect_eq(2, v0->basic.refcount);
-    expect_eq(1, v1->basic.refcount);
-    expect_eq(1, v2->basic.refcount);
-    expect_eq(2, v3->basic.refcount);
-    expect_eq(7, num_bytes_objects);
-
-    expect_eq(v0, dictionary_at(d, k1));
-    expect_key_missing(d, k2);
-    expect_eq(v3, dictionary_at(d, k3));
-    expect_eq(2, dictionary_size(d));
-    expect_eq(4, dictionary_node_size(d));
-
-    expect_eq(true, dictionary_erase(d, k1));
-    expect_eq(1, dictionary_size(d));
-    expect_eq(4, dictionary_node_size(d));
-    expect_eq(true, dictionary_erase(d, k3));
-    expect_eq(0, dictionary_size(d));
-    expect_eq(0, dictionary_node_size(d));
-
-    expect_eq(1, k1->basic.refcount);
-    expect_eq(1, k2->basic.refcount);
-    expect_eq(1, k3->basic.refcount);
-    expect_eq(1, v0->basic.refcount);
-    expect_eq(1, v1->basic.refcount);
-    expect_eq(1, v2->basic.refcount);
-    expect_eq(1, v3->basic.refcount);
-    expect_eq(7, num_bytes_objects);
-
-    delete_reference(k1);
-    delete_reference(k2);
-    delete_reference(k3);
-    delete_reference(v0);
-    delete_reference(v1);
-    delete_reference(v2);
-    delete_reference(v3);
-    expect_eq(0, num_bytes_objects);
-}
-
-void run_reorganization_test()
-{
-    printf("-- reorganization\n");
-
-    DictionaryObject *d = dictionary_new(
-            reinterpret_cast<size_t (*)(const void *)>(bytes_length),
-            reinterpret_cast<uint8_t (*)(const void *, size_t)>(bytes_at),
-            DictionaryFlag::KeysAreObjects | DictionaryFlag::ValuesAreObjects);
-
-    expect_eq(0, dictionary_size(d));
-    expect_eq(0, num_bytes_objects);
-
-    // initial state: empty
-    unordered_map<BytesObject *, BytesObject *> expected_state;
-    verify_state(expected_state, d, 0, "()");
-
-    // <> null
-    //   a null
-    //     b null
-    //       (c) "abc"
-    BytesObject *abc = tracked_bytes_new("abc");
-    dictionary_insert(d, abc, abc);
-    expected_state.emplace(abc, abc);
-    verify_state(expected_state, d, 3,
-                 "([61,61]@00+#,"
-                 "61:("
-                 "  [62,62]@61+#,"
-                 "  62:("
-                 "    [63,63]@62+#,"
-                 "    63:V)))");
-    expect_eq(3, abc->basic.refcount);
-
-    // <> null
-    //   a null
-    //     b "ab"
-    //       (c) "abc"
-    BytesObject *ab = tracked_bytes_new("ab");
-    dictionary_insert(d, ab, ab);
-    expected_state.emplace(ab, ab);
-    verify_state(expected_state, d, 3,
-                 "([61,61]@00+#,"
-                 "61:("
-                 "  [62,62]@61+#,"
-                 "  62:("
-                 "    [63,63]@62+V,"
-                 "    63:V)))");
-    expect_eq(3, ab->basic.refcount);
-
-    // <> null
-    //   a null
-    //     (b) "ab"
-    dictionary_erase(d, abc);
-    expected_state.erase(abc);
-    verify_state(expected_state, d, 2,
-                 "([61,61]@00+#,"
-                 "61:("
-                 "  [62,62]@61+#,"
-                 "  62:V))");
-    expect_eq(1, abc->basic.refcount);
-
-    // <> ""
-    //   a null
-    //     (b) "ab"
-    BytesObject *blank = tracked_bytes_new("");
-    dictionary_insert(d, blank, blank);
-    expected_state.emplace(blank, blank);
-    verify_state(expected_state, d, 2,
-                 "([61,61]@00+V,"
-                 "61:("
-                 "  [62,62]@61+#,"
-                 "  62:V))");
-    expect_eq(3, blank->basic.refcount);
-
-    // <> ""
-    //   a null
-    //     b "ab"
-    //       c null
-    //         (d) "abcd"
-    BytesObject *abcd = tracked_bytes_new("abcd");
-    dictionary_insert(d, abcd, abcd);
-    expected_state.emplace(abcd, abcd);
-    verify_state(expected_state, d, 4,
-                 "([61,61]@00+V,"
-                 "61:("
-                 "  [62,62]@61+#,"
-                 "  62:("
-                 "    [63,63]@62+V,"
-                 "    63:("
-                 "      [64,64]@63+#,"
-                 "      64:V))))");
-    expect_eq(3, abcd->basic.refcount);
-
-    // <> ""
-    //   a null
-    //     b null
-    //       c null
-    //         (d) "abcd"
-    dictionary_erase(d, ab);
-    expected_state.erase(ab);
-    verify_state(expected_state, d, 4,
-                 "([61,61]@00+V,"
-                 "61:("
-                 "  [62,62]@61+#,"
-                 "  62:("
-                 "    [63,63]@62+#,"
-                 "    63:("
-                 "      [64,64]@63+#,"
-                 "      64:V))))");
-    expect_eq(1, ab->basic.refcount);
-
-    // <> ""
-    //   a null
-    //     b null
-    //       c null
-    //         d "abcd"
-    //           (e) "abcde"
-    BytesObject *abcde = tracked_bytes_new("abcde");
-    dictionary_insert(d, abcde, abcde);
-    expected_state.emplace(abcde, abcde);
-    verify_state(expected_state, d, 5,
-                 "([61,61]@00+V,"
-                 "61:("
-                 "  [62,62]@61+#,"
-                 "  62:("
-                 "    [63,63]@62+#,"
-                 "    63:("
-                 "      [64,64]@63+#,"
-                 "      64:("
-                 "        [65,65]@64+V,"
-                 "        65:V)))))");
-    expect_eq(3, abcde->basic.refcount);
-
-    // <> ""
-    //   a null
-    //     b null
-    //       c null
-    //         d "abcd"
-    //           (e) "abcde"
-    //           (f) "abcdf"
-    BytesObject *abcdf = tracked_bytes_new("abcdf");
-    dictionary_insert(d, abcdf, abcdf);
-    expected_state.emplace(abcdf, abcdf);
-    verify_state(expected_state, d, 5,
-                 "([61,61]@00+V,"
-                 "61:("
-                 "  [62,62]@61+#,"
-                 "  62:("
-                 "    [63,63]@62+#,"
-                 "    63:("
-                 "      [64,64]@63+#,"
-                 "      64:("
-                 "        [65,66]@64+V,"
-                 "        65:V,"
-                 "        66:V)))))");
-    expect_eq(3, abcdf->basic.refcount);
-
-    // <> ""
-    //   a null
-    //     b null
-    //       c null
-    //         d "abcd"
-    //           (e) "abcde"
-    //           (f) "abcdf"
-    //         (e) "abce"
-    BytesObject *abce = tracked_bytes_new("abce");
-    dictionary_insert(d, abce, abce);
-    expected_state.emplace(abce, abce);
-    verify_state(expected_state, d, 5,
-                 "([61,61]@00+V,"
-                 "61:("
-                 "  [62,62]@61+#,"
-                 "  62:("
-                 "    [63,63]@62+#,"
-                 "    63:("
-                 "      [64,65]@63+#,"
-                 "      64:("
-                 "        [65,66]@64+V,"
-                 "        65:V,"
-                 "        66:V),"
-                 "      65:V))))");
-    expect_eq(3, abce->basic.refcount);
-
-    // <> ""
-    //   a null
-    //     b null
-    //       c null
-    //         d "abcd"
-    //           (e) "abcde"
-    //           (f) "abcdf"
-    //         e "abce"
-    //           (f) "abcef"
-    BytesObject *abcef = tracked_bytes_new("abcef");
-    dictionary_insert(d, abcef, abcef);
-    expected_state.emplace(abcef, abcef);
-    verify_state(expected_state, d, 6,
-                 "([61,61]@00+V,"
-                 "61:("
-                 "  [62,62]@61+#,"
-                 "  62:("
-                 "    [63,63]@62+#,"
-                 "    63:("
-                 "      [64,65]@63+#,"
-                 "      64:("
-                 "        [65,66]@64+V,"
-                 "        65:V,"
-                 "        66:V),"
-                 "      65:("
-                 "        [66,66]@65+V,"
-                 "        66:V)))))");
-    expect_eq(3, abcef->basic.refcount);
-
-    // <> null
-    expect_eq(8, num_bytes_objects);
-    dictionary_clear(d);
-    for (const auto &it: expected_state)
-    {
-        expect_eq(it.first, it.second);
-        expect_eq(1, it.first->basic.refcount);
-    }
-    delete_reference(abc);
-    delete_reference(ab);
-    delete_reference(blank);
-    delete_reference(abcd);
-    delete_reference(abcde);
-    delete_reference(abcdf);
-    delete_reference(abce);
-    delete_reference(abcef);
-    expected_state.clear();
-    verify_state(expected_state, d, 0, "()");
-
-    expect_eq(0, num_bytes_objects);
-}
-
-
-int main(int argc, char *argv[])
-{
-    global.reset(new GlobalContext({}));
-    run_basic_test();
-    run_reorganization_test();
-    printf("all tests passed\n");
-    return 0;
-}
+#include <errno.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+
+#include <phosg/Strings.hh>
+#include <phosg/Time.hh>
+#include <phosg/UnitTest.hh>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Dictionary.hh"
+#include "Strings.hh"
+#include "Instance.hh"
+#include "../Compiler/Contexts.hh"
+
+using namespace std;
+
+// Dictionary.cc needs this to exist, but it doesn't need to be initialized
+// because we never pass an exc_block in the unit tests
+shared_ptr<GlobalContext> global;
+
+
+void expect_key_missing(const DictionaryObject *d, void *k)
+{
+    expect(!dictionary_exists(d, k));
+    try
+    {
+        dictionary_at(d, k);
+        expect(false);
+    } catch (const out_of_range &e)
+    {}
+}
+
+void verify_state(
+        const unordered_map<BytesObject *, BytesObject *> &expected,
+        const DictionaryObject *d)
+{
+    expect_eq(expected.size(), dictionary_size(d));
+    for (const auto &it: expected)
+    {
+        expect_eq(it.second, dictionary_at(d, it.first));
+    }
+
+    auto missing_elements = expected;
+    DictionaryObject::SlotContents item;
+    while (dictionary_next_item(d, &item))
+    {
+        BytesObject *k = reinterpret_cast<BytesObject *>(item.key);
+        auto missing_it = missing_elements.find(k);
+        expect_ne(missing_it, missing_elements.end());
+        expect_eq(missing_it->second, item.value);
+        missing_elements.erase(missing_it);
+    }
+    expect_eq(true, missing_elements.empty());
+}
+
+
+static size_t num_bytes_objects = 0;
+
+static void tracked_bytes_delete(void *o)
+{
+    num_bytes_objects--;
+    free(o);
+}
+
+BytesObject *tracked_bytes_new(const char *data, size_t count)
+{
+    num_bytes_objects++;
+    BytesObject *b = bytes_new(data, count);
+    b->basic.destructor = tracked_bytes_delete;
+    return b;
+}
+
+BytesObject *tracked_bytes_new(const char *text)
+{
+    return tracked_bytes_new(text, strlen(text));
+}
+
+
+void run_basic_test()
+{
+    printf("-- basic\n");
+
+    DictionaryObject *d = dictionary_new(
+            reinterpret_cast<uint64_t (*)(const void *)>(bytes_hash),
+            reinterpret_cast<bool (*)(const void *, const void *)>(bytes_equal),
+            DictionaryFlag::KeysAreObjects | DictionaryFlag::ValuesAreObjects);
+
+    expect_eq(0, num_bytes_objects);
+    expect_eq(0, dictionary_size(d));
+    expect_eq(0, dictionary_capacity(d));
+
+    BytesObject *k1 = tracked_bytes_new("key1");
+    BytesObject *k2 = tracked_bytes_new("key2");
+    BytesObject *k3 = tracked_bytes_new("key3");
+    BytesObject *v0 = tracked_bytes_new("value0");
+    BytesObject *v1 = tracked_bytes_new("value1");
+    BytesObject *v2 = tracked_bytes_new("value2");
+    BytesObject *v3 = tracked_bytes_new("value3");
+    expect_eq(1, k1->basic.refcount);
+    expect_eq(1, k2->basic.refcount);
+    expect_eq(1, k3->basic.refcount);
+    expect_eq(1, v0->basic.refcount);
+    expect_eq(1, v1->basic.refcount);
+    expect_eq(1, v2->basic.refcount);
+    expect_eq(1, v3->basic.refcount);
+    expect_eq(7, num_bytes_objects);
+
+    dictionary_insert(d, k1, v1);
+    expect_eq(1, dictionary_size(d));
+    expect_eq(16, dictionary_capacity(d));
+    dictionary_insert(d, k2, v2);
+    expect_eq(2, dictionary_size(d));
+    expect_eq(16, dictionary_capacity(d));
+    dictionary_insert(d, k3, v3);
+    expect_eq(3, dictionary_size(d));
+    expect_eq(16, dictionary_capacity(d));
+
+    expect_eq(2, k1->basic.refcount);
+    expect_eq(2, k2->basic.refcount);
+    expect_eq(2, k3->basic.refcount);
+    expect_eq(1, v0->basic.refcount);
+    expect_eq(2, v1->basic.refcount);
+    expect_eq(2, v2->basic.refcount);
+    expect_eq(2, v3->basic.refcount);
+    expect_eq(7, num_bytes_objects);
+
+    expect_eq(v1, dictionary_at(d, k1));
+    expect_eq(v2, dictionary_at(d, k2));
+    expect_eq(v3, dictionary_at(d, k3));
+    expect_eq(3, dictionary_size(d));
+    expect_eq(16, dictionary_capacity(d));
+
+    expect_eq(true, dictionary_erase(d, k2));
+    expect_eq(2, dictionary_size(d));
+    expect_eq(16, dictionary_capacity(d));
+    expect_eq(false, dictionary_erase(d, k2));
+    expect_eq(2, dictionary_size(d));
+    expect_eq(16, dictionary_capacity(d));
+
+    expect_eq(2, k1->basic.refcount);
+    expect_eq(1, k2->basic.refcount);
+    expect_eq(2, k3->basic.refcount);
+    expect_eq(1, v0->basic.refcount);
+    expect_eq(2, v1->basic.refcount);
+    expect_eq(1, v2->basic.refcount);
+    expect_eq(2, v3->basic.refcount);
+    expect_eq(7, num_bytes_objects);
+
+    expect_eq(v1, dictionary_at(d, k1));
+    expect_key_missing(d, k2);
+    expect_eq(v3, dictionary_at(d, k3));
+    expect_eq(2, dictionary_size(d));
+    expect_eq(16, dictionary_capacity(d));
+
+    dictionary_insert(d, k1, v0);
+    expect_eq(2, dictionary_size(d));
+    expect_eq(16, dictionary_capacity(d));
+
+    expect_eq(2, k1->basic.refcount);
+    expect_eq(1, k2->basic.refcount);
+    expect_eq(2, k3->basic.refcount);
+    expect_eq(2, v0->basic.refcount);
+    expect_eq(1, v1->basic.refcount);
+    expect_eq(1, v2->basic.refcount);
+    expect_eq(2, v3->basic.refcount);
+    expect_eq(7, num_bytes_objects);
+
+    expect_eq(v0, dictionary_at(d, k1));
+    expect_key_missing(d, k2);
+    expect_eq(v3, dictionary_at(d, k3));
+    expect_eq(2, dictionary_size(d));
+    expect_eq(16, dictionary_capacity(d));
+
+    expect_eq(true, dictionary_erase(d, k1));
+    expect_eq(1, dictionary_size(d));
+    expect_eq(16, dictionary_capacity(d));
+    expect_eq(true, dictionary_erase(d, k3));
+    expect_eq(0, dictionary_size(d));
+    expect_eq(16, dictionary_capacity(d));
+
+    expect_eq(1, k1->basic.refcount);
+    expect_eq(1, k2->basic.refcount);
+    expect_eq(1, k3->basic.refcount);
+    expect_eq(1, v0->basic.refcount);
+    expect_eq(1, v1->basic.refcount);
+    expect_eq(1, v2->basic.refcount);
+    expect_eq(1, v3->basic.refcount);
+    expect_eq(7, num_bytes_objects);
+
+    delete_reference(k1);
+    delete_reference(k2);
+    delete_reference(k3);
+    delete_reference(v0);
+    delete_reference(v1);
+    delete_reference(v2);
+    delete_reference(v3);
+    expect_eq(0, num_bytes_objects);
+}
+
+
+void run_equal_keys_test()
+{
+    printf("-- equal keys\n");
+
+    DictionaryObject *d = dictionary_new(
+            reinterpret_cast<uint64_t (*)(const void *)>(bytes_hash),
+            reinterpret_cast<bool (*)(const void *, const void *)>(bytes_equal),
+            DictionaryFlag::KeysAreObjects | DictionaryFlag::ValuesAreObjects);
+
+    // a different object with the same contents should find the same slot, and
+    // replacing the value should keep the original key object
+    BytesObject *k1 = tracked_bytes_new("key");
+    BytesObject *k2 = tracked_bytes_new("key");
+    BytesObject *v1 = tracked_bytes_new("value1");
+    BytesObject *v2 = tracked_bytes_new("value2");
+    dictionary_insert(d, k1, v1);
+    expect_eq(v1, dictionary_at(d, k2));
+    dictionary_insert(d, k2, v2);
+    expect_eq(1, dictionary_size(d));
+    expect_eq(v2, dictionary_at(d, k1));
+    expect_eq(2, k1->basic.refcount);
+    expect_eq(1, k2->basic.refcount);
+    expect_eq(1, v1->basic.refcount);
+    expect_eq(2, v2->basic.refcount);
+
+    DictionaryObject::SlotContents item;
+    expect_eq(true, dictionary_next_item(d, &item));
+    expect_eq(k1, item.key);
+    expect_eq(false, dictionary_next_item(d, &item));
+
+    expect_eq(true, dictionary_erase(d, k2));
+    expect_eq(0, dictionary_size(d));
+    expect_eq(1, k1->basic.refcount);
+    expect_eq(1, v2->basic.refcount);
+
+    delete_reference(d);
+    delete_reference(k1);
+    delete_reference(k2);
+    delete_reference(v1);
+    delete_reference(v2);
+    expect_eq(0, num_bytes_objects);
+}
+
+
+void run_reserve_and_steal_test()
+{
+    printf("-- reserve and steal\n");
+
+    DictionaryObject *d = dictionary_new(
+            reinterpret_cast<uint64_t (*)(const void *)>(bytes_hash),
+            reinterpret_cast<bool (*)(const void *, const void *)>(bytes_equal),
+            DictionaryFlag::KeysAreObjects | DictionaryFlag::ValuesAreObjects);
+
+    // reserving space for 100 items means inserting them doesn't rehash
+    dictionary_reserve(d, 100);
+    expect_eq(128, dictionary_capacity(d));
+    dictionary_reserve(d, 10);
+    expect_eq(128, dictionary_capacity(d));
+
+    // stealing references means the dict owns the only reference to each
+    // object. if the key already exists, the new key is released instead
+    BytesObject *k1 = tracked_bytes_new("key1");
+    BytesObject *k1_dup = tracked_bytes_new("key1");
+    BytesObject *v1 = tracked_bytes_new("value1");
+    BytesObject *v2 = tracked_bytes_new("value2");
+    dictionary_insert_steal(d, k1, v1);
+    expect_eq(1, k1->basic.refcount);
+    expect_eq(1, v1->basic.refcount);
+    expect_eq(4, num_bytes_objects);
+    dictionary_insert_steal(d, k1_dup, v2);
+    expect_eq(1, dictionary_size(d));
+    expect_eq(v2, dictionary_at(d, k1));
+    expect_eq(2, num_bytes_objects);
+    expect_eq(128, dictionary_capacity(d));
+
+    delete_reference(d);
+    expect_eq(0, num_bytes_objects);
+}
+
+static uint64_t constant_hash(const void *)
+{
+    return 0;
+}
+
+void run_collision_test()
+{
+    printf("-- collisions\n");
+
+    // every key goes to the same group, so all keys after the first 16 have to
+    // be found by probing past full groups
+    DictionaryObject *d = dictionary_new(constant_hash, nullptr, 0);
+    for (int64_t x = 1; x <= 40; x++)
+    {
+        dictionary_insert(d, reinterpret_cast<void *>(x), reinterpret_cast<void *>(x * 10));
+    }
+    expect_eq(40, dictionary_size(d));
+    expect_eq(64, dictionary_capacity(d));
+    for (int64_t x = 1; x <= 40; x++)
+    {
+        expect_eq(reinterpret_cast<void *>(x * 10),
+                  dictionary_at(d, reinterpret_cast<void *>(x)));
+    }
+
+    // erasing from the first (full) group leaves deleted slots, which must not
+    // stop lookups for the keys in later groups
+    for (int64_t x = 1; x <= 8; x++)
+    {
+        expect_eq(true, dictionary_erase(d, reinterpret_cast<void *>(x)));
+    }
+    expect_eq(32, dictionary_size(d));
+    for (int64_t x = 1; x <= 8; x++)
+    {
+        expect_key_missing(d, reinterpret_cast<void *>(x));
+    }
+    for (int64_t x = 9; x <= 40; x++)
+    {
+        expect_eq(reinterpret_cast<void *>(x * 10),
+                  dictionary_at(d, reinterpret_cast<void *>(x)));
+    }
+
+    // new keys reuse the deleted slots, and existing keys aren't duplicated
+    for (int64_t x = 1; x <= 8; x++)
+    {
+        dictionary_insert(d, reinterpret_cast<void *>(x + 100), nullptr);
+        dictionary_insert(d, reinterpret_cast<void *>(x + 20), nullptr);
+    }
+    expect_eq(40, dictionary_size(d));
+    expect_eq(64, dictionary_capacity(d));
+    for (int64_t x = 21; x <= 28; x++)
+    {
+        expect_eq(nullptr, dictionary_at(d, reinterpret_cast<void *>(x)));
+    }
+
+    dictionary_clear(d);
+    expect_eq(0, dictionary_size(d));
+    expect_eq(0, dictionary_capacity(d));
+    expect_key_missing(d, reinterpret_cast<void *>(10));
+    delete_reference(d);
+}
+
+void run_growth_test()
+{
+    printf("-- growth\n");
+
+    DictionaryObject *d = dictionary_new(nullptr, nullptr, 0);
+    for (int64_t x = 0; x < 10000; x++)
+    {
+        dictionary_insert(d, reinterpret_cast<void *>(x), reinterpret_cast<void *>(x + 1));
+        expect_le(dictionary_size(d) * 8, dictionary_capacity(d) * 7);
+    }
+    expect_eq(10000, dictionary_size(d));
+    expect_eq(16384, dictionary_capacity(d));
+
+    int64_t key_sum = 0;
+    size_t count = 0;
+    DictionaryObject::SlotContents item;
+    while (dictionary_next_item(d, &item))
+    {
+        int64_t k = reinterpret_cast<int64_t>(item.key);
+        expect_eq(k + 1, reinterpret_cast<int64_t>(item.value));
+        key_sum += k;
+        count++;
+    }
+    expect_eq(10000, count);
+    expect_eq(49995000, key_sum);
+
+    // churning through many keys while the size stays constant should rehash
+    // in place rather than growing the table forever
+    DictionaryObject *churn = dictionary_new(nullptr, nullptr, 0);
+    for (int64_t x = 0; x < 100000; x++)
+    {
+        dictionary_insert(churn, reinterpret_cast<void *>(x), nullptr);
+        if (x >= 100)
+        {
+            expect_eq(true, dictionary_erase(churn, reinterpret_cast<void *>(x - 100)));
+        }
+    }
+    expect_eq(100, dictionary_size(churn));
+    expect_le(dictionary_capacity(churn), 256);
+
+    delete_reference(d);
+    delete_reference(churn);
+}
+
+
+static vector<int64_t> dictionary_keys(const DictionaryObject *d)
+{
+    vector<int64_t> ret;
+    DictionaryObject::SlotContents item;
+    while (dictionary_next_item(d, &item))
+    {
+        ret.emplace_back(reinterpret_cast<int64_t>(item.key));
+    }
+    return ret;
+}
+
+void run_order_test()
+{
+    printf("-- insertion order\n");
+
+    DictionaryObject *d = dictionary_new(nullptr, nullptr, 0);
+    for (int64_t k: {30, 10, 20, 0, 50})
+    {
+        dictionary_insert(d, reinterpret_cast<void *>(k), nullptr);
+    }
+    expect_eq(vector<int64_t>({30, 10, 20, 0, 50}), dictionary_keys(d));
+
+    // replacing a value doesn't move the key; erasing and reinserting it moves
+    // it to the end
+    dictionary_insert(d, reinterpret_cast<void *>(10), reinterpret_cast<void *>(1));
+    expect_eq(vector<int64_t>({30, 10, 20, 0, 50}), dictionary_keys(d));
+    expect_eq(true, dictionary_erase(d, reinterpret_cast<void *>(10)));
+    expect_eq(true, dictionary_erase(d, reinterpret_cast<void *>(0)));
+    expect_eq(vector<int64_t>({30, 20, 50}), dictionary_keys(d));
+    dictionary_insert(d, reinterpret_cast<void *>(10), nullptr);
+    expect_eq(vector<int64_t>({30, 20, 50, 10}), dictionary_keys(d));
+
+    // the order survives growing the table, which also drops the dead entries
+    for (int64_t k = 100; k < 200; k++)
+    {
+        dictionary_insert(d, reinterpret_cast<void *>(k), nullptr);
+    }
+    expect_eq(104, dictionary_size(d));
+    vector<int64_t> keys = dictionary_keys(d);
+    expect_eq(104, keys.size());
+    expect_eq(vector<int64_t>({30, 20, 50, 10}), vector<int64_t>(keys.begin(), keys.begin() + 4));
+    for (size_t x = 4; x < keys.size(); x++)
+    {
+        expect_eq(static_cast<int64_t>(x + 96), keys[x]);
+    }
+
+    delete_reference(d);
+}
+
+
+template <typename KeyT>
+struct BenchmarkKeys;
+
+template <>
+struct BenchmarkKeys<int64_t>
+{
+    static constexpr const char *name = "Int";
+    vector<void *> keys;
+
+    BenchmarkKeys(size_t count)
+    {
+        // spread the keys out so they aren't all consecutive
+        for (size_t x = 0; x < count; x++)
+        {
+            this->keys.emplace_back(reinterpret_cast<void *>(x * 0x9E3779B1));
+        }
+    }
+
+    DictionaryObject *new_dictionary()
+    {
+        return dictionary_new(nullptr, nullptr, 0);
+    }
+};
+
+template <>
+struct BenchmarkKeys<BytesObject *>
+{
+    static constexpr const char *name = "Bytes";
+    vector<void *> keys;
+
+    BenchmarkKeys(size_t count)
+    {
+        for (size_t x = 0; x < count; x++)
+        {
+            string s = string_printf("key_%zu", x * 0x9E3779B1);
+            this->keys.emplace_back(bytes_new(s.data(), s.size()));
+        }
+    }
+
+    ~BenchmarkKeys()
+    {
+        for (void *k: this->keys)
+        {
+            delete_reference(k);
+        }
+    }
+
+    DictionaryObject *new_dictionary()
+    {
+        return dictionary_new(
+                reinterpret_cast<uint64_t (*)(const void *)>(bytes_hash),
+                reinterpret_cast<bool (*)(const void *, const void *)>(bytes_equal),
+                DictionaryFlag::KeysAreObjects);
+    }
+};
+
+template <typename KeyT>
+void run_benchmark(size_t count)
+{
+    BenchmarkKeys<KeyT> b(count);
+    DictionaryObject *d = b.new_dictionary();
+
+    uint64_t start = now();
+    for (void *k: b.keys)
+    {
+        dictionary_insert(d, k, k);
+    }
+    uint64_t insert_time = now() - start;
+
+    start = now();
+    size_t found = 0;
+    for (size_t round = 0; round < 4; round++)
+    {
+        for (void *k: b.keys)
+        {
+            found += (dictionary_at(d, k) == k);
+        }
+    }
+    uint64_t lookup_time = now() - start;
+    expect_eq(count * 4, found);
+
+    start = now();
+    size_t iterated = 0;
+    for (size_t round = 0; round < 4; round++)
+    {
+        DictionaryObject::SlotContents item;
+        while (dictionary_next_item(d, &item))
+        {
+            iterated++;
+        }
+    }
+    uint64_t iterate_time = now() - start;
+    expect_eq(count * 4, iterated);
+
+    delete_reference(d);
+
+    printf("-- benchmark: %zu %s keys: insert %.1f ns/op, lookup %.1f ns/op, iterate %.1f ns/item\n",
+           count, BenchmarkKeys<KeyT>::name,
+           static_cast<double>(insert_time * 1000) / count,
+           static_cast<double>(lookup_time * 1000) / (count * 4),
+           static_cast<double>(iterate_time * 1000) / (count * 4));
+}
+
+
+int main(int argc, char *argv[])
+{
+    global.reset(new GlobalContext({}));
+    run_basic_test();
+    run_equal_keys_test();
+    run_reserve_and_steal_test();
+    run_collision_test();
+    run_growth_test();
+    run_order_test();
+    printf("all tests passed\n");
+
+    run_benchmark<int64_t>(1000000);
+    run_benchmark<BytesObject *>(1000000);
+    return 0;
+}
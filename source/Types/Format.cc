@@ -2,10 +2,16 @@
 
 #include <inttypes.h>
 #include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <type_traits>
+#include <unordered_map>
 
 #include <phosg/Strings.hh>
 
 #include "../Compiler/BuiltinFunctions.hh"
+#include "Numbers.hh"
 #include "Strings.hh"
 
 using namespace std;
@@ -87,7 +93,7 @@ struct FormatSpecifier
         }
         else if (this->precision >= 0)
         {
-            ret += string_printf(".%zd", this->width);
+            ret += string_printf(".%zd", this->precision);
         }
         if (include_format)
         {
@@ -99,52 +105,6 @@ struct FormatSpecifier
         }
         return ret;
     }
-
-    wstring wstr(bool include_format = true, bool debug = false) const
-    {
-        wstring ret = L"%";
-        if (this->alternate_form)
-        {
-            ret += L'#';
-        }
-        if (this->zero_fill)
-        {
-            ret += L'0';
-        }
-        if (this->left_justify)
-        {
-            ret += L'-';
-        }
-        if (this->sign_prefix)
-        {
-            ret += static_cast<wchar_t>(this->sign_prefix);
-        }
-        if (this->variable_width)
-        {
-            ret += L'*';
-        }
-        else if (this->width)
-        {
-            ret += wstring_printf(L"%zd", this->width);
-        }
-        if (this->variable_precision)
-        {
-            ret += L".*";
-        }
-        else if (this->precision >= 0)
-        {
-            ret += wstring_printf(L".%zd", this->width);
-        }
-        if (include_format)
-        {
-            ret += static_cast<wchar_t>(this->format_code);
-        }
-        if (debug)
-        {
-            ret += wstring_printf(L"(offset=%zd,length=%zd)", this->offset, this->length);
-        }
-        return ret;
-    }
 };
 
 enum class FormatParserState
@@ -206,6 +166,7 @@ static vector<struct FormatSpecifier> extract_formats(T *format, size_t count)
             else if (format[x] == '.')
             {
                 state = FormatParserState::Precision;
+                x++;
             }
             else
             {
@@ -228,6 +189,7 @@ static vector<struct FormatSpecifier> extract_formats(T *format, size_t count)
             else if (format[x] == '.')
             {
                 state = FormatParserState::Precision;
+                x++;
             }
             else
             {
@@ -295,7 +257,9 @@ static vector<struct FormatSpecifier> extract_formats(T *format, size_t count)
     return specs;
 }
 
-void typecheck_format(const vector<FormatSpecifier> &specs, const vector<Value> &types)
+// string_type is the type that %s accepts (the same as the format string's type)
+static void typecheck_format(const vector<FormatSpecifier> &specs,
+                             const vector<Value> &types, ValueType string_type)
 {
     size_t input_index = 0;
     for (const auto &spec: specs)
@@ -337,12 +301,20 @@ void typecheck_format(const vector<FormatSpecifier> &specs, const vector<Value>
         }
         ValueType input_type = types[input_index].type;
 
-        // s accepts Unicode only
+        // if the type isn't known yet (for example, in a function that hasn't
+        // been called yet), it's checked later, when the format is compiled
+        if (input_type == ValueType::Indeterminate)
+        {
+            input_index++;
+            continue;
+        }
+
+        // s accepts strings of the same type as the format only
         // TODO: in python, s accepts any type that can be __str__()'d
         switch (spec.format_code)
         {
             case 's':
-                if (input_type != ValueType::Unicode)
+                if (input_type != string_type)
                 {
                     string type_str = types[input_index].str();
                     throw invalid_argument(string_printf("incorrect type (%s) for %%%c",
@@ -398,217 +370,466 @@ void typecheck_format(const vector<FormatSpecifier> &specs, const vector<Value>
 void bytes_typecheck_format(const string &format, const vector<Value> &types)
 {
     auto specs = extract_formats(format.data(), format.size());
-    typecheck_format(specs, types);
+    typecheck_format(specs, types, ValueType::Bytes);
 }
 
 void unicode_typecheck_format(const wstring &format, const vector<Value> &types)
 {
     auto specs = extract_formats(format.data(), format.size());
-    typecheck_format(specs, types);
+    typecheck_format(specs, types, ValueType::Unicode);
 }
 
 
-void execute_format_spec(string &output, struct FormatSpecifier spec,
-                         const TupleObject *args, size_t &input_index)
+// a compiled format is the format string split into pieces. each piece is some
+// literal text followed by a specifier; the last piece has no specifier
+// (format_code is 0). executing one never has to look at the format string's
+// characters except to copy the literal text
+struct CompiledFormat
 {
-    if (spec.format_code == '%')
+    struct Piece
     {
-        output += '%';
-        return;
+        size_t literal_offset;
+        size_t literal_count;
+        FormatSpecifier spec;
+    };
+
+    const void *format; // BytesObject or UnicodeObject
+    vector<Piece> pieces;
+
+    template<typename CharT>
+    CompiledFormat(const void *format, const CharT *data, size_t count) : format(format)
+    {
+        size_t offset = 0;
+        for (const auto &spec: extract_formats(data, count))
+        {
+            this->pieces.emplace_back(Piece({offset, spec.offset - offset, spec}));
+            offset = spec.offset + spec.length;
+        }
+        this->pieces.emplace_back(Piece({offset, count - offset, FormatSpecifier()}));
     }
+};
 
-    if (spec.variable_width)
+static CompiledFormat compile_format(const BytesObject *format)
+{
+    return CompiledFormat(format, format->data, format->count);
+}
+
+static CompiledFormat compile_format(const UnicodeObject *format)
+{
+    if (format->kind == UnicodeKind::Latin1)
     {
-        spec.width = reinterpret_cast<int64_t>(tuple_get_item(args, input_index));
-        spec.variable_width = false;
-        input_index++;
+        return CompiledFormat(format, format->latin1, format->count);
     }
-    if (spec.variable_precision)
+    if (format->kind == UnicodeKind::UCS2)
     {
-        spec.precision = reinterpret_cast<int64_t>(tuple_get_item(args, input_index));
-        spec.variable_precision = false;
-        input_index++;
+        return CompiledFormat(format, format->ucs2, format->count);
     }
-    int64_t x = reinterpret_cast<int64_t>(tuple_get_item(args, input_index));
-    input_index++;
+    return CompiledFormat(format, format->ucs4, format->count);
+}
 
-    if (spec.format_code == 's')
+template<typename ObjectType>
+static const CompiledFormat *get_or_compile_format(ObjectType *format)
+{
+    // the table holds a reference to each format string, so the pointers can't
+    // be reused for different strings
+    static unordered_map<const void *, CompiledFormat> compiled_formats;
+    auto it = compiled_formats.find(format);
+    if (it == compiled_formats.end())
     {
-        const BytesObject *s = reinterpret_cast<const BytesObject *>(x);
-        // TODO: implement width and precision here
-        output.append(s->data, s->count);
+        it = compiled_formats.emplace(format, compile_format(format)).first;
+        add_reference(format);
+    }
+    return &it->second;
+}
+
+const CompiledFormat *bytes_compile_format(BytesObject *format)
+{
+    return get_or_compile_format(format);
+}
+
+const CompiledFormat *unicode_compile_format(UnicodeObject *format)
+{
+    return get_or_compile_format(format);
+}
+
+
+// the output of one specifier, worked out before the output is allocated
+struct FormatSegment
+{
+    const void *string_arg; // for %s; nullptr otherwise
+    bool is_char; // for %c and %%
+    uint32_t ch;
+    size_t text_offset; // for numbers; the text is in the number_text buffer
+    size_t count; // number of characters of text (or of string_arg) to write
+    size_t left_pad; // spaces around the text, for %s and %c (numbers are
+    size_t right_pad; // padded when they're formatted)
+};
 
+// formatted numbers are always ascii, so they're written as bytes whatever
+// the output's type
+static void append_float(string &output, const FormatSpecifier &spec, double f)
+{
+    // python's float formatting matches printf's, except that it doesn't look
+    // at the locale. build the printf format without allocating
+    char format[32];
+    char *p = format;
+    *(p++) = '%';
+    if (spec.alternate_form)
+    {
+        *(p++) = '#';
     }
-    else if ((spec.format_code == 'd') || (spec.format_code == 'i') ||
-             (spec.format_code == 'u') || (spec.format_code == 'o') ||
-             (spec.format_code == 'X') || (spec.format_code == 'x') ||
-             (spec.format_code == 'c'))
+    if (spec.zero_fill)
     {
-        string format = (spec.str(false) + "ll") + spec.format_code;
-        output += string_printf(format.c_str(), x);
+        *(p++) = '0';
+    }
+    if (spec.left_justify)
+    {
+        *(p++) = '-';
+    }
+    if (spec.sign_prefix)
+    {
+        *(p++) = spec.sign_prefix;
+    }
+    if (spec.width)
+    {
+        p += format_uint(p, spec.width);
+    }
+    if (spec.precision >= 0)
+    {
+        *(p++) = '.';
+        p += format_uint(p, spec.precision);
+    }
+    *(p++) = spec.format_code;
+    *p = 0;
 
+    char buf[64];
+    int count = snprintf(buf, sizeof(buf), format, f);
+    if (static_cast<size_t>(count) < sizeof(buf))
+    {
+        output.append(buf, count);
     }
-    else if ((spec.format_code == 'e') || (spec.format_code == 'E') ||
-             (spec.format_code == 'f') || (spec.format_code == 'F') ||
-             (spec.format_code == 'g') || (spec.format_code == 'G'))
+    else
     {
-        double f = *reinterpret_cast<double *>(&x);
-        string format = spec.str(false) + spec.format_code;
-        output += string_printf(format.c_str(), f);
+        size_t offset = output.size();
+        output.resize(offset + count + 1);
+        snprintf(&output[offset], count + 1, format, f);
+        output.resize(offset + count);
     }
 }
 
-// TODO: deduplicate this code with the above function
-void execute_format_spec(wstring &output, struct FormatSpecifier spec,
-                         const TupleObject *args, size_t &input_index)
+static void append_number(string &output, const FormatSpecifier &spec, int64_t x)
 {
-    if (spec.format_code == '%')
+    if ((spec.format_code == 'e') || (spec.format_code == 'E') ||
+        (spec.format_code == 'f') || (spec.format_code == 'F') ||
+        (spec.format_code == 'g') || (spec.format_code == 'G'))
     {
-        output += L'%';
+        append_float(output, spec, *reinterpret_cast<double *>(&x));
         return;
     }
 
-    if (spec.variable_width)
+    // integers are written as sign, prefix, precision zeroes, then digits.
+    // unlike printf, python writes negative hex and octal numbers with a -
+    // instead of as unsigned, and the alternate form of octal is 0o
+    char sign = (x < 0) ? '-' : spec.sign_prefix;
+    uint64_t magnitude = (x < 0) ? -static_cast<uint64_t>(x) : x;
+    const char *prefix = "";
+    char digits[max_number_text_length];
+    size_t digit_count;
+    if (spec.format_code == 'o')
     {
-        spec.width = reinterpret_cast<int64_t>(tuple_get_item(args, input_index));
-        spec.variable_width = false;
-        input_index++;
+        prefix = spec.alternate_form ? "0o" : "";
+        digit_count = format_uint_radix(digits, magnitude, 3);
     }
-    if (spec.variable_precision)
+    else if ((spec.format_code == 'x') || (spec.format_code == 'X'))
     {
-        spec.precision = reinterpret_cast<int64_t>(tuple_get_item(args, input_index));
-        spec.variable_precision = false;
-        input_index++;
+        bool uppercase = (spec.format_code == 'X');
+        prefix = spec.alternate_form ? (uppercase ? "0X" : "0x") : "";
+        digit_count = format_uint_radix(digits, magnitude, 4, uppercase);
     }
-    int64_t x = reinterpret_cast<int64_t>(tuple_get_item(args, input_index));
-    input_index++;
-
-    if (spec.format_code == 's')
+    else
     {
-        const UnicodeObject *s = reinterpret_cast<const UnicodeObject *>(x);
-        // TODO: implement width and precision here
-        output.append(s->data, s->count);
-
+        digit_count = format_uint(digits, magnitude);
     }
-    else if ((spec.format_code == 'd') || (spec.format_code == 'i') ||
-             (spec.format_code == 'u') || (spec.format_code == 'o') ||
-             (spec.format_code == 'X') || (spec.format_code == 'x') ||
-             (spec.format_code == 'c'))
-    {
-        wstring format = (spec.wstr(false) + L"ll") + static_cast<wchar_t>(spec.format_code);
 
-        wchar_t buf[64]; // this is plenty of space, right?
-        if (spec.width > static_cast<ssize_t>(sizeof(buf) / sizeof(buf[0])))
+    size_t prefix_count = strlen(prefix);
+    size_t zero_count = (spec.precision > static_cast<ssize_t>(digit_count)) ?
+                        (spec.precision - digit_count) : 0;
+    size_t count = (sign ? 1 : 0) + prefix_count + zero_count + digit_count;
+    size_t pad_count = (spec.width > static_cast<ssize_t>(count)) ? (spec.width - count) : 0;
+
+    if (pad_count && !spec.left_justify)
+    {
+        if (spec.zero_fill)
         {
-            throw invalid_argument("formatted Ints may not be longer than 64 characters");
+            zero_count += pad_count;
         }
-        int len = swprintf(buf, sizeof(buf) / sizeof(buf[0]), format.c_str(), x);
-        if ((len < 0) || (len >= static_cast<ssize_t>(sizeof(buf) / sizeof(buf[0]))))
+        else
         {
-            throw invalid_argument("formatted Int is too long");
+            output.append(pad_count, ' ');
         }
-        output.append(buf, len);
-
     }
-    else if ((spec.format_code == 'e') || (spec.format_code == 'E') ||
-             (spec.format_code == 'f') || (spec.format_code == 'F') ||
-             (spec.format_code == 'g') || (spec.format_code == 'G'))
+    if (sign)
     {
-        double f = *reinterpret_cast<double *>(&x);
-        wstring format = spec.wstr(false) + static_cast<wchar_t>(spec.format_code);
+        output += sign;
+    }
+    output.append(prefix, prefix_count);
+    output.append(zero_count, '0');
+    output.append(digits, digit_count);
+    if (pad_count && spec.left_justify)
+    {
+        output.append(pad_count, ' ');
+    }
+}
 
-        wchar_t buf[64]; // this is plenty of space, right?
-        if (spec.width > static_cast<ssize_t>(sizeof(buf) / sizeof(buf[0])))
+// works out the output of each specifier and the total length and kind of the
+// output. args has the arguments in order (including variable widths and
+// precisions); object arguments are borrowed. these buffers are reused between
+// calls to avoid allocating them every time (formatting can't recur, since no
+// python code runs during it)
+template<typename ObjectType>
+static size_t measure_format(const CompiledFormat *format, const int64_t *args,
+                             vector<FormatSegment> &segments, string &number_text,
+                             uint32_t *max_char)
+{
+    segments.clear();
+    number_text.clear();
+
+    size_t count = 0;
+    size_t input_index = 0;
+    for (const auto &piece: format->pieces)
+    {
+        count += piece.literal_count;
+        if (!piece.spec.format_code)
         {
-            throw invalid_argument("formatted Floats may not be longer than 64 characters");
+            break;
         }
-        int len = swprintf(buf, sizeof(buf) / sizeof(buf[0]), format.c_str(), f);
-        if ((len < 0) || (len >= static_cast<ssize_t>(sizeof(buf) / sizeof(buf[0]))))
+
+        segments.emplace_back(FormatSegment({nullptr, false, 0, 0, 1}));
+        FormatSegment &segment = segments.back();
+        if (piece.spec.format_code == '%')
         {
-            throw invalid_argument("formatted Float is too long");
+            segment.is_char = true;
+            segment.ch = '%';
+            count++;
+            continue;
         }
-        output.append(buf, len);
-    }
-}
 
-// TODO: this is a stupid template; make it require fewer arguments
-template<typename ObjectType, typename StringType,
-        ObjectType *(*string_new)(const StringType &)>
-ObjectType *string_format(ObjectType *format, TupleObject *args,
-                          ExceptionBlock *exc_block, bool delete_tuple_reference = false)
-{
-    ObjectType *ret = nullptr;
-    try
-    {
-        auto specs = extract_formats(format->data, format->count);
-        size_t spec_index = 0;
-        size_t input_index = 0;
-        size_t format_index = 0;
-        StringType output;
+        // like in python, a negative variable width means to left-justify, and
+        // a negative variable precision is the same as zero
+        FormatSpecifier spec = piece.spec;
+        if (spec.variable_width)
+        {
+            spec.width = args[input_index++];
+            spec.variable_width = false;
+            if (spec.width < 0)
+            {
+                spec.width = -spec.width;
+                spec.left_justify = true;
+            }
+        }
+        if (spec.variable_precision)
+        {
+            spec.precision = max<ssize_t>(args[input_index++], 0);
+            spec.variable_precision = false;
+        }
+        int64_t x = args[input_index++];
 
-        while (format_index < format->count)
+        if (spec.format_code == 's')
         {
-            if (format->data[format_index] == '%')
+            // the precision is the maximum number of characters to use
+            const ObjectType *arg = reinterpret_cast<const ObjectType *>(x);
+            segment.string_arg = arg;
+            segment.count = arg->count;
+            if ((spec.precision >= 0) && (segment.count > static_cast<size_t>(spec.precision)))
             {
-                auto &spec = specs[spec_index];
-                execute_format_spec(output, spec, args, input_index);
-                format_index += spec.length;
-                spec_index++;
+                segment.count = spec.precision;
             }
-            else
+            if (std::is_same<ObjectType, UnicodeObject>::value)
             {
-                output += format->data[format_index];
-                format_index++;
+                // a character of the right kind is enough; it doesn't have to be
+                // the largest one
+                const UnicodeObject *unicode_arg = reinterpret_cast<const UnicodeObject *>(arg);
+                if (unicode_arg->kind != UnicodeKind::Latin1)
+                {
+                    *max_char = max<uint32_t>(*max_char,
+                                              (unicode_arg->kind == UnicodeKind::UCS2) ? 0xFFFF : 0x10FFFF);
+                }
             }
+
         }
+        else if (spec.format_code == 'c')
+        {
+            segment.is_char = true;
+            segment.ch = std::is_same<ObjectType, BytesObject>::value ? (x & 0xFF) : x;
+            *max_char = max<uint32_t>(*max_char, segment.ch);
 
-        ret = string_new(output);
+        }
+        else
+        {
+            segment.text_offset = number_text.size();
+            append_number(number_text, spec, x);
+            segment.count = number_text.size() - segment.text_offset;
+        }
 
-    } catch (const exception &e)
+        if ((spec.format_code == 's') || (spec.format_code == 'c'))
+        {
+            size_t pad_count = (spec.width > static_cast<ssize_t>(segment.count)) ?
+                               (spec.width - segment.count) : 0;
+            (spec.left_justify ? segment.right_pad : segment.left_pad) = pad_count;
+        }
+        count += segment.left_pad + segment.count + segment.right_pad;
+    }
+    return count;
+}
+
+BytesObject *bytes_format_compiled(const CompiledFormat *format, const int64_t *args,
+                                   ExceptionBlock *exc_block)
+{
+    static vector<FormatSegment> segments;
+    static string number_text;
+    uint32_t max_char = 0;
+    size_t count = measure_format<BytesObject>(format, args, segments, number_text,
+                                               &max_char);
+
+    const BytesObject *format_object = reinterpret_cast<const BytesObject *>(format->format);
+    BytesObject *ret = bytes_new(nullptr, count, exc_block);
+    char *output = ret->data;
+    for (size_t x = 0; x < format->pieces.size(); x++)
     {
-        if (delete_tuple_reference)
+        const auto &piece = format->pieces[x];
+        memcpy(output, &format_object->data[piece.literal_offset], piece.literal_count);
+        output += piece.literal_count;
+        if (x >= segments.size())
         {
-            delete_reference(args);
+            break;
         }
-        raise_python_exception_with_message(exc_block, global->TypeError_class_id, e.what());
-        throw;
+
+        const FormatSegment &segment = segments[x];
+        memset(output, ' ', segment.left_pad);
+        output += segment.left_pad;
+        if (segment.string_arg)
+        {
+            memcpy(output, reinterpret_cast<const BytesObject *>(segment.string_arg)->data,
+                   segment.count);
+        }
+        else if (segment.is_char)
+        {
+            *output = segment.ch;
+        }
+        else
+        {
+            memcpy(output, &number_text[segment.text_offset], segment.count);
+        }
+        output += segment.count;
+        memset(output, ' ', segment.right_pad);
+        output += segment.right_pad;
     }
+    *output = 0;
+    return ret;
+}
 
-    if (delete_tuple_reference)
+static void unicode_write_padding(UnicodeObject *s, size_t offset, size_t count)
+{
+    for (size_t x = 0; x < count; x++)
     {
-        delete_reference(args);
+        unicode_write(s, offset + x, ' ');
+    }
+}
+
+UnicodeObject *unicode_format_compiled(const CompiledFormat *format, const int64_t *args,
+                                       ExceptionBlock *exc_block)
+{
+    static vector<FormatSegment> segments;
+    static string number_text;
+    uint32_t max_char = 0;
+    size_t count = measure_format<UnicodeObject>(format, args, segments, number_text,
+                                                 &max_char);
+
+    // the output needs the widest kind of the format string and any of the
+    // string or character arguments
+    const UnicodeObject *format_object = reinterpret_cast<const UnicodeObject *>(format->format);
+    UnicodeKind kind = static_cast<UnicodeKind>(max<uint32_t>(format_object->kind,
+                                                              unicode_kind_for_char(max_char)));
+    UnicodeObject *ret = unicode_new_with_kind(kind, count, exc_block);
+    size_t offset = 0;
+    for (size_t x = 0; x < format->pieces.size(); x++)
+    {
+        const auto &piece = format->pieces[x];
+        unicode_copy_range(ret, offset, format_object, piece.literal_offset, piece.literal_count);
+        offset += piece.literal_count;
+        if (x >= segments.size())
+        {
+            break;
+        }
+
+        const FormatSegment &segment = segments[x];
+        unicode_write_padding(ret, offset, segment.left_pad);
+        offset += segment.left_pad;
+        if (segment.string_arg)
+        {
+            unicode_copy_range(ret, offset, reinterpret_cast<const UnicodeObject *>(segment.string_arg),
+                               0, segment.count);
+        }
+        else if (segment.is_char)
+        {
+            unicode_write(ret, offset, segment.ch);
+        }
+        else
+        {
+            unicode_write_latin1(ret, offset, &number_text[segment.text_offset], segment.count);
+        }
+        offset += segment.count;
+        unicode_write_padding(ret, offset, segment.right_pad);
+        offset += segment.right_pad;
     }
     return ret;
 }
 
+
+// these are used when the format string isn't a constant, so it has to be
+// parsed on every call. parsing errors are raised as TypeErrors
+template<typename ObjectType>
+static ObjectType *string_format(ObjectType *(*format_compiled)(const CompiledFormat *,
+                                                                const int64_t *, ExceptionBlock *),
+                                 ObjectType *format, const int64_t *args,
+                                 ExceptionBlock *exc_block)
+{
+    try
+    {
+        CompiledFormat compiled = compile_format(format);
+        return format_compiled(&compiled, args, exc_block);
+
+    } catch (const invalid_argument &e)
+    {
+        raise_python_exception_with_message(exc_block, global->TypeError_class_id, e.what());
+        throw;
+    }
+}
+
 BytesObject *bytes_format(BytesObject *format, TupleObject *args,
                           ExceptionBlock *exc_block)
 {
-    return string_format<BytesObject, string, bytes_from_cxx_string>(
-            format, args, exc_block);
+    return string_format(bytes_format_compiled, format,
+                         reinterpret_cast<const int64_t *>(args->items()), exc_block);
 }
 
 UnicodeObject *unicode_format(UnicodeObject *format, TupleObject *args,
                               ExceptionBlock *exc_block)
 {
-    return string_format<UnicodeObject, wstring, unicode_from_cxx_wstring>(
-            format, args, exc_block);
+    return string_format(unicode_format_compiled, format,
+                         reinterpret_cast<const int64_t *>(args->items()), exc_block);
 }
 
-BytesObject *bytes_format_one(BytesObject *format, void *arg, bool is_object,
+BytesObject *bytes_format_one(BytesObject *format, void *arg,
                               ExceptionBlock *exc_block)
 {
-    TupleObject *t = tuple_new(1, exc_block);
-    tuple_set_item(t, 0, arg, is_object, exc_block);
-    return string_format<BytesObject, string, bytes_from_cxx_string>(
-            format, t, exc_block, true);
+    return string_format(bytes_format_compiled, format,
+                         reinterpret_cast<const int64_t *>(&arg), exc_block);
 }
 
-UnicodeObject *unicode_format_one(UnicodeObject *format, void *arg, bool is_object,
+UnicodeObject *unicode_format_one(UnicodeObject *format, void *arg,
                                   ExceptionBlock *exc_block)
 {
-    TupleObject *t = tuple_new(1, exc_block);
-    tuple_set_item(t, 0, arg, is_object, exc_block);
-    return string_format<UnicodeObject, wstring, unicode_from_cxx_wstring>(
-            format, t, exc_block, true);
+    return string_format(unicode_format_compiled, format,
+                         reinterpret_cast<const int64_t *>(&arg), exc_block);
 }
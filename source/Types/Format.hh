@@ -23,8 +23,24 @@ BytesObject *bytes_format(BytesObject *format, TupleObject *args,
 UnicodeObject *unicode_format(UnicodeObject *format, TupleObject *args,
                               ExceptionBlock *exc_block = nullptr);
 
-BytesObject *bytes_format_one(BytesObject *format, void *arg, bool is_object,
+BytesObject *bytes_format_one(BytesObject *format, void *arg,
                               ExceptionBlock *exc_block = nullptr);
 
-UnicodeObject *unicode_format_one(UnicodeObject *format, void *arg, bool is_object,
+UnicodeObject *unicode_format_one(UnicodeObject *format, void *arg,
                                   ExceptionBlock *exc_block = nullptr);
+
+// when the format string is a constant, the compiler parses it once with
+// these functions and generates calls to *_format_compiled instead of the
+// above. the arguments are passed in an array (in the same order as they would
+// be in the tuple) and are borrowed. the compiled formats are never freed.
+struct CompiledFormat;
+
+const CompiledFormat *bytes_compile_format(BytesObject *format);
+
+const CompiledFormat *unicode_compile_format(UnicodeObject *format);
+
+BytesObject *bytes_format_compiled(const CompiledFormat *format, const int64_t *args,
+                                   ExceptionBlock *exc_block = nullptr);
+
+UnicodeObject *unicode_format_compiled(const CompiledFormat *format, const int64_t *args,
+                                       ExceptionBlock *exc_block = nullptr);
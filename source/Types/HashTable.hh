@@ -0,0 +1,78 @@
+#pragma once
+
+#include <emmintrin.h>
+#include <stdint.h>
+
+
+// these are the pieces shared by DictionaryObject and SetObject, which are both
+// open-addressing hash tables in the style of SwissTable. each slot has a
+// control byte, which is either one of the special values below or the low 7
+// bits of the hash of the key in the slot. lookups compare 16 control bytes at
+// a time with SSE2 to find candidate slots, and only compare keys for slots
+// whose control bytes match. groups of 16 slots are probed in triangular
+// order, which visits every group since the group count is a power of 2.
+
+static constexpr size_t hash_table_group_size = 16;
+static constexpr size_t hash_table_min_capacity = 16;
+static constexpr int8_t hash_table_control_empty = -0x80;
+static constexpr int8_t hash_table_control_deleted = -0x02;
+
+static inline uint64_t hash_table_default_key_hash(const void *k)
+{
+    // keys are integers (or pointers compared by identity). these often differ
+    // only in their low or high bits, so mix all the bits together
+    uint64_t h = reinterpret_cast<uint64_t>(k);
+    h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9;
+    h = (h ^ (h >> 27)) * 0x94D049BB133111EB;
+    return h ^ (h >> 31);
+}
+
+static inline int8_t hash_table_control_for_hash(uint64_t hash)
+{
+    return hash & 0x7F;
+}
+
+static inline size_t hash_table_group_for_hash(uint64_t hash, size_t capacity)
+{
+    return (hash >> 7) & ((capacity / hash_table_group_size) - 1);
+}
+
+static inline uint32_t hash_table_match_control(const int8_t *group, int8_t value)
+{
+    __m128i ctrl = _mm_load_si128(reinterpret_cast<const __m128i *>(group));
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(value)));
+}
+
+static inline uint32_t hash_table_match_empty_or_deleted(const int8_t *group)
+{
+    // both special values have the high bit set, and full slots don't
+    __m128i ctrl = _mm_load_si128(reinterpret_cast<const __m128i *>(group));
+    return _mm_movemask_epi8(ctrl);
+}
+
+static inline uint32_t hash_table_match_full(const int8_t *group)
+{
+    return ~hash_table_match_empty_or_deleted(group) & 0xFFFF;
+}
+
+// returns the capacity a table should have after running out of empty slots.
+// if most of the used slots are deleted, the table is rehashed at the same
+// size instead of growing
+static inline size_t hash_table_next_capacity(size_t count, size_t capacity)
+{
+    if (!capacity)
+    {
+        return hash_table_min_capacity;
+    }
+    if (count * 16 >= capacity * 7)
+    {
+        return capacity * 2;
+    }
+    return capacity;
+}
+
+// at most 7/8 of the slots may be used, so probes always terminate quickly
+static inline size_t hash_table_max_load(size_t capacity)
+{
+    return capacity - (capacity / 8);
+}
@@ -7,6 +7,7 @@
 #include <phosg/Strings.hh>
 
 #include "../Compiler/BuiltinFunctions.hh"
+#include "Strings.hh"
 
 using namespace std;
 
@@ -55,6 +56,49 @@ void list_delete(ListObject *l)
 }
 
 
+void list_reserve(ListObject *l, size_t capacity, ExceptionBlock *exc_block)
+{
+    if (capacity <= l->capacity)
+    {
+        return;
+    }
+    void **new_items = reinterpret_cast<void **>(realloc(l->items, capacity * sizeof(void *)));
+    if (!new_items)
+    {
+        raise_python_exception(exc_block, &MemoryError_instance);
+        throw bad_alloc();
+    }
+    l->items = new_items;
+    l->capacity = capacity;
+}
+
+void list_grow(ListObject *l, ExceptionBlock *exc_block)
+{
+    list_reserve(l, (l->capacity < 4) ? 4 : (l->capacity * 2), exc_block);
+}
+
+// makes room for at least count more items. like list_grow, this at least
+// doubles the capacity, so a sequence of extends takes amortized linear time
+static void list_grow_by(ListObject *l, size_t count, ExceptionBlock *exc_block)
+{
+    size_t needed = l->count + count;
+    if (needed > l->capacity)
+    {
+        size_t doubled = (l->capacity < 4) ? 4 : (l->capacity * 2);
+        list_reserve(l, (needed > doubled) ? needed : doubled, exc_block);
+    }
+}
+
+// adds references to all of the given items (times references to each)
+static void add_item_references(void *const *items, size_t count, uint64_t times = 1)
+{
+    for (size_t x = 0; x < count; x++)
+    {
+        add_references(items[x], times);
+    }
+}
+
+
 void *list_get_item(const ListObject *l, int64_t position,
                     ExceptionBlock *exc_block)
 {
@@ -100,51 +144,125 @@ void list_set_item(ListObject *l, int64_t position, void *value,
     }
 }
 
-void list_insert(ListObject *l, int64_t position, void *value,
-                 ExceptionBlock *exc_block)
+// raises ValueError if a slice's step is zero
+static void check_slice_step(int64_t step, ExceptionBlock *exc_block)
 {
+    if (!step)
+    {
+        raise_python_exception_with_message(exc_block, global->ValueError_class_id,
+                                            "slice step cannot be zero");
+        throw invalid_argument("slice step cannot be zero");
+    }
+}
 
-    if (position < 0)
+ListObject *list_slice(const ListObject *l, int64_t start, int64_t end, int64_t step,
+                       ExceptionBlock *exc_block)
+{
+    check_slice_step(step, exc_block);
+    size_t count = slice_adjust_indices(l->count, &start, end, step);
+    ListObject *ret = list_new(count, l->items_are_objects, exc_block);
+    if (step == 1)
     {
-        position += l->count;
+        if (count)
+        {
+            memcpy(ret->items, &l->items[start], count * sizeof(void *));
+        }
     }
-    if (position < 0 || position > static_cast<ssize_t>(l->count))
+    else
     {
-        raise_python_exception_with_message(exc_block, global->IndexError_class_id,
-                                            "list index out of range");
-        throw out_of_range("index out of range for list insert");
+        for (size_t x = 0; x < count; x++, start += step)
+        {
+            ret->items[x] = l->items[start];
+        }
+    }
+    if (ret->items_are_objects)
+    {
+        add_item_references(ret->items, count);
     }
+    return ret;
+}
 
-    if (l->count <= l->capacity)
+void list_set_slice(ListObject *l, int64_t start, int64_t end, int64_t step,
+                    const ListObject *items, ExceptionBlock *exc_block)
+{
+    check_slice_step(step, exc_block);
+    size_t count = slice_adjust_indices(l->count, &start, end, step);
+    size_t new_count = items->count;
+    if ((step != 1) && (new_count != count))
     {
-        memmove(&l->items[position + 1], &l->items[position],
-                (l->count - position) * sizeof(void *));
-        l->items[position] = value;
-        l->count++;
+        raise_python_exception_with_format(exc_block, global->ValueError_class_id,
+                                           "attempt to assign sequence of size %zu to extended slice of size %zu",
+                                           new_count, count);
+        throw invalid_argument("extended slice assignment with incorrect size");
+    }
+
+    // copy the new items first, since items may be l. the removed items'
+    // references are deleted last, since the destructors may do anything
+    vector<void *> new_items(items->items, items->items + new_count);
+    vector<void *> removed_items;
+    removed_items.reserve(count);
 
+    if (step == 1)
+    {
+        removed_items.assign(&l->items[start], &l->items[start + count]);
+        if (new_count > count)
+        {
+            list_reserve(l, l->count + new_count - count, exc_block);
+        }
+        if (new_count != count)
+        {
+            memmove(&l->items[start + new_count], &l->items[start + count],
+                    (l->count - start - count) * sizeof(void *));
+        }
+        if (new_count)
+        {
+            memcpy(&l->items[start], new_items.data(), new_count * sizeof(void *));
+        }
+        l->count = l->count + new_count - count;
     }
     else
     {
-        // TODO: maybe we can do something smarter than just doubling the capacity
-        size_t new_capacity = (l->capacity == 0) ? 1 : (2 * l->capacity);
-        void **new_items = reinterpret_cast<void **>(malloc(new_capacity * sizeof(void *)));
-        if (!new_items)
+        for (size_t x = 0; x < count; x++, start += step)
         {
-            raise_python_exception(exc_block, &MemoryError_instance);
-            throw bad_alloc();
+            removed_items.emplace_back(l->items[start]);
+            l->items[start] = new_items[x];
         }
+    }
 
-        memcpy(new_items, l->items, position * sizeof(void *));
-        new_items[position] = value;
-        memcpy(&new_items[position + 1], &l->items[position],
-               (l->count - position) * sizeof(void *));
+    if (l->items_are_objects)
+    {
+        add_item_references(new_items.data(), new_count);
+        for (void *item: removed_items)
+        {
+            delete_reference(item);
+        }
+    }
+}
 
-        free(l->items);
-        l->items = new_items;
-        l->capacity = new_capacity;
-        l->count++;
+void list_insert(ListObject *l, int64_t position, void *value,
+                 ExceptionBlock *exc_block)
+{
+
+    if (position < 0)
+    {
+        position += l->count;
+    }
+    if (position < 0 || position > static_cast<ssize_t>(l->count))
+    {
+        raise_python_exception_with_message(exc_block, global->IndexError_class_id,
+                                            "list index out of range");
+        throw out_of_range("index out of range for list insert");
     }
 
+    if (l->count == l->capacity)
+    {
+        list_grow(l, exc_block);
+    }
+    memmove(&l->items[position + 1], &l->items[position],
+            (l->count - position) * sizeof(void *));
+    l->items[position] = value;
+    l->count++;
+
     if (l->items_are_objects)
     {
         add_reference(value);
@@ -171,29 +289,100 @@ void *list_pop(ListObject *l, int64_t position, ExceptionBlock *exc_block)
 
     void *ret = l->items[position];
 
-    // if less than 50% of the list will be in use after popping, shrink it to fit
-    if (l->count <= l->capacity / 2)
+    memmove(&l->items[position], &l->items[position + 1],
+            (l->count - position - 1) * sizeof(void *));
+    l->count--;
+
+    // if less than a quarter of the space is in use, give half of it back.
+    // shrinking by less than that would make alternating appends and pops
+    // reallocate every time. if realloc fails, just keep the larger array
+    if ((l->capacity > 8) && (l->count < l->capacity / 4))
     {
-        void **new_items = reinterpret_cast<void **>(malloc((l->count - 1) * sizeof(void *)));
-        if (!new_items)
+        void **new_items = reinterpret_cast<void **>(realloc(l->items,
+                                                             (l->capacity / 2) * sizeof(void *)));
+        if (new_items)
         {
-            raise_python_exception(exc_block, &MemoryError_instance);
-            throw bad_alloc();
+            l->items = new_items;
+            l->capacity /= 2;
         }
-        memcpy(new_items, l->items, position * sizeof(void *));
-        memcpy(&new_items[position], &l->items[position + 1],
-               (l->count - position - 1) * sizeof(void *));
+    }
 
+    // no need to mess with references - the reference formerly owned by the list
+    // is now returned by this function
+    return ret;
+}
+
+void list_extend(ListObject *l, const ListObject *items, ExceptionBlock *exc_block)
+{
+    // if items is l, its count and items pointer change during this function,
+    // so read them at the right times
+    size_t count = items->count;
+    if (!count)
+    {
+        return;
     }
-    else
+    list_grow_by(l, count, exc_block);
+    memcpy(&l->items[l->count], items->items, count * sizeof(void *));
+
+    // l might be an empty list that didn't know its item type yet
+    if (items->items_are_objects)
     {
-        memmove(&l->items[position], &l->items[position + 1],
-                (l->count - position - 1) * sizeof(void *));
-        l->count--;
+        l->items_are_objects = true;
+        add_item_references(&l->items[l->count], count);
     }
+    l->count += count;
+}
 
-    // no need to mess with references - the reference formerly owned by the list
-    // is now returned by this function
+ListObject *list_concat(const ListObject *a, const ListObject *b,
+                        ExceptionBlock *exc_block)
+{
+    // one of the lists might be empty, in which case it may not know that the
+    // items are objects
+    ListObject *ret = list_new(a->count + b->count,
+                               a->items_are_objects || b->items_are_objects, exc_block);
+    if (a->count)
+    {
+        memcpy(ret->items, a->items, a->count * sizeof(void *));
+    }
+    if (b->count)
+    {
+        memcpy(&ret->items[a->count], b->items, b->count * sizeof(void *));
+    }
+    if (ret->items_are_objects)
+    {
+        add_item_references(ret->items, ret->count);
+    }
+    return ret;
+}
+
+ListObject *list_repeat(const ListObject *l, int64_t count, ExceptionBlock *exc_block)
+{
+    if ((count <= 0) || !l->count)
+    {
+        return list_new(0, l->items_are_objects, exc_block);
+    }
+    if (static_cast<uint64_t>(count) > (SIZE_MAX / sizeof(void *)) / l->count)
+    {
+        raise_python_exception(exc_block, &MemoryError_instance);
+        throw bad_alloc();
+    }
+
+    // fill in the items by doubling the filled part each time, so there are
+    // only log2(count) memcpys. each item gets all of its new references at
+    // once
+    size_t total_count = l->count * count;
+    ListObject *ret = list_new(total_count, l->items_are_objects, exc_block);
+    memcpy(ret->items, l->items, l->count * sizeof(void *));
+    for (size_t filled = l->count; filled < total_count;)
+    {
+        size_t copy_count = min(filled, total_count - filled);
+        memcpy(&ret->items[filled], ret->items, copy_count * sizeof(void *));
+        filled += copy_count;
+    }
+    if (ret->items_are_objects)
+    {
+        add_item_references(l->items, l->count, count);
+    }
     return ret;
 }
 
@@ -209,6 +398,212 @@ void list_clear(ListObject *l)
     free(l->items);
     l->items = nullptr;
     l->count = 0;
+    l->capacity = 0;
+}
+
+
+// lists of Ints and Floats are sorted by 64-bit keys computed from the items,
+// which are ordered the same way as the values when compared as unsigned
+// integers. reversing the sort order just means inverting the keys, and equal
+// items still keep their original order (as in python, which reverses the
+// order without reversing runs of equal items)
+static inline uint64_t int_sort_key(uint64_t v)
+{
+    return v ^ 0x8000000000000000;
+}
+
+// positive floats are ordered by their bit patterns; negative floats are
+// ordered backward, so all of their bits are inverted. -0.0 and 0.0 are equal
+// in python, so they have the same key
+static inline uint64_t float_sort_key(uint64_t v)
+{
+    if (v == 0x8000000000000000)
+    {
+        return v;
+    }
+    return (v & 0x8000000000000000) ? ~v : (v | 0x8000000000000000);
+}
+
+// below this many items, insertion sort is faster than radix sort
+static const size_t radix_sort_min_count = 64;
+
+template <uint64_t (*Key)(uint64_t)>
+static void sort_items_by_key(uint64_t *items, size_t count, bool reverse,
+                              ExceptionBlock *exc_block)
+{
+    uint64_t key_xor = reverse ? 0xFFFFFFFFFFFFFFFF : 0;
+
+    if (count < radix_sort_min_count)
+    {
+        for (size_t x = 1; x < count; x++)
+        {
+            uint64_t item = items[x];
+            uint64_t key = Key(item) ^ key_xor;
+            size_t y = x;
+            for (; (y > 0) && ((Key(items[y - 1]) ^ key_xor) > key); y--)
+            {
+                items[y] = items[y - 1];
+            }
+            items[y] = item;
+        }
+        return;
+    }
+
+    // this is an LSD radix sort with 8-bit digits. all of the digit counts are
+    // computed in one pass, so passes where every key has the same digit (which
+    // is common for the high bytes of small ints) can be skipped entirely
+    size_t digit_counts[8][0x100];
+    memset(digit_counts, 0, sizeof(digit_counts));
+    for (size_t x = 0; x < count; x++)
+    {
+        uint64_t key = Key(items[x]) ^ key_xor;
+        for (size_t digit = 0; digit < 8; digit++)
+        {
+            digit_counts[digit][(key >> (digit * 8)) & 0xFF]++;
+        }
+    }
+
+    uint64_t *buffer = reinterpret_cast<uint64_t *>(malloc(count * sizeof(uint64_t)));
+    if (!buffer)
+    {
+        raise_python_exception(exc_block, &MemoryError_instance);
+        throw bad_alloc();
+    }
+
+    uint64_t *src = items;
+    uint64_t *dest = buffer;
+    for (size_t digit = 0; digit < 8; digit++)
+    {
+        size_t shift = digit * 8;
+        size_t *counts = digit_counts[digit];
+        if (counts[((Key(src[0]) ^ key_xor) >> shift) & 0xFF] == count)
+        {
+            continue;
+        }
+
+        // turn the counts into the offsets where each digit's items start
+        size_t offset = 0;
+        for (size_t x = 0; x < 0x100; x++)
+        {
+            size_t digit_count = counts[x];
+            counts[x] = offset;
+            offset += digit_count;
+        }
+
+        for (size_t x = 0; x < count; x++)
+        {
+            uint64_t item = src[x];
+            dest[counts[((Key(item) ^ key_xor) >> shift) & 0xFF]++] = item;
+        }
+        swap(src, dest);
+    }
+
+    if (src != items)
+    {
+        memcpy(items, src, count * sizeof(uint64_t));
+    }
+    free(buffer);
+}
+
+void list_sort_ints(ListObject *l, bool reverse, ExceptionBlock *exc_block)
+{
+    sort_items_by_key<int_sort_key>(reinterpret_cast<uint64_t *>(l->items), l->count,
+                                    reverse, exc_block);
+}
+
+void list_sort_floats(ListObject *l, bool reverse, ExceptionBlock *exc_block)
+{
+    sort_items_by_key<float_sort_key>(reinterpret_cast<uint64_t *>(l->items), l->count,
+                                      reverse, exc_block);
+}
+
+// lists of strings are sorted with a bottom-up merge sort, which is stable and
+// does fewer comparisons than quicksort (comparisons are the expensive part
+// here). short runs are insertion sorted first
+static const size_t merge_sort_run_length = 16;
+
+template <typename T, int64_t (*Compare)(const T *, const T *)>
+static void merge_sort_items(void **items, size_t count, bool reverse,
+                             ExceptionBlock *exc_block)
+{
+    // returns true if a must come before b (that is, false if they're equal,
+    // so equal items stay in their original order)
+    auto before = [reverse](void *a, void *b) -> bool {
+        int64_t result = Compare(reinterpret_cast<const T *>(a),
+                                 reinterpret_cast<const T *>(b));
+        return reverse ? (result > 0) : (result < 0);
+    };
+
+    for (size_t run_start = 0; run_start < count; run_start += merge_sort_run_length)
+    {
+        size_t run_end = min(run_start + merge_sort_run_length, count);
+        for (size_t x = run_start + 1; x < run_end; x++)
+        {
+            void *item = items[x];
+            size_t y = x;
+            for (; (y > run_start) && before(item, items[y - 1]); y--)
+            {
+                items[y] = items[y - 1];
+            }
+            items[y] = item;
+        }
+    }
+    if (count <= merge_sort_run_length)
+    {
+        return;
+    }
+
+    void **buffer = reinterpret_cast<void **>(malloc(count * sizeof(void *)));
+    if (!buffer)
+    {
+        raise_python_exception(exc_block, &MemoryError_instance);
+        throw bad_alloc();
+    }
+
+    void **src = items;
+    void **dest = buffer;
+    for (size_t width = merge_sort_run_length; width < count; width *= 2)
+    {
+        for (size_t left = 0; left < count; left += 2 * width)
+        {
+            size_t mid = min(left + width, count);
+            size_t right_end = min(left + 2 * width, count);
+            size_t x = left, y = mid, z = left;
+
+            // if the halves are already in order, just copy them
+            if ((mid < right_end) && !before(src[mid], src[mid - 1]))
+            {
+                memcpy(&dest[left], &src[left], (right_end - left) * sizeof(void *));
+                continue;
+            }
+
+            while ((x < mid) && (y < right_end))
+            {
+                dest[z++] = before(src[y], src[x]) ? src[y++] : src[x++];
+            }
+            memcpy(&dest[z], &src[x], (mid - x) * sizeof(void *));
+            z += mid - x;
+            memcpy(&dest[z], &src[y], (right_end - y) * sizeof(void *));
+        }
+        swap(src, dest);
+    }
+
+    if (src != items)
+    {
+        memcpy(items, src, count * sizeof(void *));
+    }
+    free(buffer);
+}
+
+void list_sort_bytes(ListObject *l, bool reverse, ExceptionBlock *exc_block)
+{
+    merge_sort_items<BytesObject, bytes_compare>(l->items, l->count, reverse, exc_block);
+}
+
+void list_sort_unicode(ListObject *l, bool reverse, ExceptionBlock *exc_block)
+{
+    merge_sort_items<UnicodeObject, unicode_compare>(l->items, l->count, reverse,
+                                                     exc_block);
 }
 
 size_t list_size(const ListObject *l)
@@ -8,6 +8,7 @@
 
 #include "../Compiler/Exception.hh"
 #include "Reference.hh"
+#include "Slice.hh"
 
 
 struct ListObject
@@ -24,12 +25,30 @@ ListObject *list_new(uint64_t count, bool items_are_objects,
 
 void list_delete(ListObject *l);
 
+// makes room for at least capacity items without reallocating
+void list_reserve(ListObject *l, size_t capacity, ExceptionBlock *exc_block = nullptr);
+
+// makes room for at least one more item, over-allocating so that a sequence of
+// appends takes amortized constant time
+void list_grow(ListObject *l, ExceptionBlock *exc_block = nullptr);
+
 void *list_get_item(const ListObject *l, int64_t position,
                     ExceptionBlock *exc_block = nullptr);
 
 void list_set_item(ListObject *l, int64_t position, void *value,
                    ExceptionBlock *exc_block = nullptr);
 
+// returns a new list with the items in l[start:end:step], with omitted bounds
+// passed as slice_index_missing
+ListObject *list_slice(const ListObject *l, int64_t start, int64_t end, int64_t step,
+                       ExceptionBlock *exc_block = nullptr);
+
+// implements l[start:end:step] = items. if step is 1, the slice can be
+// replaced by any number of items; otherwise, items must have as many items as
+// the slice. items may be l itself
+void list_set_slice(ListObject *l, int64_t start, int64_t end, int64_t step,
+                    const ListObject *items, ExceptionBlock *exc_block = nullptr);
+
 void list_insert(ListObject *l, int64_t position, void *value,
                  ExceptionBlock *exc_block = nullptr);
 
@@ -37,6 +56,22 @@ void list_append(ListObject *l, void *value, ExceptionBlock *exc_block = nullptr
 
 void *list_pop(ListObject *l, int64_t position, ExceptionBlock *exc_block);
 
+// appends the items in items to l. items may be l itself
+void list_extend(ListObject *l, const ListObject *items, ExceptionBlock *exc_block = nullptr);
+
+// these implement a + b and l * count, returning new lists
+ListObject *list_concat(const ListObject *a, const ListObject *b,
+                        ExceptionBlock *exc_block = nullptr);
+ListObject *list_repeat(const ListObject *l, int64_t count,
+                        ExceptionBlock *exc_block = nullptr);
+
 void list_clear(ListObject *l);
 
+// these sort lists of Ints, Floats, Bytes and Unicode objects in place. the
+// sort is stable, even if reverse is true
+void list_sort_ints(ListObject *l, bool reverse, ExceptionBlock *exc_block = nullptr);
+void list_sort_floats(ListObject *l, bool reverse, ExceptionBlock *exc_block = nullptr);
+void list_sort_bytes(ListObject *l, bool reverse, ExceptionBlock *exc_block = nullptr);
+void list_sort_unicode(ListObject *l, bool reverse, ExceptionBlock *exc_block = nullptr);
+
 size_t list_size(const ListObject *d);
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+
+// these convert numbers to text without going through printf, which parses a
+// format string and looks at the locale every time. none of them write a
+// terminating null byte; they all return the number of characters written.
+
+// the longest text that any of these functions can produce
+const size_t max_number_text_length = 66; // "-0b" + 63 ones, from bin()
+
+// writes the decimal representation of an integer (with a - if negative)
+size_t format_int(char *buf, int64_t value);
+
+size_t format_uint(char *buf, uint64_t value);
+
+// writes an unsigned integer in base 2, 8 or 16 (bits_per_digit is 1, 3 or 4)
+// with no prefix
+size_t format_uint_radix(char *buf, uint64_t value, uint8_t bits_per_digit,
+                         bool uppercase = false);
+
+// writes an integer in base 2, 8 or 16 with a python-style prefix (0b, 0o or
+// 0x) after the sign, like bin(), oct() and hex() do
+size_t format_int_prefixed(char *buf, int64_t value, uint8_t bits_per_digit);
+
+// finds the shortest string of decimal digits that parses back to the given
+// finite, nonzero, positive value (and of those, the closest one). digits
+// receives up to 17 digits (not null-terminated) and the return value is the
+// number of digits; the value is then 0.DIGITS * 10^decimal_point
+size_t float_shortest_digits(char *digits, double value, int *decimal_point);
+
+// writes a float the way python's repr() does: the shortest text that parses
+// back to the same value, using exponent notation only for very large or very
+// small values
+size_t format_float_repr(char *buf, double value);
+
+
+enum class ParseNumberResult
+{
+    Valid = 0,
+    Invalid, // not a number
+    OutOfRange, // a valid integer, but it doesn't fit in 64 bits
+};
+
+// these parse numbers with the syntax that python's int() and float() accept,
+// except that the text must already have had surrounding whitespace removed
+// and must be ascii (callers handle other characters). single underscores may
+// separate digits. base is 0 (meaning it comes from a 0b, 0o or 0x prefix, or
+// is 10 if there's no prefix) or 2 through 36. these don't allocate memory,
+// except for floats with more than 19 significant digits that can't be
+// rounded without looking at all of them
+ParseNumberResult parse_int(const char *data, size_t size, int64_t base, int64_t *value);
+
+ParseNumberResult parse_float(const char *data, size_t size, double *value);
@@ -0,0 +1,497 @@
+#include "NumericKernels.hh"
+
+#include <immintrin.h>
+
+using namespace std;
+
+
+static bool cpu_has_avx2()
+{
+    static const bool has_avx2 = __builtin_cpu_supports("avx2");
+    return has_avx2;
+}
+
+#define AVX2_FUNCTION __attribute__((target("avx2")))
+
+
+// Int arithmetic is done on unsigned values, since signed overflow is undefined
+
+static inline int64_t wrapping_add(int64_t a, int64_t b)
+{
+    return static_cast<int64_t>(static_cast<uint64_t>(a) + static_cast<uint64_t>(b));
+}
+
+static inline int64_t wrapping_mul(int64_t a, int64_t b)
+{
+    return static_cast<int64_t>(static_cast<uint64_t>(a) * static_cast<uint64_t>(b));
+}
+
+// AVX2 has no 64-bit multiply, so build one out of 32x32->64 multiplies. the
+// product of the high halves only affects bits above 64, so it's not needed
+AVX2_FUNCTION static inline __m256i avx2_mul_epi64(__m256i a, __m256i b)
+{
+    __m256i low_products = _mm256_mul_epu32(a, b);
+    __m256i cross_products = _mm256_add_epi64(
+            _mm256_mul_epu32(_mm256_srli_epi64(a, 32), b),
+            _mm256_mul_epu32(a, _mm256_srli_epi64(b, 32)));
+    return _mm256_add_epi64(low_products, _mm256_slli_epi64(cross_products, 32));
+}
+
+// Float sums use 8 partial sums: item x goes into partial sum x % 8. they're
+// combined as ((s0 + s4) + (s2 + s6)) + ((s1 + s5) + (s3 + s7)), which is the
+// order that falls out of adding the halves of the AVX2 registers together.
+// the remaining items are then added one at a time
+
+static double combine_partial_sums(const double *sums)
+{
+    return ((sums[0] + sums[4]) + (sums[2] + sums[6])) +
+           ((sums[1] + sums[5]) + (sums[3] + sums[7]));
+}
+
+AVX2_FUNCTION static double avx2_combine_partial_sums(__m256d sums_low, __m256d sums_high)
+{
+    __m256d sums = _mm256_add_pd(sums_low, sums_high);
+    __m128d halves = _mm_add_pd(_mm256_castpd256_pd128(sums), _mm256_extractf128_pd(sums, 1));
+    return _mm_cvtsd_f64(halves) + _mm_cvtsd_f64(_mm_unpackhi_pd(halves, halves));
+}
+
+
+static int64_t generic_sum_ints(const int64_t *a, size_t count)
+{
+    int64_t ret = 0;
+    for (size_t x = 0; x < count; x++)
+    {
+        ret = wrapping_add(ret, a[x]);
+    }
+    return ret;
+}
+
+AVX2_FUNCTION static int64_t avx2_sum_ints(const int64_t *a, size_t count)
+{
+    __m256i sums_low = _mm256_setzero_si256();
+    __m256i sums_high = _mm256_setzero_si256();
+    size_t x = 0;
+    for (; x + 8 <= count; x += 8)
+    {
+        sums_low = _mm256_add_epi64(sums_low, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + x)));
+        sums_high = _mm256_add_epi64(sums_high, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + x + 4)));
+    }
+    int64_t sums[4];
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(sums), _mm256_add_epi64(sums_low, sums_high));
+    int64_t ret = wrapping_add(wrapping_add(sums[0], sums[1]), wrapping_add(sums[2], sums[3]));
+    return wrapping_add(ret, generic_sum_ints(a + x, count - x));
+}
+
+int64_t numeric_kernel_sum_ints(const int64_t *a, size_t count)
+{
+    return cpu_has_avx2() ? avx2_sum_ints(a, count) : generic_sum_ints(a, count);
+}
+
+
+static double generic_sum_floats(const double *a, size_t count)
+{
+    double sums[8] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+    size_t x = 0;
+    for (; x + 8 <= count; x += 8)
+    {
+        for (size_t y = 0; y < 8; y++)
+        {
+            sums[y] += a[x + y];
+        }
+    }
+    double ret = combine_partial_sums(sums);
+    for (; x < count; x++)
+    {
+        ret += a[x];
+    }
+    return ret;
+}
+
+AVX2_FUNCTION static double avx2_sum_floats(const double *a, size_t count)
+{
+    __m256d sums_low = _mm256_setzero_pd();
+    __m256d sums_high = _mm256_setzero_pd();
+    size_t x = 0;
+    for (; x + 8 <= count; x += 8)
+    {
+        sums_low = _mm256_add_pd(sums_low, _mm256_loadu_pd(a + x));
+        sums_high = _mm256_add_pd(sums_high, _mm256_loadu_pd(a + x + 4));
+    }
+    double ret = avx2_combine_partial_sums(sums_low, sums_high);
+    for (; x < count; x++)
+    {
+        ret += a[x];
+    }
+    return ret;
+}
+
+double numeric_kernel_sum_floats(const double *a, size_t count)
+{
+    return cpu_has_avx2() ? avx2_sum_floats(a, count) : generic_sum_floats(a, count);
+}
+
+
+template <bool IsMax>
+static int64_t generic_extreme_int(const int64_t *a, size_t count)
+{
+    int64_t ret = a[0];
+    for (size_t x = 1; x < count; x++)
+    {
+        if (IsMax ? (a[x] > ret) : (a[x] < ret))
+        {
+            ret = a[x];
+        }
+    }
+    return ret;
+}
+
+template <bool IsMax>
+AVX2_FUNCTION static int64_t avx2_extreme_int(const int64_t *a, size_t count)
+{
+    // there's no 64-bit min or max instruction in AVX2, so compare and blend
+    __m256i extremes = _mm256_set1_epi64x(a[0]);
+    size_t x = 0;
+    for (; x + 4 <= count; x += 4)
+    {
+        __m256i items = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + x));
+        __m256i replace = IsMax ? _mm256_cmpgt_epi64(items, extremes) : _mm256_cmpgt_epi64(extremes, items);
+        extremes = _mm256_blendv_epi8(extremes, items, replace);
+    }
+    int64_t candidates[4];
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(candidates), extremes);
+    int64_t ret = generic_extreme_int<IsMax>(candidates, 4);
+    if (x < count)
+    {
+        int64_t rest = generic_extreme_int<IsMax>(a + x, count - x);
+        if (IsMax ? (rest > ret) : (rest < ret))
+        {
+            ret = rest;
+        }
+    }
+    return ret;
+}
+
+int64_t numeric_kernel_min_ints(const int64_t *a, size_t count)
+{
+    return cpu_has_avx2() ? avx2_extreme_int<false>(a, count) : generic_extreme_int<false>(a, count);
+}
+
+int64_t numeric_kernel_max_ints(const int64_t *a, size_t count)
+{
+    return cpu_has_avx2() ? avx2_extreme_int<true>(a, count) : generic_extreme_int<true>(a, count);
+}
+
+
+template <bool IsMax>
+static double generic_extreme_float(const double *a, size_t count)
+{
+    double ret = a[0];
+    for (size_t x = 1; x < count; x++)
+    {
+        if (IsMax ? (a[x] > ret) : (a[x] < ret))
+        {
+            ret = a[x];
+        }
+    }
+    return ret;
+}
+
+template <bool IsMax>
+AVX2_FUNCTION static double avx2_extreme_float(const double *a, size_t count)
+{
+    // minpd and maxpd return the second operand unless the first one compares
+    // less (or greater), which is the same rule as the generic version
+    __m256d extremes = _mm256_set1_pd(a[0]);
+    size_t x = 0;
+    for (; x + 4 <= count; x += 4)
+    {
+        __m256d items = _mm256_loadu_pd(a + x);
+        extremes = IsMax ? _mm256_max_pd(items, extremes) : _mm256_min_pd(items, extremes);
+    }
+    double candidates[4];
+    _mm256_storeu_pd(candidates, extremes);
+    double ret = generic_extreme_float<IsMax>(candidates, 4);
+    for (; x < count; x++)
+    {
+        if (IsMax ? (a[x] > ret) : (a[x] < ret))
+        {
+            ret = a[x];
+        }
+    }
+    return ret;
+}
+
+double numeric_kernel_min_floats(const double *a, size_t count)
+{
+    return cpu_has_avx2() ? avx2_extreme_float<false>(a, count) : generic_extreme_float<false>(a, count);
+}
+
+double numeric_kernel_max_floats(const double *a, size_t count)
+{
+    return cpu_has_avx2() ? avx2_extreme_float<true>(a, count) : generic_extreme_float<true>(a, count);
+}
+
+
+static int64_t generic_dot_ints(const int64_t *a, const int64_t *b, size_t count)
+{
+    int64_t ret = 0;
+    for (size_t x = 0; x < count; x++)
+    {
+        ret = wrapping_add(ret, wrapping_mul(a[x], b[x]));
+    }
+    return ret;
+}
+
+AVX2_FUNCTION static int64_t avx2_dot_ints(const int64_t *a, const int64_t *b, size_t count)
+{
+    __m256i sums = _mm256_setzero_si256();
+    size_t x = 0;
+    for (; x + 4 <= count; x += 4)
+    {
+        sums = _mm256_add_epi64(sums, avx2_mul_epi64(
+                _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + x)),
+                _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + x))));
+    }
+    int64_t partial_sums[4];
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(partial_sums), sums);
+    int64_t ret = generic_sum_ints(partial_sums, 4);
+    return wrapping_add(ret, generic_dot_ints(a + x, b + x, count - x));
+}
+
+int64_t numeric_kernel_dot_ints(const int64_t *a, const int64_t *b, size_t count)
+{
+    return cpu_has_avx2() ? avx2_dot_ints(a, b, count) : generic_dot_ints(a, b, count);
+}
+
+
+// the products are rounded before they're added (there's no fused
+// multiply-add), so this gives the same result with or without AVX2
+static double generic_dot_floats(const double *a, const double *b, size_t count)
+{
+    double sums[8] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+    size_t x = 0;
+    for (; x + 8 <= count; x += 8)
+    {
+        for (size_t y = 0; y < 8; y++)
+        {
+            double product = a[x + y] * b[x + y];
+            sums[y] += product;
+        }
+    }
+    double ret = combine_partial_sums(sums);
+    for (; x < count; x++)
+    {
+        double product = a[x] * b[x];
+        ret += product;
+    }
+    return ret;
+}
+
+AVX2_FUNCTION static double avx2_dot_floats(const double *a, const double *b, size_t count)
+{
+    __m256d sums_low = _mm256_setzero_pd();
+    __m256d sums_high = _mm256_setzero_pd();
+    size_t x = 0;
+    for (; x + 8 <= count; x += 8)
+    {
+        sums_low = _mm256_add_pd(sums_low, _mm256_mul_pd(_mm256_loadu_pd(a + x), _mm256_loadu_pd(b + x)));
+        sums_high = _mm256_add_pd(sums_high, _mm256_mul_pd(_mm256_loadu_pd(a + x + 4), _mm256_loadu_pd(b + x + 4)));
+    }
+    double ret = avx2_combine_partial_sums(sums_low, sums_high);
+    for (; x < count; x++)
+    {
+        double product = a[x] * b[x];
+        ret += product;
+    }
+    return ret;
+}
+
+double numeric_kernel_dot_floats(const double *a, const double *b, size_t count)
+{
+    return cpu_has_avx2() ? avx2_dot_floats(a, b, count) : generic_dot_floats(a, b, count);
+}
+
+
+// the elementwise kernels all have the same shape: an AVX2 loop over 4 items
+// at a time, then the generic loop for the rest
+
+#define DEFINE_ELEMENTWISE_KERNEL(name, type, vector_type, load, store, vector_op, scalar_op) \
+    static void generic_##name(type *dest, const type *a, const type *b, size_t count) \
+    { \
+        for (size_t x = 0; x < count; x++) \
+        { \
+            dest[x] = scalar_op(a[x], b[x]); \
+        } \
+    } \
+    AVX2_FUNCTION static void avx2_##name(type *dest, const type *a, const type *b, size_t count) \
+    { \
+        size_t x = 0; \
+        for (; x + 4 <= count; x += 4) \
+        { \
+            vector_type result = vector_op(load(a + x), load(b + x)); \
+            store(dest + x, result); \
+        } \
+        generic_##name(dest + x, a + x, b + x, count - x); \
+    } \
+    void numeric_kernel_##name(type *dest, const type *a, const type *b, size_t count) \
+    { \
+        if (cpu_has_avx2()) \
+        { \
+            avx2_##name(dest, a, b, count); \
+        } \
+        else \
+        { \
+            generic_##name(dest, a, b, count); \
+        } \
+    }
+
+AVX2_FUNCTION static inline __m256i load_ints(const int64_t *a)
+{
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a));
+}
+
+AVX2_FUNCTION static inline void store_ints(int64_t *dest, __m256i values)
+{
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dest), values);
+}
+
+static inline double scalar_add(double a, double b)
+{
+    return a + b;
+}
+
+static inline double scalar_mul(double a, double b)
+{
+    return a * b;
+}
+
+DEFINE_ELEMENTWISE_KERNEL(add_ints, int64_t, __m256i, load_ints, store_ints, _mm256_add_epi64, wrapping_add)
+DEFINE_ELEMENTWISE_KERNEL(mul_ints, int64_t, __m256i, load_ints, store_ints, avx2_mul_epi64, wrapping_mul)
+DEFINE_ELEMENTWISE_KERNEL(add_floats, double, __m256d, _mm256_loadu_pd, _mm256_storeu_pd, _mm256_add_pd, scalar_add)
+DEFINE_ELEMENTWISE_KERNEL(mul_floats, double, __m256d, _mm256_loadu_pd, _mm256_storeu_pd, _mm256_mul_pd, scalar_mul)
+
+#undef DEFINE_ELEMENTWISE_KERNEL
+
+
+static void generic_scale_ints(int64_t *dest, const int64_t *a, int64_t factor, size_t count)
+{
+    for (size_t x = 0; x < count; x++)
+    {
+        dest[x] = wrapping_mul(a[x], factor);
+    }
+}
+
+AVX2_FUNCTION static void avx2_scale_ints(int64_t *dest, const int64_t *a, int64_t factor, size_t count)
+{
+    __m256i factors = _mm256_set1_epi64x(factor);
+    size_t x = 0;
+    for (; x + 4 <= count; x += 4)
+    {
+        store_ints(dest + x, avx2_mul_epi64(load_ints(a + x), factors));
+    }
+    generic_scale_ints(dest + x, a + x, factor, count - x);
+}
+
+void numeric_kernel_scale_ints(int64_t *dest, const int64_t *a, int64_t factor, size_t count)
+{
+    if (cpu_has_avx2())
+    {
+        avx2_scale_ints(dest, a, factor, count);
+    }
+    else
+    {
+        generic_scale_ints(dest, a, factor, count);
+    }
+}
+
+static void generic_scale_floats(double *dest, const double *a, double factor, size_t count)
+{
+    for (size_t x = 0; x < count; x++)
+    {
+        dest[x] = a[x] * factor;
+    }
+}
+
+AVX2_FUNCTION static void avx2_scale_floats(double *dest, const double *a, double factor, size_t count)
+{
+    __m256d factors = _mm256_set1_pd(factor);
+    size_t x = 0;
+    for (; x + 4 <= count; x += 4)
+    {
+        _mm256_storeu_pd(dest + x, _mm256_mul_pd(_mm256_loadu_pd(a + x), factors));
+    }
+    generic_scale_floats(dest + x, a + x, factor, count - x);
+}
+
+void numeric_kernel_scale_floats(double *dest, const double *a, double factor, size_t count)
+{
+    if (cpu_has_avx2())
+    {
+        avx2_scale_floats(dest, a, factor, count);
+    }
+    else
+    {
+        generic_scale_floats(dest, a, factor, count);
+    }
+}
+
+
+static void generic_prefix_sum_ints(int64_t *dest, const int64_t *a, size_t count,
+                                    int64_t sum = 0)
+{
+    for (size_t x = 0; x < count; x++)
+    {
+        sum = wrapping_add(sum, a[x]);
+        dest[x] = sum;
+    }
+}
+
+AVX2_FUNCTION static void avx2_prefix_sum_ints(int64_t *dest, const int64_t *a, size_t count)
+{
+    // within each group of 4 items, add each item to the next one, then each
+    // pair to the next pair; then add the running total from earlier groups
+    // and broadcast the new total (the last lane) for the next group
+    __m256i zero = _mm256_setzero_si256();
+    __m256i totals = zero;
+    size_t x = 0;
+    for (; x + 4 <= count; x += 4)
+    {
+        __m256i sums = load_ints(a + x);
+        sums = _mm256_add_epi64(sums, _mm256_blend_epi32(
+                _mm256_permute4x64_epi64(sums, _MM_SHUFFLE(2, 1, 0, 0)), zero, 0x03));
+        sums = _mm256_add_epi64(sums, _mm256_blend_epi32(
+                _mm256_permute4x64_epi64(sums, _MM_SHUFFLE(1, 0, 0, 0)), zero, 0x0F));
+        sums = _mm256_add_epi64(sums, totals);
+        store_ints(dest + x, sums);
+        totals = _mm256_permute4x64_epi64(sums, _MM_SHUFFLE(3, 3, 3, 3));
+    }
+    generic_prefix_sum_ints(dest + x, a + x, count - x, x ? dest[x - 1] : 0);
+}
+
+void numeric_kernel_prefix_sum_ints(int64_t *dest, const int64_t *a, size_t count)
+{
+    if (cpu_has_avx2())
+    {
+        avx2_prefix_sum_ints(dest, a, count);
+    }
+    else
+    {
+        generic_prefix_sum_ints(dest, a, count);
+    }
+}
+
+void numeric_kernel_prefix_sum_floats(double *dest, const double *a, size_t count)
+{
+    // start from the first item rather than 0.0, so a leading -0.0 is kept
+    if (!count)
+    {
+        return;
+    }
+    double sum = a[0];
+    dest[0] = sum;
+    for (size_t x = 1; x < count; x++)
+    {
+        sum += a[x];
+        dest[x] = sum;
+    }
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+
+// these are the loops behind the __pyjit_array__ module. they work on the
+// items of Int and Float lists, which are stored as raw 64-bit values. each one
+// has an AVX2 version (which handles 4 or 8 items at a time) and a generic
+// version; the AVX2 version is used if the CPU supports it. the build doesn't
+// assume AVX2, so those versions are compiled with target attributes instead of
+// -mavx2.
+//
+// Int arithmetic wraps around on overflow, like the compiled code does. Float
+// sums and dot products are computed in 8 interleaved partial sums and then
+// combined, so they can differ from a left-to-right sum in the last bits; both
+// versions use the same order, so the result doesn't depend on the CPU. Float
+// prefix sums are computed left to right, since each one depends on the last.
+
+int64_t numeric_kernel_sum_ints(const int64_t *a, size_t count);
+double numeric_kernel_sum_floats(const double *a, size_t count);
+
+// count must not be zero for these. like python's min() and max(), these keep
+// the current value unless an item compares less (or greater), so a NaN item
+// is skipped unless it's the first item
+int64_t numeric_kernel_min_ints(const int64_t *a, size_t count);
+double numeric_kernel_min_floats(const double *a, size_t count);
+int64_t numeric_kernel_max_ints(const int64_t *a, size_t count);
+double numeric_kernel_max_floats(const double *a, size_t count);
+
+int64_t numeric_kernel_dot_ints(const int64_t *a, const int64_t *b, size_t count);
+double numeric_kernel_dot_floats(const double *a, const double *b, size_t count);
+
+// these write count results to dest, which may be the same as a or b
+void numeric_kernel_add_ints(int64_t *dest, const int64_t *a, const int64_t *b,
+                             size_t count);
+void numeric_kernel_add_floats(double *dest, const double *a, const double *b,
+                               size_t count);
+void numeric_kernel_mul_ints(int64_t *dest, const int64_t *a, const int64_t *b,
+                             size_t count);
+void numeric_kernel_mul_floats(double *dest, const double *a, const double *b,
+                               size_t count);
+void numeric_kernel_scale_ints(int64_t *dest, const int64_t *a, int64_t factor,
+                               size_t count);
+void numeric_kernel_scale_floats(double *dest, const double *a, double factor,
+                                 size_t count);
+
+// dest[x] is the sum of a[0] through a[x]
+void numeric_kernel_prefix_sum_ints(int64_t *dest, const int64_t *a, size_t count);
+void numeric_kernel_prefix_sum_floats(double *dest, const double *a, size_t count);
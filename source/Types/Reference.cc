@@ -31,6 +31,20 @@ void *add_reference(void *o)
     return o;
 }
 
+void add_references(void *o, uint64_t count)
+{
+    BasicObject *obj = reinterpret_cast<BasicObject *>(o);
+    if (debug_flags & DebugFlag::ShowRefcountChanges)
+    {
+        fprintf(stderr, "[refcount] %p+=%" PRIu64 " == %" PRId64 "\n", o, count,
+                obj->refcount += count);
+    }
+    else
+    {
+        obj->refcount += count;
+    }
+}
+
 void delete_reference(void *o, ExceptionBlock *exc_block)
 {
     BasicObject *obj = reinterpret_cast<BasicObject *>(o);
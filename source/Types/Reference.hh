@@ -21,4 +21,8 @@ struct BasicObject
 // onto the stack to keep it)
 void *add_reference(void *o);
 
+// adds several references at once, for when the same object is stored in
+// several places (like the items of a repeated list)
+void add_references(void *o, uint64_t count);
+
 void delete_reference(void *o, ExceptionBlock *exc_block = nullptr);
@@ -0,0 +1,354 @@
+#include "Set.hh"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "Instance.hh"
+
+using namespace std;
+
+extern InstanceObject MemoryError_instance;
+
+
+SetObject *set_new(uint64_t (*key_hash)(const void *k),
+                   bool (*key_equal)(const void *a, const void *b), bool items_are_objects,
+                   ExceptionBlock *exc_block)
+{
+    SetObject *s = reinterpret_cast<SetObject *>(malloc(sizeof(SetObject)));
+    if (!s)
+    {
+        raise_python_exception(exc_block, &MemoryError_instance);
+        throw bad_alloc();
+    }
+    s->basic.refcount = 1;
+    s->basic.destructor = set_delete;
+    s->count = 0;
+    s->items_are_objects = items_are_objects;
+    s->key_hash = key_hash ? key_hash : hash_table_default_key_hash;
+    s->key_equal = key_equal;
+    s->capacity = 0;
+    s->growth_left = 0;
+    s->slots = nullptr;
+    s->control = nullptr;
+    return s;
+}
+
+void set_delete(void *s)
+{
+    set_clear(reinterpret_cast<SetObject *>(s));
+    free(s);
+}
+
+
+ssize_t SetObject::find(const void *k, uint64_t hash) const
+{
+    if (!this->capacity)
+    {
+        return -1;
+    }
+
+    int8_t ctrl = hash_table_control_for_hash(hash);
+    size_t group_mask = (this->capacity / hash_table_group_size) - 1;
+    size_t group = hash_table_group_for_hash(hash, this->capacity);
+    for (size_t step = 1; step <= group_mask + 1; step++)
+    {
+        const int8_t *group_control = &this->control[group * hash_table_group_size];
+        for (uint32_t matches = hash_table_match_control(group_control, ctrl); matches;
+             matches &= (matches - 1))
+        {
+            size_t index = group * hash_table_group_size + __builtin_ctz(matches);
+            const Slot &slot = this->slots[index];
+            if ((slot.hash == hash) && ((slot.key == k) ||
+                                        (this->key_equal && this->key_equal(slot.key, k))))
+            {
+                return index;
+            }
+        }
+        if (hash_table_match_control(group_control, hash_table_control_empty))
+        {
+            return -1;
+        }
+        group = (group + step) & group_mask;
+    }
+    return -1;
+}
+
+size_t SetObject::find_insert_position(uint64_t hash) const
+{
+    size_t group_mask = (this->capacity / hash_table_group_size) - 1;
+    size_t group = hash_table_group_for_hash(hash, this->capacity);
+    for (size_t step = 1;; step++)
+    {
+        uint32_t available = hash_table_match_empty_or_deleted(
+                &this->control[group * hash_table_group_size]);
+        if (available)
+        {
+            return group * hash_table_group_size + __builtin_ctz(available);
+        }
+        group = (group + step) & group_mask;
+    }
+}
+
+void SetObject::resize(size_t new_capacity, ExceptionBlock *exc_block)
+{
+    // each Slot is 16 bytes, so the control bytes are 16-byte aligned
+    void *storage = malloc(new_capacity * (sizeof(Slot) + sizeof(int8_t)));
+    if (!storage)
+    {
+        raise_python_exception(exc_block, &MemoryError_instance);
+        throw bad_alloc();
+    }
+
+    Slot *old_slots = this->slots;
+    int8_t *old_control = this->control;
+    size_t old_capacity = this->capacity;
+
+    this->capacity = new_capacity;
+    this->slots = reinterpret_cast<Slot *>(storage);
+    this->control = reinterpret_cast<int8_t *>(&this->slots[new_capacity]);
+    memset(this->control, hash_table_control_empty, new_capacity);
+
+    for (size_t x = 0; x < old_capacity; x++)
+    {
+        if (old_control[x] < 0)
+        {
+            continue;
+        }
+        size_t index = this->find_insert_position(old_slots[x].hash);
+        this->control[index] = old_control[x];
+        this->slots[index] = old_slots[x];
+    }
+
+    this->growth_left = hash_table_max_load(new_capacity) - this->count;
+    free(old_slots);
+}
+
+
+// union and intersection already know the hashes of the items they add, so
+// they call this directly instead of set_add
+static bool set_add_with_hash(SetObject *s, void *k, uint64_t hash,
+                              ExceptionBlock *exc_block)
+{
+    if (s->find(k, hash) >= 0)
+    {
+        return false;
+    }
+
+    if (!s->growth_left)
+    {
+        s->resize(hash_table_next_capacity(s->count, s->capacity), exc_block);
+    }
+
+    size_t index = s->find_insert_position(hash);
+    if (s->control[index] == hash_table_control_empty)
+    {
+        s->growth_left--;
+    }
+    s->control[index] = hash_table_control_for_hash(hash);
+    s->slots[index].key = k;
+    s->slots[index].hash = hash;
+    s->count++;
+
+    if (s->items_are_objects)
+    {
+        add_reference(k);
+    }
+    return true;
+}
+
+bool set_add(SetObject *s, void *k, ExceptionBlock *exc_block)
+{
+    return set_add_with_hash(s, k, s->key_hash(k), exc_block);
+}
+
+bool set_discard(SetObject *s, void *k)
+{
+    ssize_t index = s->find(k, s->key_hash(k));
+    if (index < 0)
+    {
+        return false;
+    }
+
+    void *key = s->slots[index].key;
+    size_t group_start = index & ~(hash_table_group_size - 1);
+    if (hash_table_match_control(&s->control[group_start], hash_table_control_empty))
+    {
+        s->control[index] = hash_table_control_empty;
+        s->growth_left++;
+    }
+    else
+    {
+        s->control[index] = hash_table_control_deleted;
+    }
+    s->count--;
+
+    if (s->items_are_objects)
+    {
+        delete_reference(key);
+    }
+    return true;
+}
+
+void set_clear(SetObject *s)
+{
+    if (!s->capacity)
+    {
+        return;
+    }
+
+    SetObject::Slot *slots = s->slots;
+    int8_t *control = s->control;
+    size_t capacity = s->capacity;
+    s->capacity = 0;
+    s->growth_left = 0;
+    s->count = 0;
+    s->slots = nullptr;
+    s->control = nullptr;
+
+    if (s->items_are_objects)
+    {
+        for (size_t x = 0; x < capacity; x++)
+        {
+            if (control[x] >= 0)
+            {
+                delete_reference(slots[x].key);
+            }
+        }
+    }
+
+    free(slots);
+}
+
+bool set_contains(const SetObject *s, void *k)
+{
+    return s->find(k, s->key_hash(k)) >= 0;
+}
+
+
+SetObject::SlotContents::SlotContents() : key(nullptr), index(0)
+{}
+
+bool set_next_item(const SetObject *s, SetObject::SlotContents *item)
+{
+    size_t index = item->index;
+    while (index < s->capacity)
+    {
+        size_t group_start = index & ~(hash_table_group_size - 1);
+        uint32_t full = hash_table_match_full(&s->control[group_start]);
+        full &= ~((1 << (index - group_start)) - 1);
+        if (full)
+        {
+            index = group_start + __builtin_ctz(full);
+            item->key = s->slots[index].key;
+            item->index = index + 1;
+            return true;
+        }
+        index = group_start + hash_table_group_size;
+    }
+
+    item->index = index;
+    return false;
+}
+
+size_t set_size(const SetObject *s)
+{
+    return s->count;
+}
+
+
+SetObject *set_copy(const SetObject *s, ExceptionBlock *exc_block)
+{
+    SetObject *ret = set_new(s->key_hash, s->key_equal, s->items_are_objects,
+                             exc_block);
+    if (!s->count)
+    {
+        return ret;
+    }
+
+    // the copy has the same capacity, so the slots can be copied directly
+    try
+    {
+        ret->resize(s->capacity, exc_block);
+    } catch (const bad_alloc &)
+    {
+        free(ret);
+        throw;
+    }
+    memcpy(ret->slots, s->slots, s->capacity * sizeof(SetObject::Slot));
+    memcpy(ret->control, s->control, s->capacity);
+    ret->count = s->count;
+    ret->growth_left = s->growth_left;
+
+    if (ret->items_are_objects)
+    {
+        for (size_t x = 0; x < ret->capacity; x++)
+        {
+            if (ret->control[x] >= 0)
+            {
+                add_reference(ret->slots[x].key);
+            }
+        }
+    }
+    return ret;
+}
+
+SetObject *set_union(const SetObject *a, const SetObject *b,
+                     ExceptionBlock *exc_block)
+{
+    // start with a copy of the larger set, then add the items from the smaller
+    // one. the hashes are cached, so we don't need to call key_hash
+    if (a->count < b->count)
+    {
+        const SetObject *t = a;
+        a = b;
+        b = t;
+    }
+
+    SetObject *ret = set_copy(a, exc_block);
+    try
+    {
+        for (size_t x = 0; x < b->capacity; x++)
+        {
+            if (b->control[x] >= 0)
+            {
+                set_add_with_hash(ret, b->slots[x].key, b->slots[x].hash, exc_block);
+            }
+        }
+    } catch (const bad_alloc &)
+    {
+        delete_reference(ret);
+        throw;
+    }
+    return ret;
+}
+
+SetObject *set_intersection(const SetObject *a, const SetObject *b,
+                            ExceptionBlock *exc_block)
+{
+    // iterate over the smaller set and probe the larger one
+    if (a->count > b->count)
+    {
+        const SetObject *t = a;
+        a = b;
+        b = t;
+    }
+
+    SetObject *ret = set_new(a->key_hash, a->key_equal, a->items_are_objects,
+                             exc_block);
+    try
+    {
+        for (size_t x = 0; x < a->capacity; x++)
+        {
+            if ((a->control[x] >= 0) &&
+                (b->find(a->slots[x].key, a->slots[x].hash) >= 0))
+            {
+                set_add_with_hash(ret, a->slots[x].key, a->slots[x].hash, exc_block);
+            }
+        }
+    } catch (const bad_alloc &)
+    {
+        delete_reference(ret);
+        throw;
+    }
+    return ret;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "../Compiler/Exception.hh"
+#include "HashTable.hh"
+#include "Reference.hh"
+
+
+// this has the same layout as DictionaryObject up through the control pointer,
+// but sets are unordered, so the items are stored directly in the hash table's
+// slots instead of in a separate entries array. like dictionaries, Int items
+// are stored unboxed and compared by identity; object items use key_hash and
+// key_equal, and their hashes are cached in the slots
+struct SetObject
+{
+    BasicObject basic;
+
+    uint64_t count;
+    uint64_t items_are_objects;
+
+    uint64_t (*key_hash)(const void *k);
+
+    bool (*key_equal)(const void *a, const void *b);
+
+    struct Slot
+    {
+        void *key;
+        uint64_t hash;
+    };
+
+    uint64_t capacity;
+    uint64_t growth_left;
+    Slot *slots;
+    int8_t *control; // follows the slots in the same allocation
+
+    struct SlotContents
+    {
+        void *key;
+        uint64_t index; // 0 before iteration begins
+
+        SlotContents();
+    };
+
+    ssize_t find(const void *k, uint64_t hash) const;
+
+    size_t find_insert_position(uint64_t hash) const;
+
+    void resize(size_t new_capacity, ExceptionBlock *exc_block = nullptr);
+};
+
+SetObject *set_new(uint64_t (*key_hash)(const void *k),
+                   bool (*key_equal)(const void *a, const void *b), bool items_are_objects,
+                   ExceptionBlock *exc_block = nullptr);
+
+void set_delete(void *s);
+
+// returns true if the item was added (that is, it wasn't already present)
+bool set_add(SetObject *s, void *k, ExceptionBlock *exc_block = nullptr);
+
+// returns true if the item was removed
+bool set_discard(SetObject *s, void *k);
+
+void set_clear(SetObject *s);
+
+bool set_contains(const SetObject *s, void *k);
+
+bool set_next_item(const SetObject *s, SetObject::SlotContents *item);
+
+size_t set_size(const SetObject *s);
+
+SetObject *set_copy(const SetObject *s, ExceptionBlock *exc_block = nullptr);
+
+SetObject *set_union(const SetObject *a, const SetObject *b,
+                     ExceptionBlock *exc_block = nullptr);
+
+SetObject *set_intersection(const SetObject *a, const SetObject *b,
+                            ExceptionBlock *exc_block = nullptr);
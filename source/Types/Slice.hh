@@ -0,0 +1,50 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+
+// slices are compiled into calls that take the start, end and step as Ints.
+// bounds that were omitted (like the end in x[1:]) are passed as this value,
+// which can't be confused with a real index since it's out of range for any
+// object that fits in memory
+static constexpr int64_t slice_index_missing = INT64_MIN;
+
+// converts python slice bounds into the index of the first item and the number
+// of items in the slice, for a sequence of the given size. out-of-range bounds
+// are clamped, like in python. step must not be zero
+static inline size_t slice_adjust_indices(size_t size, int64_t *start, int64_t end,
+                                          int64_t step)
+{
+    int64_t count = static_cast<int64_t>(size);
+    auto clamp = [&](int64_t index, int64_t missing_value) -> int64_t {
+        if (index == slice_index_missing)
+        {
+            return missing_value;
+        }
+        if (index < 0)
+        {
+            index += count;
+            if (index < 0)
+            {
+                return (step < 0) ? -1 : 0;
+            }
+        }
+        else if (index >= count)
+        {
+            return (step < 0) ? (count - 1) : count;
+        }
+        return index;
+    };
+
+    // the defaults for a negative step go backward from the last item to the
+    // first (the end is -1, which means before the first item, not the last)
+    *start = clamp(*start, (step < 0) ? (count - 1) : 0);
+    end = clamp(end, (step < 0) ? -1 : count);
+
+    if (step < 0)
+    {
+        return (end < *start) ? ((*start - end - 1) / (-step) + 1) : 0;
+    }
+    return (*start < end) ? ((end - *start - 1) / step + 1) : 0;
+}
@@ -0,0 +1,352 @@
+#pragma once
+
+#include <emmintrin.h>
+#include <stdint.h>
+#include <string.h>
+
+
+// these are the byte-level loops behind the bytes and str methods. they work on
+// raw bytes, so they're used directly for Bytes and Latin1 Unicode objects, and
+// for substring search in wider Unicode objects too (the caller has to check
+// that matches are aligned to a character boundary). each one handles 16 bytes
+// at a time with SSE2 (which every AMD64 CPU has) and finishes the last few
+// bytes one at a time.
+
+// returns the offset of the first occurrence of needle in haystack, or -1.
+// candidate positions are found by comparing the first and last bytes of the
+// needle against 16 positions at once; only positions where both match are
+// compared in full
+static inline ssize_t string_kernel_find(const uint8_t *haystack, size_t haystack_size,
+                                         const uint8_t *needle, size_t needle_size)
+{
+    if (needle_size == 0)
+    {
+        return 0;
+    }
+    if (needle_size > haystack_size)
+    {
+        return -1;
+    }
+    if (needle_size == 1)
+    {
+        const void *p = memchr(haystack, needle[0], haystack_size);
+        return p ? (reinterpret_cast<const uint8_t *>(p) - haystack) : -1;
+    }
+
+    size_t end = haystack_size - needle_size + 1; // one past the last possible start
+    __m128i first = _mm_set1_epi8(needle[0]);
+    __m128i last = _mm_set1_epi8(needle[needle_size - 1]);
+    size_t x = 0;
+    for (; x + 16 <= end; x += 16)
+    {
+        __m128i block_first = _mm_loadu_si128(reinterpret_cast<const __m128i *>(haystack + x));
+        __m128i block_last = _mm_loadu_si128(reinterpret_cast<const __m128i *>(
+                haystack + x + needle_size - 1));
+        uint32_t matches = _mm_movemask_epi8(_mm_and_si128(
+                _mm_cmpeq_epi8(block_first, first), _mm_cmpeq_epi8(block_last, last)));
+        for (; matches; matches &= (matches - 1))
+        {
+            size_t offset = x + __builtin_ctz(matches);
+            if (!memcmp(haystack + offset + 1, needle + 1, needle_size - 2))
+            {
+                return offset;
+            }
+        }
+    }
+    for (; x < end; x++)
+    {
+        if ((haystack[x] == needle[0]) && !memcmp(haystack + x + 1, needle + 1, needle_size - 1))
+        {
+            return x;
+        }
+    }
+    return -1;
+}
+
+// returns the offset of the first byte that differs between a and b, or size
+// if there isn't one. 16 bytes are compared at once, and the offset within a
+// block comes from the lowest bit of the inverted equality mask
+static inline size_t string_kernel_first_difference(const uint8_t *a, const uint8_t *b,
+                                                    size_t size)
+{
+    size_t x = 0;
+    for (; x + 16 <= size; x += 16)
+    {
+        __m128i block_a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + x));
+        __m128i block_b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + x));
+        uint32_t differences = ~_mm_movemask_epi8(_mm_cmpeq_epi8(block_a, block_b)) & 0xFFFF;
+        if (differences)
+        {
+            return x + __builtin_ctz(differences);
+        }
+    }
+    if (x + 8 <= size)
+    {
+        uint64_t word_a, word_b;
+        memcpy(&word_a, a + x, 8);
+        memcpy(&word_b, b + x, 8);
+        if (word_a != word_b)
+        {
+            return x + (__builtin_ctzll(word_a ^ word_b) >> 3);
+        }
+        x += 8;
+    }
+    for (; x < size; x++)
+    {
+        if (a[x] != b[x])
+        {
+            return x;
+        }
+    }
+    return size;
+}
+
+// returns true if ch is whitespace. for bytes, this is the ascii whitespace
+// characters; str also has a few more in the Latin1 range and some above it
+static inline bool string_kernel_is_whitespace(uint32_t ch, bool is_unicode)
+{
+    if ((ch == ' ') || ((ch >= '\t') && (ch <= '\r')))
+    {
+        return true;
+    }
+    if (!is_unicode)
+    {
+        return false;
+    }
+    if (ch < 0x100)
+    {
+        return ((ch >= 0x1C) && (ch <= 0x1F)) || (ch == 0x85) || (ch == 0xA0);
+    }
+    return (ch == 0x1680) || ((ch >= 0x2000) && (ch <= 0x200A)) || (ch == 0x2028) ||
+           (ch == 0x2029) || (ch == 0x202F) || (ch == 0x205F) || (ch == 0x3000);
+}
+
+// returns a bit for each of the 16 bytes at p that's whitespace
+static inline uint32_t string_kernel_whitespace_mask(const uint8_t *p, bool is_unicode)
+{
+    // (ch - low) <= (high - low) as unsigned bytes is a range check; SSE2
+    // doesn't have unsigned byte compares, but min + cmpeq does the same thing
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+    __m128i shifted = _mm_sub_epi8(v, _mm_set1_epi8('\t'));
+    __m128i ws = _mm_cmpeq_epi8(_mm_min_epu8(shifted, _mm_set1_epi8('\r' - '\t')), shifted);
+    ws = _mm_or_si128(ws, _mm_cmpeq_epi8(v, _mm_set1_epi8(' ')));
+    if (is_unicode)
+    {
+        shifted = _mm_sub_epi8(v, _mm_set1_epi8(0x1C));
+        ws = _mm_or_si128(ws, _mm_cmpeq_epi8(_mm_min_epu8(shifted, _mm_set1_epi8(3)), shifted));
+        ws = _mm_or_si128(ws, _mm_cmpeq_epi8(v, _mm_set1_epi8(static_cast<char>(0x85))));
+        ws = _mm_or_si128(ws, _mm_cmpeq_epi8(v, _mm_set1_epi8(static_cast<char>(0xA0))));
+    }
+    return _mm_movemask_epi8(ws);
+}
+
+// returns the index of the first byte in [start, end) that is (or isn't, if
+// whitespace is false) whitespace, or end if there isn't one
+static inline size_t string_kernel_skip(const uint8_t *data, size_t start, size_t end,
+                                        bool whitespace, bool is_unicode)
+{
+    size_t x = start;
+    for (; x + 16 <= end; x += 16)
+    {
+        uint32_t mask = string_kernel_whitespace_mask(data + x, is_unicode);
+        if (!whitespace)
+        {
+            mask = ~mask & 0xFFFF;
+        }
+        if (mask)
+        {
+            return x + __builtin_ctz(mask);
+        }
+    }
+    for (; x < end; x++)
+    {
+        if (string_kernel_is_whitespace(data[x], is_unicode) == whitespace)
+        {
+            return x;
+        }
+    }
+    return end;
+}
+
+// returns the end of [start, end) after removing any whitespace at the end
+static inline size_t string_kernel_rskip_whitespace(const uint8_t *data, size_t start,
+                                                    size_t end, bool is_unicode)
+{
+    size_t x = end;
+    for (; x >= start + 16; x -= 16)
+    {
+        uint32_t mask = ~string_kernel_whitespace_mask(data + x - 16, is_unicode) & 0xFFFF;
+        if (mask)
+        {
+            return x - 16 + (32 - __builtin_clz(mask));
+        }
+    }
+    for (; (x > start) && string_kernel_is_whitespace(data[x - 1], is_unicode); x--)
+    {}
+    return x;
+}
+
+// returns the number of ascii bytes at the start of data. 32 bytes are checked
+// per step; when a block has a non-ascii byte in it, the 16-byte halves are
+// checked to find which byte it is
+static inline size_t string_kernel_ascii_prefix(const uint8_t *data, size_t size)
+{
+    size_t x = 0;
+    for (; x + 32 <= size; x += 32)
+    {
+        __m128i block_a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + x));
+        __m128i block_b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + x + 16));
+        if (_mm_movemask_epi8(_mm_or_si128(block_a, block_b)))
+        {
+            break;
+        }
+    }
+    for (; x + 16 <= size; x += 16)
+    {
+        uint32_t high = _mm_movemask_epi8(_mm_loadu_si128(
+                reinterpret_cast<const __m128i *>(data + x)));
+        if (high)
+        {
+            return x + __builtin_ctz(high);
+        }
+    }
+    for (; (x < size) && !(data[x] & 0x80); x++)
+    {}
+    return x;
+}
+
+// returns true if none of the bytes have the high bit set
+static inline bool string_kernel_is_ascii(const uint8_t *data, size_t size)
+{
+    return string_kernel_ascii_prefix(data, size) == size;
+}
+
+// returns the number of bytes that have the high bit set
+static inline size_t string_kernel_count_non_ascii(const uint8_t *data, size_t size)
+{
+    size_t count = 0;
+    size_t x = 0;
+    for (; x + 16 <= size; x += 16)
+    {
+        count += __builtin_popcount(_mm_movemask_epi8(_mm_loadu_si128(
+                reinterpret_cast<const __m128i *>(data + x))));
+    }
+    for (; x < size; x++)
+    {
+        count += data[x] >> 7;
+    }
+    return count;
+}
+
+// copies the ascii characters at the start of src (UCS2 characters) to dest
+// as bytes, stopping at the first character above 0x7F. returns the number of
+// characters copied. 16 characters (32 bytes) are checked and narrowed per step
+static inline size_t string_kernel_narrow_ascii_ucs2(uint8_t *dest, const uint16_t *src,
+                                                     size_t count)
+{
+    __m128i high_mask = _mm_set1_epi16(static_cast<int16_t>(0xFF80));
+    __m128i zero = _mm_setzero_si128();
+    size_t x = 0;
+    for (; x + 16 <= count; x += 16)
+    {
+        __m128i block_a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + x));
+        __m128i block_b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + x + 8));
+        __m128i high = _mm_and_si128(_mm_or_si128(block_a, block_b), high_mask);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi16(high, zero)) != 0xFFFF)
+        {
+            break;
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + x), _mm_packus_epi16(block_a, block_b));
+    }
+    for (; (x < count) && (src[x] < 0x80); x++)
+    {
+        dest[x] = src[x];
+    }
+    return x;
+}
+
+// decodes the utf-8 sequence at the start of data, which must begin with a
+// non-ascii byte; size is the number of bytes available. returns the length
+// of the sequence and sets *ch to the character it encodes. if the sequence
+// isn't valid (it's overlong, encodes a surrogate or a value above 0x10FFFF,
+// or is cut off), returns 0 and sets *ch to the number of bytes that could
+// begin a valid sequence (at least 1), which python uses in error messages
+static inline size_t string_kernel_utf8_decode(const uint8_t *data, size_t size, uint32_t *ch)
+{
+    // the second byte's range depends on the first byte; this is how
+    // overlong sequences, surrogates and out-of-range values are rejected
+    uint8_t lead = data[0];
+    uint8_t low = 0x80, high = 0xBF;
+    size_t length;
+    uint32_t value;
+    if (lead < 0xC2)
+    {
+        *ch = 1;
+        return 0;
+    }
+    else if (lead < 0xE0)
+    {
+        length = 2;
+        value = lead & 0x1F;
+    }
+    else if (lead < 0xF0)
+    {
+        length = 3;
+        value = lead & 0x0F;
+        low = (lead == 0xE0) ? 0xA0 : 0x80;
+        high = (lead == 0xED) ? 0x9F : 0xBF;
+    }
+    else if (lead < 0xF5)
+    {
+        length = 4;
+        value = lead & 0x07;
+        low = (lead == 0xF0) ? 0x90 : 0x80;
+        high = (lead == 0xF4) ? 0x8F : 0xBF;
+    }
+    else
+    {
+        *ch = 1;
+        return 0;
+    }
+
+    for (size_t x = 1; x < length; x++)
+    {
+        if ((x >= size) || (data[x] < low) || (data[x] > high))
+        {
+            *ch = x;
+            return 0;
+        }
+        value = (value << 6) | (data[x] & 0x3F);
+        low = 0x80;
+        high = 0xBF;
+    }
+    *ch = value;
+    return length;
+}
+
+// copies size bytes from src to dest, converting ascii letters to uppercase
+// or lowercase. other bytes are copied unchanged
+static inline void string_kernel_ascii_case(uint8_t *dest, const uint8_t *src, size_t size,
+                                            bool to_upper)
+{
+    // the letters to convert are a 26-byte range, and flipping 0x20 converts
+    // them to the other case
+    char first = to_upper ? 'a' : 'A';
+    __m128i first_vec = _mm_set1_epi8(first);
+    __m128i range_vec = _mm_set1_epi8(25);
+    __m128i flip_vec = _mm_set1_epi8(0x20);
+    size_t x = 0;
+    for (; x + 16 <= size; x += 16)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + x));
+        __m128i shifted = _mm_sub_epi8(v, first_vec);
+        __m128i in_range = _mm_cmpeq_epi8(_mm_min_epu8(shifted, range_vec), shifted);
+        v = _mm_xor_si128(v, _mm_and_si128(in_range, flip_vec));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + x), v);
+    }
+    for (; x < size; x++)
+    {
+        uint8_t ch = src[x];
+        dest[x] = (static_cast<uint8_t>(ch - first) < 26) ? (ch ^ 0x20) : ch;
+    }
+}
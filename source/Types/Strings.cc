@@ -1,10 +1,18 @@
 #include "Strings.hh"
 
 #include <inttypes.h>
+#include <locale.h>
 #include <stdlib.h>
 #include <string.h>
+#include <wctype.h>
+
+#include <algorithm>
+
+#include <phosg/Strings.hh>
 
 #include "../Debug.hh"
+#include "Set.hh"
+#include "StringKernels.hh"
 #include "../Compiler/BuiltinFunctions.hh"
 
 using namespace std;
@@ -12,7 +20,155 @@ using namespace std;
 
 extern shared_ptr<GlobalContext> global;
 
-BytesObject::BytesObject() : basic(free), count(0)
+// this is a word-at-a-time hash in the style of wyhash: 16 bytes are consumed
+// per iteration, and each pair of words is mixed with a single 64x64->128-bit
+// multiply. it's much faster than a bytewise hash like fnv1a for anything
+// longer than a few characters, and mixes well enough for hash tables
+static const uint64_t string_hash_secret[3] = {
+        0xA0761D6478BD642F, 0xE7037ED1A0B428DB, 0x8EBC6AF09C88C6E3};
+
+static inline uint64_t string_hash_mix(uint64_t a, uint64_t b)
+{
+    __uint128_t r = static_cast<__uint128_t>(a) * b;
+    return static_cast<uint64_t>(r) ^ static_cast<uint64_t>(r >> 64);
+}
+
+static inline uint64_t string_hash_read64(const uint8_t *p)
+{
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static uint64_t string_hash(const void *data, size_t size)
+{
+    const uint8_t *p = reinterpret_cast<const uint8_t *>(data);
+    uint64_t seed = string_hash_secret[0] ^ size;
+
+    size_t remaining = size;
+    while (remaining > 16)
+    {
+        seed = string_hash_mix(string_hash_read64(p) ^ string_hash_secret[1],
+                               string_hash_read64(p + 8) ^ seed);
+        p += 16;
+        remaining -= 16;
+    }
+
+    // the last 1-16 bytes are read as two (possibly overlapping) words
+    uint64_t a = 0, b = 0;
+    if (remaining >= 8)
+    {
+        a = string_hash_read64(p);
+        b = string_hash_read64(p + remaining - 8);
+    }
+    else if (remaining >= 4)
+    {
+        uint32_t lo, hi;
+        memcpy(&lo, p, sizeof(lo));
+        memcpy(&hi, p + remaining - 4, sizeof(hi));
+        a = (static_cast<uint64_t>(lo) << 32) | hi;
+    }
+    else if (remaining)
+    {
+        a = (static_cast<uint64_t>(p[0]) << 16) |
+            (static_cast<uint64_t>(p[remaining >> 1]) << 8) | p[remaining - 1];
+    }
+
+    uint64_t h = string_hash_mix(a ^ string_hash_secret[1], b ^ seed);
+    h = string_hash_mix(h ^ string_hash_secret[2], size ^ string_hash_secret[1]);
+
+    // 0 means the hash hasn't been computed yet
+    return h ? h : 1;
+}
+
+// returns the index (in characters) of the first occurrence of needle in
+// haystack at or after start, or -1. both must be of the given kind
+static ssize_t string_find_chars(const uint8_t *haystack, size_t haystack_count,
+                                 const uint8_t *needle, size_t needle_count, size_t kind, size_t start)
+{
+    size_t haystack_size = haystack_count * kind;
+    size_t offset = start * kind;
+    for (;;)
+    {
+        ssize_t found = string_kernel_find(haystack + offset, haystack_size - offset,
+                                           needle, needle_count * kind);
+        if (found < 0)
+        {
+            return -1;
+        }
+        // in wide strings, matches that don't start on a character boundary
+        // don't count
+        offset += found;
+        if (!(offset % kind))
+        {
+            return offset / kind;
+        }
+        offset++;
+    }
+}
+
+// returns the (start, count) of each piece of haystack between occurrences of
+// sep. sep must not be empty
+static vector<pair<size_t, size_t>> string_split_chars(const uint8_t *haystack,
+                                                       size_t haystack_count, const uint8_t *sep, size_t sep_count,
+                                                       size_t kind)
+{
+    vector<pair<size_t, size_t>> ret;
+    size_t start = 0;
+    for (ssize_t found = string_find_chars(haystack, haystack_count, sep, sep_count, kind, 0);
+         found >= 0;
+         found = string_find_chars(haystack, haystack_count, sep, sep_count, kind, start))
+    {
+        ret.emplace_back(start, found - start);
+        start = found + sep_count;
+    }
+    ret.emplace_back(start, haystack_count - start);
+    return ret;
+}
+
+// returns the (start, count) of each run of non-whitespace characters in the
+// given byte string (which is either a Bytes object or a Latin1 Unicode object)
+static vector<pair<size_t, size_t>> string_split_whitespace_bytes(const uint8_t *data,
+                                                                  size_t count, bool is_unicode)
+{
+    vector<pair<size_t, size_t>> ret;
+    size_t start = string_kernel_skip(data, 0, count, false, is_unicode);
+    while (start < count)
+    {
+        size_t end = string_kernel_skip(data, start, count, true, is_unicode);
+        ret.emplace_back(start, end - start);
+        start = string_kernel_skip(data, end, count, false, is_unicode);
+    }
+    return ret;
+}
+
+// returns the positions at which old occurs in s (in characters). if old is
+// empty, this is every position, including the end
+static vector<size_t> string_replace_positions(const uint8_t *data, size_t count,
+                                               const uint8_t *old, size_t old_count, size_t kind)
+{
+    vector<size_t> ret;
+    if (!old_count)
+    {
+        ret.reserve(count + 1);
+        for (size_t x = 0; x <= count; x++)
+        {
+            ret.emplace_back(x);
+        }
+        return ret;
+    }
+    for (ssize_t found = string_find_chars(data, count, old, old_count, kind, 0);
+         found >= 0;
+         found = string_find_chars(data, count, old, old_count, kind, found + old_count))
+    {
+        ret.emplace_back(found);
+    }
+    return ret;
+}
+
+
+BytesObject::BytesObject() : basic(free), count(0), hash(0), flags(0),
+                             capacity(0)
 {}
 
 BytesObject *bytes_new(const char *data, ssize_t count,
@@ -33,6 +189,9 @@ BytesObject *bytes_new(const char *data, ssize_t count,
     s->basic.refcount = 1;
     s->basic.destructor = free;
     s->count = count;
+    s->hash = 0;
+    s->flags = 0;
+    s->capacity = count;
     if (data)
     {
         memcpy(s->data, data, sizeof(char) * count);
@@ -67,6 +226,52 @@ BytesObject *bytes_concat(const BytesObject *a, const BytesObject *b,
     return s;
 }
 
+// returns the capacity to use when growing a string in place to hold count
+// characters. growing by at least half each time keeps the total amount of
+// copying linear in the final size
+static size_t string_append_capacity(size_t current_capacity, size_t count)
+{
+    return max<size_t>(count, current_capacity + (current_capacity >> 1) + 16);
+}
+
+void bytes_append(BytesObject **slot, BytesObject *a, BytesObject *b,
+                  ExceptionBlock *exc_block)
+{
+    // if only x refers to a, the caller's reference is the second one
+    if ((*slot != a) || (a->basic.refcount != 2))
+    {
+        BytesObject *previous = *slot;
+        *slot = bytes_concat(a, b, exc_block);
+        delete_reference(previous);
+        delete_reference(a);
+        delete_reference(b);
+        return;
+    }
+    delete_reference(a);
+
+    size_t count = a->count + b->count;
+    if (count > a->capacity)
+    {
+        size_t capacity = string_append_capacity(a->capacity, count);
+        BytesObject *resized = reinterpret_cast<BytesObject *>(realloc(a,
+                sizeof(BytesObject) + sizeof(char) * (capacity + 1)));
+        if (!resized)
+        {
+            delete_reference(b);
+            raise_python_exception(exc_block, &MemoryError_instance);
+            throw bad_alloc();
+        }
+        a = resized;
+        a->capacity = capacity;
+        *slot = a;
+    }
+    memcpy(&a->data[a->count], b->data, sizeof(char) * b->count);
+    a->count = count;
+    a->data[count] = 0;
+    a->hash = 0;
+    delete_reference(b);
+}
+
 char bytes_at(const BytesObject *s, size_t which,
               ExceptionBlock *exc_block)
 {
@@ -86,45 +291,84 @@ size_t bytes_length(const BytesObject *s)
 
 bool bytes_equal(const BytesObject *a, const BytesObject *b)
 {
+    if (a == b)
+    {
+        return true;
+    }
+    if (a->flags & b->flags & StringFlag::Interned)
+    {
+        return false;
+    }
     if (a->count != b->count)
     {
         return false;
     }
-    return !memcmp(a->data, b->data, a->count * sizeof(a->data[0]));
+    if (a->hash && b->hash && (a->hash != b->hash))
+    {
+        return false;
+    }
+    return string_kernel_first_difference(reinterpret_cast<const uint8_t *>(a->data),
+                                          reinterpret_cast<const uint8_t *>(b->data),
+                                          a->count) == a->count;
+}
+
+uint64_t bytes_hash(const BytesObject *s)
+{
+    if (!s->hash)
+    {
+        const_cast<BytesObject *>(s)->hash = string_hash(s->data,
+                                                  s->count * sizeof(s->data[0]));
+    }
+    return s->hash;
 }
 
 int64_t bytes_compare(const BytesObject *a, const BytesObject *b)
 {
-    for (size_t x = 0; (x < a->count) && (x < b->count); x++)
+    // bytes are compared as unsigned values
+    const uint8_t *a_data = reinterpret_cast<const uint8_t *>(a->data);
+    const uint8_t *b_data = reinterpret_cast<const uint8_t *>(b->data);
+    size_t count = min(a->count, b->count);
+    size_t x = string_kernel_first_difference(a_data, b_data, count);
+    if (x < count)
     {
-        if (a->data[x] < b->data[x])
-        {
-            return -1;
-        }
-        if (a->data[x] > b->data[x])
-        {
-            return 1;
-        }
+        return (a_data[x] < b_data[x]) ? -1 : 1;
     }
     if (a->count == b->count)
     {
         return 0;
     }
-    if (a->count < b->count)
-    {
-        return -1;
-    }
-    return 1;
+    return (a->count < b->count) ? -1 : 1;
 }
 
 bool bytes_contains(const BytesObject *haystack, const BytesObject *needle)
 {
-    if (needle->count == 0)
+    return bytes_find(haystack, needle) >= 0;
+}
+
+BytesObject *bytes_intern(BytesObject *s, ExceptionBlock *exc_block)
+{
+    if (s->flags & StringFlag::Interned)
     {
-        return true;
+        return s;
     }
-    return !!memmem(haystack->data, haystack->count * sizeof(char),
-                    needle->data, needle->count * sizeof(char));
+
+    static SetObject *table = set_new(
+            reinterpret_cast<uint64_t (*)(const void *)>(bytes_hash),
+            reinterpret_cast<bool (*)(const void *, const void *)>(bytes_equal),
+            true, exc_block);
+
+    ssize_t index = table->find(s, bytes_hash(s));
+    if (index >= 0)
+    {
+        BytesObject *ret = reinterpret_cast<BytesObject *>(table->slots[index].key);
+        add_reference(ret);
+        delete_reference(s);
+        return ret;
+    }
+
+    set_add(table, s, exc_block);
+    s->flags |= StringFlag::Interned;
+    return s;
 }
 
 string bytes_to_cxx_string(const BytesObject *s)
@@ -132,171 +376,1452 @@ string bytes_to_cxx_string(const BytesObject *s)
     return string(reinterpret_cast<const char *>(s->data), s->count);
 }
 
-
-UnicodeObject::UnicodeObject() : basic(free), count(0)
-{}
-
-UnicodeObject *unicode_new(const wchar_t *data, ssize_t count,
-                           ExceptionBlock *exc_block)
+// raises ValueError if a slice's step is zero
+static void check_slice_step(int64_t step, ExceptionBlock *exc_block)
 {
-    if (count < 0)
-    {
-        count = wcslen(data);
-    }
-    size_t size = sizeof(UnicodeObject) + sizeof(wchar_t) * (count + 1);
-    UnicodeObject *s = reinterpret_cast<UnicodeObject *>(malloc(size));
-    if (!s)
+    if (!step)
     {
-        raise_python_exception(exc_block, &MemoryError_instance);
-        throw bad_alloc();
+        raise_python_exception_with_message(exc_block, global->ValueError_class_id,
+                                            "slice step cannot be zero");
+        throw invalid_argument("slice step cannot be zero");
     }
-    s->basic.refcount = 1;
-    s->basic.destructor = free;
-    s->count = count;
-    if (data)
+}
+
+BytesObject *bytes_slice(BytesObject *s, int64_t start, int64_t end, int64_t step,
+                         ExceptionBlock *exc_block)
+{
+    check_slice_step(step, exc_block);
+    size_t count = slice_adjust_indices(s->count, &start, end, step);
+    if (step == 1)
     {
-        memcpy(s->data, data, sizeof(wchar_t) * count);
-        s->data[s->count] = 0;
-        if (debug_flags & DebugFlag::ShowRefcountChanges)
+        if (count == s->count)
         {
-            fprintf(stderr, "[refcount:create] created Unicode object %p: %ls\n",
-                    s, data);
+            add_reference(s);
+            return s;
         }
+        return bytes_new(&s->data[start], count, exc_block);
     }
-    else if (debug_flags & DebugFlag::ShowRefcountChanges)
+
+    BytesObject *ret = bytes_new(nullptr, count, exc_block);
+    for (size_t x = 0; x < count; x++, start += step)
     {
-        fprintf(stderr, "[refcount:create] created Unicode object %p with %zd chars\n",
-                s, count);
+        ret->data[x] = s->data[start];
     }
+    ret->data[count] = 0;
+    return ret;
+}
 
-    return s;
+int64_t bytes_find(const BytesObject *s, const BytesObject *sub)
+{
+    return string_find_chars(reinterpret_cast<const uint8_t *>(s->data), s->count,
+                             reinterpret_cast<const uint8_t *>(sub->data), sub->count, 1, 0);
 }
 
-UnicodeObject *unicode_from_cxx_wstring(const wstring &data)
+int64_t bytes_count(const BytesObject *s, const BytesObject *sub)
 {
-    return unicode_new(data.data(), data.size());
+    if (!sub->count)
+    {
+        return s->count + 1;
+    }
+    return string_replace_positions(reinterpret_cast<const uint8_t *>(s->data), s->count,
+                                    reinterpret_cast<const uint8_t *>(sub->data), sub->count, 1).size();
 }
 
-UnicodeObject *unicode_concat(const UnicodeObject *a, const UnicodeObject *b,
-                              ExceptionBlock *exc_block)
+bool bytes_startswith(const BytesObject *s, const BytesObject *prefix)
 {
-    uint64_t count = a->count + b->count;
-    UnicodeObject *s = unicode_new(nullptr, count, exc_block);
-    memcpy(s->data, a->data, sizeof(wchar_t) * a->count);
-    memcpy(&s->data[a->count], b->data, sizeof(wchar_t) * b->count);
-    s->data[s->count] = 0;
-    return s;
+    return (prefix->count <= s->count) && !memcmp(s->data, prefix->data, prefix->count);
 }
 
-wchar_t unicode_at(const UnicodeObject *s, size_t which,
-                   ExceptionBlock *exc_block)
+bool bytes_endswith(const BytesObject *s, const BytesObject *suffix)
 {
-    if (which >= s->count)
-    {
-        raise_python_exception_with_message(exc_block, global->IndexError_class_id,
-                                            "unicode index out of range");
-        throw out_of_range("index out of range for unicode object");
-    }
-    return s->data[which];
+    return (suffix->count <= s->count) &&
+           !memcmp(&s->data[s->count - suffix->count], suffix->data, suffix->count);
 }
 
-size_t unicode_length(const UnicodeObject *s)
+BytesObject *bytes_strip(const BytesObject *s, bool left, bool right,
+                         ExceptionBlock *exc_block)
 {
-    return s->count;
+    const uint8_t *data = reinterpret_cast<const uint8_t *>(s->data);
+    size_t start = left ? string_kernel_skip(data, 0, s->count, false, false) : 0;
+    size_t end = right ? string_kernel_rskip_whitespace(data, start, s->count, false) : s->count;
+    return bytes_new(&s->data[start], end - start, exc_block);
 }
 
-bool unicode_equal(const UnicodeObject *a, const UnicodeObject *b)
+static BytesObject *bytes_change_case(const BytesObject *s, bool to_upper,
+                                      ExceptionBlock *exc_block)
 {
-    if (a->count != b->count)
+    BytesObject *ret = bytes_new(nullptr, s->count, exc_block);
+    string_kernel_ascii_case(reinterpret_cast<uint8_t *>(ret->data),
+                             reinterpret_cast<const uint8_t *>(s->data), s->count, to_upper);
+    ret->data[ret->count] = 0;
+    return ret;
+}
+
+BytesObject *bytes_lower(const BytesObject *s, ExceptionBlock *exc_block)
+{
+    return bytes_change_case(s, false, exc_block);
+}
+
+BytesObject *bytes_upper(const BytesObject *s, ExceptionBlock *exc_block)
+{
+    return bytes_change_case(s, true, exc_block);
+}
+
+BytesObject *bytes_replace(const BytesObject *s, const BytesObject *old,
+                           const BytesObject *new_s, ExceptionBlock *exc_block)
+{
+    auto positions = string_replace_positions(
+            reinterpret_cast<const uint8_t *>(s->data), s->count,
+            reinterpret_cast<const uint8_t *>(old->data), old->count, 1);
+
+    // the result's size is known exactly, so it's allocated only once
+    BytesObject *ret = bytes_new(nullptr,
+                                 s->count + positions.size() * new_s->count - positions.size() * old->count,
+                                 exc_block);
+    char *dest = ret->data;
+    size_t prev_end = 0;
+    for (size_t position: positions)
     {
-        return false;
+        memcpy(dest, &s->data[prev_end], position - prev_end);
+        dest += position - prev_end;
+        memcpy(dest, new_s->data, new_s->count);
+        dest += new_s->count;
+        prev_end = position + old->count;
     }
-    return !memcmp(a->data, b->data, a->count * sizeof(a->data[0]));
+    memcpy(dest, &s->data[prev_end], s->count - prev_end);
+    ret->data[ret->count] = 0;
+    return ret;
 }
 
-int64_t unicode_compare(const UnicodeObject *a, const UnicodeObject *b)
+ListObject *bytes_split(const BytesObject *s, const BytesObject *sep,
+                        ExceptionBlock *exc_block)
 {
-    for (size_t x = 0; (x < a->count) && (x < b->count); x++)
+    const uint8_t *data = reinterpret_cast<const uint8_t *>(s->data);
+    vector<pair<size_t, size_t>> pieces;
+    if (!sep)
     {
-        if (a->data[x] < b->data[x])
-        {
-            return -1;
-        }
-        if (a->data[x] > b->data[x])
-        {
-            return 1;
-        }
+        pieces = string_split_whitespace_bytes(data, s->count, false);
     }
-    if (a->count == b->count)
+    else if (!sep->count)
     {
-        return 0;
+        raise_python_exception_with_message(exc_block, global->ValueError_class_id,
+                                            "empty separator");
+        throw invalid_argument("empty separator");
     }
-    if (a->count < b->count)
+    else
     {
-        return -1;
+        pieces = string_split_chars(data, s->count,
+                                    reinterpret_cast<const uint8_t *>(sep->data), sep->count, 1);
     }
-    return 1;
-}
 
-bool unicode_contains(const UnicodeObject *haystack, const UnicodeObject *needle)
-{
-    if (needle->count == 0)
+    ListObject *ret = list_new(pieces.size(), true, exc_block);
+    for (size_t x = 0; x < pieces.size(); x++)
     {
-        return true;
+        ret->items[x] = bytes_new(&s->data[pieces[x].first], pieces[x].second, exc_block);
     }
-    if (memmem(haystack->data, haystack->count * sizeof(wchar_t),
-               needle->data, needle->count * sizeof(wchar_t)) != nullptr)
+    return ret;
+}
+
+BytesObject *bytes_join(const BytesObject *sep, const ListObject *items,
+                        ExceptionBlock *exc_block)
+{
+    size_t count = items->count ? (sep->count * (items->count - 1)) : 0;
+    for (size_t x = 0; x < items->count; x++)
     {
-        return true;
+        count += reinterpret_cast<const BytesObject *>(items->items[x])->count;
     }
-    else
+
+    BytesObject *ret = bytes_new(nullptr, count, exc_block);
+    char *dest = ret->data;
+    for (size_t x = 0; x < items->count; x++)
     {
-        return false;
+        if (x)
+        {
+            memcpy(dest, sep->data, sep->count);
+            dest += sep->count;
+        }
+        const BytesObject *item = reinterpret_cast<const BytesObject *>(items->items[x]);
+        memcpy(dest, item->data, item->count);
+        dest += item->count;
     }
+    ret->data[ret->count] = 0;
+    return ret;
 }
 
-wstring unicode_to_cxx_wstring(const UnicodeObject *s)
+ParseNumberResult bytes_parse_int(const BytesObject *s, int64_t base, int64_t *value)
+{
+    const uint8_t *data = reinterpret_cast<const uint8_t *>(s->data);
+    size_t start = string_kernel_skip(data, 0, s->count, false, false);
+    size_t end = string_kernel_rskip_whitespace(data, start, s->count, false);
+    return parse_int(&s->data[start], end - start, base, value);
+}
+
+ParseNumberResult bytes_parse_float(const BytesObject *s, double *value)
 {
-    return wstring(s->data, s->count);
+    const uint8_t *data = reinterpret_cast<const uint8_t *>(s->data);
+    size_t start = string_kernel_skip(data, 0, s->count, false, false);
+    size_t end = string_kernel_rskip_whitespace(data, start, s->count, false);
+    return parse_float(&s->data[start], end - start, value);
 }
 
 
-BytesObject *unicode_encode_ascii(const UnicodeObject *s)
+UnicodeObject::UnicodeObject() : basic(free), count(0), hash(0), flags(0),
+                                 kind(UnicodeKind::Latin1), capacity(0)
+{}
+
+UnicodeObject *unicode_new_with_kind(UnicodeKind kind, size_t count,
+                                     ExceptionBlock *exc_block)
 {
-    return unicode_encode_ascii(s->data, s->count);
+    size_t size = sizeof(UnicodeObject) + kind * (count + 1);
+    UnicodeObject *s = reinterpret_cast<UnicodeObject *>(malloc(size));
+    if (!s)
+    {
+        raise_python_exception(exc_block, &MemoryError_instance);
+        throw bad_alloc();
+    }
+    s->basic.refcount = 1;
+    s->basic.destructor = free;
+    s->count = count;
+    s->hash = 0;
+    s->flags = 0;
+    s->kind = kind;
+    s->capacity = count;
+    unicode_write(s, count, 0);
+    if (debug_flags & DebugFlag::ShowRefcountChanges)
+    {
+        fprintf(stderr, "[refcount:create] created Unicode object %p with %zu chars of kind %d\n",
+                s, count, kind);
+    }
+    return s;
 }
 
-BytesObject *unicode_encode_ascii(const wchar_t *s, ssize_t count)
+UnicodeObject *unicode_new(const wchar_t *data, ssize_t count,
+                           ExceptionBlock *exc_block)
 {
     if (count < 0)
     {
-        count = wcslen(s);
+        count = wcslen(data);
     }
-    BytesObject *ret = bytes_new(nullptr, count);
-    for (int64_t x = 0; x < count; x++)
+
+    // or-ing the characters together doesn't give the largest one, but it does
+    // give a value that needs the same kind
+    uint32_t max_char = 0;
+    for (ssize_t x = 0; x < count; x++)
     {
-        ret->data[x] = s[x];
+        max_char |= static_cast<uint32_t>(data[x]);
     }
-    ret->data[count] = 0;
-    return ret;
+
+    UnicodeObject *s = unicode_new_with_kind(unicode_kind_for_char(max_char),
+                                             count, exc_block);
+    if (s->kind == UnicodeKind::UCS4)
+    {
+        memcpy(s->ucs4, data, count * sizeof(s->ucs4[0]));
+    }
+    else
+    {
+        for (ssize_t x = 0; x < count; x++)
+        {
+            unicode_write(s, x, data[x]);
+        }
+    }
+    return s;
 }
 
-UnicodeObject *bytes_decode_ascii(const BytesObject *s)
+UnicodeObject *unicode_new_latin1(const char *data, ssize_t count,
+                                  ExceptionBlock *exc_block)
 {
-    return bytes_decode_ascii(s->data, s->count);
+    if (count < 0)
+    {
+        count = strlen(data);
+    }
+    UnicodeObject *s = unicode_new_with_kind(UnicodeKind::Latin1, count, exc_block);
+    memcpy(s->latin1, data, count);
+    return s;
 }
 
-UnicodeObject *bytes_decode_ascii(const char *s, ssize_t count)
+UnicodeObject *unicode_from_cxx_wstring(const wstring &data)
 {
-    if (count < 0)
+    return unicode_new(data.data(), data.size());
+}
+
+// copies count characters from src (of kind SrcT) into dest (of kind DestT),
+// which must be at least as wide
+template<typename DestT, typename SrcT>
+static inline void unicode_widen(DestT *dest, const SrcT *src, size_t count)
+{
+    if (sizeof(DestT) == sizeof(SrcT))
     {
-        count = strlen(s);
+        memcpy(dest, src, count * sizeof(SrcT));
+        return;
     }
-    UnicodeObject *ret = unicode_new(nullptr, count);
-    for (int64_t x = 0; x < count; x++)
+    for (size_t x = 0; x < count; x++)
     {
-        ret->data[x] = s[x];
+        dest[x] = src[x];
     }
-    ret->data[count] = 0;
-    return ret;
+}
+
+void unicode_write_latin1(UnicodeObject *s, size_t offset, const char *data,
+                          size_t count)
+{
+    const uint8_t *chars = reinterpret_cast<const uint8_t *>(data);
+    if (s->kind == UnicodeKind::Latin1)
+    {
+        memcpy(&s->latin1[offset], chars, count);
+    }
+    else if (s->kind == UnicodeKind::UCS2)
+    {
+        unicode_widen(&s->ucs2[offset], chars, count);
+    }
+    else
+    {
+        unicode_widen(&s->ucs4[offset], chars, count);
+    }
+}
+
+void unicode_copy_range(UnicodeObject *dest, size_t dest_offset,
+                        const UnicodeObject *src, size_t src_offset, size_t count)
+{
+    if (dest->kind == src->kind)
+    {
+        memcpy(&dest->latin1[dest_offset * dest->kind],
+               &src->latin1[src_offset * src->kind], count * src->kind);
+    }
+    else if (dest->kind == UnicodeKind::UCS2)
+    {
+        unicode_widen(&dest->ucs2[dest_offset], &src->latin1[src_offset], count);
+    }
+    else if (src->kind == UnicodeKind::Latin1)
+    {
+        unicode_widen(&dest->ucs4[dest_offset], &src->latin1[src_offset], count);
+    }
+    else
+    {
+        unicode_widen(&dest->ucs4[dest_offset], &src->ucs2[src_offset], count);
+    }
+}
+
+// copies all of src's characters into dest at the given character offset.
+// dest's kind must be at least as wide as src's
+static void unicode_copy_into(UnicodeObject *dest, size_t offset,
+                              const UnicodeObject *src)
+{
+    unicode_copy_range(dest, offset, src, 0, src->count);
+}
+
+UnicodeObject *unicode_concat(const UnicodeObject *a, const UnicodeObject *b,
+                              ExceptionBlock *exc_block)
+{
+    UnicodeKind kind = static_cast<UnicodeKind>(max(a->kind, b->kind));
+    UnicodeObject *s = unicode_new_with_kind(kind, a->count + b->count, exc_block);
+    unicode_copy_into(s, 0, a);
+    unicode_copy_into(s, a->count, b);
+    return s;
+}
+
+void unicode_append(UnicodeObject **slot, UnicodeObject *a, UnicodeObject *b,
+                    ExceptionBlock *exc_block)
+{
+    // if only x refers to a, the caller's reference is the second one
+    if ((*slot != a) || (a->basic.refcount != 2) || (b->kind > a->kind))
+    {
+        UnicodeObject *previous = *slot;
+        *slot = unicode_concat(a, b, exc_block);
+        delete_reference(previous);
+        delete_reference(a);
+        delete_reference(b);
+        return;
+    }
+    delete_reference(a);
+
+    size_t count = a->count + b->count;
+    if (count > a->capacity)
+    {
+        size_t capacity = string_append_capacity(a->capacity, count);
+        UnicodeObject *resized = reinterpret_cast<UnicodeObject *>(realloc(a,
+                sizeof(UnicodeObject) + a->kind * (capacity + 1)));
+        if (!resized)
+        {
+            delete_reference(b);
+            raise_python_exception(exc_block, &MemoryError_instance);
+            throw bad_alloc();
+        }
+        a = resized;
+        a->capacity = capacity;
+        *slot = a;
+    }
+    unicode_copy_into(a, a->count, b);
+    a->count = count;
+    unicode_write(a, count, 0);
+    a->hash = 0;
+    delete_reference(b);
+}
+
+wchar_t unicode_at(const UnicodeObject *s, size_t which,
+                   ExceptionBlock *exc_block)
+{
+    if (which >= s->count)
+    {
+        raise_python_exception_with_message(exc_block, global->IndexError_class_id,
+                                            "unicode index out of range");
+        throw out_of_range("index out of range for unicode object");
+    }
+    if (s->kind == UnicodeKind::Latin1)
+    {
+        return s->latin1[which];
+    }
+    return unicode_read(s, which);
+}
+
+size_t unicode_length(const UnicodeObject *s)
+{
+    return s->count;
+}
+
+bool unicode_equal(const UnicodeObject *a, const UnicodeObject *b)
+{
+    if (a == b)
+    {
+        return true;
+    }
+    if (a->flags & b->flags & StringFlag::Interned)
+    {
+        return false;
+    }
+    // kinds are canonical, so strings of different kinds are never equal
+    if ((a->count != b->count) || (a->kind != b->kind))
+    {
+        return false;
+    }
+    if (a->hash && b->hash && (a->hash != b->hash))
+    {
+        return false;
+    }
+    size_t size = a->count * a->kind;
+    return string_kernel_first_difference(a->latin1, b->latin1, size) == size;
+}
+
+uint64_t unicode_hash(const UnicodeObject *s)
+{
+    if (!s->hash)
+    {
+        const_cast<UnicodeObject *>(s)->hash = string_hash(s->latin1,
+                                                  s->count * s->kind);
+    }
+    return s->hash;
+}
+
+int64_t unicode_compare(const UnicodeObject *a, const UnicodeObject *b)
+{
+    size_t count = min(a->count, b->count);
+    if (a->kind == b->kind)
+    {
+        // the first differing byte is in the first differing character
+        size_t x = string_kernel_first_difference(a->latin1, b->latin1,
+                                                  count * a->kind) / a->kind;
+        if (x < count)
+        {
+            return (unicode_read(a, x) < unicode_read(b, x)) ? -1 : 1;
+        }
+    }
+    else
+    {
+        for (size_t x = 0; x < count; x++)
+        {
+            uint32_t a_ch = unicode_read(a, x);
+            uint32_t b_ch = unicode_read(b, x);
+            if (a_ch != b_ch)
+            {
+                return (a_ch < b_ch) ? -1 : 1;
+            }
+        }
+    }
+    if (a->count == b->count)
+    {
+        return 0;
+    }
+    return (a->count < b->count) ? -1 : 1;
+}
+
+bool unicode_contains(const UnicodeObject *haystack, const UnicodeObject *needle)
+{
+    return unicode_find(haystack, needle) >= 0;
+}
+
+UnicodeObject *unicode_intern(UnicodeObject *s, ExceptionBlock *exc_block)
+{
+    if (s->flags & StringFlag::Interned)
+    {
+        return s;
+    }
+
+    static SetObject *table = set_new(
+            reinterpret_cast<uint64_t (*)(const void *)>(unicode_hash),
+            reinterpret_cast<bool (*)(const void *, const void *)>(unicode_equal),
+            true, exc_block);
+
+    ssize_t index = table->find(s, unicode_hash(s));
+    if (index >= 0)
+    {
+        UnicodeObject *ret = reinterpret_cast<UnicodeObject *>(table->slots[index].key);
+        add_reference(ret);
+        delete_reference(s);
+        return ret;
+    }
+
+    set_add(table, s, exc_block);
+    s->flags |= StringFlag::Interned;
+    return s;
+}
+
+wstring unicode_to_cxx_wstring(const UnicodeObject *s)
+{
+    if (s->kind == UnicodeKind::UCS4)
+    {
+        return wstring(reinterpret_cast<const wchar_t *>(s->ucs4), s->count);
+    }
+    wstring ret(s->count, 0);
+    for (size_t x = 0; x < s->count; x++)
+    {
+        ret[x] = unicode_read(s, x);
+    }
+    return ret;
+}
+
+bool unicode_is_ascii(const UnicodeObject *s)
+{
+    return (s->kind == UnicodeKind::Latin1) && string_kernel_is_ascii(s->latin1, s->count);
+}
+
+// returns s's characters as raw data of the given kind, which must be at least
+// as wide as s's kind. if s already has that kind, this is s's own data;
+// otherwise, it's a widened copy in storage
+static const uint8_t *unicode_data_as_kind(const UnicodeObject *s, uint32_t kind,
+                                           string &storage)
+{
+    if (s->kind == kind)
+    {
+        return s->latin1;
+    }
+    storage.resize(s->count * kind);
+    if (kind == UnicodeKind::UCS2)
+    {
+        unicode_widen(reinterpret_cast<uint16_t *>(storage.data()), s->latin1, s->count);
+    }
+    else if (s->kind == UnicodeKind::Latin1)
+    {
+        unicode_widen(reinterpret_cast<uint32_t *>(storage.data()), s->latin1, s->count);
+    }
+    else
+    {
+        unicode_widen(reinterpret_cast<uint32_t *>(storage.data()), s->ucs2, s->count);
+    }
+    return reinterpret_cast<const uint8_t *>(storage.data());
+}
+
+UnicodeObject *unicode_substring(const UnicodeObject *s, size_t start, size_t count,
+                                 ExceptionBlock *exc_block)
+{
+    if (s->kind == UnicodeKind::Latin1)
+    {
+        return unicode_new_latin1(reinterpret_cast<const char *>(&s->latin1[start]),
+                                  count, exc_block);
+    }
+
+    // the substring might not contain any of the characters that made s wide,
+    // so it may need a narrower kind
+    uint32_t max_char = 0;
+    for (size_t x = 0; x < count; x++)
+    {
+        max_char |= unicode_read(s, start + x);
+    }
+    UnicodeObject *ret = unicode_new_with_kind(unicode_kind_for_char(max_char), count,
+                                               exc_block);
+    if (ret->kind == s->kind)
+    {
+        memcpy(ret->latin1, &s->latin1[start * s->kind], count * s->kind);
+    }
+    else
+    {
+        for (size_t x = 0; x < count; x++)
+        {
+            unicode_write(ret, x, unicode_read(s, start + x));
+        }
+    }
+    return ret;
+}
+
+// takes ownership of s and returns an equal string with the narrowest kind,
+// which may be s itself
+static UnicodeObject *unicode_narrow(UnicodeObject *s, ExceptionBlock *exc_block)
+{
+    if (s->kind == UnicodeKind::Latin1)
+    {
+        return s;
+    }
+    uint32_t max_char = 0;
+    for (size_t x = 0; x < s->count; x++)
+    {
+        max_char |= unicode_read(s, x);
+    }
+    if (unicode_kind_for_char(max_char) == s->kind)
+    {
+        return s;
+    }
+    UnicodeObject *ret = unicode_substring(s, 0, s->count, exc_block);
+    delete_reference(s);
+    return ret;
+}
+
+UnicodeObject *unicode_slice(UnicodeObject *s, int64_t start, int64_t end, int64_t step,
+                             ExceptionBlock *exc_block)
+{
+    check_slice_step(step, exc_block);
+    size_t count = slice_adjust_indices(s->count, &start, end, step);
+    if (step == 1)
+    {
+        if (count == s->count)
+        {
+            add_reference(s);
+            return s;
+        }
+        return unicode_substring(s, start, count, exc_block);
+    }
+
+    // like unicode_substring, the result may need a narrower kind than s
+    uint32_t max_char = 0;
+    for (size_t x = 0; x < count; x++)
+    {
+        max_char |= unicode_read(s, start + x * step);
+    }
+    UnicodeObject *ret = unicode_new_with_kind(unicode_kind_for_char(max_char), count,
+                                               exc_block);
+    for (size_t x = 0; x < count; x++, start += step)
+    {
+        unicode_write(ret, x, unicode_read(s, start));
+    }
+    return ret;
+}
+
+int64_t unicode_find(const UnicodeObject *s, const UnicodeObject *sub)
+{
+    if (!sub->count)
+    {
+        return 0;
+    }
+    if (sub->kind > s->kind)
+    {
+        return -1;
+    }
+    string storage;
+    const uint8_t *sub_data = unicode_data_as_kind(sub, s->kind, storage);
+    return string_find_chars(s->latin1, s->count, sub_data, sub->count, s->kind, 0);
+}
+
+int64_t unicode_count(const UnicodeObject *s, const UnicodeObject *sub)
+{
+    if (!sub->count)
+    {
+        return s->count + 1;
+    }
+    if (sub->kind > s->kind)
+    {
+        return 0;
+    }
+    string storage;
+    const uint8_t *sub_data = unicode_data_as_kind(sub, s->kind, storage);
+    return string_replace_positions(s->latin1, s->count, sub_data, sub->count,
+                                    s->kind).size();
+}
+
+// returns true if sub occurs in s at the given character offset
+static bool unicode_matches_at(const UnicodeObject *s, const UnicodeObject *sub,
+                               size_t offset)
+{
+    if (sub->kind > s->kind)
+    {
+        return false;
+    }
+    string storage;
+    const uint8_t *sub_data = unicode_data_as_kind(sub, s->kind, storage);
+    return !memcmp(&s->latin1[offset * s->kind], sub_data, sub->count * s->kind);
+}
+
+bool unicode_startswith(const UnicodeObject *s, const UnicodeObject *prefix)
+{
+    return (prefix->count <= s->count) && unicode_matches_at(s, prefix, 0);
+}
+
+bool unicode_endswith(const UnicodeObject *s, const UnicodeObject *suffix)
+{
+    return (suffix->count <= s->count) &&
+           unicode_matches_at(s, suffix, s->count - suffix->count);
+}
+
+UnicodeObject *unicode_strip(const UnicodeObject *s, bool left, bool right,
+                             ExceptionBlock *exc_block)
+{
+    size_t start = 0, end = s->count;
+    if (s->kind == UnicodeKind::Latin1)
+    {
+        if (left)
+        {
+            start = string_kernel_skip(s->latin1, 0, s->count, false, true);
+        }
+        if (right)
+        {
+            end = string_kernel_rskip_whitespace(s->latin1, start, s->count, true);
+        }
+    }
+    else
+    {
+        for (; left && (start < end) &&
+               string_kernel_is_whitespace(unicode_read(s, start), true); start++)
+        {}
+        for (; right && (end > start) &&
+               string_kernel_is_whitespace(unicode_read(s, end - 1), true); end--)
+        {}
+    }
+    return unicode_substring(s, start, end - start, exc_block);
+}
+
+// only ascii letters are converted with the SIMD kernel. python's one-to-one
+// case mappings for the rest of unicode need tables we don't have, so other
+// characters go through the C library instead. its mapping depends on the locale,
+// and we never call setlocale, so use a UTF-8 locale explicitly if there is one
+static locale_t unicode_case_locale()
+{
+    static locale_t locale = newlocale(LC_CTYPE_MASK, "C.UTF-8", 0);
+    return locale;
+}
+
+static uint32_t unicode_simple_case(uint32_t ch, bool to_upper)
+{
+    locale_t locale = unicode_case_locale();
+    if (locale)
+    {
+        return to_upper ? towupper_l(ch, locale) : towlower_l(ch, locale);
+    }
+    return to_upper ? towupper(ch) : towlower(ch);
+}
+
+// the C library only does one-to-one mappings, but some characters map to
+// more than one character (e.g. 'ß'.upper() is 'SS'). these are the
+// unconditional mappings from SpecialCasing.txt, sorted by character. only
+// U+0130 has a multi-character lowercase mapping, so it's handled separately
+struct SpecialCaseMapping
+{
+    uint32_t ch;
+    uint32_t mapped[3]; // unused entries are zero
+};
+
+static const SpecialCaseMapping special_upper_mappings[] = {
+    {0x00DF, {0x0053, 0x0053, 0x0000}}, {0x0149, {0x02BC, 0x004E, 0x0000}},
+    {0x01F0, {0x004A, 0x030C, 0x0000}}, {0x0390, {0x0399, 0x0308, 0x0301}},
+    {0x03B0, {0x03A5, 0x0308, 0x0301}}, {0x0587, {0x0535, 0x0552, 0x0000}},
+    {0x1E96, {0x0048, 0x0331, 0x0000}}, {0x1E97, {0x0054, 0x0308, 0x0000}},
+    {0x1E98, {0x0057, 0x030A, 0x0000}}, {0x1E99, {0x0059, 0x030A, 0x0000}},
+    {0x1E9A, {0x0041, 0x02BE, 0x0000}}, {0x1F50, {0x03A5, 0x0313, 0x0000}},
+    {0x1F52, {0x03A5, 0x0313, 0x0300}}, {0x1F54, {0x03A5, 0x0313, 0x0301}},
+    {0x1F56, {0x03A5, 0x0313, 0x0342}}, {0x1F80, {0x1F08, 0x0399, 0x0000}},
+    {0x1F81, {0x1F09, 0x0399, 0x0000}}, {0x1F82, {0x1F0A, 0x0399, 0x0000}},
+    {0x1F83, {0x1F0B, 0x0399, 0x0000}}, {0x1F84, {0x1F0C, 0x0399, 0x0000}},
+    {0x1F85, {0x1F0D, 0x0399, 0x0000}}, {0x1F86, {0x1F0E, 0x0399, 0x0000}},
+    {0x1F87, {0x1F0F, 0x0399, 0x0000}}, {0x1F88, {0x1F08, 0x0399, 0x0000}},
+    {0x1F89, {0x1F09, 0x0399, 0x0000}}, {0x1F8A, {0x1F0A, 0x0399, 0x0000}},
+    {0x1F8B, {0x1F0B, 0x0399, 0x0000}}, {0x1F8C, {0x1F0C, 0x0399, 0x0000}},
+    {0x1F8D, {0x1F0D, 0x0399, 0x0000}}, {0x1F8E, {0x1F0E, 0x0399, 0x0000}},
+    {0x1F8F, {0x1F0F, 0x0399, 0x0000}}, {0x1F90, {0x1F28, 0x0399, 0x0000}},
+    {0x1F91, {0x1F29, 0x0399, 0x0000}}, {0x1F92, {0x1F2A, 0x0399, 0x0000}},
+    {0x1F93, {0x1F2B, 0x0399, 0x0000}}, {0x1F94, {0x1F2C, 0x0399, 0x0000}},
+    {0x1F95, {0x1F2D, 0x0399, 0x0000}}, {0x1F96, {0x1F2E, 0x0399, 0x0000}},
+    {0x1F97, {0x1F2F, 0x0399, 0x0000}}, {0x1F98, {0x1F28, 0x0399, 0x0000}},
+    {0x1F99, {0x1F29, 0x0399, 0x0000}}, {0x1F9A, {0x1F2A, 0x0399, 0x0000}},
+    {0x1F9B, {0x1F2B, 0x0399, 0x0000}}, {0x1F9C, {0x1F2C, 0x0399, 0x0000}},
+    {0x1F9D, {0x1F2D, 0x0399, 0x0000}}, {0x1F9E, {0x1F2E, 0x0399, 0x0000}},
+    {0x1F9F, {0x1F2F, 0x0399, 0x0000}}, {0x1FA0, {0x1F68, 0x0399, 0x0000}},
+    {0x1FA1, {0x1F69, 0x0399, 0x0000}}, {0x1FA2, {0x1F6A, 0x0399, 0x0000}},
+    {0x1FA3, {0x1F6B, 0x0399, 0x0000}}, {0x1FA4, {0x1F6C, 0x0399, 0x0000}},
+    {0x1FA5, {0x1F6D, 0x0399, 0x0000}}, {0x1FA6, {0x1F6E, 0x0399, 0x0000}},
+    {0x1FA7, {0x1F6F, 0x0399, 0x0000}}, {0x1FA8, {0x1F68, 0x0399, 0x0000}},
+    {0x1FA9, {0x1F69, 0x0399, 0x0000}}, {0x1FAA, {0x1F6A, 0x0399, 0x0000}},
+    {0x1FAB, {0x1F6B, 0x0399, 0x0000}}, {0x1FAC, {0x1F6C, 0x0399, 0x0000}},
+    {0x1FAD, {0x1F6D, 0x0399, 0x0000}}, {0x1FAE, {0x1F6E, 0x0399, 0x0000}},
+    {0x1FAF, {0x1F6F, 0x0399, 0x0000}}, {0x1FB2, {0x1FBA, 0x0399, 0x0000}},
+    {0x1FB3, {0x0391, 0x0399, 0x0000}}, {0x1FB4, {0x0386, 0x0399, 0x0000}},
+    {0x1FB6, {0x0391, 0x0342, 0x0000}}, {0x1FB7, {0x0391, 0x0342, 0x0399}},
+    {0x1FBC, {0x0391, 0x0399, 0x0000}}, {0x1FC2, {0x1FCA, 0x0399, 0x0000}},
+    {0x1FC3, {0x0397, 0x0399, 0x0000}}, {0x1FC4, {0x0389, 0x0399, 0x0000}},
+    {0x1FC6, {0x0397, 0x0342, 0x0000}}, {0x1FC7, {0x0397, 0x0342, 0x0399}},
+    {0x1FCC, {0x0397, 0x0399, 0x0000}}, {0x1FD2, {0x0399, 0x0308, 0x0300}},
+    {0x1FD3, {0x0399, 0x0308, 0x0301}}, {0x1FD6, {0x0399, 0x0342, 0x0000}},
+    {0x1FD7, {0x0399, 0x0308, 0x0342}}, {0x1FE2, {0x03A5, 0x0308, 0x0300}},
+    {0x1FE3, {0x03A5, 0x0308, 0x0301}}, {0x1FE4, {0x03A1, 0x0313, 0x0000}},
+    {0x1FE6, {0x03A5, 0x0342, 0x0000}}, {0x1FE7, {0x03A5, 0x0308, 0x0342}},
+    {0x1FF2, {0x1FFA, 0x0399, 0x0000}}, {0x1FF3, {0x03A9, 0x0399, 0x0000}},
+    {0x1FF4, {0x038F, 0x0399, 0x0000}}, {0x1FF6, {0x03A9, 0x0342, 0x0000}},
+    {0x1FF7, {0x03A9, 0x0342, 0x0399}}, {0x1FFC, {0x03A9, 0x0399, 0x0000}},
+    {0xFB00, {0x0046, 0x0046, 0x0000}}, {0xFB01, {0x0046, 0x0049, 0x0000}},
+    {0xFB02, {0x0046, 0x004C, 0x0000}}, {0xFB03, {0x0046, 0x0046, 0x0049}},
+    {0xFB04, {0x0046, 0x0046, 0x004C}}, {0xFB05, {0x0053, 0x0054, 0x0000}},
+    {0xFB06, {0x0053, 0x0054, 0x0000}}, {0xFB13, {0x0544, 0x0546, 0x0000}},
+    {0xFB14, {0x0544, 0x0535, 0x0000}}, {0xFB15, {0x0544, 0x053B, 0x0000}},
+    {0xFB16, {0x054E, 0x0546, 0x0000}}, {0xFB17, {0x0544, 0x053D, 0x0000}},
+};
+
+static const SpecialCaseMapping special_lower_mappings[] = {
+    {0x0130, {0x0069, 0x0307, 0x0000}},
+};
+
+template <size_t N>
+static const SpecialCaseMapping *find_special_case_mapping(
+        const SpecialCaseMapping (&mappings)[N], uint32_t ch)
+{
+    const SpecialCaseMapping *it = lower_bound(mappings, mappings + N, ch,
+            [](const SpecialCaseMapping &m, uint32_t ch) { return m.ch < ch; });
+    return ((it != mappings + N) && (it->ch == ch)) ? it : nullptr;
+}
+
+static bool unicode_is_cased(uint32_t ch)
+{
+    return (unicode_simple_case(ch, true) != ch) || (unicode_simple_case(ch, false) != ch);
+}
+
+static UnicodeObject *unicode_change_case(const UnicodeObject *s, bool to_upper,
+                                          ExceptionBlock *exc_block)
+{
+    if (unicode_is_ascii(s))
+    {
+        UnicodeObject *ret = unicode_new_with_kind(UnicodeKind::Latin1, s->count, exc_block);
+        string_kernel_ascii_case(ret->latin1, s->latin1, s->count, to_upper);
+        return ret;
+    }
+
+    wstring data;
+    data.reserve(s->count);
+    for (size_t x = 0; x < s->count; x++)
+    {
+        uint32_t ch = unicode_read(s, x);
+        const SpecialCaseMapping *special = to_upper ?
+                find_special_case_mapping(special_upper_mappings, ch) :
+                find_special_case_mapping(special_lower_mappings, ch);
+        if (special)
+        {
+            for (size_t y = 0; (y < 3) && special->mapped[y]; y++)
+            {
+                data.push_back(special->mapped[y]);
+            }
+        }
+        else if (!to_upper && (ch == 0x03A3))
+        {
+            // capital sigma becomes final sigma at the end of a word, which is
+            // where it follows a cased character and isn't followed by one.
+            // python also skips case-ignorable characters (like apostrophes)
+            // when checking this, but we don't have a table for those
+            bool is_final = (x > 0) && unicode_is_cased(unicode_read(s, x - 1)) &&
+                            ((x + 1 == s->count) || !unicode_is_cased(unicode_read(s, x + 1)));
+            data.push_back(is_final ? 0x03C2 : 0x03C3);
+        }
+        else
+        {
+            data.push_back(unicode_simple_case(ch, to_upper));
+        }
+    }
+    return unicode_new(data.data(), data.size(), exc_block);
+}
+
+UnicodeObject *unicode_lower(const UnicodeObject *s, ExceptionBlock *exc_block)
+{
+    return unicode_change_case(s, false, exc_block);
+}
+
+UnicodeObject *unicode_upper(const UnicodeObject *s, ExceptionBlock *exc_block)
+{
+    return unicode_change_case(s, true, exc_block);
+}
+
+UnicodeObject *unicode_replace(const UnicodeObject *s, const UnicodeObject *old,
+                               const UnicodeObject *new_s, ExceptionBlock *exc_block)
+{
+    if (old->kind > s->kind)
+    {
+        return unicode_substring(s, 0, s->count, exc_block);
+    }
+    string old_storage;
+    const uint8_t *old_data = unicode_data_as_kind(old, s->kind, old_storage);
+    auto positions = string_replace_positions(s->latin1, s->count, old_data,
+                                              old->count, s->kind);
+
+    // the result's size is known exactly, so it's allocated only once. it may
+    // need to be narrowed afterward if the replaced parts had the only wide
+    // characters in s
+    UnicodeObject *ret = unicode_new_with_kind(
+            static_cast<UnicodeKind>(max(s->kind, new_s->kind)),
+            s->count + positions.size() * new_s->count - positions.size() * old->count,
+            exc_block);
+    string new_storage;
+    const uint8_t *new_data = unicode_data_as_kind(new_s, ret->kind, new_storage);
+    string s_storage;
+    const uint8_t *s_data = unicode_data_as_kind(s, ret->kind, s_storage);
+
+    size_t kind = ret->kind;
+    uint8_t *dest = ret->latin1;
+    size_t prev_end = 0;
+    for (size_t position: positions)
+    {
+        memcpy(dest, &s_data[prev_end * kind], (position - prev_end) * kind);
+        dest += (position - prev_end) * kind;
+        memcpy(dest, new_data, new_s->count * kind);
+        dest += new_s->count * kind;
+        prev_end = position + old->count;
+    }
+    memcpy(dest, &s_data[prev_end * kind], (s->count - prev_end) * kind);
+    return unicode_narrow(ret, exc_block);
+}
+
+ListObject *unicode_split(const UnicodeObject *s, const UnicodeObject *sep,
+                          ExceptionBlock *exc_block)
+{
+    vector<pair<size_t, size_t>> pieces;
+    if (!sep)
+    {
+        if (s->kind == UnicodeKind::Latin1)
+        {
+            pieces = string_split_whitespace_bytes(s->latin1, s->count, true);
+        }
+        else
+        {
+            size_t start = 0;
+            while (start < s->count)
+            {
+                if (string_kernel_is_whitespace(unicode_read(s, start), true))
+                {
+                    start++;
+                    continue;
+                }
+                size_t end = start + 1;
+                for (; (end < s->count) &&
+                       !string_kernel_is_whitespace(unicode_read(s, end), true); end++)
+                {}
+                pieces.emplace_back(start, end - start);
+                start = end;
+            }
+        }
+    }
+    else if (!sep->count)
+    {
+        raise_python_exception_with_message(exc_block, global->ValueError_class_id,
+                                            "empty separator");
+        throw invalid_argument("empty separator");
+    }
+    else if (sep->kind > s->kind)
+    {
+        pieces.emplace_back(0, s->count);
+    }
+    else
+    {
+        string storage;
+        const uint8_t *sep_data = unicode_data_as_kind(sep, s->kind, storage);
+        pieces = string_split_chars(s->latin1, s->count, sep_data, sep->count, s->kind);
+    }
+
+    ListObject *ret = list_new(pieces.size(), true, exc_block);
+    for (size_t x = 0; x < pieces.size(); x++)
+    {
+        ret->items[x] = unicode_substring(s, pieces[x].first, pieces[x].second, exc_block);
+    }
+    return ret;
+}
+
+UnicodeObject *unicode_join(const UnicodeObject *sep, const ListObject *items,
+                            ExceptionBlock *exc_block)
+{
+    // the result has the widest kind of any of the pieces (or the separator, if
+    // it's used at all)
+    size_t count = 0;
+    uint32_t kind = UnicodeKind::Latin1;
+    if (items->count > 1)
+    {
+        count = sep->count * (items->count - 1);
+        kind = sep->kind;
+    }
+    for (size_t x = 0; x < items->count; x++)
+    {
+        const UnicodeObject *item = reinterpret_cast<const UnicodeObject *>(items->items[x]);
+        count += item->count;
+        kind = max(kind, item->kind);
+    }
+
+    UnicodeObject *ret = unicode_new_with_kind(static_cast<UnicodeKind>(kind), count,
+                                               exc_block);
+    size_t offset = 0;
+    for (size_t x = 0; x < items->count; x++)
+    {
+        if (x)
+        {
+            unicode_copy_into(ret, offset, sep);
+            offset += sep->count;
+        }
+        const UnicodeObject *item = reinterpret_cast<const UnicodeObject *>(items->items[x]);
+        unicode_copy_into(ret, offset, item);
+        offset += item->count;
+    }
+    return ret;
+}
+
+// python accepts decimal digits from any script in numbers (e.g. int('\u0663')
+// is 3). the Nd characters all come in runs of 10 (0 through 9), so this is the
+// first character of each run other than the ascii one
+static const uint32_t unicode_zero_digits[] = {
+    0x0660, 0x06F0, 0x07C0, 0x0966, 0x09E6, 0x0A66, 0x0AE6, 0x0B66,
+    0x0BE6, 0x0C66, 0x0CE6, 0x0D66, 0x0DE6, 0x0E50, 0x0ED0, 0x0F20,
+    0x1040, 0x1090, 0x17E0, 0x1810, 0x1946, 0x19D0, 0x1A80, 0x1A90,
+    0x1B50, 0x1BB0, 0x1C40, 0x1C50, 0xA620, 0xA8D0, 0xA900, 0xA9D0,
+    0xA9F0, 0xAA50, 0xABF0, 0xFF10, 0x104A0, 0x10D30, 0x11066, 0x110F0,
+    0x11136, 0x111D0, 0x112F0, 0x11450, 0x114D0, 0x11650, 0x116C0, 0x11730,
+    0x118E0, 0x11950, 0x11C50, 0x11D50, 0x11DA0, 0x16A60, 0x16AC0, 0x16B50,
+    0x1D7CE, 0x1D7D8, 0x1D7E2, 0x1D7EC, 0x1D7F6, 0x1E140, 0x1E2F0, 0x1E950,
+    0x1FBF0,
+};
+
+// returns the ascii digit for a non-ascii decimal digit, or 0 if ch isn't one
+static char unicode_decimal_digit_to_ascii(uint32_t ch)
+{
+    const uint32_t *end = unicode_zero_digits +
+                          sizeof(unicode_zero_digits) / sizeof(unicode_zero_digits[0]);
+    const uint32_t *it = upper_bound(unicode_zero_digits, end, ch);
+    if ((it == unicode_zero_digits) || (ch - *(it - 1) >= 10))
+    {
+        return 0;
+    }
+    return '0' + (ch - *(it - 1));
+}
+
+// python accepts whitespace around numbers, so this finds the rest of the text
+// and passes it to parse as ascii. decimal digits from other scripts are
+// converted to ascii digits; anything else that isn't ascii can't be part of a
+// number
+template<typename ParseFn>
+static ParseNumberResult unicode_parse_number(const UnicodeObject *s, ParseFn parse)
+{
+    if (s->kind == UnicodeKind::Latin1)
+    {
+        size_t start = string_kernel_skip(s->latin1, 0, s->count, false, true);
+        size_t end = string_kernel_rskip_whitespace(s->latin1, start, s->count, true);
+        return parse(reinterpret_cast<const char *>(&s->latin1[start]), end - start);
+    }
+
+    size_t start = 0, end = s->count;
+    for (; (start < end) && string_kernel_is_whitespace(unicode_read(s, start), true); start++)
+    {}
+    for (; (end > start) && string_kernel_is_whitespace(unicode_read(s, end - 1), true); end--)
+    {}
+
+    char buf[128];
+    string long_buf;
+    char *text = buf;
+    if (end - start > sizeof(buf))
+    {
+        long_buf.resize(end - start);
+        text = &long_buf[0];
+    }
+    for (size_t x = start; x < end; x++)
+    {
+        uint32_t ch = unicode_read(s, x);
+        if (ch >= 0x80)
+        {
+            ch = unicode_decimal_digit_to_ascii(ch);
+            if (!ch)
+            {
+                return ParseNumberResult::Invalid;
+            }
+        }
+        text[x - start] = ch;
+    }
+    return parse(text, end - start);
+}
+
+ParseNumberResult unicode_parse_int(const UnicodeObject *s, int64_t base, int64_t *value)
+{
+    return unicode_parse_number(s, [&](const char *text, size_t size) {
+        return parse_int(text, size, base, value);
+    });
+}
+
+ParseNumberResult unicode_parse_float(const UnicodeObject *s, double *value)
+{
+    return unicode_parse_number(s, [&](const char *text, size_t size) {
+        return parse_float(text, size, value);
+    });
+}
+
+
+BytesObject *unicode_encode_ascii(const UnicodeObject *s)
+{
+    if (s->kind == UnicodeKind::Latin1)
+    {
+        return bytes_new(reinterpret_cast<const char *>(s->latin1), s->count);
+    }
+    BytesObject *ret = bytes_new(nullptr, s->count);
+    for (size_t x = 0; x < s->count; x++)
+    {
+        ret->data[x] = unicode_read(s, x);
+    }
+    ret->data[s->count] = 0;
+    return ret;
+}
+
+BytesObject *unicode_encode_ascii(const wchar_t *s, ssize_t count)
+{
+    if (count < 0)
+    {
+        count = wcslen(s);
+    }
+    BytesObject *ret = bytes_new(nullptr, count);
+    for (int64_t x = 0; x < count; x++)
+    {
+        ret->data[x] = s[x];
+    }
+    ret->data[count] = 0;
+    return ret;
+}
+
+UnicodeObject *bytes_decode_ascii(const BytesObject *s)
+{
+    return bytes_decode_ascii(s->data, s->count);
+}
+
+UnicodeObject *bytes_decode_ascii(const char *s, ssize_t count)
+{
+    // ascii is a subset of latin1, so this is just a copy
+    return unicode_new_latin1(s, count);
+}
+
+
+StringCodec string_codec_for_name(const UnicodeObject *name)
+{
+    // python ignores case, hyphens and underscores when looking up codecs
+    string normalized;
+    for (size_t x = 0; x < name->count; x++)
+    {
+        uint32_t ch = unicode_read(name, x);
+        if ((ch == '-') || (ch == '_'))
+        {
+            continue;
+        }
+        if (ch >= 0x80)
+        {
+            return StringCodec::Unknown;
+        }
+        normalized.push_back(tolower(ch));
+    }
+
+    if ((normalized == "utf8") || (normalized == "u8"))
+    {
+        return StringCodec::UTF8;
+    }
+    if ((normalized == "ascii") || (normalized == "usascii"))
+    {
+        return StringCodec::ASCII;
+    }
+    if ((normalized == "latin1") || (normalized == "latin") ||
+        (normalized == "iso88591") || (normalized == "l1"))
+    {
+        return StringCodec::Latin1;
+    }
+    return StringCodec::Unknown;
+}
+
+static const char *string_codec_name(StringCodec codec)
+{
+    switch (codec)
+    {
+        case StringCodec::UTF8:
+            return "utf-8";
+        case StringCodec::ASCII:
+            return "ascii";
+        case StringCodec::Latin1:
+            return "latin-1";
+        default:
+            return "unknown";
+    }
+}
+
+// copies size bytes of validated utf-8 data into dest as characters of type
+// CharT, which must be wide enough for all of them. runs of ascii bytes are
+// found with the ascii kernel and copied without decoding
+template <typename CharT>
+static void utf8_decode_into(CharT *dest, const uint8_t *data, size_t size)
+{
+    for (size_t x = 0; x < size;)
+    {
+        if (data[x] < 0x80)
+        {
+            size_t ascii_count = string_kernel_ascii_prefix(data + x, size - x);
+            unicode_widen(dest, data + x, ascii_count);
+            dest += ascii_count;
+            x += ascii_count;
+        }
+        else
+        {
+            uint32_t ch;
+            x += string_kernel_utf8_decode(data + x, size - x, &ch);
+            *(dest++) = ch;
+        }
+    }
+}
+
+UnicodeObject *bytes_decode_utf8(const char *data, size_t size, string *error,
+                                 ExceptionBlock *exc_block)
+{
+    // validate the data and count the characters first, so the result can be
+    // allocated with the right kind and size before anything is decoded
+    const uint8_t *bytes = reinterpret_cast<const uint8_t *>(data);
+    size_t count = 0;
+    uint32_t max_char = 0;
+    for (size_t x = 0; x < size;)
+    {
+        if (bytes[x] < 0x80)
+        {
+            size_t ascii_count = string_kernel_ascii_prefix(bytes + x, size - x);
+            x += ascii_count;
+            count += ascii_count;
+            continue;
+        }
+
+        uint32_t ch;
+        size_t length = string_kernel_utf8_decode(bytes + x, size - x, &ch);
+        if (!length)
+        {
+            // ch is the length of the invalid sequence. if it isn't the first
+            // byte that's the problem, either the data ended early or one of the
+            // continuation bytes is wrong
+            const char *reason = (ch == 1) && ((bytes[x] < 0xC2) || (bytes[x] >= 0xF5))
+                    ? "invalid start byte"
+                    : (x + ch >= size) ? "unexpected end of data" : "invalid continuation byte";
+            if (ch == 1)
+            {
+                *error = string_printf("'utf-8' codec can't decode byte 0x%02hhx in position %zu: %s",
+                                       bytes[x], x, reason);
+            }
+            else
+            {
+                *error = string_printf("'utf-8' codec can't decode bytes in position %zu-%zu: %s",
+                                       x, x + ch - 1, reason);
+            }
+            return nullptr;
+        }
+        max_char = max(max_char, ch);
+        x += length;
+        count++;
+    }
+
+    if (count == size)
+    {
+        return unicode_new_latin1(data, size, exc_block);
+    }
+    UnicodeObject *s = unicode_new_with_kind(unicode_kind_for_char(max_char), count,
+                                             exc_block);
+    if (s->kind == UnicodeKind::Latin1)
+    {
+        utf8_decode_into(s->latin1, bytes, size);
+    }
+    else if (s->kind == UnicodeKind::UCS2)
+    {
+        utf8_decode_into(s->ucs2, bytes, size);
+    }
+    else
+    {
+        utf8_decode_into(s->ucs4, bytes, size);
+    }
+    return s;
+}
+
+UnicodeObject *bytes_decode(const BytesObject *s, StringCodec codec, string *error,
+                            ExceptionBlock *exc_block)
+{
+    if (codec == StringCodec::UTF8)
+    {
+        return bytes_decode_utf8(s->data, s->count, error, exc_block);
+    }
+    if (codec == StringCodec::ASCII)
+    {
+        const uint8_t *data = reinterpret_cast<const uint8_t *>(s->data);
+        size_t ascii_count = string_kernel_ascii_prefix(data, s->count);
+        if (ascii_count < s->count)
+        {
+            *error = string_printf("'ascii' codec can't decode byte 0x%02hhx in position %zu: ordinal not in range(128)",
+                                   data[ascii_count], ascii_count);
+            return nullptr;
+        }
+    }
+    // every byte is a valid latin-1 character
+    return unicode_new_latin1(s->data, s->count, exc_block);
+}
+
+// returns the number of bytes needed to encode count characters as utf-8, and
+// sets *surrogate_index to the index of the first surrogate (which can't be
+// encoded), or -1 if there are none
+template <typename CharT>
+static size_t utf8_encoded_size(const CharT *chars, size_t count, ssize_t *surrogate_index)
+{
+    size_t size = count;
+    *surrogate_index = -1;
+    for (size_t x = 0; x < count; x++)
+    {
+        uint32_t ch = chars[x];
+        size += (ch >= 0x80) + (ch >= 0x800) + (ch >= 0x10000);
+        if (((ch & 0xFFFFF800) == 0xD800) && (*surrogate_index < 0))
+        {
+            *surrogate_index = x;
+        }
+    }
+    return size;
+}
+
+// encodes count characters as utf-8 into dest, which must be large enough.
+// runs of ascii characters are copied (or narrowed) without encoding
+template <typename CharT>
+static void utf8_encode_into(uint8_t *dest, const CharT *chars, size_t count)
+{
+    for (size_t x = 0; x < count;)
+    {
+        uint32_t ch = chars[x];
+        if (ch < 0x80)
+        {
+            size_t ascii_count;
+            if constexpr (sizeof(CharT) == 1)
+            {
+                ascii_count = string_kernel_ascii_prefix(chars + x, count - x);
+                memcpy(dest, chars + x, ascii_count);
+            }
+            else if constexpr (sizeof(CharT) == 2)
+            {
+                ascii_count = string_kernel_narrow_ascii_ucs2(dest, chars + x, count - x);
+            }
+            else
+            {
+                for (ascii_count = 0; (x + ascii_count < count) && (chars[x + ascii_count] < 0x80);
+                     ascii_count++)
+                {
+                    dest[ascii_count] = chars[x + ascii_count];
+                }
+            }
+            dest += ascii_count;
+            x += ascii_count;
+            continue;
+        }
+
+        if (ch < 0x800)
+        {
+            *(dest++) = 0xC0 | (ch >> 6);
+        }
+        else
+        {
+            if (ch < 0x10000)
+            {
+                *(dest++) = 0xE0 | (ch >> 12);
+            }
+            else
+            {
+                *(dest++) = 0xF0 | (ch >> 18);
+                *(dest++) = 0x80 | ((ch >> 12) & 0x3F);
+            }
+            *(dest++) = 0x80 | ((ch >> 6) & 0x3F);
+        }
+        *(dest++) = 0x80 | (ch & 0x3F);
+        x++;
+    }
+}
+
+size_t unicode_utf8_size(const UnicodeObject *s, ssize_t *surrogate_index)
+{
+    ssize_t unused_index;
+    if (!surrogate_index)
+    {
+        surrogate_index = &unused_index;
+    }
+    if (s->kind == UnicodeKind::Latin1)
+    {
+        *surrogate_index = -1;
+        return s->count + string_kernel_count_non_ascii(s->latin1, s->count);
+    }
+    if (s->kind == UnicodeKind::UCS2)
+    {
+        return utf8_encoded_size(s->ucs2, s->count, surrogate_index);
+    }
+    return utf8_encoded_size(s->ucs4, s->count, surrogate_index);
+}
+
+void unicode_write_utf8(uint8_t *dest, const UnicodeObject *s)
+{
+    if (s->kind == UnicodeKind::Latin1)
+    {
+        utf8_encode_into(dest, s->latin1, s->count);
+    }
+    else if (s->kind == UnicodeKind::UCS2)
+    {
+        utf8_encode_into(dest, s->ucs2, s->count);
+    }
+    else
+    {
+        utf8_encode_into(dest, s->ucs4, s->count);
+    }
+}
+
+// returns the way python's error messages show a character that can't be
+// encoded, like '\xe9' or '\u2603'
+static string unicode_char_repr_for_error(uint32_t ch)
+{
+    if (ch < 0x100)
+    {
+        return string_printf("'\\x%02x'", ch);
+    }
+    if (ch < 0x10000)
+    {
+        return string_printf("'\\u%04x'", ch);
+    }
+    return string_printf("'\\U%08x'", ch);
+}
+
+BytesObject *unicode_encode(const UnicodeObject *s, StringCodec codec, string *error,
+                            ExceptionBlock *exc_block)
+{
+    if (codec == StringCodec::UTF8)
+    {
+        ssize_t surrogate_index;
+        size_t size = unicode_utf8_size(s, &surrogate_index);
+        if (surrogate_index >= 0)
+        {
+            *error = string_printf("'utf-8' codec can't encode character %s in position %zd: surrogates not allowed",
+                                   unicode_char_repr_for_error(unicode_read(s, surrogate_index)).c_str(),
+                                   surrogate_index);
+            return nullptr;
+        }
+        if (size == s->count)
+        {
+            return bytes_new(reinterpret_cast<const char *>(s->latin1), s->count, exc_block);
+        }
+        BytesObject *ret = bytes_new(nullptr, size, exc_block);
+        unicode_write_utf8(reinterpret_cast<uint8_t *>(ret->data), s);
+        ret->data[size] = 0;
+        return ret;
+    }
+
+    // ascii and latin-1 both encode characters as single bytes, so the string
+    // must be latin1 and (for ascii) can't have any bytes above 0x7F
+    size_t valid_count = (s->kind != UnicodeKind::Latin1) ? 0
+            : (codec == StringCodec::ASCII) ? string_kernel_ascii_prefix(s->latin1, s->count)
+            : s->count;
+    if (valid_count == s->count)
+    {
+        return bytes_new(reinterpret_cast<const char *>(s->latin1), s->count, exc_block);
+    }
+    uint32_t limit = (codec == StringCodec::ASCII) ? 0x80 : 0x100;
+    for (; unicode_read(s, valid_count) < limit; valid_count++)
+    {}
+    *error = string_printf("'%s' codec can't encode character %s in position %zu: ordinal not in range(%" PRIu32 ")",
+                           string_codec_name(codec),
+                           unicode_char_repr_for_error(unicode_read(s, valid_count)).c_str(),
+                           valid_count, limit);
+    return nullptr;
 }
@@ -4,33 +4,115 @@
 #include <unordered_map>
 
 #include "../Compiler/Exception.hh"
+#include "List.hh"
+#include "Numbers.hh"
 #include "Reference.hh"
+#include "Slice.hh"
 
 
 // string and bytes objects are null-terminated for convenience (so we can use
 // C standard library functions on them). this means that the number of
-// allocated characters is actually (count + 1).
+// allocated characters is actually (capacity + 1). capacity is usually the same
+// as count; it's only larger for strings that have been appended to in place
+// (see bytes_append and unicode_append).
+
+// hash is 0 until bytes_hash or unicode_hash is first called on the object, and
+// is never 0 after that. strings are immutable once they're visible to python
+// code, except that bytes_append and unicode_append modify strings that only
+// one variable refers to (and reset the hash to 0 when they do this).
+
+// interned strings are the only object with their contents in the intern table
+// (see bytes_intern and unicode_intern), so two different interned objects
+// never have the same contents. this lets equality checks and dict lookups
+// compare pointers instead of contents when both sides are interned.
+
+enum StringFlag
+{
+    Interned = 0x01,
+};
 
 struct BytesObject
 {
     BasicObject basic;
 
     uint64_t count;
+    uint64_t hash;
+    uint64_t flags;
+    uint64_t capacity;
     char data[0];
 
     BytesObject();
 };
 
+// unicode objects store their characters in the narrowest width that can hold
+// all of them, like in python (PEP 393). kind is the number of bytes per
+// character. the kind is always the narrowest one possible (so, for example, a
+// UCS2 string always contains at least one character above 0xFF); this means
+// equal strings always have the same kind, so they can be compared and hashed
+// as raw bytes. every function that creates a unicode object must preserve
+// this, usually by calling unicode_kind_for_char on the largest character.
+
+enum UnicodeKind
+{
+    Latin1 = 1,
+    UCS2 = 2,
+    UCS4 = 4,
+};
+
 struct UnicodeObject
 {
     BasicObject basic;
 
     uint64_t count;
-    wchar_t data[0];
+    uint64_t hash;
+    uint32_t flags;
+    uint32_t kind;
+    uint64_t capacity; // in characters, not bytes
+    union
+    {
+        uint8_t latin1[0];
+        uint16_t ucs2[0];
+        uint32_t ucs4[0];
+    };
 
     UnicodeObject();
 };
 
+inline UnicodeKind unicode_kind_for_char(uint32_t ch)
+{
+    if (ch < 0x100)
+    {
+        return UnicodeKind::Latin1;
+    }
+    return (ch < 0x10000) ? UnicodeKind::UCS2 : UnicodeKind::UCS4;
+}
+
+inline uint32_t unicode_read(const UnicodeObject *s, size_t index)
+{
+    if (s->kind == UnicodeKind::Latin1)
+    {
+        return s->latin1[index];
+    }
+    return (s->kind == UnicodeKind::UCS2) ? s->ucs2[index] : s->ucs4[index];
+}
+
+// ch must fit in s's kind
+inline void unicode_write(UnicodeObject *s, size_t index, uint32_t ch)
+{
+    if (s->kind == UnicodeKind::Latin1)
+    {
+        s->latin1[index] = ch;
+    }
+    else if (s->kind == UnicodeKind::UCS2)
+    {
+        s->ucs2[index] = ch;
+    }
+    else
+    {
+        s->ucs4[index] = ch;
+    }
+}
+
 
 BytesObject *bytes_new(const char *data, ssize_t count,
                        ExceptionBlock *exc_block = nullptr);
@@ -40,6 +122,14 @@ BytesObject *bytes_from_cxx_string(const std::string &data);
 BytesObject *bytes_concat(const BytesObject *a, const BytesObject *b,
                           ExceptionBlock *exc_block = nullptr);
 
+// implements `x = x + b` (and `x += b`) where slot points to x and a is the
+// value x had before b was evaluated. if x still refers to a and nothing else
+// does, a is extended in place (with geometric growth, so building a string
+// this way in a loop takes linear time); otherwise x is replaced with a new
+// string. this takes ownership of the caller's references to a and b.
+void bytes_append(BytesObject **slot, BytesObject *a, BytesObject *b,
+                  ExceptionBlock *exc_block = nullptr);
+
 char bytes_at(const BytesObject *s, size_t which,
               ExceptionBlock *exc_block = nullptr);
 
@@ -47,20 +137,88 @@ size_t bytes_length(const BytesObject *s);
 
 bool bytes_equal(const BytesObject *a, const BytesObject *b);
 
+uint64_t bytes_hash(const BytesObject *s);
+
 int64_t bytes_compare(const BytesObject *a, const BytesObject *b);
 
 bool bytes_contains(const BytesObject *needle, const BytesObject *haystack);
 
+// takes ownership of the caller's reference to s and returns a new reference to
+// the interned object with the same contents (which may be s itself). interned
+// objects are never freed, since the intern table holds a reference to each
+BytesObject *bytes_intern(BytesObject *s, ExceptionBlock *exc_block = nullptr);
+
 std::string bytes_to_cxx_string(const BytesObject *s);
 
+// these implement slicing (s[start:end:step]), with omitted bounds passed as
+// slice_index_missing. a slice that covers all of s is a new reference to s
+// rather than a copy, since strings are immutable. they don't consume any
+// references
+BytesObject *bytes_slice(BytesObject *s, int64_t start, int64_t end, int64_t step,
+                         ExceptionBlock *exc_block = nullptr);
+
+// these implement the bytes methods of the same names. they don't consume any
+// references. if sep is null, split splits on runs of whitespace
+int64_t bytes_find(const BytesObject *s, const BytesObject *sub);
+
+int64_t bytes_count(const BytesObject *s, const BytesObject *sub);
+
+bool bytes_startswith(const BytesObject *s, const BytesObject *prefix);
+
+bool bytes_endswith(const BytesObject *s, const BytesObject *suffix);
+
+BytesObject *bytes_strip(const BytesObject *s, bool left, bool right,
+                         ExceptionBlock *exc_block = nullptr);
+
+BytesObject *bytes_lower(const BytesObject *s, ExceptionBlock *exc_block = nullptr);
+
+BytesObject *bytes_upper(const BytesObject *s, ExceptionBlock *exc_block = nullptr);
+
+BytesObject *bytes_replace(const BytesObject *s, const BytesObject *old,
+                           const BytesObject *new_s, ExceptionBlock *exc_block = nullptr);
+
+ListObject *bytes_split(const BytesObject *s, const BytesObject *sep,
+                        ExceptionBlock *exc_block = nullptr);
+
+// items must be a list of Bytes objects
+BytesObject *bytes_join(const BytesObject *sep, const ListObject *items,
+                        ExceptionBlock *exc_block = nullptr);
+
+// these parse the contents like int() and float() do; surrounding whitespace
+// is ignored. they don't consume any references
+ParseNumberResult bytes_parse_int(const BytesObject *s, int64_t base, int64_t *value);
+
+ParseNumberResult bytes_parse_float(const BytesObject *s, double *value);
+
+// chooses the narrowest kind that can hold all the characters in data
 UnicodeObject *unicode_new(const wchar_t *data, ssize_t count,
                            ExceptionBlock *exc_block = nullptr);
 
+UnicodeObject *unicode_new_latin1(const char *data, ssize_t count,
+                                  ExceptionBlock *exc_block = nullptr);
+
+// the characters are not initialized (except the terminating null), so the
+// caller must fill them in, and must choose the kind that the contents need
+UnicodeObject *unicode_new_with_kind(UnicodeKind kind, size_t count,
+                                     ExceptionBlock *exc_block = nullptr);
+
 UnicodeObject *unicode_from_cxx_wstring(const std::wstring &data);
 
+// these fill in the characters of a string from unicode_new_with_kind. the
+// string's kind must be at least as wide as the characters being written
+void unicode_write_latin1(UnicodeObject *s, size_t offset, const char *data,
+                          size_t count);
+void unicode_copy_range(UnicodeObject *dest, size_t dest_offset,
+                        const UnicodeObject *src, size_t src_offset, size_t count);
+
 UnicodeObject *unicode_concat(const UnicodeObject *a, const UnicodeObject *b,
                               ExceptionBlock *exc_block = nullptr);
 
+// like bytes_append. the string can only be extended in place if b's kind is
+// no wider than its own
+void unicode_append(UnicodeObject **slot, UnicodeObject *a, UnicodeObject *b,
+                    ExceptionBlock *exc_block = nullptr);
+
 wchar_t unicode_at(const UnicodeObject *s, size_t which,
                    ExceptionBlock *exc_block = nullptr);
 
@@ -68,12 +226,60 @@ size_t unicode_length(const UnicodeObject *s);
 
 bool unicode_equal(const UnicodeObject *a, const UnicodeObject *b);
 
+uint64_t unicode_hash(const UnicodeObject *s);
+
 int64_t unicode_compare(const UnicodeObject *a, const UnicodeObject *b);
 
 bool unicode_contains(const UnicodeObject *needle, const UnicodeObject *haystack);
 
+UnicodeObject *unicode_intern(UnicodeObject *s,
+                              ExceptionBlock *exc_block = nullptr);
+
 std::wstring unicode_to_cxx_wstring(const UnicodeObject *s);
 
+// returns true if all the characters are ASCII, in which case the latin1
+// data can be used as a C string
+bool unicode_is_ascii(const UnicodeObject *s);
+
+// returns a new object with count characters of s starting at start, in the
+// narrowest kind that can hold them
+UnicodeObject *unicode_substring(const UnicodeObject *s, size_t start, size_t count,
+                                 ExceptionBlock *exc_block = nullptr);
+
+UnicodeObject *unicode_slice(UnicodeObject *s, int64_t start, int64_t end, int64_t step,
+                             ExceptionBlock *exc_block = nullptr);
+
+// these implement the str methods of the same names, like the bytes functions
+// above
+int64_t unicode_find(const UnicodeObject *s, const UnicodeObject *sub);
+
+int64_t unicode_count(const UnicodeObject *s, const UnicodeObject *sub);
+
+bool unicode_startswith(const UnicodeObject *s, const UnicodeObject *prefix);
+
+bool unicode_endswith(const UnicodeObject *s, const UnicodeObject *suffix);
+
+UnicodeObject *unicode_strip(const UnicodeObject *s, bool left, bool right,
+                             ExceptionBlock *exc_block = nullptr);
+
+UnicodeObject *unicode_lower(const UnicodeObject *s, ExceptionBlock *exc_block = nullptr);
+
+UnicodeObject *unicode_upper(const UnicodeObject *s, ExceptionBlock *exc_block = nullptr);
+
+UnicodeObject *unicode_replace(const UnicodeObject *s, const UnicodeObject *old,
+                               const UnicodeObject *new_s, ExceptionBlock *exc_block = nullptr);
+
+ListObject *unicode_split(const UnicodeObject *s, const UnicodeObject *sep,
+                          ExceptionBlock *exc_block = nullptr);
+
+// items must be a list of Unicode objects
+UnicodeObject *unicode_join(const UnicodeObject *sep, const ListObject *items,
+                            ExceptionBlock *exc_block = nullptr);
+
+ParseNumberResult unicode_parse_int(const UnicodeObject *s, int64_t base, int64_t *value);
+
+ParseNumberResult unicode_parse_float(const UnicodeObject *s, double *value);
+
 BytesObject *unicode_encode_ascii(const UnicodeObject *s);
 
 BytesObject *unicode_encode_ascii(const wchar_t *s, ssize_t size = -1);
@@ -81,3 +287,36 @@ BytesObject *unicode_encode_ascii(const wchar_t *s, ssize_t size = -1);
 UnicodeObject *bytes_decode_ascii(const BytesObject *s);
 
 UnicodeObject *bytes_decode_ascii(const char *s, ssize_t size = -1);
+
+// the codecs that bytes.decode and str.encode support
+enum class StringCodec
+{
+    Unknown = 0,
+    UTF8,
+    ASCII,
+    Latin1,
+};
+
+StringCodec string_codec_for_name(const UnicodeObject *name);
+
+// these implement bytes.decode and str.encode. if the text can't be converted,
+// they return nullptr and set *error to the message that python would use;
+// the caller should raise UnicodeDecodeError or UnicodeEncodeError with it.
+// they don't consume any references
+UnicodeObject *bytes_decode(const BytesObject *s, StringCodec codec, std::string *error,
+                            ExceptionBlock *exc_block = nullptr);
+
+BytesObject *unicode_encode(const UnicodeObject *s, StringCodec codec, std::string *error,
+                            ExceptionBlock *exc_block = nullptr);
+
+UnicodeObject *bytes_decode_utf8(const char *data, size_t size, std::string *error,
+                                 ExceptionBlock *exc_block = nullptr);
+
+// returns the size of s encoded as utf-8, and sets *surrogate_index (if
+// given) to the index of the first surrogate in s, or -1 if there are none.
+// unicode_encode refuses to encode surrogates, but unicode_write_utf8 encodes
+// them like any other character, which is what print() does
+size_t unicode_utf8_size(const UnicodeObject *s, ssize_t *surrogate_index = nullptr);
+
+// dest must have room for unicode_utf8_size(s) bytes
+void unicode_write_utf8(uint8_t *dest, const UnicodeObject *s);
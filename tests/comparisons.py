@@ -48,3 +48,46 @@ do_comparisons(2, 3)
 do_comparisons(2.0, 3)
 do_comparisons(2, 3.0)
 do_comparisons(2.0, 3.0)
+
+# comparisons used as conditions branch directly instead of producing a bool
+def do_branch_comparisons(a, b):
+  if a < b:
+    print('  ' + repr(a) + ' < ' + repr(b))
+  if a > b:
+    print('  ' + repr(a) + ' > ' + repr(b))
+  if a <= b and a >= b:
+    print('  ' + repr(a) + ' <= and >= ' + repr(b))
+  if a == b or a != b:
+    print('  ' + repr(a) + ' == or != ' + repr(b))
+  if a == b:
+    print('  ' + repr(a) + ' == ' + repr(b))
+  elif a != b:
+    print('  ' + repr(a) + ' != ' + repr(b))
+
+print('branches')
+do_branch_comparisons(2, 3)
+do_branch_comparisons(3, 3)
+do_branch_comparisons(2.0, 3)
+do_branch_comparisons(3, 2.0)
+do_branch_comparisons(2.5, 2.5)
+do_branch_comparisons(unicode_aa, unicode_bb)
+
+# nan compares unequal (and unordered) to everything, including itself
+def do_nan_branches(nan):
+  if nan == nan:
+    print('  nan == nan')
+  if nan != nan:
+    print('  nan != nan')
+  if nan < 1.0 or nan >= 1.0:
+    print('  nan is ordered')
+do_nan_branches(float('nan'))
+
+def count_range(start, limit):
+  i = start
+  count = 0
+  while i <= limit:
+    if i < 10 and i != 5 or i > 90:
+      count = count + 1
+    i = i + 1
+  return count
+print(count_range(0, 100))
@@ -0,0 +1,176 @@
+import sys
+
+def count_words(words):
+  counts = {'a': 0, 'b': 0, 'c': 0}
+  total = 0
+  for w in words:
+    if w in counts:
+      total = total + counts[w] + 1
+  return total
+
+def lookup(k):
+  d = {1: 10, 2: 20, 3: 30}
+  if k in d:
+    return d[k]
+  return -1
+
+def missing(k):
+  d = {1: 'one', 2: 'two'}
+  ret = 'missing'
+  try:
+    ret = d[k]
+  except KeyError:
+    pass
+  return ret
+
+def squares(keys):
+  d = {0: 0, 1: 1, 2: 4, 3: 9, 4: 16, 5: 25, 6: 36, 7: 49, 8: 64, 9: 81,
+       10: 100, 11: 121, 12: 144, 13: 169, 14: 196, 15: 225, 16: 256, 17: 289,
+       18: 324, 19: 361, 20: 400}
+  total = 0
+  for x in keys:
+    if x not in d:
+      total = total - 1
+    else:
+      total = total + d[x]
+  return total
+
+def strings(a, b):
+  d = {'ab': 1, 'abc': 2, 'x': 3}
+  return d[a + b] * 10 + len(b)
+
+def computed_keys(a, b):
+  d = {a: 'first', b: 'second', a + b: 'third'}
+  return d[b] + ' ' + d[a + b]
+
+def key_order():
+  d = {'pear': 1, 'apple': 2, 'fig': 3, 'banana': 4, 'cherry': 5}
+  ret = ''
+  for k in d:
+    ret = ret + k + ' '
+  return ret
+
+def int_key_order():
+  d = {30: 0, 10: 0, 20: 0, 40: 0, 5: 0}
+  total = 0
+  for k in d:
+    total = total * 100 + k
+  return total
+
+def comprehension_squares(n):
+  d = {x: x * x for x in n}
+  return d[3] + len(d)
+
+def comprehension_filtered(words):
+  return len({w: len(w) for w in words if len(w) > 2})
+
+def comprehension_lookup(words, k):
+  d = {w + '!': w for w in words}
+  return d[k]
+
+def comprehension_order():
+  d = {w + w: w for w in ['pear', 'apple', 'fig', 'apple']}
+  ret = ''
+  for k in d:
+    ret = ret + k + ' '
+  return ret
+
+def interned_lookup(words, k):
+  d = {sys.intern(w + w): w for w in words}
+  return d[k]
+
+def interned_contains(words, k):
+  d = {sys.intern(w + w): w for w in words}
+  return k in d
+
+print(count_words(['a', 'x', 'c', 'c']))
+print(lookup(2))
+print(lookup(5))
+print(missing(2))
+print(missing(3))
+print(squares([0, 5, 10, 15, 20, 25, 30, 35]))
+print(strings('a', 'b'))
+print(strings('ab', 'c'))
+print(computed_keys(3, 4))
+print(computed_keys(5, 5))
+print(key_order())
+print(int_key_order())
+print(comprehension_squares([1, 2, 3, 4]))
+print(comprehension_filtered(['a', 'abc', 'hello', 'xy']))
+print(comprehension_lookup(['a', 'b'], 'b!'))
+print(comprehension_order())
+print(interned_lookup(['cd', 'ab', 'xyz'], sys.intern('a' + 'bab')))
+print(interned_lookup(['cd', 'ab', 'xyz'], 'xyz' + 'xyz'))
+print(interned_contains(['cd', 'ab'], sys.intern('cdc' + 'd')))
+print(interned_contains(['cd', 'ab'], sys.intern('ab' + 'ba')))
+print(interned_contains(['cd', 'ab'], 'abab'))
+print(sys.intern('x' + 'y') == sys.intern('xy'))
+print(sys.intern('x' + 'y') == sys.intern('yx'))
+floats = {x: 1.5 * x for x in (1, 3)}
+print(floats[3])
+keys = {k: k for k in {'p': 1, 'q': 2}}
+print(keys['q'])
+
+def checked_value(x:int) -> str:
+  if x > 2:
+    raise ValueError('too big')
+  return 'v' + repr(x)
+
+def partial_dict(x:int) -> int:
+  n = 0
+  try:
+    n = len({'a': checked_value(1), 'b': checked_value(2), checked_value(x): 'c'})
+  except ValueError:
+    n = -1
+  return n
+
+print(partial_dict(1))
+print(partial_dict(3))
+
+# dicts that start empty get their key and value types from item assignments
+counts = {}
+counts['a'] = 1
+counts['b'] = 2
+counts['a'] = 3
+print(counts['a'] + counts['b'])
+print(len(counts))
+item_squares = {}
+item_squares[1] = 2
+print(item_squares[1])
+
+# item assignments change dicts that started with known contents too
+grown = {'z': 0}
+grown['a'] = 1
+if 'a' in grown:
+  print('a was added')
+else:
+  print('a was not added')
+print('a' in grown)
+
+def next_key(x):
+  return x + 1
+
+item_squares[next_key(1)] = 4
+print(item_squares[2])
+
+def tally(n:int) -> int:
+  seen = {}
+  for w in ['x', 'yy', 'x', 'zzz']:
+    seen[w] = len(w) * n
+  return len(seen) * 100 + seen['zzz']
+
+print(tally(2))
+never_filled = {}
+print(len(never_filled))
+
+# reading from dicts whose contents aren't known gives the dict's value type
+doubled = {dk: dk * 2 for dk in [1, 2, 3]}
+total = 0
+total = total + doubled[2]
+counts['c'] = 10
+total = total + counts['c']
+print(total)
+shared_table = {'a': 1}
+same_table = shared_table
+same_table['a'] = 5
+print(shared_table['a'])
@@ -0,0 +1,69 @@
+# long if/elif chains that compare a variable against constants are compiled
+# as jump tables (dense values) or binary searches (sparse values)
+
+def dense(op):
+  if op == 1:
+    return 'one'
+  elif op == 2:
+    return 'two'
+  elif op == 4:
+    return 'four'
+  elif op == 3:
+    return 'three'
+  elif op == 6:
+    return 'six'
+  else:
+    return 'other'
+
+def sparse(op):
+  if op == -1000:
+    return 'minus one thousand'
+  elif op == 7:
+    return 'seven'
+  elif 100 == op:
+    return 'one hundred'
+  elif op == 12345:
+    return 'twelve thousand three hundred forty-five'
+  elif op == 0:
+    return 'zero'
+  elif op == 99999:
+    return 'ninety-nine thousand nine hundred ninety-nine'
+  elif op == -5:
+    return 'minus five'
+  elif op == 2000000000:
+    return 'two billion'
+  return 'other'
+
+def no_else(op):
+  if op == 10:
+    print('ten')
+  elif op == 11:
+    print('eleven')
+  elif op == 12:
+    print('twelve')
+  elif op == 13:
+    print('thirteen')
+  print('done with ' + repr(op))
+
+x = -2
+while x < 8:
+  print(repr(x) + ': ' + dense(x))
+  x = x + 1
+
+print(sparse(-1001))
+print(sparse(-1000))
+print(sparse(-5))
+print(sparse(-4))
+print(sparse(0))
+print(sparse(7))
+print(sparse(8))
+print(sparse(100))
+print(sparse(12345))
+print(sparse(99999))
+print(sparse(2000000000))
+print(sparse(3000000000))
+
+x = 9
+while x < 15:
+  no_else(x)
+  x = x + 1
@@ -11,3 +11,84 @@ try:
   print('somehow managed to close ridiculous fd')
 except OSError as e:
   print('can\'t close ridiculous fd; errno=' + repr(e.errno) + ' (' + posix.strerror(e.errno) + ')')
+
+# int() and float() accept python's number syntax, with surrounding whitespace
+print(int('  -1_234_567 \n'))
+print(int(b'12345678901234567'))
+print(int('0x1F', 16))
+print(int('0b101', 0))
+print(int('zz', 36))
+print(int('-9223372036854775808'))
+print(float(' 2.5e-3 '))
+print(float(b'-1_000.25'))
+print(float('0.1'))
+print(float('1e400'))
+print(float('-infinity'))
+print(float('123456789012345678901234567890'))
+print(float('2.2250738585072011e-308'))
+# decimal digits from other scripts count too
+print(int(chr(0x663)))
+print(float(chr(0x663) + '.' + chr(0x665)))
+print(int(' -' + chr(0x9EA) + chr(0x9E8) + ' '))
+print(int(chr(0xFF11) + chr(0xFF10), 16))
+
+def try_int(s, base):
+  try:
+    print(int(s, base))
+  except ValueError:
+    print('ValueError')
+  except OverflowError:
+    print('OverflowError')
+
+try_int('010', 0)
+try_int('1__0', 10)
+try_int('0x', 16)
+try_int('12', 1)
+try_int(chr(0xB2), 10)
+
+try:
+  print(float('1.2.3'))
+except ValueError:
+  print('can\'t convert \'1.2.3\' to a float')
+
+# method calls need to know the object's type, so these can't be in a function
+try:
+  print(b'\xff'.decode())
+except UnicodeDecodeError:
+  print('invalid start byte')
+try:
+  print(b'abc\xe2\x98'.decode('utf-8'))
+except UnicodeDecodeError:
+  print('unexpected end of data')
+try:
+  print(b'\xed\xa0\x80'.decode('utf-8'))
+except UnicodeDecodeError:
+  print('encoded surrogate')
+try:
+  print(b'\xc0\xaf'.decode('utf-8'))
+except UnicodeDecodeError:
+  print('overlong sequence')
+try:
+  print(b'\xf4\x90\x80\x80'.decode('utf-8'))
+except UnicodeDecodeError:
+  print('character out of range')
+try:
+  print(b'caf\xe9'.decode('ascii'))
+except UnicodeDecodeError:
+  print('not ascii')
+try:
+  print(repr('caf\xe9'.encode('ascii')))
+except UnicodeEncodeError:
+  print('can\'t encode as ascii')
+try:
+  print(repr('\u2603'.encode('latin-1')))
+except UnicodeEncodeError:
+  print('can\'t encode as latin-1')
+try:
+  print(repr(chr(0xd800).encode()))
+except UnicodeEncodeError:
+  print('can\'t encode a surrogate')
+try:
+  print(b'abc'.decode('not-a-codec'))
+except LookupError:
+  print('unknown encoding')
@@ -33,3 +33,40 @@ print("Int // Int = Int: %d" % (7 // 5))
 print("Int // Float = Float: %g" % (7 // 5.0))
 print("Float // Int = Float: %g" % (7.0 // 5))
 print("Float // Float = Float: %g" % (7.0 // 5.0))
+
+# test chained float expressions, including ones that may be contracted into
+# fused multiply-adds (the values here are exact either way)
+def horner(x):
+  return ((2.5 * x + 1.25) * x - 0.5) * x + 3.0
+
+def mixed(x, n):
+  return 2 * x + n
+
+def sub_product(a, b, c):
+  return c - a * b
+
+def div_chain(a, b):
+  return (a + b) / (a - b) * 2.0
+
+print("horner(2) should be 27: %g" % horner(2.0))
+print("horner(-1.5) should be -1.875: %g" % horner(-1.5))
+print("mixed(1.5, 3) should be 6: %g" % mixed(1.5, 3))
+print("sub_product(1.5, 2, 10) should be 7: %g" % sub_product(1.5, 2.0, 10.0))
+print("div_chain(3, 1) should be 4: %g" % div_chain(3.0, 1.0))
+
+# floats are printed with the shortest text that reads back as the same value
+print(0.1)
+print(0.1 + 0.2)
+print(1.0)
+print(-2.5)
+print(1 / 3)
+print(1e15)
+print(1e16)
+print(0.0001)
+print(0.00001)
+print(2.0 ** 70)
+print(repr(123.456))
+print(repr(5e-324))
+print(repr(1.7976931348623157e308))
+print(-0.0)
+print("%10.3f|%-10.2e|%+g|%G" % (3.14159, 12345.678, 2.5, 1e-10))
@@ -18,3 +18,20 @@ print("hex(a) should be 0x204: " + hex(a))
 print("hex(b) should be 0x404: " + hex(b))
 print("'%%o' %% a should be 0o1004: %o" % a)
 print("'%%o' %% b should be 0o2004: %o" % b)
+print("'%%#o' %% a should be 0o1004: %#o" % a)
+print("'%%x' %% (a - b) should be -200: %x" % (a - b))
+print("'%%#06X' %% a should be 0X0204: %#06X" % a)
+print("'%%+.5d' %% a should be +00516: %+.5d" % a)
+print("'%%-6d|' %% a should be 516   |: %-6d|" % a)
+
+# the extremes of the 64-bit range
+smallest = -9223372036854775807 - 1
+print(smallest)
+print(9223372036854775807)
+print(repr(smallest))
+print(bin(smallest))
+print(oct(smallest))
+print(hex(smallest))
+print(hex(0x123456789ABCDEF0))
+print(bin(-5))
+print(oct(0))
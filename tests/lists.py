@@ -24,3 +24,225 @@ for y in b:
   print(y)
 else:
   print('done')
+
+# list comprehensions. without an if clause, the result is allocated at its
+# final size; with one, it grows as items are added
+def squares_of(n):
+  return [v * v for v in n]
+
+def long_words(words):
+  return [w + '!' for w in words if len(w) > 3]
+
+def halves(n):
+  return [v / 2 for v in n]
+
+def show_items(l):
+  for item in l:
+    print(item)
+
+squares = squares_of([1, 2, 3, 4, 5])
+print(len(squares))
+show_items(squares)
+show_items(long_words(['a', 'cherry', 'kiwi', 'fig', 'banana', 'plum', 'pear', 'grapefruit']))
+show_items(halves([1.0, 3.0, 4.5]))
+show_items([t + 1 for t in (10, 20, 30)])
+show_items([len(k) for k in {'one': 1, 'three': 3}])
+nested = [[s, s * 10] for s in [1, 4, 9, 16, 25] if s % 2 == 1]
+print(len(nested))
+print(nested[2][1])
+# indexing a comprehension's result gives its item type
+cubes = [cb * cb * cb for cb in [1, 2, 3]]
+odd_cubes = [cb for cb in cubes if cb % 2 == 1]
+item_total = 0
+item_total = item_total + cubes[2] + odd_cubes[-1]
+print(item_total)
+nested_total = 0
+nested_total = nested_total + nested[1][0]
+print(nested_total)
+print(len([q for q in [1, -2, 3, -4, 5, -6, 7, -8, 9, -10, 11, -12, 13, -14, 15, -16, 17] if q > 0]))
+
+# slices and slice assignment
+numbers = [1, 2, 3, 4, 5, 6, 7, 8]
+show_items(numbers[2:5])
+show_items(numbers[::-3])
+print(len(numbers[10:]))
+words = ['alpha', 'beta', 'gamma', 'delta']
+show_items(words[1:3])
+numbers[1:3] = [20, 30, 40]
+show_items(numbers)
+numbers[2:] = []
+print(len(numbers))
+numbers[0:0] = [7, 8]
+show_items(numbers)
+numbers[::2] = [0, 0]
+show_items(numbers)
+numbers[:] = numbers
+print(len(numbers))
+words[::2] = ['one', 'two']
+show_items(words)
+try:
+  numbers[::2] = [1, 2, 3, 4, 5]
+except ValueError:
+  print('attempt to assign sequence of size 5 to extended slice of size 2')
+sliced = [1, 2]
+sliced[0:1] = [9]
+if sliced[0] == 9:
+  print('sliced[0] was changed')
+else:
+  print('sliced[0] was not changed')
+
+def slice_start(x):
+  return x - 1
+
+sliced[slice_start(1):3] = [4]
+show_items(sliced)
+sliced[slice_start(1):slice_start(2):slice_start(2)] = [5]
+show_items(sliced)
+
+# item assignment
+numbers[0] = 100
+numbers[-1] = 200
+show_items(numbers)
+words[1] = 'three'
+show_items(words)
+try:
+  numbers[10] = 1
+except IndexError:
+  print('list assignment index out of range')
+assigned = [1, 2]
+assigned[0] = 5
+if assigned[0] == 5:
+  print('assigned[0] was changed')
+else:
+  print('assigned[0] was not changed')
+
+def next_index(x):
+  return x + 1
+
+assigned[next_index(0)] = 6
+print(assigned[1])
+
+# sorting. Int and Float lists use a radix sort (or insertion sort if they're
+# short), and Bytes and Unicode lists use a merge sort
+ints = [5, -3, 9, 0, 1000000000000, -7, 5, 2]
+show_items(sorted(ints))
+show_items(sorted(ints, reverse=True))
+print(ints[0])
+ints.sort()
+print(ints[0])
+floats = [2.5, -0.0, 1.0, 0.0, -3.25, 1e300, -1e-300]
+show_items(sorted(floats))
+floats.sort(reverse=True)
+show_items(floats)
+names = ['pear', 'Apple', 'fig', 'apple', 'caf\xe9', 'cafe', '☃']
+show_items(sorted(names))
+show_items(sorted(names, reverse=True))
+raw = [b'b', b'a', b'\xff', b'ab']
+raw.sort()
+for r in raw:
+  print(repr(r))
+
+def is_sorted(l):
+  prev = l[0]
+  for item in l:
+    if item < prev:
+      return False
+    prev = item
+  return True
+
+many_ints = [(x * 7919) % 1009 - 500 for x in [1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40, 41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, 52, 53, 54, 55, 56, 57, 58, 59, 60, 61, 62, 63, 64, 65, 66, 67, 68, 69, 70]]
+sorted_ints = sorted(many_ints)
+print(sorted_ints[0])
+print(sorted_ints[69])
+print(is_sorted(sorted_ints))
+many_floats = [v / 8.0 for v in many_ints]
+many_floats.sort()
+print(many_floats[0])
+print(is_sorted(many_floats))
+many_words = [w + 'x' for w in ['q', 'b', 'z', 'a', 'm', 'c', 'y', 'd', 'k', 'e', 'o', 'f', 'r', 'g', 's', 'h', 't', 'i', 'u', 'j', 'p', 'l', 'v', 'n', 'w']]
+many_words.sort(reverse=True)
+print(many_words[0])
+print(many_words[24])
+
+print('extend, concatenation and repetition')
+ext = [1, 2]
+ext.extend([3, 4, 5])
+show_items(ext)
+ext.extend(ext)
+print(len(ext))
+print(ext[9])
+alias = ext
+alias += [6]
+print(len(ext))
+# the list is read before the right side, so it's the one that gets extended
+def rebind_extended():
+  global extended
+  extended = [9, 9]
+  return [3]
+extended = [1, 2]
+extended_alias = extended
+extended += rebind_extended()
+print(len(extended))
+print(len(extended_alias))
+joined = ext + [7, 8]
+print(len(joined))
+print(len(ext))
+print(joined[12])
+words = ['a', 'b'] + ['c']
+words.extend(['d'])
+show_items(words)
+print(len([] + words))
+print(len(words + []))
+repeated = ['ab', 'cd'] * 3
+show_items(repeated)
+print(len(3 * [0.5]))
+print(len([1, 2] * 0))
+print(len([1, 2] * -4))
+stack = [0]
+for n in many_ints:
+  stack.append(n)
+print(len(stack))
+print(stack[70])
+
+print('pop')
+popped = [0, 1, 2]
+popped.pop()
+print(len(popped))
+last = popped.pop()
+print(last)
+letters = ['a', 'b', 'c']
+print(letters.pop(0) + letters.pop())
+print(len(letters))
+popped_floats = [1.5, 2.5]
+print(popped_floats.pop() + 1.0)
+try:
+  emptied = [1]
+  emptied.pop()
+  emptied.pop()
+except IndexError:
+  print('pop from empty list')
+# popping most of a large list makes it shrink its storage
+shrinking = [0] * 40
+pop_total = 0
+while len(shrinking) > 3:
+  pop_total = pop_total + shrinking.pop() + 1
+print(pop_total)
+print(len(shrinking))
+shrinking.append(7)
+print(shrinking.pop())
+replaced = [1, 2, 3]
+replaced.pop()
+replaced.append(4)
+if replaced[2] == 3:
+  print('replaced[2] is still 3')
+else:
+  print('replaced[2] was replaced')
+# changes through another reference to the list are seen too
+aliased = [1, 2, 3]
+same_list = aliased
+same_list.pop()
+same_list.append(4)
+if aliased[2] == 3:
+  print('aliased[2] is still 3')
+else:
+  print('aliased[2] was replaced')
@@ -0,0 +1,85 @@
+def dedup_count(a, b, c):
+  s = {a, b, c, a, b}
+  return len(s)
+
+def member(x):
+  primes = {2, 3, 5, 7, 11, 13}
+  if x in primes:
+    return 'prime'
+  return 'not prime'
+
+def names(n):
+  s = {'alpha', 'beta', 'gamma'}
+  return n in s
+
+def not_member(x):
+  return x not in {1, 2, 3}
+
+def ops(a, b):
+  x = {a, a + 1, a + 2, a + 3}
+  y = {b, b + 1, b + 2}
+  u = x | y
+  i = x & y
+  return len(u) * 100 + len(i)
+
+def methods(n):
+  s = {0}
+  i = 1
+  while i < n:
+    s.add(i % 7)
+    i = i + 1
+  s.discard(3)
+  s.discard(100)
+  return len(s)
+
+def iterate():
+  total = 0
+  for x in {5, 10, 15, 10}:
+    total = total + x
+  return total
+
+def strings(a, b):
+  s = {a, b, a + b}
+  t = {b, 'x'}
+  return len(s & t) * 10 + len(s | t)
+
+print(dedup_count(1, 2, 3))
+print(dedup_count(4, 4, 4))
+print(member(7))
+print(member(8))
+print(names('beta'))
+print(names('delta'))
+print(not_member(2))
+print(not_member(5))
+print(ops(1, 3))
+print(ops(10, 100))
+print(methods(50))
+print(iterate())
+print(strings('ab', 'cde'))
+
+def lengths(words):
+  return {len(w) for w in words}
+
+def small_evens(n):
+  return {x for x in n if x % 2 == 0 and x < 10}
+
+print(len(lengths(['a', 'bb', 'cc', 'ddd', 'e'])))
+print(3 in lengths(['a', 'bb', 'cc', 'ddd', 'e']))
+print(len(small_evens([2, 4, 4, 6, 12, 8, 8])))
+print(len({w + w for w in ['x', 'y', 'x']}))
+
+def checked_name(x:int) -> str:
+  if x > 2:
+    raise ValueError('too big')
+  return 'n' + repr(x)
+
+def partial_set(x:int) -> int:
+  n = 0
+  try:
+    n = len({checked_name(1), checked_name(2), checked_name(x)})
+  except ValueError:
+    n = -1
+  return n
+
+print(partial_set(1))
+print(partial_set(3))
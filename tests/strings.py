@@ -0,0 +1,275 @@
+def describe(s):
+  return len(s)
+
+def join3(a, b, c):
+  return a + b + c
+
+latin = 'caf' + chr(233)
+wide = 'snow' + chr(0x2603)
+astral = 'smile' + chr(0x1F600)
+
+print(describe(latin))
+print(describe(wide))
+print(describe(astral))
+print(ord(chr(233)))
+print(ord(chr(0x2603)))
+print(ord(chr(0x1F600)))
+
+# concatenation widens to the widest kind
+mixed = join3(latin, wide, astral)
+print(len(mixed))
+print(mixed == join3('caf' + chr(233), 'snow' + chr(0x2603), 'smile' + chr(0x1F600)))
+print(mixed == join3(latin, wide, 'smile'))
+
+# equal contents built in different ways compare equal
+print(latin == 'caf' + chr(233))
+print(wide == 'snow' + chr(0x2603))
+print(latin == 'cafe')
+
+# ordering compares code points, not bytes
+print(latin < wide)
+print('a' + chr(0xFF) < 'a' + chr(0x100))
+print(chr(0x1F600) > chr(0xFFFF))
+print('abc' < 'abd')
+print('ab' < 'abc')
+
+# containment across kinds
+print('caf' in latin)
+print(chr(0x2603) in mixed)
+print(chr(0x2603) in latin)
+print(chr(233) + 'snow' in mixed)
+print(chr(0x1F600) in wide)
+print('' in wide)
+
+# formatting with strings of different kinds
+print(len('%s/%s' % (latin, wide)))
+print('%s-%d' % ('abc', 12))
+print(('[%s]' % wide) == '[snow' + chr(0x2603) + ']')
+print(repr('plain'))
+
+# searching (long enough to use the vector loops)
+text = 'the quick brown fox jumps over the lazy dog; the end'
+print(text.find('the'))
+print(text.find('lazy dog'))
+print(text.find('cat'))
+print(text.find('d'))
+print(text.count('the'))
+print(text.count('o'))
+print(text.startswith('the quick'))
+print(text.endswith('end'))
+print(text.endswith('the'))
+print(b'0123456789abcdef0123456789xyz'.find(b'xyz'))
+print(b'aaaaaaaaaaaaaaaaaaaaaaaaaaaaaab'.find(b'ab'))
+print(b'abababababababababababab'.count(b'aba'))
+print((wide + 'abc').find('abc'))
+print((wide + 'abc').find(chr(0x2603)))
+
+# splitting and joining
+words = text.split(' ')
+print(len(words))
+print(words[3])
+print('|'.join(words))
+print(len('  lots   of\tspace\nhere   and there               ok  '.split()))
+print('-'.join('  lots   of\tspace\nhere   and there               ok  '.split()))
+print(repr(b','.join(b'a,b,,c'.split(b','))))
+print(len(''.split()))
+print(len(''.split(',')))
+print((chr(0x2603) + ',').join(['x', 'y', 'z']) == 'x' + chr(0x2603) + ',y' + chr(0x2603) + ',z')
+
+# stripping, replacing and changing case
+print('[' + '                    padded on both sides      \n'.strip() + ']')
+print('[' + '   left   '.lstrip() + ']')
+print('[' + '   right   '.rstrip() + ']')
+print(repr(b'\t\tbytes too  '.strip()))
+print(text.replace('the', 'a'))
+print(text.replace(' ', ''))
+print(repr(b'xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx'.replace(b'x', b'yz')))
+print(text.upper())
+print(text.upper().lower() == text)
+print(repr(b'Mixed Case Bytes With Some Length'.lower()))
+print(('caf' + chr(233) + ' au lait').upper() == 'CAF' + chr(201) + ' AU LAIT')
+print(('caf' + chr(233)).upper() == 'CAF' + chr(201))
+print(('stra' + chr(223) + 'e').upper() == 'STRASSE')
+print((chr(304) + 'stanbul').lower() == 'i' + chr(775) + 'stanbul')
+print(chr(0xFB01).upper() == 'FI')
+print((chr(0x3A3) + chr(0x391) + chr(0x3A3)).lower() == chr(0x3C3) + chr(0x3B1) + chr(0x3C2))
+
+# appending to a string variable (in place if nothing else refers to it)
+def build_unicode(n):
+    s = ''
+    i = 0
+    while i < n:
+        s = s + 'ab'
+        i += 1
+    return s
+
+def build_bytes(n):
+    s = b'>'
+    i = 0
+    while i < n:
+        s += b'xyz'
+        i += 1
+    return s
+
+def append_shared():
+    s = 'start'
+    t = s
+    s += '+more'
+    return t + '|' + s
+
+def append_wider():
+    s = 'abc'
+    s += chr(0x2603)
+    s += 'def'
+    s += chr(0x1F600)
+    return s
+
+def append_then_lookup():
+    s = 'key'
+    d = {'keyx': 10, 'key': 20}
+    v = d[s]
+    s += 'x'
+    return v + d[s]
+
+print(len(build_unicode(10000)))
+print(build_unicode(3))
+print(repr(build_bytes(4)))
+print(append_shared())
+print(append_wider() == 'abc' + chr(0x2603) + 'def' + chr(0x1F600))
+print(append_then_lookup())
+
+# x is read before the right side, so reassigning x there doesn't change the result
+def rebind_appended():
+    global appended
+    appended = 'other'
+    return '!'
+
+appended = 'start'
+appended += rebind_appended()
+print(appended)
+appended = appended + rebind_appended()
+print(appended)
+counter = 10
+counter += 5
+counter *= 2
+print(counter)
+
+# formatting with constant formats (parsed at compile time) and other formats
+def describe_count(name, count, ratio):
+    return '%s: %d items (%.1f%%)' % (name, count, ratio)
+
+print(describe_count('apples', 12, 37.5))
+print(describe_count('pears', 3, 9.25))
+print('%5.1f|%-6d|%+d|%05d|%x|%X|%o|%c' % (2.25, 42, 7, -3, 255, 255, 8, 65))
+print('%*d|%-*d|%.*f' % (5, 1, 4, 2, 3, 2.5))
+print('%d is prime' % 17)
+print('nothing to format' % ())
+print(('%c%s' % (0x2603, wide)) == chr(0x2603) + wide)
+print(repr(b'%s=%d' % (b'key', 5)))
+pair = ('x', 10)
+print('%s -> %d' % pair)
+print(('[' + '%s' + ']') % 'built at runtime')
+print('[%5s]' % 'ab')
+print('[%.2s]' % 'abcdef')
+print('[%-6.3s|%3c|%-3c]' % ('abcdef', 97, 98))
+print('[%*s|%*s|%.*s]' % (4, 'x', -4, 'y', 1, 'xyz'))
+print('[%*d|%.*f]' % (-5, 3, -1, 1.5))
+print(repr(b'[%5s|%-4s|%.1s]' % (b'ab', b'c', b'xyz')))
+
+# comparisons, including ones against constants (which are compiled inline)
+def compare_to_constants(s):
+  print(s == 'abc')
+  print(s != 'abc')
+  print('hello, world!' == s)
+  print(s == '')
+  print(s == 'caf\xe9')
+  print(s == '\u2603 snowman \u2603')
+  print(s == 'a longer string that is more than sixteen bytes')
+  if s == 'abc':
+    print('is abc')
+  if s != 'hello, world!':
+    print('not hello')
+
+compare_to_constants('abc')
+compare_to_constants('abd')
+compare_to_constants('ab')
+compare_to_constants('')
+compare_to_constants('hello, world!')
+compare_to_constants('hello, world?')
+compare_to_constants('caf' + chr(233))
+compare_to_constants('\u2603 snowman ' + chr(0x2603))
+compare_to_constants('\u2603 snowman \u2604')
+compare_to_constants('a longer string that is more than sixteen bytes')
+compare_to_constants('a longer string that is more than sixteen byteS')
+
+def compare_bytes_to_constants(b):
+  print(b == b'xyz')
+  print(b != b'\xff\x80\x00\x01\x02\x03\x04\x05\x06')
+  print(b'' == b)
+
+compare_bytes_to_constants(b'xyz')
+compare_bytes_to_constants(b'xy')
+compare_bytes_to_constants(b'\xff\x80\x00\x01\x02\x03\x04\x05\x06')
+compare_bytes_to_constants(b'')
+print(b'\x80' < b'\x01')
+print(b'abcdefghijklmnopqrstuvwxyz1' < b'abcdefghijklmnopqrstuvwxyz2')
+print('b' > 'abc')
+print('\u2603a' < '\u2603b')
+print('caf\xe9' < 'cafe')
+print('xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxa' < 'xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxb')
+
+# utf-8 (and ascii and latin-1) encoding and decoding
+print(b'plain ascii text'.decode())
+print(len(b'caf\xc3\xa9'.decode('utf-8')))
+print(b'caf\xc3\xa9'.decode('utf-8'))
+print(b'\xe2\x98\x83 snowman \xe2\x98\x83'.decode('UTF8'))
+print(len(b'\xf0\x9f\x98\x80!'.decode()))
+print(b'caf\xe9'.decode('latin-1'))
+print(repr('caf\xe9'.encode()))
+print(repr('caf\xe9'.encode('latin_1')))
+print(repr('\u2603 snowman'.encode('utf-8')))
+print(repr('\U0001f600'.encode()))
+print(repr(''.encode()))
+print('\u2603 snowman \u2603' == b'\xe2\x98\x83 snowman \xe2\x98\x83'.decode())
+long_text = 'this line is long enough to go through the 32-byte ascii blocks, then has an accent: caf\xe9, then more ascii text after it'
+print(long_text.encode().decode() == long_text)
+print(len(long_text.encode()))
+wide_text = 'wide text with a snowman (\u2603) in the middle of a long run of ascii characters on both sides'
+print(wide_text.encode().decode() == wide_text)
+print(len(wide_text.encode()))
+
+# non-ascii characters in the source are decoded as utf-8
+print('☃')
+print(len('☃'))
+print('☃' == '\u2603')
+print('café')
+print(len('😀'))
+
+# slices. a slice of the whole string is the same object; other slices are
+# copied, and may have a narrower kind than the original
+sliced_bytes = b'hello world'
+print(repr(sliced_bytes[1:4]))
+print(repr(sliced_bytes[:5]))
+print(repr(sliced_bytes[6:]))
+print(repr(sliced_bytes[::2]))
+print(repr(sliced_bytes[::-1]))
+print(repr(sliced_bytes[-3:]))
+print(repr(sliced_bytes[:]))
+print(repr(sliced_bytes[8:2]))
+print(repr(sliced_bytes[-100:100]))
+sliced_text = 'caf\xe9 \u2603 snow'
+print(sliced_text[:4])
+print(sliced_text[5:6])
+print(sliced_text[7:])
+print(sliced_text[7:] == 'snow')
+print(sliced_text[::-1])
+print(sliced_text[1::3])
+print(len(sliced_text[::2]))
+print('abcdefgh'[2:-2])
+print('abcdefgh'[-1:-9:-2])
+print('\U0001f600 smile'[1:] == ' smile')
+slice_step = 0
+try:
+  print('abcdefgh'[::slice_step])
+except ValueError:
+  print('slice step cannot be zero')
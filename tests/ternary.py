@@ -0,0 +1,57 @@
+def int_max(a, b):
+  return a if a > b else b
+
+def int_min(a, b):
+  return a if a < b else b
+
+def clamp_low(a):
+  return 0 if a < 0 else a
+
+def pick(a, b, c):
+  return 100 if c else -100
+
+def bool_pick(a, b):
+  return True if a == b else False
+
+def float_min(a, b):
+  return a if a < b else b
+
+def float_max(a, b):
+  return a if a > b else b
+
+def float_min_swapped(a, b):
+  return b if a > b else a
+
+def float_max_swapped(a, b):
+  return b if a < b else a
+
+def float_pick(a, b):
+  return 1.5 if a <= b else b
+
+def float_choose(a, b, c):
+  return a if c else b
+
+print(repr(int_max(3, 7)))
+print(repr(int_max(-3, -7)))
+print(repr(int_min(3, 7)))
+print(repr(int_min(5, 5)))
+print(repr(clamp_low(-12)))
+print(repr(clamp_low(12)))
+print(repr(pick(1, 2, 0)))
+print(repr(pick(1, 2, 8)))
+print(repr(bool_pick(4, 4)))
+print(repr(bool_pick(4, 5)))
+print(repr(float_min(1.5, 2.5)))
+print(repr(float_min(2.5, -1.5)))
+print(repr(float_max(1.5, 2.5)))
+print(repr(float_max(2.5, -1.5)))
+print(repr(float_min_swapped(1.5, 2.5)))
+print(repr(float_min_swapped(2.5, -1.5)))
+print(repr(float_max_swapped(1.5, 2.5)))
+print(repr(float_max_swapped(2.5, -1.5)))
+print(repr(float_min(0.0, -0.0)))
+print(repr(float_max(-0.0, 0.0)))
+print(repr(float_pick(1.0, 2.0)))
+print(repr(float_pick(3.0, 2.0)))
+print(repr(float_choose(3.25, 2.0, True)))
+print(repr(float_choose(3.25, 2.0, False)))
@@ -0,0 +1,59 @@
+import __pyjit_array__ as array
+
+# sizes around the vector widths, so both the vector loops and the leftover
+# items are covered
+ints = [(x * 7919) % 1009 - 500 for x in [1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23]]
+small_ints = [3, -1, 4]
+floats = [v * 0.25 for v in ints]
+small_floats = [1.5, -2.0]
+
+print('sum(ints) == %d' % array.sum(ints))
+assert array.sum(ints) == 758
+assert array.sum(small_ints) == 6
+assert array.sum([1, 2, 3, 4, 5, 6, 7, 8]) == 36
+print('sum(floats) == %g' % array.sum(floats))
+assert array.sum(floats) == array.sum(ints) * 0.25
+assert array.sum(small_floats) == -0.5
+
+print('min(ints) == %d, max(ints) == %d' % (array.min(ints), array.max(ints)))
+assert array.min(ints) == -471
+assert array.max(ints) == 476
+assert array.max([5, 9, 2, 9, -4]) == 9
+assert array.min(small_ints) == -1
+assert array.max(small_floats) == 1.5
+assert array.min(floats) == array.min(ints) * 0.25
+
+print('dot(ints, ints) == %d' % array.dot(ints, ints))
+assert array.dot(ints, ints) == 1840120
+assert array.dot([1, 2, 3, 4, 5], [5, 4, 3, 2, 1]) == 35
+assert array.dot(small_floats, [2.0, 0.5]) == 2.0
+
+sums = array.add(ints, ints)
+assert len(sums) == 23
+assert sums[22] == ints[22] * 2
+products = array.mul(ints, ints)
+assert products[17] == ints[17] * ints[17]
+assert array.mul([1.5, 2.0, 3.0, 4.0, 5.0], [2.0, 2.0, 2.0, 2.0, 0.5])[4] == 2.5
+scaled = array.scale(ints, -3)
+assert scaled[5] == ints[5] * -3
+assert array.scale(floats, 4)[9] == ints[9]
+assert array.scale(small_floats, 0.5)[1] == -1.0
+
+prefix = array.cumsum(ints)
+assert prefix[0] == ints[0]
+assert prefix[22] == array.sum(ints)
+assert prefix[10] == 546
+float_prefix = array.cumsum([0.5, 0.25, 0.125, 1.0, 2.0])
+assert float_prefix[4] == 3.875
+
+try:
+  array.dot([1, 2], [1, 2, 3])
+  assert False
+except ValueError:
+  print('dot of different lengths raised ValueError')
+
+try:
+  array.min([1.0][0:0])
+  assert False
+except ValueError:
+  print('min of empty list raised ValueError')
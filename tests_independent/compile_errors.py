@@ -59,3 +59,34 @@ def test_type_annotations():
     assert False
 
 test_type_annotations()
+
+
+# sorted() and list.sort() don't support key functions, and unknown keyword
+# arguments are compile errors rather than being ignored
+def sort_by_length(words):
+  return sorted(words, key=len)
+
+def add_default(x, y=2):
+  return x + y
+
+def call_add_default(x):
+  return add_default(x, z=3)
+
+def test_keyword_arguments():
+  print(add_default(1, y=5))
+
+  try:
+    print(sort_by_length(['ccc', 'a', 'bb']))
+  except PyJitCompilerError as e:
+    print('compiler error at %s:%d - %s' % (e.filename, e.line, e.message))
+  else:
+    assert False
+
+  try:
+    print(call_add_default(1))
+  except PyJitCompilerError as e:
+    print('compiler error at %s:%d - %s' % (e.filename, e.line, e.message))
+  else:
+    assert False
+
+test_keyword_arguments()
@@ -0,0 +1,25 @@
+import __pyjit__
+
+# growing a dict to 10000 items resizes its table about 10 times. each resize
+# has to free the old table, so building the same dict again and again
+# shouldn't use any more memory after the first time
+def build_dict(n):
+  d = {}
+  i = 0
+  while i < n:
+    d[i] = i * 2
+    i += 1
+  return len(d)
+
+assert build_dict(10000) == 10000
+
+heap_before = __pyjit__.heap_used_size()
+rounds = 0
+while rounds < 20:
+  build_dict(10000)
+  rounds += 1
+heap_after = __pyjit__.heap_used_size()
+
+print('heap used before: %d' % heap_before)
+print('heap used after: %d' % heap_after)
+assert heap_after - heap_before < 0x10000